@@ -0,0 +1,225 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       codebuf.c                                                          */
+/*                                                                          */
+/*       Instruction buffer owned by the compiler.  See "codebuf.h".        */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "code.h"
+#include "codebuf.h"
+#include "global.h"
+
+#define INITIAL_CAPACITY 1024
+
+/*--------------------------------------------------------------------------*/
+/*  InitCodeBuffer: Sets up an empty buffer.  Storage is allocated lazily  */
+/*  on the first emit.                                                      */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void InitCodeBuffer(CODEBUF *cb)
+{
+    cb->code = NULL;
+    cb->base = 0;
+    cb->count = 0;
+    cb->capacity = 0;
+    cb->killed = 0;
+    cb->pos = -1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ClearCodeBuffer: Empties the buffer for the next compilation, keeping  */
+/*  its storage.                                                            */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void ClearCodeBuffer(CODEBUF *cb)
+{
+    cb->base = 0;
+    cb->count = 0;
+    cb->killed = 0;
+    cb->pos = -1;
+}
+
+PUBLIC void FreeCodeBuffer(CODEBUF *cb)
+{
+    free(cb->code);
+    InitCodeBuffer(cb);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BufferAddress: Equivalent of CurrentCodeAddress() for the buffer.      */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int BufferAddress(CODEBUF *cb)
+{
+    return cb->base + cb->count;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Append: Adds one instruction to the end of the buffer, growing it by   */
+/*  doubling when full.                                                     */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Reserve(CODEBUF *cb, int count)
+{
+    INSTRUCTION *grown;
+    int newCapacity = cb->capacity;
+
+    if (cb->count + count <= cb->capacity)
+        return;
+    while (cb->count + count > newCapacity)
+        newCapacity = newCapacity == 0 ? INITIAL_CAPACITY : newCapacity * 2;
+    if (NULL == (grown = realloc(cb->code, newCapacity * sizeof(INSTRUCTION))))
+    {
+        fprintf(stderr, "out of memory in code buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    cb->code = grown;
+    cb->capacity = newCapacity;
+}
+
+PRIVATE void Append(CODEBUF *cb, int op, int operand, int hasOperand)
+{
+    Reserve(cb, 1);
+    cb->code[cb->count].op = op;
+    cb->code[cb->count].operand = operand;
+    cb->code[cb->count].hasOperand = hasOperand;
+    cb->code[cb->count].target = NULL;
+    cb->code[cb->count].pos = cb->pos;
+    cb->count++;
+}
+
+PUBLIC void BufferEmit(CODEBUF *cb, int op, int operand)
+{
+    Append(cb, op, operand, 1);
+}
+
+PUBLIC void BufferEmitOp(CODEBUF *cb, int op)
+{
+    Append(cb, op, 0, 0);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BufferAppend: Appends a copy of "count" instructions that were         */
+/*  generated at address "from", which may be code still in the buffer.    */
+/*  Branches to within the copied code, or to just after it, are moved     */
+/*  with it; the rest, and calls, keep their operands.                      */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void BufferAppend(CODEBUF *cb, INSTRUCTION *code, int count, int from)
+{
+    INSTRUCTION *copy;
+    int inside = cb->count > 0 && code >= cb->code && code < cb->code + cb->count;
+    int offset = inside ? code - cb->code : 0, i;
+
+    if (count <= 0)
+        return;
+    Reserve(cb, count);
+    if (inside)
+        code = cb->code + offset;
+    copy = &cb->code[cb->count];
+    memcpy(copy, code, count * sizeof(INSTRUCTION));
+    for (i = 0; i < count; i++)
+    {
+        if (IsBranchOp(copy[i].op) && copy[i].operand >= from && copy[i].operand <= from + count)
+            copy[i].operand += BufferAddress(cb) - from;
+    }
+    cb->count += count;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BufferBackPatch: Equivalent of BackPatch() for the buffer.  Patches    */
+/*  outside the buffer, or to retired code, are ignored, as BackPatch does  */
+/*  after a kill.                                                           */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void BufferBackPatch(CODEBUF *cb, int location, int address)
+{
+    if (location >= cb->base && location < cb->base + cb->count)
+        cb->code[location - cb->base].operand = address;
+}
+
+PUBLIC INSTRUCTION *BufferInstruction(CODEBUF *cb, int location)
+{
+    if (location < cb->base || location >= cb->base + cb->count)
+        return NULL;
+    return &cb->code[location - cb->base];
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BufferTruncate: Drops the instructions from "location" on, for code    */
+/*  generated only to be replaced.  Retired code cannot be dropped.        */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void BufferTruncate(CODEBUF *cb, int location)
+{
+    if (location >= cb->base && location < cb->base + cb->count)
+        cb->count = location - cb->base;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BufferKill: Abandons code generation, both here and in "code.h".       */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void BufferKill(CODEBUF *cb)
+{
+    cb->killed = 1;
+    KillCodeGeneration();
+}
+
+PRIVATE void EmitSink(void *arg, INSTRUCTION *code, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (code[i].hasOperand)
+            Emit(code[i].op, code[i].operand);
+        else
+            _Emit(code[i].op);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FlushCodeBuffer: Hands every buffered instruction to the code          */
+/*  generator, in order, so that its addresses match the buffer's.  The    */
+/*  caller still calls WriteCodeFile() afterwards.  Code retired earlier   */
+/*  must have gone to the code generator too.                               */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void FlushCodeBuffer(CODEBUF *cb)
+{
+    RetireCode(cb, EmitSink, NULL);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  RetireCode: Passes every buffered instruction to "sink" and drops it,  */
+/*  keeping the storage for the code that follows.  The caller must be     */
+/*  sure that no back-patch or fixup still refers to it.                    */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void RetireCode(CODEBUF *cb, CODESINK sink, void *arg)
+{
+    if (cb->count > 0)
+        sink(arg, cb->code, cb->count);
+    cb->base += cb->count;
+    cb->count = 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  IsBranchOp: True for the instructions whose operand is a code address. */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int IsBranchOp(int op)
+{
+    return op == I_BR || op == I_BG || op == I_BL || op == I_BGZ || op == I_BLZ;
+}
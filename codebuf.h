@@ -0,0 +1,64 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       codebuf.h                                                          */
+/*                                                                          */
+/*       Instruction buffer owned by the compiler.  Code generation goes    */
+/*       through this buffer instead of straight to "code.h" so that the    */
+/*       emitted instructions can be inspected, recorded and relocated      */
+/*       before they are handed on to the code generator.                   */
+/*                                                                          */
+/*       Code that nothing can patch any more can be retired from the       */
+/*       front of the buffer, so only the code still being generated is     */
+/*       held in memory.  Addresses stay absolute: "base" is the address    */
+/*       of the first instruction still held.                               */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef CODEBUF_H
+#define CODEBUF_H
+
+#include "global.h"
+
+typedef struct
+{
+    int op;         /*  Opcode, one of the I_ codes in "code.h".    */
+    int operand;    /*  Operand, meaningful if hasOperand is set.   */
+    int hasOperand; /*  1 if emitted with Emit, 0 if with _Emit.    */
+    char *target;   /*  Callee name for I_CALL, NULL otherwise.     */
+    int pos;        /*  Source offset of the statement, or -1.      */
+} INSTRUCTION;
+
+typedef struct
+{
+    INSTRUCTION *code; /*  Instructions not yet retired.            */
+    int base;          /*  Address of code[0].                      */
+    int count;         /*  Instructions held in "code".             */
+    int capacity;      /*  Allocated size of "code".                */
+    int killed;        /*  Set once code generation is abandoned.   */
+    int pos;           /*  Source offset given to new instructions. */
+} CODEBUF;
+
+typedef void (*CODESINK)(void *arg, INSTRUCTION *code, int count);
+
+PUBLIC void InitCodeBuffer(CODEBUF *cb);
+PUBLIC void ClearCodeBuffer(CODEBUF *cb);
+PUBLIC void FreeCodeBuffer(CODEBUF *cb);
+PUBLIC int BufferAddress(CODEBUF *cb);
+PUBLIC void BufferEmit(CODEBUF *cb, int op, int operand);
+PUBLIC void BufferEmitOp(CODEBUF *cb, int op);
+PUBLIC void BufferAppend(CODEBUF *cb, INSTRUCTION *code, int count, int from);
+PUBLIC void BufferTruncate(CODEBUF *cb, int location);
+PUBLIC void BufferBackPatch(CODEBUF *cb, int location, int address);
+PUBLIC INSTRUCTION *BufferInstruction(CODEBUF *cb, int location);
+PUBLIC void BufferKill(CODEBUF *cb);
+PUBLIC void FlushCodeBuffer(CODEBUF *cb);
+PUBLIC void RetireCode(CODEBUF *cb, CODESINK sink, void *arg);
+PUBLIC int IsBranchOp(int op);
+
+#endif
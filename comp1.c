@@ -10,17 +10,44 @@
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include "code.h"
+#include "codebuf.h"
+#include "compcache.h"
+#include "context.h"
+#include "cpl.h"
+#include "cplbin.h"
+#include "cplfuzz.h"
+#include "deadcode.h"
 #include "debug.h"
 #include "global.h"
 #include "line.h"
+#include "listing.h"
+#include "llparse.h"
+#include "lltable.h"
+#include "proccache.h"
 #include "scanner.h"
+#include "serve.h"
 #include "sets.h"
 #include "strtab.h"
 #include "symbol.h"
+#include "tokbuf.h"
+#include "workpool.h"
+
+#define COMPILER_VERSION "comp1 1.4" /*  Part of every compile cache key. */
+#define MAXMANIFESTLINE 3 * 4096
+#define INLINE_LIMIT 16   /*  Longest block --profile inlines.             */
+#define UNROLL_MAX 4      /*  Most copies of a loop --profile makes.       */
+#define UNROLL_LIMIT 64   /*  Longest loop it makes them of, copies included. */
+#define UNROLL_FULL 16    /*  Most passes --unroll unrolls completely.     */
 
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
@@ -28,389 +55,702 @@
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE FILE *InputFile; /*  CPL source comes from here.          */
-PRIVATE FILE *ListFile;  /*  For nicely-formatted syntax errors.  */
-PRIVATE FILE *CodeFile;  /*  This is the output machine code file */
+PRIVATE OPTIONS Options; /*  Fixed once the command line has been read. */
+
+PRIVATE CONTEXT LibraryContext; /*  Kept warm between CompileBuffer calls. */
+PRIVATE int LibraryReady;
+
+typedef struct
+{
+    char *input; /*  Names of the unit's three files.            */
+    char *list;
+    char *code;
+    long size;   /*  Source size, used to schedule big units first. */
+} UNIT;
+
+typedef struct
+{
+    CONTEXT *cx;
+    UNIT *units;
+    int count;
+    int capacity;
+} BATCH;
 
-PRIVATE TOKEN CurrentToken; /*  Parser lookahead token.  Updated by  */
-                            /*  routine Accept (below).  Must be     */
-                            /*  initialised before parser starts.    */
+typedef struct
+{
+    CONTEXT *cx;
+    FILE *held;         /*  Standard output while serving.            */
+    char *code;         /*  Code file of the last request.            */
+    size_t codeLength;
+    char *listing;      /*  Listing of the last request.              */
+    size_t listingLength;
+    char *diagnostics;  /*  Standard output of the last request.      */
+    size_t diagnosticsCapacity;
+} SERVER;
+
+#define UNIT_VALID 0   /*  Status of a unit after CompileBatchUnit.     */
+#define UNIT_INVALID 1
+#define UNIT_UNOPENED 2
+
+/*  ParseNested states.  It starts in PN_BLOCK or PN_EXPRESSION; the     */
+/*  rest are the points in the recursive routines it stands for that a    */
+/*  nested routine returns to, or that loop.  "a", "b" and "c" are the    */
+/*  locals saved in a PARSEFRAME.                                          */
+#define PN_BLOCK 0
+#define PN_EXPRESSION 1
+#define PN_COMPOUNDTERM 2
+#define PN_TERM 3
+#define PN_OPPREC 4          /*  b: minPrec.                            */
+#define PN_STATEMENTS 5      /*  ParseBlock's loop.                     */
+#define PN_STATEMENT_DONE 6  /*  a: ParseStatement's saved position.    */
+#define PN_WHILE_DONE 7      /*  a: position, b: Label1, c: L2 patch.   */
+#define PN_THEN_DONE 8       /*  a: position, b: L1 patch, c: swap.     */
+#define PN_ELSE_DONE 9       /*  a: position, b: L2 patch, c: L1 patch  */
+                             /*  if the arms are to be swapped, or -1.  */
+#define PN_TERMS 10          /*  ParseExpression after its first term.  */
+#define PN_ADDOPS 11         /*  ParseExpression's loop.                */
+#define PN_ADDOP_DONE 12
+#define PN_MULTOPS 13        /*  ParseCompoundTerm's loop.              */
+#define PN_MULTOP_DONE 14
+#define PN_NEGATE 15         /*  a: ParseTerm's negate flag.            */
+#define PN_PARENTHESIS 16    /*  ParseSubTerm's ")".                    */
+#define PN_OPERATORS 17      /*  ParseOpPrec's loop; a: op1, b: minPrec. */
+#define PN_OPERAND_DONE 18   /*  a: op1, b: minPrec.                    */
+#define PN_OPERATOR_DONE 19  /*  a: op1, b: minPrec.                    */
 
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
-/*  Function prototypes                                                     */
+/*  Code generation as the grammar sees it.  Under --check the parser      */
+/*  routines are only a recogniser: EMIT and EMITOP generate nothing,      */
+/*  PatchCode patches nothing, and the symbol table is never touched, so   */
+/*  a check costs no more than scanning and parsing.                        */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE int OpenFiles(int argc, char *argv[]);
-PRIVATE void ParseProgram(void);
-PRIVATE void ParseDeclarations(void);
-PRIVATE void ParseProcDeclaration(void);
-PRIVATE void ParseParameterList(void);
-PRIVATE void ParseFormalParameter(void);
-PRIVATE void ParseBlock(void);
-PRIVATE void ParseStatement(void);
-PRIVATE void ParseSimpleStatement(void);
-PRIVATE void ParseRestOfStatement(SYMBOL *target);
-PRIVATE void ParseProcCallList(SYMBOL *target);
-PRIVATE void ParseAssignment(void);
-PRIVATE void ParseActualParameter(void);
-PRIVATE void ParseWhileStatement(void);
-PRIVATE void ParseIfStatement(void);
-PRIVATE void ParseReadStatement(void);
-PRIVATE void ParseWriteStatement(void);
-PRIVATE void ParseExpression(void);
-PRIVATE void ParseCompoundTerm(void);
-PRIVATE void ParseTerm(void);
-PRIVATE void ParseSubTerm(void);
-PRIVATE int ParseBooleanExpression(void);
-PRIVATE void ParseAddOp(void);
-PRIVATE void ParseMultOp(void);
-PRIVATE int ParseRelOp(void);
-PRIVATE void Accept(int code);
-PRIVATE void MakeSymbolTableEntry(int symtype);
-PRIVATE SYMBOL *LookupSymbol(void);
-PRIVATE void ParseOpPrec(int minPrec);
-PRIVATE void Synchronise(SET *F, SET *FB);
-
-int errCount = 0; /*Int that counts amount of errors received by parser*/
-int scope = 0;    /*Global scope*/
+#define CHECKING(cx) ((cx)->options->Check)
+#define EMIT(cx, op, operand)                               \
+    do                                                      \
+    {                                                       \
+        if (!CHECKING(cx))                                  \
+            BufferEmit(&(cx)->CodeBuffer, (op), (operand)); \
+    } while (0)
+#define EMITOP(cx, op)                            \
+    do                                            \
+    {                                             \
+        if (!CHECKING(cx))                        \
+            BufferEmitOp(&(cx)->CodeBuffer, (op)); \
+    } while (0)
 
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Function prototypes                                                     */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReadSource(CONTEXT *cx);
+#ifndef CPL_LIBRARY
+PRIVATE int ParseOptions(int *argc, char *argv[]);
+PRIVATE int OpenFiles(CONTEXT *cx, int argc, char *argv[]);
+PRIVATE int OpenUnit(CONTEXT *cx, char *input, char *list, char *code);
+PRIVATE int CompileBatch(CONTEXT *cx);
+PRIVATE int AddUnit(BATCH *batch, char *input, char *list, char *code);
+PRIVATE int ReadManifest(BATCH *batch, char *manifest);
+PRIVATE int CollectTree(BATCH *batch, char *dir);
+PRIVATE void FreeBatch(BATCH *batch);
+PRIVATE int CompileBatchUnit(int unit, void *arg);
+PRIVATE int CompileServer(CONTEXT *cx);
+PRIVATE int CompileRequest(void *arg, char *source, size_t length, SERVEREPLY *reply);
+PRIVATE void CompileUnit(CONTEXT *cx);
+PRIVATE int CheckFiles(CONTEXT *cx, int argc, char *argv[]);
+PRIVATE void CheckSyntax(CONTEXT *cx);
+PRIVATE void ParseWithTable(CONTEXT *cx);
+PRIVATE TOKEN TableNext(void *arg, int skip);
+PRIVATE void TableAction(void *arg, int action, TOKEN *lookahead);
+PRIVATE void TableError(void *arg, int expected, uint64_t expectedSet, TOKEN *lookahead);
+#endif
+PRIVATE void ResetCompiler(CONTEXT *cx);
+PRIVATE void Compile(CONTEXT *cx);
+PRIVATE int CompileInParallel(CONTEXT *cx);
+PRIVATE void BeginListing(CONTEXT *cx);
+PRIVATE void EndListing(CONTEXT *cx);
+PRIVATE void WriteCode(CONTEXT *cx);
+PRIVATE void RetireFinishedCode(CONTEXT *cx);
+PRIVATE void ImageSink(void *arg, INSTRUCTION *code, int count);
+PRIVATE void LocateCodeLines(CONTEXT *cx);
+PRIVATE void ReportStats(CONTEXT *cx);
+PRIVATE void AppendProcReport(CONTEXT *cx);
+PRIVATE void ParseProgram(CONTEXT *cx);
+PRIVATE void ParseDeclarations(CONTEXT *cx);
+PRIVATE void ParseProcDeclaration(CONTEXT *cx);
+PRIVATE void ParseProcBody(CONTEXT *cx, SYMBOL *proc);
+PRIVATE void StartProcDeclaration(CONTEXT *cx);
+PRIVATE void CompileProcInChild(CONTEXT *cx, char *name, int fd);
+PRIVATE void CollectProcJob(CONTEXT *cx);
+PRIVATE void ParseParameterList(CONTEXT *cx);
+PRIVATE void ParseFormalParameter(CONTEXT *cx);
+PRIVATE void ParseBlock(CONTEXT *cx);
+PRIVATE void ParseStatement(CONTEXT *cx);
+PRIVATE void ParseSimpleStatement(CONTEXT *cx);
+PRIVATE void ParseRestOfStatement(CONTEXT *cx, SYMBOL *target);
+PRIVATE void ParseProcCallList(CONTEXT *cx, SYMBOL *target);
+PRIVATE void ParseAssignment(CONTEXT *cx);
+PRIVATE void ParseActualParameter(CONTEXT *cx);
+PRIVATE void ParseWhileStatement(CONTEXT *cx);
+PRIVATE void ParseIfStatement(CONTEXT *cx);
+PRIVATE void ParseReadStatement(CONTEXT *cx);
+PRIVATE void ParseWriteStatement(CONTEXT *cx);
+PRIVATE void ParseExpression(CONTEXT *cx);
+PRIVATE void ParseCompoundTerm(CONTEXT *cx);
+PRIVATE void ParseTerm(CONTEXT *cx);
+PRIVATE void ParseSubTerm(CONTEXT *cx);
+PRIVATE int ParseBooleanExpression(CONTEXT *cx);
+PRIVATE void ParseAddOp(CONTEXT *cx);
+PRIVATE void ParseMultOp(CONTEXT *cx);
+PRIVATE int ParseRelOp(CONTEXT *cx);
+PRIVATE void Accept(CONTEXT *cx, int code);
+PRIVATE void MakeSymbolTableEntry(CONTEXT *cx, int symtype);
+PRIVATE SYMBOL *LookupSymbol(CONTEXT *cx);
+PRIVATE SYMBOL *ProbeSymbol(CONTEXT *cx, char *s, int *hashindex);
+PRIVATE void PatchCode(CONTEXT *cx, int location, int address);
+PRIVATE void ParseOpPrec(CONTEXT *cx, int minPrec);
+PRIVATE void ParseNested(CONTEXT *cx, int state);
+PRIVATE int Precedence(int code);
+PRIVATE int OperatorInstruction(int code);
+PRIVATE void Synchronise(CONTEXT *cx, SET *F, SET *FB);
+PRIVATE int ReportDiagnostic(CONTEXT *cx, int kind, int expected, char *message);
+PRIVATE void SkipToken(CONTEXT *cx);
+PRIVATE void Abandon(CONTEXT *cx, char *reason);
+PRIVATE TOKEN NextToken(CONTEXT *cx);
+PRIVATE TOKEN ScanToken(CONTEXT *cx);
+PRIVATE FINGERPRINT CaptureProcedure(CONTEXT *cx);
+PRIVATE int CapturedScopes(CONTEXT *cx);
+PRIVATE SYMBOL *DeclaredProcedure(CONTEXT *cx, char *name);
+PRIVATE int ReplayProcedure(CONTEXT *cx, SYMBOL *proc, PCENTRY *entry, int origin);
+PRIVATE void ImportProcedures(CONTEXT *cx);
+PRIVATE void ExportProcedure(CONTEXT *cx, SYMBOL *proc, int start, int procs);
+PRIVATE void EndWhileStatement(CONTEXT *cx, int top, int exit);
+PRIVATE int UnrollFactor(CONTEXT *cx, int top);
+PRIVATE void CopyCode(CONTEXT *cx, int from, int count);
+PRIVATE int HotThenArm(CONTEXT *cx, int cond);
+PRIVATE void SwapIfArms(CONTEXT *cx, int cond, int jump, int end);
+PRIVATE void SaveInlineBody(CONTEXT *cx, SYMBOL *proc, int end);
+PRIVATE void EliminateDeadCode(CONTEXT *cx, int start, int procedure);
+PRIVATE int InlineCall(CONTEXT *cx, SYMBOL *callee);
+PRIVATE int UnrollCountedLoop(CONTEXT *cx, int top, int branch);
+PRIVATE long long CountedPasses(int op, int first, int bound, int step);
+
+#ifndef CPL_LIBRARY
 /*--------------------------------------------------------------------------*/
 /*  Main: Comp1 entry point. Accepts input and list file.                   */
 /*  Calls ParseProgram. Writes to output file.                              */
 /*--------------------------------------------------------------------------*/
 PUBLIC int main(int argc, char *argv[])
 {
-    if (OpenFiles(argc, argv))
+    CONTEXT Context;
+    FILE *report;
+    int ok;
+
+    if (!ParseOptions(&argc, argv))
+        return EXIT_FAILURE;
+
+    if ((Options.BatchPath != NULL || Options.TreePath != NULL || Options.ServePath != NULL) &&
+        (argc != 1 || Options.ProcCachePath != NULL))
     {
-        InitCharProcessor(InputFile, ListFile);
-        InitCodeGenerator(CodeFile);
-        CurrentToken = GetToken();
-        ParseProgram();
-        WriteCodeFile();
-        fclose(InputFile);
-        fclose(ListFile);
-        fclose(CodeFile);
-        if (errCount == 0)
+        fprintf(stderr, "%s --batch, --tree and --serve take no file names or --incremental\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (Options.ProcReportPath != NULL)
+    {
+        if (NULL == (report = fopen(Options.ProcReportPath, "w")))
         {
-            printf("Valid\n");
+            fprintf(stderr, "cannot open \"%s\" for output\n", Options.ProcReportPath);
+            return EXIT_FAILURE;
         }
-        return EXIT_SUCCESS;
+        WriteProcReportHeader(report);
+        fclose(report);
     }
-    else
-        return EXIT_FAILURE;
+
+    InitContext(&Context, &Options);
+    if (Options.ServePath != NULL)
+        ok = CompileServer(&Context);
+    else if (Options.BatchPath != NULL || Options.TreePath != NULL)
+        ok = CompileBatch(&Context);
+    else if (Options.Check)
+        ok = CheckFiles(&Context, argc, argv);
+    else if ((ok = OpenFiles(&Context, argc, argv)))
+        CompileUnit(&Context);
+    FreeContext(&Context);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 /*--------------------------------------------------------------------------*/
-/*                                                                          */
-/*  Parser routines: Recursive-descent implementaion of the grammar's       */
-/*                   productions.                                           */
-/*                                                                          */
-/*                                                                          */
-/*  ParseProgram implements:                                                */
-/*                                                                          */
-/*       <Program>     :== "PROGRAM" <Identifier> ";" [ <Declarations> ]    */
-/*		                   { <ProcDeclaration> } <Block> "."                */
-/*                                                                          */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
-/*                                                                          */
+/*  CompileBatch: Compiles every unit named by --batch and --tree in this   */
+/*  process, or with --jobs on a pool of worker processes.  Output is       */
+/*  always reported in manifest order, then tree order.  Returns 0 if the  */
+/*  manifest or any unit's files could not be opened, or under --check if  */
+/*  any unit is invalid.                                                    */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseProgram(void)
+PRIVATE int CompileBatch(CONTEXT *cx)
 {
-    /*Setup Sets Start*/
-    SET DeclarationsFS_aug_Program;
-    SET ProcDeclarationFS_aug_Program;
-    SET ProcDeclarationFBS_Program;
-    InitSet(&DeclarationsFS_aug_Program, 3, VAR, PROCEDURE, BEGIN);         /*First First Set of Program*/
-    InitSet(&ProcDeclarationFS_aug_Program, 2, PROCEDURE, BEGIN);           /*Second First Set of Program*/
-    InitSet(&ProcDeclarationFBS_Program, 3, ENDOFPROGRAM, END, ENDOFINPUT); /*Follow + Beacon Set of Program*/
-                                                                            /*Setup Sets End*/
-
-    Accept(PROGRAM);
-    MakeSymbolTableEntry(STYPE_PROGRAM);
-    Accept(IDENTIFIER);
-
-    scope++;
-
-    Accept(SEMICOLON);
-
-    Synchronise(&DeclarationsFS_aug_Program, &ProcDeclarationFBS_Program); /*Augmented error recovery*/
-
-    if (CurrentToken.code == VAR)
+    BATCH batch;
+    long *weights;
+    int *status;
+    int i, units = 0, invalid = 0, ok = 1;
+
+    batch.cx = cx;
+    batch.units = NULL;
+    batch.count = batch.capacity = 0;
+    if (cx->options->BatchPath != NULL && !ReadManifest(&batch, cx->options->BatchPath))
+        ok = 0;
+    if (cx->options->TreePath != NULL && !CollectTree(&batch, cx->options->TreePath))
+        ok = 0;
+
+    status = malloc((batch.count + 1) * sizeof(int));
+    weights = malloc((batch.count + 1) * sizeof(long));
+    if (status == NULL || weights == NULL)
     {
-        ParseDeclarations();
+        fprintf(stderr, "out of memory in batch\n");
+        FreeBatch(&batch);
+        free(status);
+        free(weights);
+        return 0;
     }
 
-    Synchronise(&ProcDeclarationFS_aug_Program, &ProcDeclarationFBS_Program); /*Augmented error recovery*/
-
-    while (CurrentToken.code == PROCEDURE)
+    if (cx->options->Jobs > 1)
     {
-        ParseProcDeclaration();
-        Synchronise(&ProcDeclarationFS_aug_Program, &ProcDeclarationFBS_Program); /*Augmented error recovery*/
+        for (i = 0; i < batch.count; i++)
+            weights[i] = batch.units[i].size;
+        if (!RunWorkPool(batch.count, weights, cx->options->Jobs, CompileBatchUnit, &batch, status))
+            ok = 0;
+    }
+    else
+    {
+        for (i = 0; i < batch.count; i++)
+            status[i] = CompileBatchUnit(i, &batch);
     }
 
-    ParseBlock();
-
-    Accept(ENDOFPROGRAM); /* Token "." has name ENDOFPROGRAM          */
-    Accept(ENDOFINPUT);
+    for (i = 0; i < batch.count; i++)
+    {
+        if (status[i] == UNIT_VALID || status[i] == UNIT_INVALID)
+            units++;
+        else
+            ok = 0;
+        if (status[i] == UNIT_INVALID)
+            invalid++;
+        if (status[i] == UNIT_INVALID && cx->options->Check)
+            ok = 0;
+    }
+    printf("Batch: %d unit(s) compiled, %d with errors\n", units, invalid);
 
-    RemoveSymbols(scope);
-    scope--;
+    FreeBatch(&batch);
+    free(status);
+    free(weights);
+    return ok;
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseDeclarations implements:                                         */
-/*                                                                          */
-/*       <Declarations>     :== "VAR" <Variable> { "," <Variable> } ";"     */
-/*                                                                          */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
-/*                                                                          */
+/*  FreeBatch: Releases the units ReadManifest and CollectTree added.       */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseDeclarations(void)
+PRIVATE void FreeBatch(BATCH *batch)
 {
-    Accept(VAR);
-    MakeSymbolTableEntry(STYPE_VARIABLE);
-    Accept(IDENTIFIER);
+    int i;
 
-    while (CurrentToken.code == COMMA)
+    for (i = 0; i < batch->count; i++)
     {
-        Accept(COMMA);
-        MakeSymbolTableEntry(STYPE_VARIABLE);
-        Accept(IDENTIFIER);
+        free(batch->units[i].input);
+        free(batch->units[i].list);
+        free(batch->units[i].code);
     }
-
-    Accept(SEMICOLON);
+    free(batch->units);
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseProcDeclaration implements:                                      */
-/*                                                                          */
-/*       <ProcDeclaration>     :== "PROCEDURE" <Identifier>                 */
-/*                                 [<ParameterList>] ";" [<Declarations>]   */
-/*                                 {<ProcDeclaration>} <Block> ";"          */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
-/*                                                                          */
+/*  CompileBatchUnit: Compiles one unit of a batch.  This is the work       */
+/*  function for RunWorkPool, so it runs in a worker process with the       */
+/*  worker's own copy of the context.                                       */
 /*--------------------------------------------------------------------------*/
+PRIVATE int CompileBatchUnit(int unit, void *arg)
+{
+    BATCH *batch = arg;
+    UNIT *u = &batch->units[unit];
+
+    if (!OpenUnit(batch->cx, u->input, u->list, u->code))
+        return UNIT_UNOPENED;
+    CompileUnit(batch->cx);
+    return batch->cx->errCount + batch->cx->syncCount == 0 ? UNIT_VALID : UNIT_INVALID;
+}
 
-PRIVATE void ParseProcDeclaration(void)
+PRIVATE char *CopyPath(char *s)
 {
-    /*Setup Sets Start*/
-    SET DeclarationsFS_aug_ProcDeclaration;
-    SET ProcDeclarationFS_aug_ProcDeclaration;
-    SET ProcDeclarationFSB_ProcDeclaration;
-    InitSet(&DeclarationsFS_aug_ProcDeclaration, 3, VAR, PROCEDURE, BEGIN);         /*First First Set of ProcDeclaration*/
-    InitSet(&ProcDeclarationFS_aug_ProcDeclaration, 2, PROCEDURE, BEGIN);           /*Second First Set of ProcDeclaration*/
-    InitSet(&ProcDeclarationFSB_ProcDeclaration, 3, ENDOFINPUT, ENDOFPROGRAM, END); /*Follow + Beacon Set of ProcDeclaration*/
-                                                                                    /*Setup Sets End*/
-    Accept(PROCEDURE);
-    MakeSymbolTableEntry(STYPE_PROCEDURE);
-    Accept(IDENTIFIER);
+    char *copy;
+
+    if (NULL == (copy = malloc(strlen(s) + 1)))
+        return NULL;
+    return strcpy(copy, s);
+}
 
-    scope++;
+/*--------------------------------------------------------------------------*/
+/*  AddUnit: Appends a unit to the batch, noting its source size.           */
+/*--------------------------------------------------------------------------*/
+PRIVATE int AddUnit(BATCH *batch, char *input, char *list, char *code)
+{
+    UNIT *grown;
+    struct stat st;
 
-    if (CurrentToken.code == LEFTPARENTHESIS)
+    if (batch->count == batch->capacity)
     {
-        ParseParameterList();
+        batch->capacity = batch->capacity == 0 ? 64 : batch->capacity * 2;
+        if (NULL == (grown = realloc(batch->units, batch->capacity * sizeof(UNIT))))
+            return 0;
+        batch->units = grown;
     }
 
-    Accept(SEMICOLON);
+    grown = &batch->units[batch->count];
+    grown->input = CopyPath(input);
+    grown->list = CopyPath(list);
+    grown->code = CopyPath(code);
+    grown->size = stat(input, &st) == 0 ? (long)st.st_size : 0;
+    if (grown->input == NULL || grown->list == NULL || grown->code == NULL)
+        return 0;
+    batch->count++;
+    return 1;
+}
 
-    Synchronise(&DeclarationsFS_aug_ProcDeclaration, &ProcDeclarationFSB_ProcDeclaration); /*Augmented error recovery*/
+/*--------------------------------------------------------------------------*/
+/*  ReadManifest: Adds the units listed in a manifest, one                  */
+/*  "<inputfile> <listfile> <codefile>" triple per line.  Blank lines and   */
+/*  lines starting with "!" are ignored.                                    */
+/*--------------------------------------------------------------------------*/
+PRIVATE int ReadManifest(BATCH *batch, char *manifest)
+{
+    FILE *f;
+    char line[MAXMANIFESTLINE];
+    char *input, *list, *code;
+    int ok = 1;
 
-    if (CurrentToken.code == VAR)
+    if (NULL == (f = fopen(manifest, "r")))
     {
-        ParseDeclarations();
+        fprintf(stderr, "cannot open \"%s\" for input\n", manifest);
+        return 0;
     }
 
-    Synchronise(&ProcDeclarationFS_aug_ProcDeclaration, &ProcDeclarationFSB_ProcDeclaration); /*Augmented error recovery*/
-
-    while (CurrentToken.code == PROCEDURE)
+    while (fgets(line, sizeof(line), f) != NULL)
     {
-        ParseProcDeclaration();
-        Synchronise(&ProcDeclarationFS_aug_ProcDeclaration, &ProcDeclarationFSB_ProcDeclaration); /*Augmented error recovery*/
+        if (NULL == (input = strtok(line, " \t\r\n")) || input[0] == '!')
+            continue;
+        list = strtok(NULL, " \t\r\n");
+        code = strtok(NULL, " \t\r\n");
+        if (list == NULL || code == NULL)
+        {
+            fprintf(stderr, "%s: expected <inputfile> <listfile> <codefile>\n", manifest);
+            ok = 0;
+        }
+        else if (!AddUnit(batch, input, list, code))
+            ok = 0;
     }
 
-    ParseBlock();
-
-    Accept(SEMICOLON);
+    fclose(f);
+    return ok;
+}
 
-    RemoveSymbols(scope);
-    scope--;
+PRIVATE int ByName(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseParameterList implements:                                        */
-/*                                                                          */
-/*       <ParameterList>     :==  "(" <FormalParameter> { ","               */
-/*				  <FormalParameter> } ")"                                   */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
-/*                                                                          */
+/*  CollectTree: Adds every "<name>.prog" under "dir", in sorted order,     */
+/*  with its listing in "<name>.lst" and code in "<name>.code" beside it.   */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseParameterList(void)
+PRIVATE int CollectTree(BATCH *batch, char *dir)
 {
-    Accept(LEFTPARENTHESIS);
-    ParseFormalParameter();
+    DIR *d;
+    struct dirent *de;
+    struct stat st;
+    char **names = NULL, **grown;
+    char path[4096], list[4096], code[4096];
+    size_t length;
+    int count = 0, capacity = 0, i, ok = 1;
+
+    if (NULL == (d = opendir(dir)))
+    {
+        fprintf(stderr, "cannot open directory \"%s\"\n", dir);
+        return 0;
+    }
+    while (NULL != (de = readdir(d)))
+    {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        if (count == capacity)
+        {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            if (NULL == (grown = realloc(names, capacity * sizeof(char *))))
+                break;
+            names = grown;
+        }
+        if (NULL != (names[count] = CopyPath(de->d_name)))
+            count++;
+    }
+    closedir(d);
+    if (count > 0)
+        qsort(names, count, sizeof(char *), ByName);
 
-    while (CurrentToken.code == COMMA)
+    for (i = 0; i < count; i++)
     {
-        Accept(COMMA);
-        ParseFormalParameter();
+        snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+        length = strlen(path);
+        if (stat(path, &st) != 0)
+            ;
+        else if (S_ISDIR(st.st_mode))
+            ok = CollectTree(batch, path) && ok;
+        else if (length > 5 && strcmp(path + length - 5, ".prog") == 0)
+        {
+            snprintf(list, sizeof(list), "%.*s.lst", (int)(length - 5), path);
+            snprintf(code, sizeof(code), "%.*s.code", (int)(length - 5), path);
+            ok = AddUnit(batch, path, list, code) && ok;
+        }
+        free(names[i]);
     }
 
-    Accept(RIGHTPARENTHESIS);
+    free(names);
+    return ok;
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseFormalParameter implements:                                      */
 /*                                                                          */
-/*       <FormalParameter>     :==  [ "REF" ] <Variable>                    */
+/*  CompileServer:  Serves compile requests on the --serve socket until     */
+/*                  the server is stopped.                                  */
+/*                                                                          */
+/*    Standard output is sent to a temporary file for as long as the        */
+/*    server runs, so whatever a compilation prints can be returned to the  */
+/*    client as its diagnostics.                                            */
 /*                                                                          */
 /*    Inputs:       None                                                    */
 /*                                                                          */
 /*    Outputs:      None                                                    */
 /*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseFormalParameter(void)
+PRIVATE int CompileServer(CONTEXT *cx)
 {
-    if (CurrentToken.code == REF)
+    SERVER server;
+    int saved, ok;
+
+    memset(&server, 0, sizeof(server));
+    server.cx = cx;
+    fflush(stdout);
+    if (NULL == (server.held = tmpfile()) ||
+        (saved = dup(STDOUT_FILENO)) < 0 || dup2(fileno(server.held), STDOUT_FILENO) < 0)
     {
-        Accept(REF);
-        MakeSymbolTableEntry(STYPE_REFPAR);
-    }
-    else
-    {
-        MakeSymbolTableEntry(STYPE_VALUEPAR);
+        fprintf(stderr, "cannot capture diagnostics\n");
+        return 0;
     }
 
-    Accept(IDENTIFIER);
+    ok = Serve(cx->options->ServePath, CompileRequest, &server);
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    fclose(server.held);
+    free(server.code);
+    free(server.listing);
+    free(server.diagnostics);
+    return ok;
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseBlock implements:		                                        */
 /*                                                                          */
-/*       <Block>     :==  "BEGIN" { <Statement> ";" } "END"                 */
+/*  CompileRequest:  Compiles one source sent to the server, entirely in    */
+/*                   memory, and fills in the reply.                        */
 /*                                                                          */
-/*    Inputs:       None                                                    */
+/*    The request goes through CompileUnit like any other unit, so it uses  */
+/*    the compile cache for lookups.  There are no files to add to the      */
+/*    cache from, so a miss is not stored.                                  */
 /*                                                                          */
-/*    Outputs:      None                                                    */
+/*    Inputs:       1) The SERVER.                                          */
+/*                  2) Source and its length.                               */
 /*                                                                          */
-/*    Returns:      Nothing                                                 */
+/*    Outputs:      Reply, pointing into the SERVER's buffers.              */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Returns:      1, or 0 to drop the connection if the request could not */
+/*                  be set up.                                              */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseBlock(void)
+PRIVATE int CompileRequest(void *arg, char *source, size_t length, SERVEREPLY *reply)
 {
-    /*Setup Sets Start*/
-    SET StatementFS_aug_Block;
-    SET StatementFBS_Block;
-    InitSet(&StatementFS_aug_Block, 6, IDENTIFIER, WHILE, IF, READ, WRITE, END); /*First Set of Block*/
-    InitSet(&StatementFBS_Block, 4, ELSE, ENDOFPROGRAM, ENDOFINPUT);             /*Follow + Beacon Set of Block*/
-                                                                                 /*Setup Sets End*/
-    Accept(BEGIN);
+    SERVER *server = arg;
+    CONTEXT *cx = server->cx;
+    char *grown;
+    long held;
 
-    scope++;
+    free(server->code);
+    free(server->listing);
+    server->code = server->listing = NULL;
 
-    Synchronise(&StatementFS_aug_Block, &StatementFBS_Block); /*Augmented error recovery*/
+    fflush(stdout);
+    if (ftruncate(STDOUT_FILENO, 0) != 0 || lseek(STDOUT_FILENO, 0, SEEK_SET) != 0)
+        return 0;
 
-    while (CurrentToken.code == WHILE || CurrentToken.code == IF || CurrentToken.code == READ || CurrentToken.code == WRITE || CurrentToken.code == IDENTIFIER)
+    /*fmemopen() rejects an empty buffer, so an empty request reads from  */
+    /*/dev/null instead.                                                   */
+    if (length > 0)
+        cx->InputFile = fmemopen(source, length, "r");
+    else
+        cx->InputFile = fopen("/dev/null", "r");
+    if (cx->InputFile == NULL)
+        return 0;
+    if (NULL == (cx->ListFile = open_memstream(&server->listing, &server->listingLength)) ||
+        NULL == (cx->CodeFile = open_memstream(&server->code, &server->codeLength)))
     {
-        ParseStatement();
-        Accept(SEMICOLON);
-        Synchronise(&StatementFS_aug_Block, &StatementFBS_Block); /*Augmented error recovery*/
+        fclose(cx->InputFile);
+        if (cx->ListFile != NULL)
+            fclose(cx->ListFile);
+        return 0;
     }
+    cx->InputPath = "-";
+    cx->ListPath = NULL;
+    cx->CodePath = NULL;
+
+    CompileUnit(cx);
 
-    RemoveSymbols(scope);
-    scope--;
+    fflush(stdout);
+    held = lseek(STDOUT_FILENO, 0, SEEK_CUR);
+    if (held < 0)
+        held = 0;
+    if ((size_t)held > server->diagnosticsCapacity)
+    {
+        if (NULL == (grown = realloc(server->diagnostics, held)))
+            return 0;
+        server->diagnostics = grown;
+        server->diagnosticsCapacity = held;
+    }
+    if (held > 0 && pread(fileno(server->held), server->diagnostics, held, 0) != held)
+        return 0;
 
-    Accept(END);
+    reply->status = cx->errCount + cx->syncCount == 0 ? 0 : 1;
+    reply->code = server->code;
+    reply->codeLength = server->codeLength;
+    reply->diagnostics = server->diagnostics;
+    reply->diagnosticsLength = held;
+    reply->listing = server->listing;
+    reply->listingLength = server->listingLength;
+    return 1;
 }
 
 /*--------------------------------------------------------------------------*/
-/*                                                                          */
-/*  ParseStatement implements:                                              */
-/*                                                                          */
-/*       <Statement>   :== <SimpleStatement> | <WhileStatement> |           */
-/*			   <IfStatement> | <ReadStatement> |                            */
-/*			   <WriteStatement>                   		                    */
-/*                                                                          */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
-/*                                                                          */
+/*  CompileUnit: Compiles the files opened by OpenUnit, going through the   */
+/*  compile cache if there is one, and closes them.                         */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseStatement(void)
+PRIVATE void CompileUnit(CONTEXT *cx)
 {
-    if (CurrentToken.code == WHILE)
+    FINGERPRINT key = 0;
+    int hit = 0;
+
+    ResetCompiler(cx);
+    if (cx->options->CacheDir != NULL)
+    {
+        if (ReadSource(cx))
+        {
+            key = CompileCacheKey(COMPILER_VERSION, cx->options->CompileFlags, cx->Source, cx->SourceLength);
+            hit = FetchCompileCache(&cx->CompileCache, key, cx->ListFile, cx->CodeFile);
+        }
+        CountCompileCache(&cx->CompileCache, hit);
+    }
+    if (cx->options->Check)
+        CheckSyntax(cx);
+    else if (!hit)
+        Compile(cx);
+    fclose(cx->InputFile);
+    if (cx->ListFile != NULL)
+        fclose(cx->ListFile);
+    if (cx->CodeFile != NULL)
+        fclose(cx->CodeFile);
+    if (cx->options->CacheDir != NULL)
+    {
+        if (!hit && key != 0 && cx->CodePath != NULL && cx->errCount + cx->syncCount == 0 && !cx->CodeBuffer.killed &&
+            !StoreCompileCache(&cx->CompileCache, key, cx->ListPath, cx->CodePath))
+            fprintf(stderr, "cannot write to cache \"%s\"\n", cx->options->CacheDir);
+        printf("Compile cache: %s (%ld hit(s), %ld miss(es))\n", hit ? "hit" : "miss",
+               cx->CompileCache.hits, cx->CompileCache.misses);
+    }
+    if (cx->options->BatchPath != NULL || cx->options->TreePath != NULL || cx->options->Check)
+    {
+        printf("%s: %s\n", cx->InputPath, cx->errCount + cx->syncCount == 0 ? "Valid" : "Invalid");
+    }
+    else if (cx->errCount == 0)
     {
-        ParseWhileStatement();
+        printf("Valid\n");
     }
-    else if (CurrentToken.code == IF)
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CheckFiles: Checks the syntax of every file named on the command line  */
+/*  under --check.  Returns 0 if any could not be opened or is invalid.    */
+/*--------------------------------------------------------------------------*/
+PRIVATE int CheckFiles(CONTEXT *cx, int argc, char *argv[])
+{
+    int i, ok = 1;
+
+    if (argc < 2)
     {
-        ParseIfStatement();
+        fprintf(stderr, "%s --check [options] <inputfile>...\n", argv[0]);
+        return 0;
     }
-    else if (CurrentToken.code == READ)
+
+    for (i = 1; i < argc; i++)
     {
-        ParseReadStatement();
+        if (!OpenUnit(cx, argv[i], NULL, NULL))
+        {
+            ok = 0;
+            continue;
+        }
+        CompileUnit(cx);
+        if (cx->errCount + cx->syncCount > 0)
+            ok = 0;
     }
-    else if (CurrentToken.code == WRITE)
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CheckSyntax: Compile() for --check.  Runs the scanner and parser over   */
+/*  InputFile with the listing thrown away, writing no code.                */
+/*--------------------------------------------------------------------------*/
+PRIVATE void CheckSyntax(CONTEXT *cx)
+{
+    StartStats(&cx->Stats, cx->options->Stats != STATS_OFF);
+    if (NULL == (cx->ListStream = OpenDiscardStream()))
     {
-        ParseWriteStatement();
+        fprintf(stderr, "cannot open a stream for the listing\n");
+        exit(EXIT_FAILURE);
     }
+    InitCharProcessor(cx->InputFile, cx->ListStream);
+    if (cx->options->LL1)
+        ParseWithTable(cx);
     else
     {
-        ParseSimpleStatement();
+        cx->CurrentToken = NextToken(cx);
+        ParseProgram(cx);
     }
+    fclose(cx->ListStream);
+    cx->ListStream = NULL;
+    ReportStats(cx);
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseSimpleStatement implements:                                      */
 /*                                                                          */
-/*       <SimpleStatement>     :==  <VarOrProcName> <RestOfStatement>       */
+/*  ParseWithTable:  Checks a program with the table-driven parser of      */
+/*                   "llparse.h" instead of the recursive descent one, for  */
+/*                   --ll1.                                                 */
+/*                                                                          */
+/*    The tables are generated from "cpl.grammar" by llgen.  The hooks      */
+/*    below read tokens through NextToken() and SkipToken(), so the error   */
+/*    budgets, statistics and --proc-report lines work as for a check by    */
+/*    ParseProgram(), and report errors the same way.  Its recovery sets    */
+/*    are the grammar's FIRST and FOLLOW sets rather than the hand-written  */
+/*    ones, so an invalid program may get different messages.              */
 /*                                                                          */
 /*    Inputs:       None                                                    */
 /*                                                                          */
@@ -418,327 +758,576 @@ PRIVATE void ParseStatement(void)
 /*                                                                          */
 /*    Returns:      Nothing                                                 */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Side Effects: Reads the whole input.  Counts errors in "errCount"     */
+/*                  and "syncCount".                                        */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseSimpleStatement(void)
+PRIVATE void ParseWithTable(CONTEXT *cx)
 {
-    SYMBOL *target;
+    LLHOOKS hooks;
 
-    target = LookupSymbol();
+    hooks.next = TableNext;
+    hooks.action = TableAction;
+    hooks.error = TableError;
+    hooks.arg = cx;
+    LLParse(CplGrammar(), &hooks);
+}
+
+PRIVATE TOKEN TableNext(void *arg, int skip)
+{
+    CONTEXT *cx = arg;
 
-    MakeSymbolTableEntry(STYPE_VALUEPAR);
-    Accept(IDENTIFIER);
-    ParseRestOfStatement(target);
+    if (skip)
+        SkipToken(cx);
+    else
+        cx->CurrentToken = NextToken(cx);
+    return cx->CurrentToken;
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseRestOfStatement implements:                                      */
-/*                                                                          */
-/*       <ParseRestOfStatement>     :==  <ProcCallList> | <Assignment> |    */
-/*					 NULL     			                                    */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
-/*                                                                          */
+/*  TableAction: Runs the actions written into "cpl.grammar", which keep    */
+/*  the scope count and the --proc-report lines.                            */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseRestOfStatement(SYMBOL *target)
+PRIVATE void TableAction(void *arg, int action, TOKEN *lookahead)
 {
-    switch (CurrentToken.code)
-    {
-    case LEFTPARENTHESIS:
-        ParseProcCallList(target);
+    CONTEXT *cx = arg;
+    int stat = cx->OpenProcStat;
 
-    case SEMICOLON:
-        if (target != NULL && target->type == STYPE_PROCEDURE)
-            Emit(I_CALL, target->address);
-        else
-        {
-            printf("Error - Not a procedure");
-            KillCodeGeneration();
-        }
+    switch (action)
+    {
+    case LL_OPENSCOPE:
+        OpenScope(cx);
         break;
-
-    case ASSIGNMENT:
-    default:
-        ParseAssignment();
-        if (target != NULL && target->type == STYPE_VARIABLE)
-            Emit(I_STOREA, target->address);
-        else
+    case LL_CLOSESCOPE:
+        cx->scope--;
+        break;
+    case LL_BEGINPROC:
+        if (cx->options->ProcReportPath != NULL)
+            BeginProcStat(cx, NULL, lookahead->pos);
+        break;
+    case LL_PROCNAME:
+        if (stat >= 0 && lookahead->code == IDENTIFIER)
+            cx->ProcStats[stat].name = ArenaString(&cx->Arena, lookahead->s);
+        OpenScope(cx);
+        break;
+    case LL_ENDPROC:
+        if (stat >= 0)
+            EndProcStat(cx, stat, lookahead->pos, 0);
+        break;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  TableError: Reports a syntax error as Accept() does for a token that    */
+/*  doesn't match, and as Synchronise() does for one that no rule starts    */
+/*  with.                                                                   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void TableError(void *arg, int expected, uint64_t expectedSet, TOKEN *lookahead)
+{
+    CONTEXT *cx = arg;
+    SET set;
+    int code;
+
+    if (expected >= 0)
+    {
+        if (ReportDiagnostic(cx, CPL_SYNTAX, expected, "syntax error"))
         {
-            printf("Error - undeclared variable");
-            KillCodeGeneration();
+            if (!cx->Quiet)
+                printf("Syntax Error\n");
+            SyntaxError(expected, *lookahead);
         }
+        cx->errCount++;
     }
-    /* Nothing needs to be parsed for epsilon */
+    else
+    {
+        if (ReportDiagnostic(cx, CPL_SYNTAX, -1, "unexpected token"))
+        {
+            ClearSet(&set);
+            for (code = 0; code < LL_MAXTOKENS; code++)
+            {
+                if (expectedSet & LL_BIT(code))
+                    AddElement(&set, code);
+            }
+            SyntaxError2(set, *lookahead);
+        }
+        cx->syncCount++;
+    }
+    COUNT_STAT(&cx->Stats, STAT_RECOVERIES);
 }
 
+#endif
+
 /*--------------------------------------------------------------------------*/
-/*	  ParseProcCallList implements:                                         */
 /*                                                                          */
-/*       <ProcCallList>     :==  "(" <ActualParameter> { ","                */
-/*				 <ActualParameter> } ")"                                    */
+/*  CompileBuffer:  Library entry point; see "cpl.h".  Compiles "length"    */
+/*                  bytes of source from memory.                            */
 /*                                                                          */
-/*    Inputs:       None                                                    */
+/*    The first call sets up a context that later calls reuse, so its       */
+/*    buffers are only allocated once.                                      */
 /*                                                                          */
-/*    Outputs:      None                                                    */
+/*    Inputs:       1) Source and its length.                               */
+/*                  2) Whether to return a listing.                         */
 /*                                                                          */
-/*    Returns:      Nothing                                                 */
+/*    Outputs:      Result, to be released with FreeCompileResult().        */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0); 0 if    */
+/*                  the in-memory streams could not be set up.              */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
+PUBLIC int CompileBuffer(char *source, size_t length, int wantListing, CPLRESULT *result)
+{
+    CONTEXT *cx = &LibraryContext;
 
-PRIVATE void ParseProcCallList(SYMBOL *target)
+    memset(result, 0, sizeof(CPLRESULT));
+    if (!LibraryReady)
+    {
+        InitOptions(&Options);
+        InitContext(cx, &Options);
+        LibraryReady = 1;
+    }
+
+    if (length > 0)
+        cx->InputFile = fmemopen(source, length, "r");
+    else
+        cx->InputFile = fopen("/dev/null", "r");
+    Options.Listing = wantListing ? LISTING_FULL : LISTING_NONE;
+    cx->ListFile = NULL;
+    if (wantListing)
+        cx->ListFile = open_memstream(&result->listing, &result->listingLength);
+    cx->CodeFile = open_memstream(&result->code, &result->codeLength);
+    if (cx->InputFile == NULL || (wantListing && cx->ListFile == NULL) || cx->CodeFile == NULL)
+    {
+        if (cx->InputFile != NULL)
+            fclose(cx->InputFile);
+        if (cx->ListFile != NULL)
+            fclose(cx->ListFile);
+        if (cx->CodeFile != NULL)
+            fclose(cx->CodeFile);
+        FreeCompileResult(result);
+        return 0;
+    }
+    cx->InputPath = "-";
+    cx->ListPath = NULL;
+    cx->CodePath = NULL;
+
+    ResetCompiler(cx);
+    cx->Quiet = 1;
+    Compile(cx);
+    fclose(cx->InputFile);
+    if (cx->ListFile != NULL)
+        fclose(cx->ListFile);
+    fclose(cx->CodeFile);
+
+    result->valid = cx->errCount + cx->syncCount == 0;
+    if (cx->DiagnosticCount > 0)
+    {
+        if (NULL == (result->diagnostics = malloc(cx->DiagnosticCount * sizeof(CPLDIAGNOSTIC))))
+        {
+            FreeCompileResult(result);
+            return 0;
+        }
+        memcpy(result->diagnostics, cx->Diagnostics, cx->DiagnosticCount * sizeof(CPLDIAGNOSTIC));
+        result->diagnosticCount = cx->DiagnosticCount;
+    }
+
+    LocateDiagnostics(result->diagnostics, result->diagnosticCount, source, length);
+    return 1;
+}
+
+PUBLIC void FreeCompileResult(CPLRESULT *result)
 {
-    Accept(LEFTPARENTHESIS);
+    free(result->code);
+    free(result->listing);
+    free(result->diagnostics);
+    memset(result, 0, sizeof(CPLRESULT));
+}
 
-    ParseActualParameter();
+/*--------------------------------------------------------------------------*/
+/*  ResetCompiler: Puts the context back to its starting values             */
+/*  between units.  Buffers and the arena keep their storage, so later      */
+/*  units in a batch don't pay for allocating it again.                     */
+/*--------------------------------------------------------------------------*/
+PRIVATE void ResetCompiler(CONTEXT *cx)
+{
+    memset(&cx->CurrentToken, 0, sizeof(cx->CurrentToken));
+    cx->errCount = 0;
+    cx->syncCount = 0;
+    cx->scope = 0;
+    cx->Recovering = 0;
+    cx->Abandoned = 0;
+    cx->Skipped = 0;
+    cx->DiagnosticCount = 0;
+    cx->SourceLength = 0;
+    cx->EntryPoint = 0;
+    cx->ProgramName = NULL;
+    cx->DataSize = 0;
+    cx->ProcCount = 0;
+    cx->LineCount = 0;
+    cx->SymbolCount = 0;
+    cx->DebugOwner = -1;
+    cx->FixupCount = 0;
+    cx->ProfileShift = 0;
+    cx->StoreEnd = -1;
+    cx->StoreLoop = -1;
+    ClearInlineBodies(cx);
+    cx->ProcStatCount = 0;
+    cx->OpenProcStat = -1;
+    RemoveSymbols(0);
+    ClearCodeBuffer(&cx->CodeBuffer);
+    ClearTokenBuffer(&cx->Pending);
+    FreeObject(&cx->Object);
+    ResetArena(&cx->Arena);
+}
 
-    while (CurrentToken.code == COMMA)
+/*--------------------------------------------------------------------------*/
+/*  Compile: Runs the scanner, parser and code generator over InputFile,    */
+/*  writing the listing and code files.                                     */
+/*--------------------------------------------------------------------------*/
+PRIVATE void Compile(CONTEXT *cx)
+{
+    /*The parallel pass may have to be thrown away, which needs a listing*/
+    /*that is a real file so that it can be truncated.                    */
+    StartStats(&cx->Stats, cx->options->Stats != STATS_OFF);
+    if (cx->options->ProcJobs > 1 && cx->options->ProcCachePath == NULL && cx->options->ProcReportPath == NULL &&
+        cx->options->Format != CODE_OBJECT && cx->options->Profile == NULL && !cx->options->DeadCode &&
+        (cx->options->Listing == LISTING_NONE || fileno(cx->ListFile) >= 0))
     {
-        Accept(COMMA);
-        ParseActualParameter();
+        if (CompileInParallel(cx))
+        {
+            ReportStats(cx);
+            return;
+        }
+        ResetCompiler(cx);
+        rewind(cx->InputFile);
+        if (cx->options->Listing != LISTING_NONE)
+        {
+            fflush(cx->ListFile);
+            if (ftruncate(fileno(cx->ListFile), 0) != 0)
+                fprintf(stderr, "cannot truncate \"%s\"\n", cx->ListPath);
+            rewind(cx->ListFile);
+        }
     }
 
-    Accept(RIGHTPARENTHESIS);
+    BeginListing(cx);
+    InitCharProcessor(cx->InputFile, cx->ListStream);
+    InitCodeGenerator(cx->CodeFile);
+    if (cx->options->Format == CODE_BINARY)
+        BeginCodeImage(cx->CodeFile);
+    if (cx->options->ProcCachePath != NULL)
+        LoadProcCache(&cx->ProcCache, cx->options->ProcCachePath);
+    cx->CurrentToken = NextToken(cx);
+    ParseProgram(cx);
+    if (cx->options->Profile != NULL && !cx->CodeBuffer.killed &&
+        BufferAddress(&cx->CodeBuffer) - cx->ProfileShift != cx->options->Profile->codeCount)
+        fprintf(stderr,
+                "%s: the profile is of %d instructions, not %d; was it taken without --profile, --unroll or "
+                "--dead-code?\n",
+                cx->InputPath != NULL ? cx->InputPath : "input", cx->options->Profile->codeCount,
+                BufferAddress(&cx->CodeBuffer) - cx->ProfileShift);
+    EndListing(cx);
+    WriteCode(cx);
+    if (cx->options->ProcCachePath != NULL)
+    {
+        if (!cx->CodeBuffer.killed && !SaveProcCache(&cx->ProcCache, cx->options->ProcCachePath))
+            fprintf(stderr, "cannot write \"%s\"\n", cx->options->ProcCachePath);
+        printf("Procedure cache: %d hit(s), %d miss(es)\n", cx->ProcCache.hits, cx->ProcCache.misses);
+    }
+    if (cx->options->DeadCode && !cx->Quiet && !cx->CodeBuffer.killed)
+        printf("Dead code: %ld instruction(s), %ld bytes removed from %s\n", cx->Stats.counts[STAT_REMOVED],
+               cx->Stats.counts[STAT_REMOVED] * (long)sizeof(CPLBININSTR),
+               cx->InputPath != NULL ? cx->InputPath : "input");
+    ReportStats(cx);
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseAssignment implements:                                           */
-/*                                                                          */
-/*       <Assignment>     :==  ":=" <Expression>                            */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
-/*                                                                          */
+/*  ReportStats: Stops the statistics and writes them to standard error if */
+/*  --stats was given.                                                      */
 /*--------------------------------------------------------------------------*/
+PRIVATE void ReportStats(CONTEXT *cx)
+{
+    StopStats(&cx->Stats);
+    cx->Stats.counts[STAT_INSTRUCTIONS] = BufferAddress(&cx->CodeBuffer);
+    if (cx->options->Stats != STATS_OFF)
+        WriteStats(stderr, &cx->Stats, cx->InputPath != NULL ? cx->InputPath : "-", cx->options->Stats);
+    if (cx->options->ProcReportPath != NULL)
+        AppendProcReport(cx);
+}
 
-PRIVATE void ParseAssignment(void)
+/*--------------------------------------------------------------------------*/
+/*  AppendProcReport: Adds this compilation's lines to the --proc-report   */
+/*  file in a single write, so that batch workers sharing the file do not  */
+/*  interleave their lines.                                                 */
+/*--------------------------------------------------------------------------*/
+PRIVATE void AppendProcReport(CONTEXT *cx)
 {
-    Accept(ASSIGNMENT);
-    ParseExpression();
+    char *text = NULL;
+    size_t length = 0;
+    FILE *f;
+    int fd;
+
+    if (cx->SourceLength == 0)
+        ReadSource(cx);
+    if (NULL == (f = open_memstream(&text, &length)))
+        return;
+    WriteProcReport(f, cx->ProcStats, cx->ProcStatCount, cx->InputPath != NULL ? cx->InputPath : "-",
+                    cx->Source, cx->SourceLength, cx->options->ProcSort);
+    fclose(f);
+    if ((fd = open(cx->options->ProcReportPath, O_WRONLY | O_APPEND)) < 0 ||
+        write(fd, text, length) != (ssize_t)length)
+        fprintf(stderr, "cannot write \"%s\"\n", cx->options->ProcReportPath);
+    if (fd >= 0)
+        close(fd);
+    free(text);
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseActualParameter implements:                                      */
 /*                                                                          */
-/*       <ActualParameter>     :==  <Variable> | <Expression>               */
+/*  CompileInParallel:  Compiles InputFile with the bodies of top-level     */
+/*                      procedures handed to child processes, up to         */
+/*                      --proc-jobs at a time.                              */
+/*                                                                          */
+/*    This is a speculative pass.  Children compile a procedure only when   */
+/*    it has no errors, so diagnostics are never split between processes;   */
+/*    instead, if anything goes wrong, this pass is abandoned and the       */
+/*    caller compiles again serially, which reports the errors exactly as   */
+/*    a serial compile always does.  Standard output is held back until     */
+/*    the pass is known to have succeeded.                                  */
 /*                                                                          */
 /*    Inputs:       None                                                    */
 /*                                                                          */
 /*    Outputs:      None                                                    */
 /*                                                                          */
-/*    Returns:      Nothing                                                 */
+/*    Returns:      1 if the code file has been written, 0 if the caller    */
+/*                  must rewind the input and listing and compile serially. */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Side Effects: Reads InputFile and writes the listing.                 */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseActualParameter(void)
+PRIVATE int CompileInParallel(CONTEXT *cx)
 {
-    if (CurrentToken.code == SUBTRACT)
+    FILE *held;
+    int saved, ok, c;
+
+    fflush(stdout);
+    if (NULL == (held = tmpfile()))
+        return 0;
+    if ((saved = dup(STDOUT_FILENO)) < 0 || dup2(fileno(held), STDOUT_FILENO) < 0)
     {
-        ParseExpression();
+        if (saved >= 0)
+            close(saved);
+        fclose(held);
+        return 0;
     }
-    else if (CurrentToken.code == IDENTIFIER || CurrentToken.code == INTCONST || CurrentToken.code == LEFTPARENTHESIS)
+
+    if (NULL == (cx->ProcJobs = malloc(cx->options->ProcJobs * sizeof(PROCJOB))))
     {
-        ParseExpression();
+        fprintf(stderr, "out of memory for procedure jobs\n");
+        exit(EXIT_FAILURE);
     }
-    else
+    cx->ProcJobCount = 0;
+    cx->ProcJobsFailed = 0;
+
+    BeginListing(cx);
+    InitCharProcessor(cx->InputFile, cx->ListStream);
+    InitCodeGenerator(cx->CodeFile);
+    if (cx->options->Format == CODE_BINARY)
+        BeginCodeImage(cx->CodeFile);
+    cx->CurrentToken = NextToken(cx);
+    ParseProgram(cx);
+    while (cx->ProcJobCount > 0)
+        CollectProcJob(cx);
+    EndListing(cx);
+    free(cx->ProcJobs);
+    cx->ProcJobs = NULL;
+
+    ok = !cx->ProcJobsFailed && cx->errCount + cx->syncCount == 0 && !cx->CodeBuffer.killed;
+
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    if (ok)
     {
-        MakeSymbolTableEntry(STYPE_LOCALVAR);
-        Accept(IDENTIFIER);
+        rewind(held);
+        while ((c = getc(held)) != EOF)
+            putchar(c);
+        WriteCode(cx);
     }
+    fclose(held);
+    return ok;
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseWhileStatement implements:                                       */
-/*                                                                          */
-/*       <WhileStatement>     :==  "WHILE" <BooleanExpression> "DO" <Block> */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*  BeginListing:  Sets up "ListStream" for the --listing mode.  Only a     */
+/*                 full listing keeps what the scanner writes; if its       */
+/*                 writer thread cannot be started the scanner writes the   */
+/*                 listing file directly.                                   */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseWhileStatement(void)
+PRIVATE void BeginListing(CONTEXT *cx)
 {
-    int Label1, Label2, L2BackPatchLoc;
-
-    Accept(WHILE);
-
-    Label1 = CurrentCodeAddress();
-    L2BackPatchLoc = ParseBooleanExpression();
-
-    Accept(DO);
-    ParseBlock();
-
-    Emit(I_BR, Label1);
-    Label2 = CurrentCodeAddress();
-    BackPatch(L2BackPatchLoc, Label2);
+    if (cx->options->Listing == LISTING_FULL)
+        cx->ListStream = OpenListWriter(&cx->ListWriter, cx->ListFile);
+    else
+        cx->ListStream = OpenDiscardStream();
+    if (cx->ListStream == NULL)
+        cx->ListStream = cx->ListFile;
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseIfStatement implements:                                          */
-/*                                                                          */
-/*       <IfStatement>     :==  "IF" <BooleanExpression> "THEN"             */
-/*				<Block> ["ELSE" <Block> ]                                   */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
 /*                                                                          */
-/*    Returns:      Nothing                                                 */
-/*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*  EndListing:  Waits for a full listing to be written out, or writes the  */
+/*               error listing, which needs the source text.                */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseIfStatement(void)
+PRIVATE void EndListing(CONTEXT *cx)
 {
-    int Label1, Label2, L1BackPatchLoc, L2BackPatchLoc;
-
-    Accept(IF);
-
-    L1BackPatchLoc = ParseBooleanExpression();
-
-    Accept(THEN);
-    ParseBlock();
-
-    if (CurrentToken.code == ELSE)
+    if (cx->ListStream != cx->ListFile)
     {
-        L2BackPatchLoc = CurrentCodeAddress();
-        Emit(I_BR, 0);
-        Accept(ELSE);
-        Label1 = CurrentCodeAddress();
-        BackPatch(L1BackPatchLoc, Label1);
-        ParseBlock();
-        Label2 = CurrentCodeAddress();
-        BackPatch(L2BackPatchLoc, Label2);
+        if (cx->options->Listing == LISTING_FULL)
+            CloseListWriter(&cx->ListWriter);
+        else
+            fclose(cx->ListStream);
     }
-    else
+    cx->ListStream = NULL;
+
+    if (cx->options->Listing == LISTING_ERRORS && cx->DiagnosticCount > 0 &&
+        (cx->SourceLength > 0 || ReadSource(cx)))
     {
-        Label1 = CurrentCodeAddress();
-        BackPatch(L1BackPatchLoc, Label1);
+        LocateDiagnostics(cx->Diagnostics, cx->DiagnosticCount, cx->Source, cx->SourceLength);
+        WriteErrorListing(cx->ListFile, cx->Source, cx->SourceLength, cx->Diagnostics, cx->DiagnosticCount);
     }
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseReadStatement implements:                                        */
-/*                                                                          */
-/*       <ReadStatement>     :==  "READ" "(" <Variable> { "," <Variable>    */
-/*                                 } ")"                                    */
-/*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*  WriteCode:  Writes the rest of the buffered code to CodeFile in the     */
+/*              --format chosen, through the code generator for the text    */
+/*              format, and finishes the file.  A binary image is left      */
+/*              unfinished once code generation has been killed.  Under     */
+/*              --debug it gets a debug section, whose line table needs     */
+/*              the source text, read back if the compile has not read it   */
+/*              already.                                                    */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
-
-PRIVATE void ParseReadStatement(void)
+PRIVATE void WriteCode(CONTEXT *cx)
 {
-    SYMBOL *var;
+    DEBUGINFO debug;
+    int phase = EnterPhase(&cx->Stats, STAT_EMIT);
 
-    Accept(READ);
-    Accept(LEFTPARENTHESIS);
-
-    var = LookupSymbol();
-    if (var != NULL && (*var).type == STYPE_VARIABLE)
+    if (cx->options->Format == CODE_TEXT)
     {
-        Emit(I_LOADA, (*var).address);
+        FlushCodeBuffer(&cx->CodeBuffer);
+        WriteCodeFile();
     }
-    else
+    else if (cx->options->Format == CODE_OBJECT)
     {
-        Error("Not declared or not a variable", CurrentToken.code);
+        if (!cx->CodeBuffer.killed && cx->errCount + cx->syncCount == 0 &&
+            (!SetObjectMain(&cx->Object, cx->ProgramName, cx->DataSize, &cx->CodeBuffer, cx->EntryPoint,
+                            BufferAddress(&cx->CodeBuffer)) ||
+             !WriteObject(cx->CodeFile, &cx->Object)))
+            fprintf(stderr, "cannot write \"%s\"\n", cx->CodePath != NULL ? cx->CodePath : "object file");
     }
-    _Emit(I_READ);
-
-    Accept(IDENTIFIER);
-
-    while (CurrentToken.code == COMMA)
+    else if (!cx->CodeBuffer.killed)
     {
-        Accept(COMMA);
-
-        var = LookupSymbol();
-        if (var != NULL && (*var).type == STYPE_VARIABLE)
+        RetireCode(&cx->CodeBuffer, ImageSink, cx);
+        if (cx->options->Debug)
         {
-            Emit(I_LOADA, (*var).address);
+            LocateCodeLines(cx);
+            debug.lines = cx->Lines;
+            debug.lineCount = cx->LineCount;
+            debug.symbols = cx->Symbols;
+            debug.symbolCount = cx->SymbolCount;
         }
-        else
-        {
-            Error("Not declared or not a variable", CurrentToken.code);
-        }
-        _Emit(I_LOADA);
-        Accept(IDENTIFIER);
+        if (!EndCodeImage(cx->CodeFile, BufferAddress(&cx->CodeBuffer), cx->EntryPoint, cx->DataSize,
+                          cx->Procs, cx->ProcCount, cx->options->Debug ? &debug : NULL))
+            fprintf(stderr, "cannot write \"%s\"\n", cx->CodePath != NULL ? cx->CodePath : "code file");
     }
-
-    Accept(RIGHTPARENTHESIS);
+    EnterPhase(&cx->Stats, phase);
 }
 
 /*--------------------------------------------------------------------------*/
-/*	  ParseWriteStatement implements:                                       */
-/*                                                                          */
-/*       <WriteStatement>     :==  "WRITE" "(" <Expression> {","            */
-/*				   <Expression>} ")"                                        */
 /*                                                                          */
-/*    Inputs:       None                                                    */
-/*                                                                          */
-/*    Outputs:      None                                                    */
-/*                                                                          */
-/*    Returns:      Nothing                                                 */
+/*  RetireFinishedCode:  Passes the code buffered so far on to the code     */
+/*                       file, called between top-level procedures, so      */
+/*                       that the buffer only ever holds one procedure.     */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Nothing can patch code already generated at that point unless a call  */
+/*    still waits for its callee's address.  The parallel pass keeps all    */
+/*    its code, since it may be thrown away, and so does an object unit,    */
+/*    which is written out whole.                                           */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
+PRIVATE void RetireFinishedCode(CONTEXT *cx)
+{
+    int phase;
+
+    if (cx->ProcJobs != NULL || cx->FixupCount > 0 || cx->CodeBuffer.killed ||
+        cx->options->Format == CODE_OBJECT)
+        return;
+    phase = EnterPhase(&cx->Stats, STAT_EMIT);
+    if (cx->options->Format == CODE_TEXT)
+        FlushCodeBuffer(&cx->CodeBuffer);
+    else
+        RetireCode(&cx->CodeBuffer, ImageSink, cx);
+    EnterPhase(&cx->Stats, phase);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ImageSink: Writes retired code to a binary image and, under --debug,   */
+/*  extends the line table over it.  The buffer's base is still the        */
+/*  address of "code".                                                      */
+/*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseWriteStatement(void)
+PRIVATE void ImageSink(void *arg, INSTRUCTION *code, int count)
 {
-    Accept(WRITE);
-    Accept(LEFTPARENTHESIS);
-    ParseExpression();
+    CONTEXT *cx = arg;
+
+    WriteImageCode(cx->CodeFile, code, count);
+    if (cx->options->Debug)
+        AddCodeLines(cx, code, cx->CodeBuffer.base, count);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  LocateCodeLines: Turns the source offsets in the line table into line  */
+/*  numbers, or 0 where there is no offset or no source to count lines in, */
+/*  and merges runs that end up on the same line.                           */
+/*--------------------------------------------------------------------------*/
 
-    _Emit(I_WRITE);
+PRIVATE void LocateCodeLines(CONTEXT *cx)
+{
+    int *newlines = NULL;
+    int i, n = 0, lines = 0, line;
 
-    while (CurrentToken.code == COMMA)
+    if (cx->LineCount > 0 && (cx->SourceLength > 0 || ReadSource(cx)))
+        newlines = IndexLines(cx->Source, cx->SourceLength, &lines);
+    for (i = 0; i < cx->LineCount; i++)
     {
-        Accept(COMMA);
-        ParseExpression();
-        _Emit(I_WRITE);
+        line = 0;
+        if (newlines != NULL && cx->Lines[i].line >= 0)
+            line = LineOf(newlines, lines, cx->Lines[i].line);
+        if (n > 0 && cx->Lines[n - 1].line == line)
+            continue;
+        cx->Lines[n].address = cx->Lines[i].address;
+        cx->Lines[n++].line = line;
     }
-
-    Accept(RIGHTPARENTHESIS);
+    cx->LineCount = n;
+    free(newlines);
 }
 
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
-/*  ParseExpression implements:                                             */
+/*  Parser routines: Recursive-descent implementaion of the grammar's       */
+/*                   productions.                                           */
 /*                                                                          */
-/*       <Expression>  :== <CompoundTerm> { <AddOp> <CompoundTerm> }        */
 /*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*  ParseProgram implements:                                                */
+/*                                                                          */
+/*       <Program>     :== "PROGRAM" <Identifier> ";" [ <Declarations> ]    */
+/*		                   { <ProcDeclaration> } <Block> "."                */
 /*                                                                          */
 /*                                                                          */
 /*    Inputs:       None                                                    */
@@ -751,33 +1340,66 @@ PRIVATE void ParseWriteStatement(void)
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseExpression(void)
+PRIVATE void ParseProgram(CONTEXT *cx)
 {
-    int op = 0;
+    /*Setup Sets Start*/
+    SET DeclarationsFS_aug_Program;
+    SET ProcDeclarationFS_aug_Program;
+    SET ProcDeclarationFBS_Program;
+    InitSet(&DeclarationsFS_aug_Program, 3, VAR, PROCEDURE, BEGIN);         /*First First Set of Program*/
+    InitSet(&ProcDeclarationFS_aug_Program, 2, PROCEDURE, BEGIN);           /*Second First Set of Program*/
+    InitSet(&ProcDeclarationFBS_Program, 3, ENDOFPROGRAM, END, ENDOFINPUT); /*Follow + Beacon Set of Program*/
+                                                                            /*Setup Sets End*/
+
+    Accept(cx, PROGRAM);
+    MakeSymbolTableEntry(cx, STYPE_PROGRAM);
+    if (cx->CurrentToken.code == IDENTIFIER)
+        cx->ProgramName = ArenaString(&cx->Arena, cx->CurrentToken.s);
+    Accept(cx, IDENTIFIER);
+
+    OpenScope(cx);
+    ImportProcedures(cx);
 
-    ParseCompoundTerm();
-    ParseOpPrec(0);
+    Accept(cx, SEMICOLON);
 
-    while ((CurrentToken.code == ADD) || (CurrentToken.code == SUBTRACT))
+    Synchronise(cx, &DeclarationsFS_aug_Program, &ProcDeclarationFBS_Program); /*Augmented error recovery*/
+
+    if (cx->CurrentToken.code == VAR)
     {
-        ParseAddOp();
-        ParseCompoundTerm();
+        ParseDeclarations(cx);
+    }
 
-        if (op == ADD)
-            _Emit(I_ADD);
+    Synchronise(cx, &ProcDeclarationFS_aug_Program, &ProcDeclarationFBS_Program); /*Augmented error recovery*/
+
+    while (cx->CurrentToken.code == PROCEDURE)
+    {
+        if (cx->ProcJobs != NULL)
+            StartProcDeclaration(cx);
         else
-            _Emit(I_SUB);
+            ParseProcDeclaration(cx);
+        Synchronise(cx, &ProcDeclarationFS_aug_Program, &ProcDeclarationFBS_Program); /*Augmented error recovery*/
+        RetireFinishedCode(cx);
     }
+
+    while (cx->ProcJobCount > 0)
+        CollectProcJob(cx);
+
+    cx->EntryPoint = BufferAddress(&cx->CodeBuffer);
+    ParseBlock(cx);
+    EliminateDeadCode(cx, cx->EntryPoint, 0);
+
+    Accept(cx, ENDOFPROGRAM); /* Token "." has name ENDOFPROGRAM          */
+    Accept(cx, ENDOFINPUT);
+
+    if (!CHECKING(cx))
+        RemoveSymbols(cx->scope);
+    cx->scope--;
 }
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseDeclarations implements:                                         */
 /*                                                                          */
-/*  ParseCompoundTerm implements:                                           */
-/*                                                                          */
-/*       <CompoundTerm>  :== <Term> { <MultOp> <Term> }                     */
-/*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*       <Declarations>     :== "VAR" <Variable> { "," <Variable> } ";"     */
 /*                                                                          */
 /*                                                                          */
 /*    Inputs:       None                                                    */
@@ -790,33 +1412,28 @@ PRIVATE void ParseExpression(void)
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseCompoundTerm(void)
+PRIVATE void ParseDeclarations(CONTEXT *cx)
 {
-    int op = 0;
+    Accept(cx, VAR);
+    MakeSymbolTableEntry(cx, STYPE_VARIABLE);
+    Accept(cx, IDENTIFIER);
 
-    ParseTerm();
-
-    while ((CurrentToken.code == MULTIPLY) || (CurrentToken.code == DIVIDE))
+    while (cx->CurrentToken.code == COMMA)
     {
-        ParseMultOp();
-        ParseTerm();
-
-        if (op == MULTIPLY)
-            _Emit(I_MULT);
-        else
-            _Emit(I_DIV);
+        Accept(cx, COMMA);
+        MakeSymbolTableEntry(cx, STYPE_VARIABLE);
+        Accept(cx, IDENTIFIER);
     }
+
+    Accept(cx, SEMICOLON);
 }
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseProcDeclaration implements:                                      */
 /*                                                                          */
-/*  ParseTerm implements:                                                   */
-/*                                                                          */
-/*       <Term>  :== [ "−" ] <SubTerm>                                      */
-/*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
-/*                                                                          */
+/*       <ProcDeclaration>     :== "PROCEDURE" <Identifier>                 */
+/*                                 [<ParameterList>] ";" [<Declarations>]   */
+/*                                 {<ProcDeclaration>} <Block> ";"          */
 /*                                                                          */
 /*    Inputs:       None                                                    */
 /*                                                                          */
@@ -828,84 +1445,158 @@ PRIVATE void ParseCompoundTerm(void)
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseTerm(void)
+PRIVATE void ParseProcDeclaration(CONTEXT *cx)
 {
-    int negateflag = 0;
-
-    if (CurrentToken.code == SUBTRACT)
+    char *name = NULL;
+    int cached, start = 0, errorsBefore = 0, stat = -1, first, origin, procs, symbols;
+    FINGERPRINT fp = 0;
+    PCENTRY *entry;
+    SYMBOL *proc;
+
+    first = cx->CurrentToken.pos;
+    Accept(cx, PROCEDURE);
+    MakeSymbolTableEntry(cx, STYPE_PROCEDURE);
+    if (cx->CurrentToken.code == IDENTIFIER)
+        name = ArenaString(&cx->Arena, cx->CurrentToken.s);
+    Accept(cx, IDENTIFIER);
+    proc = DeclaredProcedure(cx, name);
+    if (cx->options->ProcReportPath != NULL)
+        stat = BeginProcStat(cx, name, first);
+
+    /*Incremental mode: top-level procedures whose tokens and outer symbols*/
+    /*are unchanged since the last build reuse their cached code.          */
+    cached = cx->options->ProcCachePath != NULL && cx->scope == 1 && name != NULL && !TokensPending(&cx->Pending);
+    origin = cx->CurrentToken.pos;
+    start = BufferAddress(&cx->CodeBuffer);
+    procs = cx->ProcCount;
+    symbols = cx->SymbolCount;
+    if (cached)
     {
-        negateflag = 1;
-        Accept(SUBTRACT);
+        fp = CaptureProcedure(cx);
+        if (fp != 0 && NULL != (entry = LookupProcCache(&cx->ProcCache, name, fp)) &&
+            ReplayProcedure(cx, proc, entry, origin))
+        {
+            if (stat >= 0)
+            {
+                cx->ProcStats[stat].peakScope = CapturedScopes(cx);
+                EndProcStat(cx, stat, cx->Pending.tokens[cx->Pending.count - 1].pos, 1);
+            }
+            ExportProcedure(cx, proc, start, procs);
+            /*The token after the END was captured but not fingerprinted;  */
+            /*it must still be the ";" a body parsed in full would accept.  */
+            cx->CurrentToken = cx->Pending.tokens[cx->Pending.count - 1];
+            ClearTokenBuffer(&cx->Pending);
+            Accept(cx, SEMICOLON);
+            return;
+        }
+        cx->CurrentToken = NextToken(cx);
+        errorsBefore = cx->errCount + cx->syncCount;
     }
 
-    ParseSubTerm();
-
-    if (negateflag)
-    {
-        _Emit(I_NEG);
-    }
+    ParseProcBody(cx, proc);
+
+    /*The procedure itself was added to the table after its nested ones.   */
+    if (cached && fp != 0 && proc != NULL && cx->errCount + cx->syncCount == errorsBefore && !cx->CodeBuffer.killed &&
+        NULL != (entry = StoreProcCache(&cx->ProcCache, name, fp, &cx->CodeBuffer, start, proc->address,
+                                        BufferAddress(&cx->CodeBuffer), origin,
+                                        &cx->Procs[procs], cx->ProcCount - procs - 1)))
+        StoreProcSymbols(entry, cx->Symbols, symbols, cx->SymbolCount - symbols, start);
+    ExportProcedure(cx, proc, start, procs);
+    if (stat >= 0)
+        EndProcStat(cx, stat, cx->ProcEnd, 0);
 }
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseProcBody implements the part of <ProcDeclaration> after the      */
+/*    procedure's name:                                                     */
 /*                                                                          */
-/*  ParseSubTerm implements:                                                */
-/*                                                                          */
-/*       <SubTerm>  :== <Variable> | <IntConst> | "(" <Expression> ")"      */
-/*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
-/*                                                                          */
+/*       [<ParameterList>] ";" [<Declarations>] {<ProcDeclaration>}         */
+/*       <Block> ";"                                                        */
 /*                                                                          */
-/*    Inputs:       None                                                    */
+/*    Inputs:       The procedure's symbol, or NULL if its heading was in   */
+/*                  error.                                                  */
 /*                                                                          */
 /*    Outputs:      None                                                    */
 /*                                                                          */
 /*    Returns:      Nothing                                                 */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Side Effects: Lookahead token advanced.  The procedure's own scope    */
+/*                  is opened and closed again.  Its address is set when    */
+/*                  its block starts, and it is added to the procedure      */
+/*                  table after any nested procedures.                      */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseSubTerm(void)
+PRIVATE void ParseProcBody(CONTEXT *cx, SYMBOL *proc)
 {
-    SYMBOL *var;
+    int start = BufferAddress(&cx->CodeBuffer), owner = cx->DebugOwner;
+
+    /*Setup Sets Start*/
+    SET DeclarationsFS_aug_ProcDeclaration;
+    SET ProcDeclarationFS_aug_ProcDeclaration;
+    SET ProcDeclarationFSB_ProcDeclaration;
+    InitSet(&DeclarationsFS_aug_ProcDeclaration, 3, VAR, PROCEDURE, BEGIN);         /*First First Set of ProcDeclaration*/
+    InitSet(&ProcDeclarationFS_aug_ProcDeclaration, 2, PROCEDURE, BEGIN);           /*Second First Set of ProcDeclaration*/
+    InitSet(&ProcDeclarationFSB_ProcDeclaration, 3, ENDOFINPUT, ENDOFPROGRAM, END); /*Follow + Beacon Set of ProcDeclaration*/
+                                                                                    /*Setup Sets End*/
+    if (cx->options->Debug)
+        cx->DebugOwner = AddDebugSymbol(cx, proc != NULL ? ArenaString(&cx->Arena, proc->s) : "?",
+                                        STYPE_PROCEDURE, cx->scope, -1, owner);
+    OpenScope(cx);
 
-    switch (CurrentToken.code)
+    if (cx->CurrentToken.code == LEFTPARENTHESIS)
     {
-    case IDENTIFIER:
-    default:
-        var = LookupSymbol();
-        if (var != NULL && var->type == STYPE_VARIABLE)
-        {
-            Emit(I_LOADA, var->address);
-        }
-        else
-        {
-            printf("Error - Name undeclared or not a variable");
-            Accept(IDENTIFIER);
-            break;
-        }
-    case INTCONST:
-        Emit(I_LOADI, CurrentToken.value);
-        Accept(INTCONST);
-        break;
-    case LEFTPARENTHESIS:
-        Accept(LEFTPARENTHESIS);
-        ParseExpression();
-        Accept(RIGHTPARENTHESIS);
-        break;
+        ParseParameterList(cx);
+    }
+
+    Accept(cx, SEMICOLON);
+
+    Synchronise(cx, &DeclarationsFS_aug_ProcDeclaration, &ProcDeclarationFSB_ProcDeclaration); /*Augmented error recovery*/
+
+    if (cx->CurrentToken.code == VAR)
+    {
+        ParseDeclarations(cx);
+    }
+
+    Synchronise(cx, &ProcDeclarationFS_aug_ProcDeclaration, &ProcDeclarationFSB_ProcDeclaration); /*Augmented error recovery*/
+
+    while (cx->CurrentToken.code == PROCEDURE)
+    {
+        ParseProcDeclaration(cx);
+        Synchronise(cx, &ProcDeclarationFS_aug_ProcDeclaration, &ProcDeclarationFSB_ProcDeclaration); /*Augmented error recovery*/
+    }
+
+    if (proc != NULL)
+    {
+        proc->address = BufferAddress(&cx->CodeBuffer);
+        ResolveCallFixups(cx, proc);
+        if (cx->options->Debug)
+            cx->Symbols[cx->DebugOwner].address = proc->address;
+    }
+
+    ParseBlock(cx);
+
+    cx->ProcEnd = cx->CurrentToken.pos;
+    Accept(cx, SEMICOLON);
+
+    if (proc != NULL)
+    {
+        EliminateDeadCode(cx, proc->address, 1);
+        AddProcedure(cx, ArenaString(&cx->Arena, proc->s), start, proc->address, BufferAddress(&cx->CodeBuffer));
+        SaveInlineBody(cx, proc, BufferAddress(&cx->CodeBuffer));
     }
+
+    if (!CHECKING(cx))
+        RemoveSymbols(cx->scope);
+    cx->scope--;
+    cx->DebugOwner = owner;
 }
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseParameterList implements:                                        */
 /*                                                                          */
-/*  ParseBooleanExpression implements:                                      */
-/*                                                                          */
-/*       <BooleanExpression>  :== <Expression> <RelOp> <Expression>         */
-/*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
-/*                                                                          */
+/*       <ParameterList>     :==  "(" <FormalParameter> { ","               */
+/*				  <FormalParameter> } ")"                                   */
 /*                                                                          */
 /*    Inputs:       None                                                    */
 /*                                                                          */
@@ -917,31 +1608,24 @@ PRIVATE void ParseSubTerm(void)
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE int ParseBooleanExpression(void)
+PRIVATE void ParseParameterList(CONTEXT *cx)
 {
-    int BackPatchAddr, RelOpInstruction;
-
-    ParseExpression();
-
-    RelOpInstruction = ParseRelOp();
+    Accept(cx, LEFTPARENTHESIS);
+    ParseFormalParameter(cx);
 
-    ParseExpression();
+    while (cx->CurrentToken.code == COMMA)
+    {
+        Accept(cx, COMMA);
+        ParseFormalParameter(cx);
+    }
 
-    _Emit(I_SUB);
-    BackPatchAddr = CurrentCodeAddress();
-    Emit(RelOpInstruction, 0);
-    return BackPatchAddr;
+    Accept(cx, RIGHTPARENTHESIS);
 }
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseFormalParameter implements:                                      */
 /*                                                                          */
-/*  ParseAddOp implements:                                                  */
-/*                                                                          */
-/*       <AddOp>  :== "+" | "-"                                             */
-/*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
-/*                                                                          */
+/*       <FormalParameter>     :==  [ "REF" ] <Variable>                    */
 /*                                                                          */
 /*    Inputs:       None                                                    */
 /*                                                                          */
@@ -953,23 +1637,25 @@ PRIVATE int ParseBooleanExpression(void)
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseAddOp(void)
+PRIVATE void ParseFormalParameter(CONTEXT *cx)
 {
-    if (CurrentToken.code == ADD)
-        Accept(ADD);
-    else if (CurrentToken.code == SUBTRACT)
-        Accept(SUBTRACT);
+    if (cx->CurrentToken.code == REF)
+    {
+        Accept(cx, REF);
+        MakeSymbolTableEntry(cx, STYPE_REFPAR);
+    }
+    else
+    {
+        MakeSymbolTableEntry(cx, STYPE_VALUEPAR);
+    }
+
+    Accept(cx, IDENTIFIER);
 }
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseBlock implements:		                                        */
 /*                                                                          */
-/*  ParseMultOp implements:                                                 */
-/*                                                                          */
-/*       <MultOp>  :== "*" | "/"                                            */
-/*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
-/*                                                                          */
+/*       <Block>     :==  "BEGIN" { <Statement> ";" } "END"                 */
 /*                                                                          */
 /*    Inputs:       None                                                    */
 /*                                                                          */
@@ -981,22 +1667,48 @@ PRIVATE void ParseAddOp(void)
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseMultOp(void)
+PRIVATE void ParseBlock(CONTEXT *cx)
 {
-    if (CurrentToken.code == MULTIPLY)
-        Accept(MULTIPLY);
-    else if (CurrentToken.code == DIVIDE)
-        Accept(DIVIDE);
+    /*Setup Sets Start*/
+    SET StatementFS_aug_Block;
+    SET StatementFBS_Block;
+    InitSet(&StatementFS_aug_Block, 6, IDENTIFIER, WHILE, IF, READ, WRITE, END); /*First Set of Block*/
+    InitSet(&StatementFBS_Block, 3, ELSE, ENDOFPROGRAM, ENDOFINPUT);             /*Follow + Beacon Set of Block*/
+                                                                                 /*Setup Sets End*/
+    if (cx->options->ExplicitStack)
+    {
+        ParseNested(cx, PN_BLOCK);
+        return;
+    }
+
+    Accept(cx, BEGIN);
+
+    OpenScope(cx);
+
+    Synchronise(cx, &StatementFS_aug_Block, &StatementFBS_Block); /*Augmented error recovery*/
+
+    while (cx->CurrentToken.code == WHILE || cx->CurrentToken.code == IF || cx->CurrentToken.code == READ || cx->CurrentToken.code == WRITE || cx->CurrentToken.code == IDENTIFIER)
+    {
+        ParseStatement(cx);
+        Accept(cx, SEMICOLON);
+        Synchronise(cx, &StatementFS_aug_Block, &StatementFBS_Block); /*Augmented error recovery*/
+    }
+
+    if (!CHECKING(cx))
+        RemoveSymbols(cx->scope);
+    cx->scope--;
+    cx->StoreEnd = -1;
+
+    Accept(cx, END);
 }
 
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
-/*  ParseRelOp implements:                                                  */
-/*                                                                          */
-/*       <RelOp> :== "=" | "<=" | ">=" | "<" | ">"                          */
+/*  ParseStatement implements:                                              */
 /*                                                                          */
-/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
-/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*       <Statement>   :== <SimpleStatement> | <WhileStatement> |           */
+/*			   <IfStatement> | <ReadStatement> |                            */
+/*			   <WriteStatement>                   		                    */
 /*                                                                          */
 /*                                                                          */
 /*    Inputs:       None                                                    */
@@ -1005,285 +1717,2575 @@ PRIVATE void ParseMultOp(void)
 /*                                                                          */
 /*    Returns:      Nothing                                                 */
 /*                                                                          */
-/*    Side Effects: Lookahead token advanced.                               */
+/*    Side Effects: Lookahead token advanced.  Code generated for the       */
+/*                  statement, outside any statement nested in it, is       */
+/*                  marked with the statement's source offset.              */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE int ParseRelOp(void)
+PRIVATE void ParseStatement(CONTEXT *cx)
 {
-    int RelOpInstruction;
+    int pos = cx->CodeBuffer.pos;
 
-    switch (CurrentToken.code)
+    cx->CodeBuffer.pos = cx->CurrentToken.pos;
+    if (cx->CurrentToken.code == WHILE)
     {
-    case LESSEQUAL:
-        RelOpInstruction = I_BG;
-        Accept(LESSEQUAL);
-        break;
-    case GREATEREQUAL:
-        RelOpInstruction = I_BL;
-        Accept(GREATEREQUAL);
-        break;
-    case LESS:
-        RelOpInstruction = I_BGZ;
-        Accept(LESS);
-        break;
-    case GREATER:
-        RelOpInstruction = I_BLZ;
-        Accept(GREATER);
-        break;
-    case EQUALITY:
-        RelOpInstruction = I_BR;
-        Accept(EQUALITY);
-        break;
+        ParseWhileStatement(cx);
     }
-
-    return RelOpInstruction;
+    else if (cx->CurrentToken.code == IF)
+    {
+        ParseIfStatement(cx);
+    }
+    else if (cx->CurrentToken.code == READ)
+    {
+        ParseReadStatement(cx);
+    }
+    else if (cx->CurrentToken.code == WRITE)
+    {
+        ParseWriteStatement(cx);
+    }
+    else
+    {
+        ParseSimpleStatement(cx);
+    }
+    cx->CodeBuffer.pos = pos;
 }
 
-/*  No need to parse Variable                                               */
+/*--------------------------------------------------------------------------*/
+/*	  ParseSimpleStatement implements:                                      */
+/*                                                                          */
+/*       <SimpleStatement>     :==  <VarOrProcName> <RestOfStatement>       */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
 
-/*  No need to parse VarOrProcName                                          */
+PRIVATE void ParseSimpleStatement(CONTEXT *cx)
+{
+    SYMBOL *target;
 
-/*  No need to parse Identifier                                             */
+    target = LookupSymbol(cx);
 
-/*  No need to parse IntConst                                               */
+    MakeSymbolTableEntry(cx, STYPE_VALUEPAR);
+    Accept(cx, IDENTIFIER);
+    ParseRestOfStatement(cx, target);
+}
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseRestOfStatement implements:                                      */
 /*                                                                          */
-/*  End of parser.  Support routines follow.                                */
+/*       <ParseRestOfStatement>     :==  <ProcCallList> | <Assignment> |    */
+/*					 NULL     			                                    */
 /*                                                                          */
-/*--------------------------------------------------------------------------*/
+/*    Inputs:       None                                                    */
 /*                                                                          */
-/*  Accept:  Takes an expected token name as argument, and if the current   */
-/*           lookahead matches this, advances the lookahead and returns.    */
+/*    Outputs:      None                                                    */
 /*                                                                          */
-/*           If the expected token fails to match the current lookahead,    */
-/*           this routine reports a syntax error and exits ("crash & burn"  */
-/*           parsing).  Note the use of routine "SyntaxError"               */
-/*           (from "scanner.h") which puts the error message on the         */
-/*           standard output and on the listing file, and the helper        */
-/*           "ReadToEndOfFile" which just ensures that the listing file is  */
-/*           completely generated.                                          */
+/*    Returns:      Nothing                                                 */
 /*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
 /*                                                                          */
-/*    Inputs:       Integer code of expected token                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseRestOfStatement(CONTEXT *cx, SYMBOL *target)
+{
+    switch (cx->CurrentToken.code)
+    {
+    case LEFTPARENTHESIS:
+        ParseProcCallList(cx, target);
+
+    case SEMICOLON:
+        if (target != NULL && target->type == STYPE_PROCEDURE)
+        {
+            if (InlineCall(cx, target))
+                break;
+            EMIT(cx, I_CALL, target->address);
+            BufferInstruction(&cx->CodeBuffer, BufferAddress(&cx->CodeBuffer) - 1)->target = target->s;
+            if (target->address < 0)
+                AddCallFixup(cx, BufferAddress(&cx->CodeBuffer) - 1, target);
+        }
+        else
+        {
+            if (ReportDiagnostic(cx, CPL_SEMANTIC, -1, "not a procedure") && !cx->Quiet)
+                printf("Error - Not a procedure");
+            BufferKill(&cx->CodeBuffer);
+        }
+        break;
+
+    case ASSIGNMENT:
+    default:
+        ParseAssignment(cx);
+        if (target != NULL && target->type == STYPE_VARIABLE)
+        {
+            EMIT(cx, I_STOREA, target->address);
+            cx->StoreEnd = BufferAddress(&cx->CodeBuffer);
+        }
+        else
+        {
+            if (ReportDiagnostic(cx, CPL_SEMANTIC, -1, "undeclared variable") && !cx->Quiet)
+                printf("Error - undeclared variable");
+            BufferKill(&cx->CodeBuffer);
+        }
+    }
+    /* Nothing needs to be parsed for epsilon */
+}
+
+/*--------------------------------------------------------------------------*/
+/*	  ParseProcCallList implements:                                         */
+/*                                                                          */
+/*       <ProcCallList>     :==  "(" <ActualParameter> { ","                */
+/*				 <ActualParameter> } ")"                                    */
+/*                                                                          */
+/*    Inputs:       None                                                    */
 /*                                                                          */
 /*    Outputs:      None                                                    */
 /*                                                                          */
 /*    Returns:      Nothing                                                 */
 /*                                                                          */
-/*    Side Effects: If successful, advances the current lookahead token     */
-/*                  "CurrentToken".                                         */
+/*    Side Effects: Lookahead token advanced.                               */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE void Accept(int ExpectedToken)
+PRIVATE void ParseProcCallList(CONTEXT *cx, SYMBOL *target)
 {
-    static int recovering = 0;
+    Accept(cx, LEFTPARENTHESIS);
 
-    if (recovering)
-    {
-        while (CurrentToken.code != ExpectedToken && CurrentToken.code != ENDOFINPUT)
-            CurrentToken = GetToken();
-        recovering = 0;
-    }
-    if (CurrentToken.code != ExpectedToken)
+    ParseActualParameter(cx);
+
+    while (cx->CurrentToken.code == COMMA)
     {
-        printf("Syntax Error\n");
-        SyntaxError(ExpectedToken, CurrentToken);
-        errCount++;
-        recovering = 1;
+        Accept(cx, COMMA);
+        ParseActualParameter(cx);
     }
-    else
-        CurrentToken = GetToken();
+
+    Accept(cx, RIGHTPARENTHESIS);
 }
 
 /*--------------------------------------------------------------------------*/
+/*	  ParseAssignment implements:                                           */
 /*                                                                          */
-/*  OpenFiles:  Reads strings from the command-line and opens the           */
-/*              associated input and listing files.                         */
+/*       <Assignment>     :==  ":=" <Expression>                            */
 /*                                                                          */
-/*    Note that this routine mmodifies the globals "InputFile" and          */
-/*    "ListingFile".  It returns 1 ("true" in C-speak) if the input and     */
-/*    listing files are successfully opened, 0 if not, allowing the caller  */
-/*    to make a graceful exit if the opening process failed.                */
+/*    Inputs:       None                                                    */
 /*                                                                          */
+/*    Outputs:      None                                                    */
 /*                                                                          */
-/*    Inputs:       1) Integer argument count (standard C "argc").          */
-/*                  2) Array of pointers to C-strings containing arguments  */
-/*                  (standard C "argv").                                    */
+/*    Returns:      Nothing                                                 */
 /*                                                                          */
-/*    Outputs:      No direct outputs, but note side effects.               */
+/*    Side Effects: Lookahead token advanced.                               */
 /*                                                                          */
-/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseAssignment(CONTEXT *cx)
+{
+    Accept(cx, ASSIGNMENT);
+    ParseExpression(cx);
+}
+
+/*--------------------------------------------------------------------------*/
+/*	  ParseActualParameter implements:                                      */
 /*                                                                          */
-/*    Side Effects: If successful, modifies globals "InputFile" and         */
-/*                  "ListingFile".                                          */
+/*       <ActualParameter>     :==  <Variable> | <Expression>               */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
-PRIVATE int OpenFiles(int argc, char *argv[])
+PRIVATE void ParseActualParameter(CONTEXT *cx)
 {
-    if (argc != 4)
-    {
-        fprintf(stderr, "%s <inputfile> <listfile> <codefile>\n", argv[0]);
-        return 0;
-    }
-
-    if (NULL == (InputFile = fopen(argv[1], "r")))
+    if (cx->CurrentToken.code == SUBTRACT)
     {
-        fprintf(stderr, "cannot open \"%s\" for input\n", argv[1]);
-        return 0;
+        ParseExpression(cx);
     }
-
-    if (NULL == (ListFile = fopen(argv[2], "w")))
+    else if (cx->CurrentToken.code == IDENTIFIER || cx->CurrentToken.code == INTCONST || cx->CurrentToken.code == LEFTPARENTHESIS)
     {
-        fprintf(stderr, "cannot open \"%s\" for output\n", argv[2]);
-        fclose(InputFile);
-        return 0;
+        ParseExpression(cx);
     }
-
-    /*Added an if statement to open the CodeFile*/
-    if (NULL == (CodeFile = fopen(argv[3], "w")))
+    else
     {
-        fprintf(stderr, "cannot open \"%s\" for output\n", argv[3]);
-        fclose(CodeFile);
-        return 0;
+        MakeSymbolTableEntry(cx, STYPE_LOCALVAR);
+        Accept(cx, IDENTIFIER);
     }
-
-    return 1;
 }
 
-PRIVATE void MakeSymbolTableEntry(int symtype)
-{
-    /*Variable declarations*/
-    PRIVATE SYMBOL *oldsptr;
-    PRIVATE SYMBOL *newsptr;
-
-    char *cptr;
-    int hashindex;
+/*--------------------------------------------------------------------------*/
+/*	  ParseWhileStatement implements:                                       */
+/*                                                                          */
+/*       <WhileStatement>     :==  "WHILE" <BooleanExpression> "DO" <Block> */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseWhileStatement(CONTEXT *cx)
+{
+    int Label1, L2BackPatchLoc;
+
+    Accept(cx, WHILE);
+
+    Label1 = BufferAddress(&cx->CodeBuffer);
+    if (cx->StoreEnd == Label1)
+        cx->StoreLoop = Label1;
+    L2BackPatchLoc = ParseBooleanExpression(cx);
+
+    Accept(cx, DO);
+    ParseBlock(cx);
+
+    EndWhileStatement(cx, Label1, L2BackPatchLoc);
+}
+
+/*--------------------------------------------------------------------------*/
+/*	  ParseIfStatement implements:                                          */
+/*                                                                          */
+/*       <IfStatement>     :==  "IF" <BooleanExpression> "THEN"             */
+/*				<Block> ["ELSE" <Block> ]                                   */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseIfStatement(CONTEXT *cx)
+{
+    int Label1, Label2, L1BackPatchLoc, L2BackPatchLoc, swap;
+
+    Accept(cx, IF);
+
+    L1BackPatchLoc = ParseBooleanExpression(cx);
+    swap = HotThenArm(cx, L1BackPatchLoc);
+
+    Accept(cx, THEN);
+    ParseBlock(cx);
+
+    if (cx->CurrentToken.code == ELSE)
+    {
+        L2BackPatchLoc = BufferAddress(&cx->CodeBuffer);
+        EMIT(cx, I_BR, 0);
+        Accept(cx, ELSE);
+        Label1 = BufferAddress(&cx->CodeBuffer);
+        PatchCode(cx, L1BackPatchLoc, Label1);
+        ParseBlock(cx);
+        Label2 = BufferAddress(&cx->CodeBuffer);
+        PatchCode(cx, L2BackPatchLoc, Label2);
+        if (swap)
+            SwapIfArms(cx, L1BackPatchLoc, L2BackPatchLoc, Label2);
+    }
+    else
+    {
+        Label1 = BufferAddress(&cx->CodeBuffer);
+        PatchCode(cx, L1BackPatchLoc, Label1);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*	  ParseReadStatement implements:                                        */
+/*                                                                          */
+/*       <ReadStatement>     :==  "READ" "(" <Variable> { "," <Variable>    */
+/*                                 } ")"                                    */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseReadStatement(CONTEXT *cx)
+{
+    SYMBOL *var;
+
+    Accept(cx, READ);
+    Accept(cx, LEFTPARENTHESIS);
+
+    var = LookupSymbol(cx);
+    if (var != NULL && (*var).type == STYPE_VARIABLE)
+    {
+        EMIT(cx, I_LOADA, (*var).address);
+    }
+    else
+    {
+        if (ReportDiagnostic(cx, CPL_SEMANTIC, -1, "not declared or not a variable"))
+            Error("Not declared or not a variable", cx->CurrentToken.code);
+    }
+    EMITOP(cx, I_READ);
+
+    Accept(cx, IDENTIFIER);
+
+    while (cx->CurrentToken.code == COMMA)
+    {
+        Accept(cx, COMMA);
+
+        var = LookupSymbol(cx);
+        if (var != NULL && (*var).type == STYPE_VARIABLE)
+        {
+            EMIT(cx, I_LOADA, (*var).address);
+        }
+        else
+        {
+            if (ReportDiagnostic(cx, CPL_SEMANTIC, -1, "not declared or not a variable"))
+                Error("Not declared or not a variable", cx->CurrentToken.code);
+        }
+        EMITOP(cx, I_LOADA);
+        Accept(cx, IDENTIFIER);
+    }
+
+    Accept(cx, RIGHTPARENTHESIS);
+}
+
+/*--------------------------------------------------------------------------*/
+/*	  ParseWriteStatement implements:                                       */
+/*                                                                          */
+/*       <WriteStatement>     :==  "WRITE" "(" <Expression> {","            */
+/*				   <Expression>} ")"                                        */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseWriteStatement(CONTEXT *cx)
+{
+    Accept(cx, WRITE);
+    Accept(cx, LEFTPARENTHESIS);
+    ParseExpression(cx);
+
+    EMITOP(cx, I_WRITE);
+
+    while (cx->CurrentToken.code == COMMA)
+    {
+        Accept(cx, COMMA);
+        ParseExpression(cx);
+        EMITOP(cx, I_WRITE);
+    }
+
+    Accept(cx, RIGHTPARENTHESIS);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseExpression implements:                                             */
+/*                                                                          */
+/*       <Expression>  :== <CompoundTerm> { <AddOp> <CompoundTerm> }        */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseExpression(CONTEXT *cx)
+{
+    int op = 0;
+
+    if (cx->options->ExplicitStack)
+    {
+        ParseNested(cx, PN_EXPRESSION);
+        return;
+    }
+
+    ParseCompoundTerm(cx);
+    ParseOpPrec(cx, 0);
+
+    while ((cx->CurrentToken.code == ADD) || (cx->CurrentToken.code == SUBTRACT))
+    {
+        ParseAddOp(cx);
+        ParseCompoundTerm(cx);
+
+        if (op == ADD)
+            EMITOP(cx, I_ADD);
+        else
+            EMITOP(cx, I_SUB);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseCompoundTerm implements:                                           */
+/*                                                                          */
+/*       <CompoundTerm>  :== <Term> { <MultOp> <Term> }                     */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseCompoundTerm(CONTEXT *cx)
+{
+    int op = 0;
+
+    ParseTerm(cx);
+
+    while ((cx->CurrentToken.code == MULTIPLY) || (cx->CurrentToken.code == DIVIDE))
+    {
+        ParseMultOp(cx);
+        ParseTerm(cx);
+
+        if (op == MULTIPLY)
+            EMITOP(cx, I_MULT);
+        else
+            EMITOP(cx, I_DIV);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseTerm implements:                                                   */
+/*                                                                          */
+/*       <Term>  :== [ "−" ] <SubTerm>                                      */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseTerm(CONTEXT *cx)
+{
+    int negateflag = 0;
+
+    if (cx->CurrentToken.code == SUBTRACT)
+    {
+        negateflag = 1;
+        Accept(cx, SUBTRACT);
+    }
+
+    ParseSubTerm(cx);
+
+    if (negateflag)
+    {
+        EMITOP(cx, I_NEG);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseSubTerm implements:                                                */
+/*                                                                          */
+/*       <SubTerm>  :== <Variable> | <IntConst> | "(" <Expression> ")"      */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseSubTerm(CONTEXT *cx)
+{
+    SYMBOL *var;
+
+    switch (cx->CurrentToken.code)
+    {
+    case IDENTIFIER:
+    default:
+        var = LookupSymbol(cx);
+        if (var != NULL && var->type == STYPE_VARIABLE)
+        {
+            EMIT(cx, I_LOADA, var->address);
+        }
+        else
+        {
+            if (ReportDiagnostic(cx, CPL_SEMANTIC, -1, "name undeclared or not a variable") && !cx->Quiet)
+                printf("Error - Name undeclared or not a variable");
+            Accept(cx, IDENTIFIER);
+            break;
+        }
+    case INTCONST:
+        EMIT(cx, I_LOADI, cx->CurrentToken.value);
+        Accept(cx, INTCONST);
+        break;
+    case LEFTPARENTHESIS:
+        Accept(cx, LEFTPARENTHESIS);
+        ParseExpression(cx);
+        Accept(cx, RIGHTPARENTHESIS);
+        break;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseBooleanExpression implements:                                      */
+/*                                                                          */
+/*       <BooleanExpression>  :== <Expression> <RelOp> <Expression>         */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ParseBooleanExpression(CONTEXT *cx)
+{
+    int BackPatchAddr, RelOpInstruction;
+
+    ParseExpression(cx);
+
+    RelOpInstruction = ParseRelOp(cx);
+
+    ParseExpression(cx);
+
+    EMITOP(cx, I_SUB);
+    BackPatchAddr = BufferAddress(&cx->CodeBuffer);
+    EMIT(cx, RelOpInstruction, 0);
+    return BackPatchAddr;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseAddOp implements:                                                  */
+/*                                                                          */
+/*       <AddOp>  :== "+" | "-"                                             */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseAddOp(CONTEXT *cx)
+{
+    if (cx->CurrentToken.code == ADD)
+        Accept(cx, ADD);
+    else if (cx->CurrentToken.code == SUBTRACT)
+        Accept(cx, SUBTRACT);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseMultOp implements:                                                 */
+/*                                                                          */
+/*       <MultOp>  :== "*" | "/"                                            */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseMultOp(CONTEXT *cx)
+{
+    if (cx->CurrentToken.code == MULTIPLY)
+        Accept(cx, MULTIPLY);
+    else if (cx->CurrentToken.code == DIVIDE)
+        Accept(cx, DIVIDE);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseRelOp implements:                                                  */
+/*                                                                          */
+/*       <RelOp> :== "=" | "<=" | ">=" | "<" | ">"                          */
+/*                                                                          */
+/*       Note that <Identifier> and <IntConst> are handled by the scanner   */
+/*       and are returned as tokens IDENTIFIER and INTCONST respectively.   */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced.                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ParseRelOp(CONTEXT *cx)
+{
+    int RelOpInstruction;
+
+    switch (cx->CurrentToken.code)
+    {
+    case LESSEQUAL:
+        RelOpInstruction = I_BG;
+        Accept(cx, LESSEQUAL);
+        break;
+    case GREATEREQUAL:
+        RelOpInstruction = I_BL;
+        Accept(cx, GREATEREQUAL);
+        break;
+    case LESS:
+        RelOpInstruction = I_BGZ;
+        Accept(cx, LESS);
+        break;
+    case GREATER:
+        RelOpInstruction = I_BLZ;
+        Accept(cx, GREATER);
+        break;
+    case EQUALITY:
+        RelOpInstruction = I_BR;
+        Accept(cx, EQUALITY);
+        break;
+    }
+
+    return RelOpInstruction;
+}
+
+/*  No need to parse Variable                                               */
+
+/*  No need to parse VarOrProcName                                          */
+
+/*  No need to parse Identifier                                             */
+
+/*  No need to parse IntConst                                               */
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseNested:  ParseBlock and ParseExpression under --explicit-stack.    */
+/*                                                                          */
+/*    Blocks nest through ParseStatement, ParseIfStatement and              */
+/*    ParseWhileStatement, and expressions through the parentheses of       */
+/*    ParseSubTerm, so a deeply nested program can run the recursive        */
+/*    routines out of native stack.  This runs all of them as one loop      */
+/*    instead.  Calling a routine is a change of state, and what the        */
+/*    caller still has to do is pushed on "Frames" with its locals, to be   */
+/*    popped when the callee returns.  Nesting is then limited only by      */
+/*    memory, at a frame or two a level, and the frames are kept for the    */
+/*    next compilation.                                                     */
+/*                                                                          */
+/*    Each state does what its routine does at that point, so the code,     */
+/*    listing and errors are the same as without --explicit-stack.          */
+/*    Statements and operands that cannot nest are left to the usual        */
+/*    routines; an expression inside one of those is parsed by a run of     */
+/*    its own, above this one's frames.                                     */
+/*                                                                          */
+/*    Inputs:       PN_BLOCK or PN_EXPRESSION.                              */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Those of ParseBlock or ParseExpression.                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ParseNested(CONTEXT *cx, int state)
+{
+    SET StatementFS_aug_Block;
+    SET StatementFBS_Block;
+    PARSEFRAME *f;
+    int base = cx->FrameCount, a = 0, b = 0, c = 0, code;
+
+    InitSet(&StatementFS_aug_Block, 6, IDENTIFIER, WHILE, IF, READ, WRITE, END);
+    InitSet(&StatementFBS_Block, 3, ELSE, ENDOFPROGRAM, ENDOFINPUT);
+
+    for (;;)
+    {
+        code = cx->CurrentToken.code;
+        switch (state)
+        {
+        case PN_BLOCK:
+            Accept(cx, BEGIN);
+            OpenScope(cx);
+            Synchronise(cx, &StatementFS_aug_Block, &StatementFBS_Block);
+            state = PN_STATEMENTS;
+            continue;
+
+        case PN_STATEMENTS:
+            if (code != WHILE && code != IF && code != READ && code != WRITE && code != IDENTIFIER)
+            {
+                if (!CHECKING(cx))
+                    RemoveSymbols(cx->scope);
+                cx->scope--;
+                cx->StoreEnd = -1;
+                Accept(cx, END);
+                break;
+            }
+            a = cx->CodeBuffer.pos;
+            cx->CodeBuffer.pos = cx->CurrentToken.pos;
+            if (code == WHILE)
+            {
+                Accept(cx, WHILE);
+                b = BufferAddress(&cx->CodeBuffer);
+                if (cx->StoreEnd == b)
+                    cx->StoreLoop = b;
+                c = ParseBooleanExpression(cx);
+                Accept(cx, DO);
+                PushParseFrame(cx, PN_WHILE_DONE, a, b, c);
+                state = PN_BLOCK;
+                continue;
+            }
+            if (code == IF)
+            {
+                Accept(cx, IF);
+                b = ParseBooleanExpression(cx);
+                Accept(cx, THEN);
+                PushParseFrame(cx, PN_THEN_DONE, a, b, HotThenArm(cx, b));
+                state = PN_BLOCK;
+                continue;
+            }
+            if (code == READ)
+                ParseReadStatement(cx);
+            else if (code == WRITE)
+                ParseWriteStatement(cx);
+            else
+                ParseSimpleStatement(cx);
+            state = PN_STATEMENT_DONE;
+            continue;
+
+        case PN_STATEMENT_DONE:
+            cx->CodeBuffer.pos = a;
+            Accept(cx, SEMICOLON);
+            Synchronise(cx, &StatementFS_aug_Block, &StatementFBS_Block);
+            state = PN_STATEMENTS;
+            continue;
+
+        case PN_WHILE_DONE:
+            EndWhileStatement(cx, b, c);
+            state = PN_STATEMENT_DONE;
+            continue;
+
+        case PN_THEN_DONE:
+            if (code == ELSE)
+            {
+                PushParseFrame(cx, PN_ELSE_DONE, a, BufferAddress(&cx->CodeBuffer), c ? b : -1);
+                EMIT(cx, I_BR, 0);
+                Accept(cx, ELSE);
+                PatchCode(cx, b, BufferAddress(&cx->CodeBuffer));
+                state = PN_BLOCK;
+                continue;
+            }
+            PatchCode(cx, b, BufferAddress(&cx->CodeBuffer));
+            state = PN_STATEMENT_DONE;
+            continue;
+
+        case PN_ELSE_DONE:
+            PatchCode(cx, b, BufferAddress(&cx->CodeBuffer));
+            if (c >= 0)
+                SwapIfArms(cx, c, b, BufferAddress(&cx->CodeBuffer));
+            state = PN_STATEMENT_DONE;
+            continue;
+
+        case PN_EXPRESSION:
+            PushParseFrame(cx, PN_TERMS, 0, 0, 0);
+            state = PN_COMPOUNDTERM;
+            continue;
+
+        case PN_TERMS:
+            PushParseFrame(cx, PN_ADDOPS, 0, 0, 0);
+            b = 0;
+            state = PN_OPPREC;
+            continue;
+
+        case PN_ADDOPS:
+            if (code != ADD && code != SUBTRACT)
+                break;
+            ParseAddOp(cx);
+            PushParseFrame(cx, PN_ADDOP_DONE, 0, 0, 0);
+            state = PN_COMPOUNDTERM;
+            continue;
+
+        case PN_ADDOP_DONE:
+            /*  ParseExpression tests an "op" it never sets.  */
+            EMITOP(cx, ADD == 0 ? I_ADD : I_SUB);
+            state = PN_ADDOPS;
+            continue;
+
+        case PN_COMPOUNDTERM:
+            PushParseFrame(cx, PN_MULTOPS, 0, 0, 0);
+            state = PN_TERM;
+            continue;
+
+        case PN_MULTOPS:
+            if (code != MULTIPLY && code != DIVIDE)
+                break;
+            ParseMultOp(cx);
+            PushParseFrame(cx, PN_MULTOP_DONE, 0, 0, 0);
+            state = PN_TERM;
+            continue;
+
+        case PN_MULTOP_DONE:
+            /*  So does ParseCompoundTerm.  */
+            EMITOP(cx, MULTIPLY == 0 ? I_MULT : I_DIV);
+            state = PN_MULTOPS;
+            continue;
+
+        case PN_TERM:
+            a = code == SUBTRACT;
+            if (a)
+                Accept(cx, SUBTRACT);
+            if (cx->CurrentToken.code == LEFTPARENTHESIS)
+            {
+                PushParseFrame(cx, PN_NEGATE, a, 0, 0);
+                PushParseFrame(cx, PN_PARENTHESIS, 0, 0, 0);
+                Accept(cx, LEFTPARENTHESIS);
+                state = PN_EXPRESSION;
+                continue;
+            }
+            ParseSubTerm(cx);
+            state = PN_NEGATE;
+            continue;
+
+        case PN_PARENTHESIS:
+            Accept(cx, RIGHTPARENTHESIS);
+            break;
+
+        case PN_NEGATE:
+            if (a)
+                EMITOP(cx, I_NEG);
+            break;
+
+        case PN_OPPREC:
+            a = code;
+            state = PN_OPERATORS;
+            continue;
+
+        case PN_OPERATORS:
+            if (Precedence(a) < b)
+                break;
+            cx->CurrentToken = NextToken(cx);
+            PushParseFrame(cx, PN_OPERAND_DONE, a, b, 0);
+            state = PN_TERM;
+            continue;
+
+        case PN_OPERAND_DONE:
+            if (Precedence(code) > Precedence(a))
+            {
+                PushParseFrame(cx, PN_OPERATOR_DONE, a, b, 0);
+                b = Precedence(a) + 1;
+                state = PN_OPPREC;
+                continue;
+            }
+            state = PN_OPERATOR_DONE;
+            continue;
+
+        case PN_OPERATOR_DONE:
+            EMITOP(cx, OperatorInstruction(a));
+            a = cx->CurrentToken.code;
+            state = PN_OPERATORS;
+            continue;
+        }
+
+        /*  The routine for "state" has returned.  */
+        if (cx->FrameCount == base)
+            return;
+        f = &cx->Frames[--cx->FrameCount];
+        state = f->state;
+        a = f->a;
+        b = f->b;
+        c = f->c;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Precedence, OperatorInstruction: The precedence of an operator token    */
+/*  and the instruction it emits, for ParseOpPrec and ParseNested.  Any     */
+/*  token that is not an operator ends an expression.                       */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Precedence(int code)
+{
+    switch (code)
+    {
+    case ADD:
+    case SUBTRACT:
+        return 10;
+    case MULTIPLY:
+    case DIVIDE:
+        return 20;
+    default:
+        return -1;
+    }
+}
+
+PRIVATE int OperatorInstruction(int code)
+{
+    switch (code)
+    {
+    case ADD:
+        return I_ADD;
+    case SUBTRACT:
+        return I_SUB;
+    case MULTIPLY:
+        return I_MULT;
+    default:
+        return I_DIV;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  End of parser.  Support routines follow.                                */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Accept:  Takes an expected token name as argument, and if the current   */
+/*           lookahead matches this, advances the lookahead and returns.    */
+/*                                                                          */
+/*           If the expected token fails to match the current lookahead,    */
+/*           this routine reports a syntax error and exits ("crash & burn"  */
+/*           parsing).  Note the use of routine "SyntaxError"               */
+/*           (from "scanner.h") which puts the error message on the         */
+/*           standard output and on the listing file, and the helper        */
+/*           "ReadToEndOfFile" which just ensures that the listing file is  */
+/*           completely generated.                                          */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       Integer code of expected token                          */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: If successful, advances the current lookahead token     */
+/*                  "CurrentToken".                                         */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Accept(CONTEXT *cx, int ExpectedToken)
+{
+    if (cx->Recovering)
+    {
+        while (cx->CurrentToken.code != ExpectedToken && cx->CurrentToken.code != ENDOFINPUT)
+            SkipToken(cx);
+        cx->Recovering = 0;
+    }
+    if (cx->CurrentToken.code != ExpectedToken)
+    {
+        if (ReportDiagnostic(cx, CPL_SYNTAX, ExpectedToken, "syntax error"))
+        {
+            if (!cx->Quiet)
+                printf("Syntax Error\n");
+            SyntaxError(ExpectedToken, cx->CurrentToken);
+        }
+        cx->errCount++;
+        cx->Recovering = 1;
+    }
+    else
+        cx->CurrentToken = NextToken(cx);
+}
+
+#ifndef CPL_LIBRARY
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  OpenFiles:  Reads strings from the command-line and opens the           */
+/*              associated input and listing files.                         */
+/*                                                                          */
+/*    Note that this routine mmodifies the context's "InputFile" and        */
+/*    "ListingFile".  It returns 1 ("true" in C-speak) if the input and     */
+/*    listing files are successfully opened, 0 if not, allowing the caller  */
+/*    to make a graceful exit if the opening process failed.                */
+/*                                                                          */
+/*                                                                          */
+/*    Inputs:       1) Integer argument count (standard C "argc").          */
+/*                  2) Array of pointers to C-strings containing arguments  */
+/*                  (standard C "argv").                                    */
+/*                                                                          */
+/*    Outputs:      No direct outputs, but note side effects.               */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*    Side Effects: If successful, modifies the context's "InputFile" and   */
+/*                  "ListingFile".                                          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int OpenFiles(CONTEXT *cx, int argc, char *argv[])
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "%s [options] <inputfile> <listfile> <codefile>\n", argv[0]);
+        fprintf(stderr, "%s [options] [--jobs <n>] --batch <manifest> | --tree <dir>\n", argv[0]);
+        return 0;
+    }
+
+    return OpenUnit(cx, argv[1], argv[2], argv[3]);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  OpenUnit:  Opens the input, listing and code files of one compilation  */
+/*             unit; under --check, only the input.                         */
+/*                                                                          */
+/*    Inputs:       Names of the input, listing and code files.             */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*    Side Effects: If successful, modifies the context's "InputFile",      */
+/*                  "ListFile" and "CodeFile" and the matching paths.       */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int OpenUnit(CONTEXT *cx, char *input, char *list, char *code)
+{
+    if (NULL == (cx->InputFile = fopen(input, "r")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for input\n", input);
+        return 0;
+    }
+
+    /*A check writes neither a listing nor code*/
+    if (cx->options->Check)
+    {
+        cx->ListFile = cx->CodeFile = NULL;
+        cx->InputPath = input;
+        cx->ListPath = cx->CodePath = NULL;
+        return 1;
+    }
+
+    if (NULL == (cx->ListFile = fopen(list, "w")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for output\n", list);
+        fclose(cx->InputFile);
+        return 0;
+    }
+
+    /*Added an if statement to open the CodeFile*/
+    if (NULL == (cx->CodeFile = fopen(code, "w")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for output\n", code);
+        fclose(cx->InputFile);
+        fclose(cx->ListFile);
+        return 0;
+    }
+
+    cx->InputPath = input;
+    cx->ListPath = list;
+    cx->CodePath = code;
+    return 1;
+}
+
+#endif
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ReadSource:  Reads the whole of InputFile, from the beginning, into     */
+/*               "Source", then rewinds it for the scanner.                 */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReadSource(CONTEXT *cx)
+{
+    size_t n;
+    char *grown;
+
+    if (cx->Source == NULL)
+    {
+        if (NULL == (cx->Source = malloc(8192)))
+            return 0;
+        cx->SourceCapacity = 8192;
+    }
+    rewind(cx->InputFile);
+    cx->SourceLength = 0;
+    while ((n = fread(cx->Source + cx->SourceLength, 1, cx->SourceCapacity - cx->SourceLength, cx->InputFile)) > 0)
+    {
+        cx->SourceLength += n;
+        if (cx->SourceLength == cx->SourceCapacity)
+        {
+            if (NULL == (grown = realloc(cx->Source, cx->SourceCapacity * 2)))
+                return 0;
+            cx->Source = grown;
+            cx->SourceCapacity *= 2;
+        }
+    }
+    rewind(cx->InputFile);
+    return !ferror(cx->InputFile);
+}
+
+#ifndef CPL_LIBRARY
+PRIVATE PROFILE Profile; /*  Read by ParseOptions for --profile.          */
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ParseOptions:  Removes any leading options from the command-line,       */
+/*                 leaving the file names for OpenFiles.                    */
+/*                                                                          */
+/*       --incremental <cachefile>   Reuse code for unchanged top-level    */
+/*                                   procedures from <cachefile>, and      */
+/*                                   update it for the next build.         */
+/*       --cache-dir <dir>           Look the whole compilation up in, and */
+/*                                   add it to, the cache in <dir>.        */
+/*       --cache-limit <bytes>       Evict old entries from <dir> above    */
+/*                                   this size (default 64MB).             */
+/*       --batch <manifest>          Compile every unit listed in          */
+/*                                   <manifest> in this one process.       */
+/*       --tree <dir>                Compile every .prog file under <dir>. */
+/*       --serve <socket>            Compile requests sent to a Unix       */
+/*                                   domain socket; see "serve.h".         */
+/*       --jobs <n>                  Compile --batch and --tree units on   */
+/*                                   <n> worker processes (0: one per CPU).*/
+/*       --proc-jobs <n>             Generate code for up to <n> top-level */
+/*                                   procedures at once (0: one per CPU).  */
+/*                                   Ignored with --incremental,           */
+/*                                   --profile or --dead-code.             */
+/*       --stats text|json           Report phase times and counters for   */
+/*                                   each compilation on standard error.   */
+/*       --proc-report <file>        Write a line per procedure to <file>; */
+/*                                   see "stats.h".  Turns off --proc-jobs.*/
+/*       --proc-sort source|name|time|size                                 */
+/*                                   Order of the --proc-report lines.     */
+/*       --check                     Only check the syntax of each input,  */
+/*                                   writing no listing or code: "comp1    */
+/*                                   --check <inputfile>...", or with      */
+/*                                   --batch or --tree.  Fails if any      */
+/*                                   input is invalid.                     */
+/*       --ll1                       With --check, parse with the table-   */
+/*                                   driven parser generated from          */
+/*                                   "cpl.grammar"; see "llparse.h".       */
+/*       --explicit-stack            Parse blocks, statements and          */
+/*                                   expressions on a stack on the heap    */
+/*                                   rather than by recursion, so nesting  */
+/*                                   is limited only by memory.            */
+/*                                                                          */
+/*    Every other option is recorded in "CompileFlags", which is part of    */
+/*    the compile cache key:                                                */
+/*                                                                          */
+/*       --listing none|full|errors  Write no listing (the default), the   */
+/*                                   scanner's full listing, or only the   */
+/*                                   lines around each error.              */
+/*       --format text|binary|object Write the code file as text for the   */
+/*                                   course simulator (the default), in    */
+/*                                   the binary format of "cplbin.h", or   */
+/*                                   as an object unit for cpllink; see    */
+/*                                   "cplobj.h".  Objects are compiled     */
+/*                                   without --proc-jobs.                  */
+/*       --import <objfile>          With --format object, declare the     */
+/*                                   procedures <objfile> exports, to be   */
+/*                                   linked in by cpllink.  May be given   */
+/*                                   more than once.                       */
+/*       --debug                     Add a line table and symbol map to a  */
+/*                                   binary code file.                     */
+/*       --profile <file>            Lay out IF statements, inline calls   */
+/*                                   and unroll loops by the counts        */
+/*                                   "cplprof --counts" wrote for a run of */
+/*                                   this program built without it; see    */
+/*                                   "profile.h".  The key covers the      */
+/*                                   counts, not just the file name.       */
+/*       --unroll <n>                Make <n> passes a test in each WHILE  */
+/*                                   loop counting a variable to a         */
+/*                                   constant, finishing in the loop as it */
+/*                                   was; one of few enough known passes   */
+/*                                   is unrolled completely.               */
+/*       --dead-code                 Fold branches on constants and remove */
+/*                                   unreachable code and assignments no   */
+/*                                   path reads, then say how much code    */
+/*                                   that saved; see "deadcode.h".         */
+/*       --max-errors <n>            Stop after <n> errors (default 100;   */
+/*                                   0: no limit).  An error at the same   */
+/*                                   token as the last is not reported.    */
+/*       --max-skip <n>              Stop once error recovery has skipped  */
+/*                                   <n> tokens (default 0: no limit).     */
+/*                                                                          */
+/*    Inputs:       1) Pointer to the argument count.                       */
+/*                  2) Argument vector.                                     */
+/*                                                                          */
+/*    Outputs:      Argument count and vector with the options removed.     */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*    Side Effects: Fills in "Options".                                     */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ParseOptions(int *argc, char *argv[])
+{
+    char fingerprint[24];
+    int i, n, first, neutral;
+
+    InitOptions(&Options);
+    for (i = 1; i < *argc && argv[i][0] == '-' && argv[i][1] == '-'; i++)
+    {
+        first = i;
+        neutral = 0;
+        if (strcmp(argv[i], "--incremental") == 0 && i + 1 < *argc)
+        {
+            Options.ProcCachePath = argv[++i];
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--cache-dir") == 0 && i + 1 < *argc)
+        {
+            Options.CacheDir = argv[++i];
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--cache-limit") == 0 && i + 1 < *argc)
+        {
+            Options.CacheLimit = atol(argv[++i]);
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < *argc)
+        {
+            Options.BatchPath = argv[++i];
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--tree") == 0 && i + 1 < *argc)
+        {
+            Options.TreePath = argv[++i];
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--listing") == 0 && i + 1 < *argc)
+        {
+            if (strcmp(argv[++i], "none") == 0)
+                Options.Listing = LISTING_NONE;
+            else if (strcmp(argv[i], "full") == 0)
+                Options.Listing = LISTING_FULL;
+            else if (strcmp(argv[i], "errors") == 0)
+                Options.Listing = LISTING_ERRORS;
+            else
+            {
+                fprintf(stderr, "%s: --listing takes none, full or errors\n", argv[0]);
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i], "--stats") == 0 && i + 1 < *argc)
+        {
+            if (strcmp(argv[++i], "text") == 0)
+                Options.Stats = STATS_TEXT;
+            else if (strcmp(argv[i], "json") == 0)
+                Options.Stats = STATS_JSON;
+            else
+            {
+                fprintf(stderr, "%s: --stats takes text or json\n", argv[0]);
+                return 0;
+            }
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--proc-report") == 0 && i + 1 < *argc)
+        {
+            Options.ProcReportPath = argv[++i];
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--proc-sort") == 0 && i + 1 < *argc)
+        {
+            if (strcmp(argv[++i], "source") == 0)
+                Options.ProcSort = PROCSORT_SOURCE;
+            else if (strcmp(argv[i], "name") == 0)
+                Options.ProcSort = PROCSORT_NAME;
+            else if (strcmp(argv[i], "time") == 0)
+                Options.ProcSort = PROCSORT_TIME;
+            else if (strcmp(argv[i], "size") == 0)
+                Options.ProcSort = PROCSORT_SIZE;
+            else
+            {
+                fprintf(stderr, "%s: --proc-sort takes source, name, time or size\n", argv[0]);
+                return 0;
+            }
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--format") == 0 && i + 1 < *argc)
+        {
+            if (strcmp(argv[++i], "text") == 0)
+                Options.Format = CODE_TEXT;
+            else if (strcmp(argv[i], "binary") == 0)
+                Options.Format = CODE_BINARY;
+            else if (strcmp(argv[i], "object") == 0)
+                Options.Format = CODE_OBJECT;
+            else
+            {
+                fprintf(stderr, "%s: --format takes text, binary or object\n", argv[0]);
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i], "--import") == 0 && i + 1 < *argc)
+        {
+            if (Options.ImportCount == MAXIMPORTS)
+            {
+                fprintf(stderr, "%s: more than %d --import options\n", argv[0], MAXIMPORTS);
+                return 0;
+            }
+            Options.Imports[Options.ImportCount++] = argv[++i];
+        }
+        else if (strcmp(argv[i], "--debug") == 0)
+            Options.Debug = 1;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < *argc)
+        {
+            FreeProfile(&Profile);
+            if (!ReadProfile(argv[++i], &Profile))
+            {
+                fprintf(stderr, "%s: cannot read profile \"%s\"\n", argv[0], argv[i]);
+                return 0;
+            }
+            Options.Profile = &Profile;
+        }
+        else if (strcmp(argv[i], "--unroll") == 0 && i + 1 < *argc)
+        {
+            if ((Options.Unroll = atoi(argv[++i])) <= 0)
+            {
+                fprintf(stderr, "%s: --unroll takes a factor of 1 or more\n", argv[0]);
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i], "--dead-code") == 0)
+            Options.DeadCode = 1;
+        else if (strcmp(argv[i], "--check") == 0)
+        {
+            Options.Check = 1;
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--explicit-stack") == 0)
+        {
+            Options.ExplicitStack = 1;
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--ll1") == 0)
+        {
+            Options.LL1 = 1;
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--max-errors") == 0 && i + 1 < *argc)
+            Options.MaxErrors = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--max-skip") == 0 && i + 1 < *argc)
+            Options.MaxSkip = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < *argc)
+        {
+            Options.ServePath = argv[++i];
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < *argc)
+        {
+            if ((Options.Jobs = atoi(argv[++i])) <= 0)
+                Options.Jobs = DefaultWorkers();
+            neutral = 1;
+        }
+        else if (strcmp(argv[i], "--proc-jobs") == 0 && i + 1 < *argc)
+        {
+            if ((Options.ProcJobs = atoi(argv[++i])) <= 0)
+                Options.ProcJobs = DefaultWorkers();
+            neutral = 1;
+        }
+        else
+        {
+            fprintf(stderr, "%s: unknown or incomplete option \"%s\"\n", argv[0], argv[i]);
+            return 0;
+        }
+
+        for (; !neutral && first <= i; first++)
+        {
+            if (strlen(Options.CompileFlags) + strlen(argv[first]) + 2 > MAXFLAGS)
+                return 0;
+            strcat(Options.CompileFlags, argv[first]);
+            strcat(Options.CompileFlags, " ");
+        }
+    }
+
+    if (Options.Profile != NULL)
+    {
+        sprintf(fingerprint, "%016llx ", Options.Profile->fingerprint);
+        if (strlen(Options.CompileFlags) + strlen(fingerprint) + 1 > MAXFLAGS)
+            return 0;
+        strcat(Options.CompileFlags, fingerprint);
+    }
+
+    if (Options.Debug && Options.Format != CODE_BINARY)
+    {
+        fprintf(stderr, "%s: --debug needs --format binary\n", argv[0]);
+        return 0;
+    }
+
+    if (Options.Check && (Options.Debug || Options.ProcCachePath != NULL || Options.CacheDir != NULL ||
+                          Options.ServePath != NULL))
+    {
+        fprintf(stderr, "%s: --check takes no --debug, --incremental, --cache-dir or --serve\n", argv[0]);
+        return 0;
+    }
+
+    if (Options.Profile != NULL && (Options.Format == CODE_OBJECT || Options.Check || Options.ProcCachePath != NULL))
+    {
+        fprintf(stderr, "%s: --profile takes no --format object, --check or --incremental\n", argv[0]);
+        return 0;
+    }
+
+    if (Options.Unroll > 0 && Options.ProcCachePath != NULL)
+    {
+        fprintf(stderr, "%s: --unroll takes no --incremental\n", argv[0]);
+        return 0;
+    }
+
+    if (Options.DeadCode && Options.ProcCachePath != NULL)
+    {
+        fprintf(stderr, "%s: --dead-code takes no --incremental\n", argv[0]);
+        return 0;
+    }
+
+    if (Options.ImportCount > 0 && Options.Format != CODE_OBJECT)
+    {
+        fprintf(stderr, "%s: --import needs --format object\n", argv[0]);
+        return 0;
+    }
+
+    if (Options.LL1 && !Options.Check)
+    {
+        fprintf(stderr, "%s: --ll1 needs --check\n", argv[0]);
+        return 0;
+    }
+
+    for (n = 1; i < *argc; n++, i++)
+        argv[n] = argv[i];
+    *argc = n;
+    return 1;
+}
+#endif
+
+PRIVATE void MakeSymbolTableEntry(CONTEXT *cx, int symtype)
+{
+    /*Variable declarations*/
+    SYMBOL *oldsptr;
+    SYMBOL *newsptr;
+
+    char *cptr;
+    int hashindex, phase;
     int varaddress = 0;
 
-    if (CurrentToken.code == IDENTIFIER)
+    if (CHECKING(cx))
+        return;
+    if (cx->CurrentToken.code == IDENTIFIER)
+    {
+        if (NULL == (oldsptr = ProbeSymbol(cx, cx->CurrentToken.s, &hashindex)) || oldsptr->scope < cx->scope)
+        {
+            if (oldsptr == NULL)
+                cptr = cx->CurrentToken.s;
+            else
+                cptr = oldsptr->s;
+            phase = EnterPhase(&cx->Stats, STAT_SYMBOLS);
+            newsptr = EnterSymbol(cptr, hashindex);
+            COUNT_STAT(&cx->Stats, STAT_ENTERS);
+            EnterPhase(&cx->Stats, phase);
+            if (newsptr == NULL)
+            {
+                BufferKill(&cx->CodeBuffer);
+            }
+            else
+            {
+                if (oldsptr == NULL)
+                    PreserveString();
+                newsptr->scope = cx->scope;
+                newsptr->type = symtype;
+                if (symtype == STYPE_VARIABLE)
+                {
+                    newsptr->address = varaddress;
+                    if (cx->options->Debug)
+                        AddDebugSymbol(cx, ArenaString(&cx->Arena, cptr), STYPE_VARIABLE, cx->scope,
+                                       varaddress, cx->DebugOwner);
+                    if (cx->scope == 1)
+                        cx->DataSize++;
+                    varaddress++;
+                }
+                else
+                    newsptr->address = -1;
+            }
+        }
+        else
+        {
+            if (ReportDiagnostic(cx, CPL_SEMANTIC, -1, "variable already declared"))
+                Error("Variable already declared", cx->CurrentToken.pos);
+        }
+    }
+}
+
+PRIVATE SYMBOL *LookupSymbol(CONTEXT *cx)
+{
+    SYMBOL *sptr;
+    if (cx->CurrentToken.code == IDENTIFIER && !CHECKING(cx))
+    {
+        sptr = ProbeSymbol(cx, cx->CurrentToken.s, NULL);
+        if (sptr == NULL)
+        {
+            if (ReportDiagnostic(cx, CPL_SEMANTIC, -1, "identifier not declared"))
+                Error("Identifier not declared", cx->CurrentToken.pos);
+            BufferKill(&cx->CodeBuffer);
+        }
+    }
+    else
+        sptr = NULL;
+
+    return sptr;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ProbeSymbol, PatchCode: Probe() and BufferBackPatch(), counted, with    */
+/*  the Probe() timed as symbol table work.                                 */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE SYMBOL *ProbeSymbol(CONTEXT *cx, char *s, int *hashindex)
+{
+    int phase = EnterPhase(&cx->Stats, STAT_SYMBOLS);
+    SYMBOL *sptr = Probe(s, hashindex);
+
+    COUNT_STAT(&cx->Stats, STAT_PROBES);
+    EnterPhase(&cx->Stats, phase);
+    return sptr;
+}
+
+PRIVATE void PatchCode(CONTEXT *cx, int location, int address)
+{
+    if (CHECKING(cx))
+        return;
+    BufferBackPatch(&cx->CodeBuffer, location, address);
+    COUNT_STAT(&cx->Stats, STAT_BACKPATCHES);
+}
+
+/*Need to be called in ParseExpression somewhere*/
+
+PRIVATE void ParseOpPrec(CONTEXT *cx, int minPrec)
+{
+    /* Declare 2 variables which will be used to determine precedence */
+    int op1, op2;
+
+    /* Set op1 to whatever the current symbol is */
+    op1 = cx->CurrentToken.code;
+
+    /* Begin a loop to check precedence - note that if the end of the expression is */
+    /* reached, precedence will be less than one, which will end the loop */
+    while (Precedence(op1) >= minPrec)
+    {
+        cx->CurrentToken = NextToken(cx);
+
+        /* NOTE: This ParseTerm() was previously ParseInt(). This was replaced to handle */
+        /* parentheses and unary minuses */
+        ParseTerm(cx);
+        /* Get the second operator and write it to op2 */
+        op2 = cx->CurrentToken.code;
+
+        /* If op1 has a higher precedence than op2, op1 is run immediately */
+        /* Otherwise, the precedence of op1 is incremented and the function is */
+        /* called recursively */
+        if (Precedence(op2) > Precedence(op1))
+            ParseOpPrec(cx, Precedence(op1) + 1);
+
+        /* Emit whatever the operation is for op1 using OperatorInstruction() */
+        EMITOP(cx, OperatorInstruction(op1));
+        op1 = cx->CurrentToken.code;
+    }
+}
+
+/*Syncronise function which is used for the augmented error recovery*/
+PRIVATE void Synchronise(CONTEXT *cx, SET *F, SET *FB)
+{
+    SET S;
+
+    S = Union(2, F, FB);
+    if (!InSet(F, cx->CurrentToken.code))
+    {
+        if (ReportDiagnostic(cx, CPL_SYNTAX, -1, "unexpected token"))
+            SyntaxError2(*F, cx->CurrentToken);
+        cx->syncCount++;
+        COUNT_STAT(&cx->Stats, STAT_RECOVERIES);
+        while (!InSet(&S, cx->CurrentToken.code) && cx->CurrentToken.code != ENDOFINPUT)
+        {
+            SkipToken(cx);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ReportDiagnostic:  Records an error found at the current lookahead,     */
+/*                     unless it only repeats the one before it or the      */
+/*                     compilation has been abandoned.                      */
+/*                                                                          */
+/*    An error of the same kind and at the same source offset as the last  */
+/*    one is part of the same cascade (Synchronise and then Accept, say,   */
+/*    both stopping at one token) and is dropped.  Once --max-errors       */
+/*    have been recorded, the next error abandons the compilation          */
+/*    instead; with --max-errors 0 there is no limit.  Dropped errors      */
+/*    still count in "errCount" and "syncCount", so the program stays      */
+/*    invalid.                                                             */
+/*    A check knows no symbols, so it reports no semantic errors.          */
+/*                                                                          */
+/*    Inputs:       1) Kind of error, CPL_SYNTAX or CPL_SEMANTIC.           */
+/*                  2) Expected token code, or -1.                          */
+/*                  3) Message for the diagnostic record.                   */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      1 if it was recorded and the caller should print it,    */
+/*                  0 if not.                                               */
+/*                                                                          */
+/*    Side Effects: May add to "Diagnostics" and abandon the compilation.   */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReportDiagnostic(CONTEXT *cx, int kind, int expected, char *message)
+{
+    CPLDIAGNOSTIC *last;
+
+    if (cx->Abandoned || (kind == CPL_SEMANTIC && CHECKING(cx)))
+        return 0;
+    last = cx->DiagnosticCount > 0 ? &cx->Diagnostics[cx->DiagnosticCount - 1] : NULL;
+    if (last != NULL && last->kind == kind && last->pos == cx->CurrentToken.pos)
+        return 0;
+    if (cx->options->MaxErrors > 0 && cx->DiagnosticCount == cx->options->MaxErrors)
+    {
+        Abandon(cx, "Too many errors; compilation stopped");
+        return 0;
+    }
+    AddDiagnostic(cx, kind, &cx->CurrentToken, expected, message);
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  SkipToken: Passes over the lookahead during error recovery, abandoning  */
+/*  the compilation once --max-skip tokens have been skipped.              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void SkipToken(CONTEXT *cx)
+{
+    cx->CurrentToken = NextToken(cx);
+    if (++cx->Skipped == cx->options->MaxSkip)
+        Abandon(cx, "Too many tokens skipped; compilation stopped");
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Abandon: Stops a compilation that has run over one of its error         */
+/*  budgets.  NextToken() reads nothing more and returns ENDOFINPUT, so     */
+/*  the parse unwinds in steps bounded by how deeply it is nested.          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Abandon(CONTEXT *cx, char *reason)
+{
+    if (!cx->Abandoned)
+    {
+        Error(reason, cx->CurrentToken.pos);
+        cx->Abandoned = 1;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  NextToken:  Returns the next lookahead token.  Tokens that have been    */
+/*              read ahead into "Pending" are handed back first, then the   */
+/*              scanner is called as normal.  A detached context gets      */
+/*              ENDOFINPUT instead, as it shares the input file's offset    */
+/*              with its parent, and so does an abandoned one, at the      */
+/*              offset where it stopped.                                    */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE TOKEN NextToken(CONTEXT *cx)
+{
+    TOKEN token;
+
+    if (cx->Abandoned)
+    {
+        token = cx->CurrentToken;
+        token.code = ENDOFINPUT;
+        return token;
+    }
+    if (TokensPending(&cx->Pending))
+        return NextBufferedToken(&cx->Pending);
+    if (cx->Detached)
+    {
+        memset(&token, 0, sizeof(token));
+        token.code = ENDOFINPUT;
+        return token;
+    }
+    return ScanToken(cx);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ScanToken: GetToken(), counted and timed as scanning.                   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE TOKEN ScanToken(CONTEXT *cx)
+{
+    int phase = EnterPhase(&cx->Stats, STAT_SCAN);
+    TOKEN token = GetToken();
+
+    COUNT_STAT(&cx->Stats, STAT_TOKENS);
+    EnterPhase(&cx->Stats, phase);
+    return token;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  CaptureProcedure:  Reads the rest of a procedure declaration, from the  */
+/*                     current lookahead up to the ";" after the END of     */
+/*                     its block, into "Pending" and fingerprints it.       */
+/*                                                                          */
+/*    The fingerprint covers every token and its offset from the first,     */
+/*    so that cached source offsets stay right, plus the type, scope and    */
+/*    address of each already-declared symbol the procedure names, so a     */
+/*    change to a global it uses invalidates it too.  Nested procedures     */
+/*    are part of the enclosing procedure's capture.  Whether --debug is   */
+/*    on is hashed first, since only then does the entry carry symbols.     */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Fingerprint, or 0 if input ended first.                 */
+/*                                                                          */
+/*    Side Effects: Tokens moved into "Pending"; the caller must reload     */
+/*                  "CurrentToken" with NextToken() or discard them.  The  */
+/*                  last, the token after END, is not fingerprinted, so    */
+/*                  one discarding them must still accept it as the ";".   */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE FINGERPRINT CaptureProcedure(CONTEXT *cx)
+{
+    FINGERPRINT fp = FINGERPRINT_SEED;
+    SYMBOL *sptr;
+    TOKEN token;
+    int depth = 0, nested = 0, origin;
+
+    token = cx->CurrentToken;
+    origin = token.pos;
+    fp = HashInt(fp, cx->options->Debug);
+    for (;;)
+    {
+        AppendToken(&cx->Pending, token);
+        token = cx->Pending.tokens[cx->Pending.count - 1];
+
+        fp = HashInt(fp, token.code);
+        fp = HashInt(fp, token.pos - origin);
+        if (token.code == INTCONST)
+            fp = HashInt(fp, token.value);
+        else if (token.code == IDENTIFIER)
+        {
+            fp = HashString(fp, token.s);
+            if (NULL != (sptr = ProbeSymbol(cx, token.s, NULL)))
+            {
+                fp = HashInt(fp, sptr->type);
+                fp = HashInt(fp, sptr->scope);
+                fp = HashInt(fp, sptr->address);
+            }
+        }
+
+        if (token.code == ENDOFINPUT)
+            return 0;
+        else if (token.code == PROCEDURE)
+            nested++;
+        else if (token.code == BEGIN)
+            depth++;
+        else if (token.code == END && --depth == 0)
+        {
+            if (nested == 0)
+                break;
+            nested--;
+        }
+
+        token = ScanToken(cx);
+    }
+
+    AppendToken(&cx->Pending, ScanToken(cx));
+    return fp != 0 ? fp : 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CapturedScopes: The deepest scope parsing the procedure captured in     */
+/*  "Pending" would open, for a replayed procedure's report line.  Each     */
+/*  nested procedure and each block goes one scope deeper.                  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int CapturedScopes(CONTEXT *cx)
+{
+    int i, code, depth = 0, nested = 0, peak = 0;
+
+    for (i = 0; i < cx->Pending.count - 1; i++)
     {
-        if (NULL == (oldsptr = Probe(CurrentToken.s, &hashindex)) || oldsptr->scope < scope)
+        code = cx->Pending.tokens[i].code;
+        if (code == PROCEDURE)
+            nested++;
+        else if (code == BEGIN)
         {
-            if (oldsptr == NULL)
-                cptr = CurrentToken.s;
-            else
-                cptr = oldsptr->s;
-            if (NULL == (newsptr = EnterSymbol(cptr, hashindex)))
+            depth++;
+            if (peak < nested + depth)
+                peak = nested + depth;
+        }
+        else if (code == END && --depth == 0 && nested > 0)
+            nested--;
+    }
+    return cx->scope + 1 + peak;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  DeclaredProcedure: The symbol of the procedure whose heading has just   */
+/*  been parsed, or NULL if "name" is NULL or is not a procedure declared   */
+/*  in the current scope.                                                   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE SYMBOL *DeclaredProcedure(CONTEXT *cx, char *name)
+{
+    SYMBOL *proc;
+
+    if (name == NULL || CHECKING(cx) || NULL == (proc = ProbeSymbol(cx, name, NULL)) ||
+        proc->type != STYPE_PROCEDURE || proc->scope != cx->scope)
+        return NULL;
+    return proc;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReplayProcedure: Appends a procedure's cached or child-compiled code   */
+/*  to the buffer in place of compiling its body.  Its address is set      */
+/*  first, so that recursive calls in the code resolve to it, and it and   */
+/*  its nested procedures are added to the procedure table, and under      */
+/*  --debug its symbols to the debug map, if the replay succeeds.          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReplayProcedure(CONTEXT *cx, SYMBOL *proc, PCENTRY *entry, int origin)
+{
+    int start = BufferAddress(&cx->CodeBuffer), base = cx->SymbolCount, i;
+    CODESYMBOL *sym;
+    PCPROC *p;
+
+    if (proc == NULL)
+        return 0;
+    proc->address = start + entry->entry;
+    if (!ReplayProcCache(entry, &cx->CodeBuffer, origin))
+    {
+        proc->address = -1;
+        return 0;
+    }
+    ResolveCallFixups(cx, proc);
+    for (i = 0; i < entry->nestedCount; i++)
+    {
+        p = &entry->nested[i];
+        AddProcedure(cx, ArenaString(&cx->Arena, p->name), start + p->start, start + p->entry, start + p->end);
+    }
+    AddProcedure(cx, ArenaString(&cx->Arena, proc->s), start, proc->address, BufferAddress(&cx->CodeBuffer));
+    for (i = 0; cx->options->Debug && i < entry->symbolCount; i++)
+    {
+        sym = &entry->symbols[i];
+        AddDebugSymbol(cx, ArenaString(&cx->Arena, sym->name), sym->kind, sym->depth,
+                       sym->kind == STYPE_PROCEDURE && sym->address >= 0 ? start + sym->address : sym->address,
+                       sym->owner >= 0 ? base + sym->owner : cx->DebugOwner);
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ImportProcedures: Declares the procedures each --import unit exports   */
+/*  at the top level.  They never get an address here, so calls to them    */
+/*  only ever reach the object by name, for cpllink to resolve.  A unit    */
+/*  that cannot be read, or a name declared twice, stops any code being    */
+/*  written.                                                                */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ImportProcedures(CONTEXT *cx)
+{
+    CPLOBJECT unit;
+    SYMBOL *sptr;
+    char *path, *name;
+    int hashindex, i, j;
+
+    for (i = 0; i < cx->options->ImportCount && !CHECKING(cx); i++)
+    {
+        path = cx->options->Imports[i];
+        InitObject(&unit);
+        if (!ReadObject(path, &unit))
+        {
+            fprintf(stderr, "cannot read object \"%s\"\n", path);
+            BufferKill(&cx->CodeBuffer);
+            continue;
+        }
+
+        for (j = 0; j < unit.procCount; j++)
+        {
+            name = unit.procs[j]->name;
+            if (NULL != (sptr = ProbeSymbol(cx, name, &hashindex)) && sptr->scope == cx->scope)
             {
-                KillCodeGeneration();
+                fprintf(stderr, "procedure \"%s\" from \"%s\" is already declared\n", name, path);
+                BufferKill(&cx->CodeBuffer);
             }
+            else if (NULL == (sptr = EnterSymbol(sptr != NULL ? sptr->s : ArenaString(&cx->Arena, name), hashindex)))
+                BufferKill(&cx->CodeBuffer);
             else
             {
-                if (oldsptr == NULL)
-                    PreserveString();
-                newsptr->scope = scope;
-                newsptr->type = symtype;
-                if (symtype == STYPE_VARIABLE)
-                {
-                    newsptr->address = varaddress;
-                    varaddress++;
-                }
-                else
-                    newsptr->address = -1;
+                COUNT_STAT(&cx->Stats, STAT_ENTERS);
+                sptr->scope = cx->scope;
+                sptr->type = STYPE_PROCEDURE;
+                sptr->address = -1;
             }
         }
-        else
-        {
-            Error("Variable already declared", CurrentToken.pos);
-        }
+        FreeObject(&unit);
     }
 }
 
-PRIVATE SYMBOL *LookupSymbol(void)
+/*--------------------------------------------------------------------------*/
+/*  ExportProcedure: Under --format object, adds the top-level procedure   */
+/*  just compiled from "start" on to the unit, with the procedures nested  */
+/*  in it from procedure table entry "procs" on.                            */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ExportProcedure(CONTEXT *cx, SYMBOL *proc, int start, int procs)
 {
-    SYMBOL *sptr;
-    if (CurrentToken.code == IDENTIFIER)
+    if (cx->options->Format != CODE_OBJECT || cx->scope != 1 || proc == NULL || CHECKING(cx) ||
+        cx->CodeBuffer.killed)
+        return;
+    if (!AddObjectProc(&cx->Object, proc->s, &cx->CodeBuffer, start, proc->address, BufferAddress(&cx->CodeBuffer),
+                       &cx->Procs[procs], cx->ProcCount - procs - 1))
     {
-        sptr = Probe(CurrentToken.s, NULL);
-        if (sptr == NULL)
-        {
-            Error("Identifier not declared", CurrentToken.pos);
-            KillCodeGeneration();
-        }
+        fprintf(stderr, "out of memory for object unit\n");
+        BufferKill(&cx->CodeBuffer);
     }
-    else
-        sptr = NULL;
+}
 
-    return sptr;
+/*--------------------------------------------------------------------------*/
+/*  EliminateDeadCode: Under --dead-code, removes the dead code of the     */
+/*  block just generated from "start": a procedure's if "procedure" is     */
+/*  set, whose variables may be read after it returns, or else the main    */
+/*  program's.  See "deadcode.h".                                           */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void EliminateDeadCode(CONTEXT *cx, int start, int procedure)
+{
+    int count = BufferAddress(&cx->CodeBuffer) - start, removed, *map;
+
+    if (!cx->options->DeadCode || cx->CodeBuffer.killed || count <= 0)
+        return;
+    if (NULL == (map = malloc((count + 1) * sizeof(int))))
+    {
+        fprintf(stderr, "out of memory eliminating dead code\n");
+        exit(EXIT_FAILURE);
+    }
+    if ((removed = RemoveDeadCode(&cx->CodeBuffer, start, procedure, map)) > 0)
+    {
+        RemapCallFixups(cx, start, count, map);
+        cx->ProfileShift -= removed;
+        cx->Stats.counts[STAT_REMOVED] += removed;
+    }
+    free(map);
 }
 
-/*Need to be called in ParseExpression somewhere*/
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Profile-guided code generation.  Under --profile the counts of a run    */
+/*  of this program, built without --profile, --unroll or --dead-code,      */
+/*  decide three things:                                                    */
+/*                                                                          */
+/*    - An IF whose THEN arm ran more often than its ELSE arm has them      */
+/*      swapped, so the hot arm is the one that needs no BR over the        */
+/*      other to reach the end of the statement.                            */
+/*    - A call from hot code to a procedure called hot and whose block is   */
+/*      no longer than INLINE_LIMIT is replaced by a copy of that block.    */
+/*    - A hot WHILE loop that went round at least twice each time it ran    */
+/*      has its test and body repeated, so it takes one BR back to the top */
+/*      for every few passes rather than one for each.                      */
+/*                                                                          */
+/*    Each change keeps what the code does; where the counts do not fit    */
+/*    the code, because the profile is of another program, the code is    */
+/*    only laid out less well.  The profiled address of code now being    */
+/*    generated is its address less "ProfileShift", the instructions       */
+/*    inlining and unrolling have added before it.  Code they copy is not   */
+/*    looked up again.                                                      */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
 
-/* Declare the operator instruction array */
-int operatorInstruction[4];
+/*--------------------------------------------------------------------------*/
+/*  EndWhileStatement: Ends a WHILE loop whose test starts at "top" and    */
+/*  leaves by the branch at "exit", with its body just generated.  Unless  */
+/*  UnrollCountedLoop() can rebuild it, repeats test and body as            */
+/*  UnrollFactor() says, branches back to the top, then patches every copy */
+/*  of the exit branch to come to the end.                                  */
+/*--------------------------------------------------------------------------*/
 
-PRIVATE void ParseOpPrec(int minPrec)
+PRIVATE void EndWhileStatement(CONTEXT *cx, int top, int exit)
 {
-    /* Declare 2 variables which will be used to determine precedence */
-    int op1, op2;
+    int factor, length, i, counted = UnrollCountedLoop(cx, top, exit);
+
+    if (cx->StoreLoop == top)
+        cx->StoreLoop = -1;
+    if (counted)
+        return;
+    factor = UnrollFactor(cx, top);
+    length = BufferAddress(&cx->CodeBuffer) - top;
+    for (i = 1; i < factor; i++)
+        CopyCode(cx, top, length);
+    EMIT(cx, I_BR, top);
+    for (i = 0; i < factor; i++)
+        PatchCode(cx, exit + i * length, BufferAddress(&cx->CodeBuffer));
+    if (factor > 1)
+        COUNT_STAT(&cx->Stats, STAT_UNROLLED);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  UnrollFactor: How many copies of the loop from "top" to here to make,  */
+/*  1 unless the branch back to its top is hot.  That branch's count is    */
+/*  the passes made; its target's, less those, the times the loop was      */
+/*  entered.                                                                */
+/*--------------------------------------------------------------------------*/
 
-    /* Declare the precedence array */
-    int prec[5];
+PRIVATE int UnrollFactor(CONTEXT *cx, int top)
+{
+    PROFILE *p = cx->options->Profile;
+    PROFEDGE *edge;
+    long long entered;
+    int n, length = BufferAddress(&cx->CodeBuffer) - top, factor;
+
+    if (p == NULL || cx->CodeBuffer.killed || length <= 0 ||
+        NULL == (edge = ProfileEdges(p, BufferAddress(&cx->CodeBuffer) - cx->ProfileShift, &n)) || n != 1 ||
+        edge->count < p->hot || (entered = BlockCount(p, edge->to) - edge->count) <= 0)
+        return 1;
+    factor = edge->count / entered < UNROLL_MAX ? (int)(edge->count / entered) : UNROLL_MAX;
+    while (factor > 1 && factor * length + 1 > UNROLL_LIMIT)
+        factor--;
+    return factor > 1 ? factor : 1;
+}
 
-    /*This can be moved to a neater location later, but it's fine to leave it */
-    /*here for now. */
-    prec[ADD] = 10;
-    prec[SUBTRACT] = 10;
-    prec[MULTIPLY] = 20;
-    prec[DIVIDE] = 20;
-    prec[LEFTPARENTHESIS] = -1;
-    prec[SEMICOLON] = -1;
+/*--------------------------------------------------------------------------*/
+/*  CopyCode: Appends a copy of the "count" instructions at "from", with   */
+/*  the calls in them still waiting for their callee.                       */
+/*--------------------------------------------------------------------------*/
 
-    /* Again, this can be moved later */
-    operatorInstruction[ADD] = I_ADD;
-    operatorInstruction[SUBTRACT] = I_SUB;
-    operatorInstruction[MULTIPLY] = I_MULT;
-    operatorInstruction[DIVIDE] = I_DIV;
+PRIVATE void CopyCode(CONTEXT *cx, int from, int count)
+{
+    INSTRUCTION *code = BufferInstruction(&cx->CodeBuffer, from);
 
-    /* Set op1 to whatever the current symbol is */
-    op1 = CurrentToken.code;
+    if (code == NULL || count <= 0)
+        return;
+    MoveCallFixups(cx, from, count, BufferAddress(&cx->CodeBuffer), 1);
+    BufferAppend(&cx->CodeBuffer, code, count, from);
+    cx->ProfileShift += count;
+}
 
-    /* Begin a loop to check precedence - note that if the end of the expression is */
-    /* reached, precedence will be less than one, which will end the loop */
-    while (prec[op1] >= minPrec)
+/*--------------------------------------------------------------------------*/
+/*  HotThenArm: True if the IF whose condition branches at "cond" should   */
+/*  have its arms swapped, should it have an ELSE: the condition fell      */
+/*  through to the THEN arm more often than it branched to the other.      */
+/*  A test for "=" branches unconditionally and cannot be turned round.    */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int HotThenArm(CONTEXT *cx, int cond)
+{
+    INSTRUCTION *branch;
+    PROFEDGE *edges;
+    long long then = 0, other = 0;
+    int n, i, at = cond - cx->ProfileShift;
+
+    if (cx->options->Profile == NULL || NULL == (branch = BufferInstruction(&cx->CodeBuffer, cond)) ||
+        branch->op == I_BR || !IsBranchOp(branch->op))
+        return 0;
+    edges = ProfileEdges(cx->options->Profile, at, &n);
+    for (i = 0; i < n; i++)
     {
-        CurrentToken = GetToken();
+        if (edges[i].to == at + 1)
+            then += edges[i].count;
+        else
+            other += edges[i].count;
+    }
+    return then > other;
+}
 
-        /* NOTE: This ParseTerm() was previously ParseInt(). This was replaced to handle */
-        /* parentheses and unary minuses */
-        ParseTerm();
-        /* Get the second operator and write it to op2 */
-        op2 = CurrentToken.code;
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  SwapIfArms:  Turns an IF round, so that                                 */
+/*                                                                          */
+/*       cond: B<not c> else; <then>; jump: BR end; else: <else>; end:      */
+/*                                                                          */
+/*    becomes                                                               */
+/*                                                                          */
+/*       cond: B<c> then; <else>; BR end; then: <then>; end:                */
+/*                                                                          */
+/*    Branches within each arm move with it, and one to the end of an arm   */
+/*    goes where that arm now ends.  Nothing outside the statement can     */
+/*    branch into it, so nothing else changes but calls still waiting for  */
+/*    their callee.                                                         */
+/*                                                                          */
+/*    Inputs:       1) Address of the condition's branch.                   */
+/*                  2) Address of the BR ending the THEN arm.               */
+/*                  3) Address just after the ELSE arm.                     */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
 
-        /* If op1 has a higher precedence than op2, op1 is run immediately */
-        /* Otherwise, the precedence of op1 is incremented and the function is */
-        /* called recursively */
-        if (prec[op2] > prec[op1])
-            ParseOpPrec(prec[op1] + 1);
+PRIVATE void SwapIfArms(CONTEXT *cx, int cond, int jump, int end)
+{
+    INSTRUCTION *code, *arms, *armsThen, *armsElse;
+    int thenLength = jump - cond - 1, elseLength = end - jump - 1, i;
+
+    if (cx->CodeBuffer.killed || NULL == (code = BufferInstruction(&cx->CodeBuffer, cond)) ||
+        BufferAddress(&cx->CodeBuffer) != end)
+        return;
+    if (NULL == (arms = malloc((end - cond - 1) * sizeof(INSTRUCTION))))
+    {
+        fprintf(stderr, "out of memory in code generator\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(arms, code + 1, (end - cond - 1) * sizeof(INSTRUCTION));
+    armsThen = arms;
+    armsElse = arms + thenLength + 1;
+
+    for (i = 0; i < elseLength; i++)
+    {
+        if (IsBranchOp(armsElse[i].op) && armsElse[i].operand > jump && armsElse[i].operand <= end)
+            armsElse[i].operand -= jump - cond;
+    }
+    for (i = 0; i < thenLength; i++)
+    {
+        if (IsBranchOp(armsThen[i].op) && armsThen[i].operand > cond && armsThen[i].operand <= jump)
+            armsThen[i].operand += elseLength + 1;
+    }
+    memcpy(code + 1, armsElse, elseLength * sizeof(INSTRUCTION));
+    code[1 + elseLength] = arms[thenLength];
+    memcpy(code + 2 + elseLength, armsThen, thenLength * sizeof(INSTRUCTION));
+    free(arms);
 
-        /* Emit whatever the operation is for op1 using the operatorInstruction */
-        /* array above. */
-        _Emit(operatorInstruction[op1]);
-        op1 = CurrentToken.code;
+    switch (code->op)
+    {
+    case I_BG:
+        code->op = I_BLZ;
+        break;
+    case I_BLZ:
+        code->op = I_BG;
+        break;
+    case I_BL:
+        code->op = I_BGZ;
+        break;
+    case I_BGZ:
+        code->op = I_BL;
+        break;
     }
+    code->operand = cond + 2 + elseLength;
+
+    /*The THEN arm's fixups go past the end first, out of the ELSE arm's way.*/
+    MoveCallFixups(cx, cond + 1, thenLength, end + 1, 0);
+    MoveCallFixups(cx, jump + 1, elseLength, cond + 1, 0);
+    MoveCallFixups(cx, end + 1, thenLength, cond + 2 + elseLength, 0);
+    COUNT_STAT(&cx->Stats, STAT_SWAPPED);
 }
 
-/*Syncronise function which is used for the augmented error recovery*/
-PRIVATE void Synchronise(SET *F, SET *FB)
+/*--------------------------------------------------------------------------*/
+/*  SaveInlineBody: Keeps the block of "proc", just ended at "end", if      */
+/*  the profile called it hot and InlineCall() could use it: it is short,  */
+/*  and every call in it has its address and is not to itself.             */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void SaveInlineBody(CONTEXT *cx, SYMBOL *proc, int end)
 {
-    SET S;
+    PROFILE *p = cx->options->Profile;
+    INSTRUCTION *code;
+    int count = end - proc->address, i;
+
+    if (p == NULL || cx->CodeBuffer.killed || count > INLINE_LIMIT || ProfileCalls(p, proc->s) < p->hot)
+        return;
+    if (NULL == (code = BufferInstruction(&cx->CodeBuffer, proc->address)) && count > 0)
+        return;
+    for (i = 0; i < count; i++)
+    {
+        if (code[i].op == I_CALL && (code[i].operand < 0 || code[i].operand == proc->address))
+            return;
+    }
+    AddInlineBody(cx, proc->address, code, count);
+}
 
-    S = Union(2, F, FB);
-    if (!InSet(F, CurrentToken.code))
+/*--------------------------------------------------------------------------*/
+/*  InlineCall: Generates a copy of the block of "callee" in place of a    */
+/*  call to it, if the call is in hot code and the block was kept by       */
+/*  SaveInlineBody().  Returns 1 if it did, 0 if a CALL is still needed.   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int InlineCall(CONTEXT *cx, SYMBOL *callee)
+{
+    PROFILE *p = cx->options->Profile;
+    INLINEBODY *body;
+
+    if (p == NULL || cx->CodeBuffer.killed || callee->address < 0 ||
+        NULL == (body = FindInlineBody(cx, callee->address)) ||
+        BlockCount(p, BufferAddress(&cx->CodeBuffer) - cx->ProfileShift) < p->hot)
+        return 0;
+    BufferAppend(&cx->CodeBuffer, body->code, body->count, body->entry);
+    cx->ProfileShift += body->count - 1;
+    COUNT_STAT(&cx->Stats, STAT_INLINED);
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  UnrollCountedLoop:  Under --unroll, rebuilds a WHILE loop that counts   */
+/*                      a variable toward a constant,                       */
+/*                                                                          */
+/*       WHILE v <relop> k DO BEGIN ... v := v + s; END                     */
+/*                                                                          */
+/*    where k and s are integer constants, the step (or "v := v - s")      */
+/*    takes v toward k, no branch in the body can pass over it, and       */
+/*    nothing before it can change v: no other assignment to it, READ or   */
+/*    call.  Its code, with <pass> the body up to and including the step, */
+/*                                                                          */
+/*       top:  LOADA v; LOADI k; SUB; B<not relop> end; <pass>; BR top;     */
+/*       end:                                                               */
+/*                                                                          */
+/*    becomes a loop making n passes a test, for as long as the last of    */
+/*    them would pass it too, then the loop as it was for any left over:   */
+/*                                                                          */
+/*       top:  LOADA v; LOADI k - (n - 1) * s; SUB; B<not relop> rest;      */
+/*             <pass> n times; BR top;                                      */
+/*       rest: LOADA v; LOADI k; SUB; B<not relop> end; <pass>; BR rest;    */
+/*       end:                                                               */
+/*                                                                          */
+/*    n is the --unroll factor, less if the copies would not fit in        */
+/*    UNROLL_LIMIT instructions.  When the statement just before the loop  */
+/*    sets v to a constant the number of passes is known, and if it is no  */
+/*    more than UNROLL_FULL and they fit, the loop becomes just that many  */
+/*    copies of <pass>.                                                     */
+/*                                                                          */
+/*    Inputs:       1) Address of the loop's test.                          */
+/*                  2) Address of its exit branch.                          */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      1 if the loop was ended here, 0 if it is still to be    */
+/*                  ended as usual.                                         */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int UnrollCountedLoop(CONTEXT *cx, int top, int branch)
+{
+    INSTRUCTION *code, *pass, *copy;
+    int end = BufferAddress(&cx->CodeBuffer), length = end - branch - 1, variable, limit, step, factor, rest, i;
+    long long passes = -1, bound;
+
+    if (cx->options->Unroll <= 0 || cx->CodeBuffer.killed || branch != top + 3 || length < 4 ||
+        NULL == (code = BufferInstruction(&cx->CodeBuffer, top)))
+        return 0;
+    pass = code + 4;
+    variable = code[0].operand;
+    limit = code[1].operand;
+    if (code[0].op != I_LOADA || code[1].op != I_LOADI || code[2].op != I_SUB ||
+        pass[length - 4].op != I_LOADA || pass[length - 4].operand != variable ||
+        pass[length - 3].op != I_LOADI || pass[length - 1].op != I_STOREA || pass[length - 1].operand != variable)
+        return 0;
+    if (pass[length - 2].op == I_ADD)
+        step = pass[length - 3].operand;
+    else if (pass[length - 2].op == I_SUB && pass[length - 3].operand != INT_MIN)
+        step = -pass[length - 3].operand;
+    else
+        return 0;
+    if (((code[3].op == I_BGZ || code[3].op == I_BG) && step <= 0) ||
+        ((code[3].op == I_BLZ || code[3].op == I_BL) && step >= 0) || code[3].op == I_BR)
+        return 0;
+    for (i = 0; i < length - 4; i++)
+    {
+        if (pass[i].op == I_CALL || pass[i].op == I_READ || (pass[i].op == I_STOREA && pass[i].operand == variable))
+            return 0;
+        /*A branch past the start of the step, at branch + length - 3,     */
+        /*could skip it.                                                    */
+        if (IsBranchOp(pass[i].op) && (pass[i].operand <= branch || pass[i].operand > branch + length - 3))
+            return 0;
+    }
+
+    if (cx->StoreLoop == top && NULL != BufferInstruction(&cx->CodeBuffer, top - 2) && code[-2].op == I_LOADI &&
+        code[-1].op == I_STOREA && code[-1].operand == variable)
+        passes = CountedPasses(code[3].op, code[-2].operand, limit, step);
+    if (passes >= 0 && passes <= UNROLL_FULL && passes * length <= UNROLL_LIMIT)
     {
-        SyntaxError2(*F, CurrentToken);
-        while (!InSet(&S, CurrentToken.code))
+        if (NULL == (copy = malloc(length * sizeof(INSTRUCTION))))
         {
-            CurrentToken = GetToken();
+            fprintf(stderr, "out of memory in code generator\n");
+            exit(EXIT_FAILURE);
         }
+        memcpy(copy, pass, length * sizeof(INSTRUCTION));
+        BufferTruncate(&cx->CodeBuffer, top);
+        for (i = 0; i < passes; i++)
+            BufferAppend(&cx->CodeBuffer, copy, length, branch + 1);
+        free(copy);
+        cx->ProfileShift += (int)passes * length - (end + 1 - top);
+        COUNT_STAT(&cx->Stats, STAT_UNROLLED);
+        return 1;
     }
-}
\ No newline at end of file
+
+    factor = cx->options->Unroll;
+    while (factor > 1 && factor * length + 5 > UNROLL_LIMIT)
+        factor--;
+    bound = limit - (long long)(factor - 1) * step;
+    if (factor < 2 || bound < INT_MIN || bound > INT_MAX)
+        return 0;
+    code[1].operand = (int)bound;
+    for (i = 1; i < factor; i++)
+        CopyCode(cx, branch + 1, length);
+    EMIT(cx, I_BR, top);
+    rest = BufferAddress(&cx->CodeBuffer);
+    CopyCode(cx, top, 4);
+    BufferInstruction(&cx->CodeBuffer, rest + 1)->operand = limit;
+    CopyCode(cx, branch + 1, length);
+    EMIT(cx, I_BR, rest);
+    cx->ProfileShift++;
+    PatchCode(cx, branch, rest);
+    PatchCode(cx, rest + 3, BufferAddress(&cx->CodeBuffer));
+    COUNT_STAT(&cx->Stats, STAT_UNROLLED);
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CountedPasses: How many passes a loop makes counting from "first" by   */
+/*  "step" while its test, which branches out by "op", passes against      */
+/*  "bound"; -1 if the count or the test's SUB would leave the range of   */
+/*  an int on the way.                                                      */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE long long CountedPasses(int op, int first, int bound, int step)
+{
+    long long distance = step > 0 ? (long long)bound - first : (long long)first - bound;
+    long long size = step > 0 ? step : -(long long)step, passes, last;
+
+    if (op == I_BGZ || op == I_BLZ)
+        passes = distance <= 0 ? 0 : (distance + size - 1) / size;
+    else
+        passes = distance < 0 ? 0 : distance / size + 1;
+    last = first + passes * step;
+    if ((distance < 0 ? -distance : distance) + size > INT_MAX || last < INT_MIN || last > INT_MAX)
+        return -1;
+    return passes;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  StartProcDeclaration:  Parallel version of ParseProcDeclaration for     */
+/*                         top-level procedures.                            */
+/*                                                                          */
+/*    The heading is parsed here, so the procedure's name is in the symbol  */
+/*    table before the body is compiled.  The body is captured and given    */
+/*    to a child process, which inherits the symbol table as it is now and  */
+/*    sends back its code relocatably.  When --proc-jobs children are       */
+/*    already running the oldest is collected first, so code is appended    */
+/*    in declaration order.  Bodies with nested procedures, whose calls     */
+/*    cannot be resolved by name at the top level, are parsed here once     */
+/*    all earlier children have been collected.  Once the pass is known to  */
+/*    have failed the rest of the program is simply parsed here.            */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*    Side Effects: Lookahead token advanced past the declaration.          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void StartProcDeclaration(CONTEXT *cx)
+{
+    char *name = NULL;
+    int fds[2], pid, i, nested, origin;
+    SYMBOL *proc;
+
+    Accept(cx, PROCEDURE);
+    MakeSymbolTableEntry(cx, STYPE_PROCEDURE);
+    if (cx->CurrentToken.code == IDENTIFIER)
+        name = ArenaString(&cx->Arena, cx->CurrentToken.s);
+    Accept(cx, IDENTIFIER);
+    proc = DeclaredProcedure(cx, name);
+
+    if (proc == NULL || cx->errCount + cx->syncCount > 0)
+        cx->ProcJobsFailed = 1;
+    if (cx->ProcJobsFailed)
+    {
+        ParseProcBody(cx, proc);
+        return;
+    }
+
+    origin = cx->CurrentToken.pos;
+    nested = 0 == CaptureProcedure(cx);
+    for (i = 0; i < cx->Pending.count && !nested; i++)
+        nested = cx->Pending.tokens[i].code == PROCEDURE;
+
+    if (!nested && cx->ProcJobCount == cx->options->ProcJobs)
+        CollectProcJob(cx);
+    fflush(stdout);
+    fflush(cx->ListStream);
+    if (nested || pipe(fds) != 0)
+        pid = -1;
+    else if ((pid = fork()) < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+    else if (pid == 0)
+    {
+        close(fds[0]);
+        CompileProcInChild(cx, name, fds[1]);
+    }
+
+    if (pid < 0)
+    {
+        while (cx->ProcJobCount > 0)
+            CollectProcJob(cx);
+        cx->CurrentToken = NextToken(cx);
+        ParseProcBody(cx, proc);
+        return;
+    }
+
+    close(fds[1]);
+    cx->ProcJobs[cx->ProcJobCount].pid = pid;
+    cx->ProcJobs[cx->ProcJobCount].fd = fds[0];
+    cx->ProcJobs[cx->ProcJobCount].origin = origin;
+    cx->ProcJobCount++;
+    ClearTokenBuffer(&cx->Pending);
+    cx->CurrentToken = NextToken(cx);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  CompileProcInChild:  Child side of StartProcDeclaration.  Parses the    */
+/*                       captured body and writes its code to "fd" as a     */
+/*                       procedure cache entry.                             */
+/*                                                                          */
+/*    Nothing the child prints is wanted, so standard output and the        */
+/*    listing are sent to /dev/null; a listing stream with a writer thread  */
+/*    drops what a child writes to it by itself.  No entry is written if    */
+/*    the body has errors or does not end exactly where the capture did.    */
+/*                                                                          */
+/*    Inputs:       1) Procedure name.                                      */
+/*                  2) Write end of the result pipe.                        */
+/*                                                                          */
+/*    Outputs:      Code entry on "fd".                                     */
+/*                                                                          */
+/*    Returns:      Never; the child exits.                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void CompileProcInChild(CONTEXT *cx, char *name, int fd)
+{
+    PROCCACHE result;
+    PCENTRY *entry;
+    SYMBOL *proc;
+    FILE *out;
+    int null, start, origin, procs, symbols;
+
+    if ((null = open("/dev/null", O_WRONLY)) < 0 || dup2(null, STDOUT_FILENO) < 0 ||
+        (cx->ListStream == cx->ListFile && dup2(null, fileno(cx->ListFile)) < 0))
+        _exit(EXIT_FAILURE);
+
+    cx->Detached = 1;
+    cx->CurrentToken = NextToken(cx);
+    origin = cx->CurrentToken.pos;
+    start = BufferAddress(&cx->CodeBuffer);
+    proc = DeclaredProcedure(cx, name);
+    procs = cx->ProcCount;
+    symbols = cx->SymbolCount;
+    ParseProcBody(cx, proc);
+
+    if (cx->errCount + cx->syncCount > 0 || cx->CodeBuffer.killed ||
+        cx->CurrentToken.code != ENDOFINPUT || NULL == (out = fdopen(fd, "w")))
+        _exit(EXIT_FAILURE);
+
+    InitProcCache(&result);
+    if (NULL == (entry = StoreProcCache(&result, name, 0, &cx->CodeBuffer, start, proc->address,
+                                        BufferAddress(&cx->CodeBuffer), origin,
+                                        &cx->Procs[procs], cx->ProcCount - procs - 1)))
+        _exit(EXIT_FAILURE);
+    StoreProcSymbols(entry, cx->Symbols, symbols, cx->SymbolCount - symbols, start);
+    WriteProcEntry(out, result.entries);
+    _exit(fclose(out) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  CollectProcJob:  Waits for the oldest running child and appends the     */
+/*                   code it sends back to the buffer.  Sets                */
+/*                   "ProcJobsFailed" if it sent none.                      */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void CollectProcJob(CONTEXT *cx)
+{
+    PCENTRY *entry = NULL;
+    FILE *in;
+    int status, got = 0;
+
+    if (cx->ProcJobCount == 0)
+        return;
+
+    if (NULL != (in = fdopen(cx->ProcJobs[0].fd, "r")))
+    {
+        got = ReadProcEntry(in, &entry) == 1;
+        fclose(in);
+    }
+    else
+        close(cx->ProcJobs[0].fd);
+
+    if (waitpid(cx->ProcJobs[0].pid, &status, 0) < 0 ||
+        !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+        got = 0;
+    if (!got || cx->ProcJobsFailed ||
+        !ReplayProcedure(cx, DeclaredProcedure(cx, entry->name), entry, cx->ProcJobs[0].origin))
+        cx->ProcJobsFailed = 1;
+    if (entry != NULL)
+        FreeProcEntry(entry);
+
+    cx->ProcJobCount--;
+    memmove(cx->ProcJobs, cx->ProcJobs + 1, cx->ProcJobCount * sizeof(PROCJOB));
+}
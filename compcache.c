@@ -0,0 +1,282 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       compcache.c                                                        */
+/*                                                                          */
+/*       Content-addressed cache of whole compilations.  See "compcache.h". */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include "compcache.h"
+#include "global.h"
+#include "proccache.h"
+
+#define MAXPATH 4096
+
+typedef struct
+{
+    char key[32]; /*  File name without its ".code"/".list" suffix. */
+    long size;    /*  Combined size of both files.                  */
+    time_t mtime; /*  Most recent use of either file.               */
+} CACHEENTRY;
+
+PUBLIC void InitCompileCache(COMPCACHE *cc, char *dir, long limit)
+{
+    cc->dir = dir;
+    cc->limit = limit;
+    cc->hits = 0;
+    cc->misses = 0;
+    mkdir(dir, 0777);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CompileCacheKey: Hashes everything that determines the output.         */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC FINGERPRINT CompileCacheKey(char *version, char *flags, char *source, size_t length)
+{
+    FINGERPRINT key = FINGERPRINT_SEED;
+
+    key = HashString(key, version);
+    key = HashString(key, flags);
+    key = HashBytes(key, &length, sizeof(length));
+    return HashBytes(key, source, length);
+}
+
+PRIVATE void EntryPath(COMPCACHE *cc, FINGERPRINT key, char *suffix, char *path)
+{
+    snprintf(path, MAXPATH, "%s/%016llx.%s", cc->dir, key, suffix);
+}
+
+PRIVATE int CopyStream(FILE *from, FILE *to)
+{
+    char buffer[8192];
+    size_t n;
+
+    while ((n = fread(buffer, 1, sizeof(buffer), from)) > 0)
+    {
+        if (fwrite(buffer, 1, n, to) != n)
+            return 0;
+    }
+    return !ferror(from);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FetchCompileCache: On a hit, copies the cached listing and code into   */
+/*  the given (already open) output files and returns 1.  Both cache       */
+/*  files are opened before either output is touched, so a miss leaves the */
+/*  outputs empty for the normal compile to fill in.                        */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int FetchCompileCache(COMPCACHE *cc, FINGERPRINT key, FILE *listFile, FILE *codeFile)
+{
+    char listPath[MAXPATH], codePath[MAXPATH];
+    FILE *list, *code;
+    int ok;
+
+    EntryPath(cc, key, "list", listPath);
+    EntryPath(cc, key, "code", codePath);
+    if (NULL == (list = fopen(listPath, "rb")))
+        return 0;
+    if (NULL == (code = fopen(codePath, "rb")))
+    {
+        fclose(list);
+        return 0;
+    }
+
+    ok = CopyStream(list, listFile) && CopyStream(code, codeFile);
+    fclose(list);
+    fclose(code);
+
+    /*  Touch the entry so that eviction treats it as recently used.    */
+    utime(listPath, NULL);
+    utime(codePath, NULL);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Publish: Copies "source" into the cache as "dest", by way of a         */
+/*  temporary file in the same directory and a rename, so that readers     */
+/*  only ever see complete entries.                                         */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Publish(COMPCACHE *cc, char *source, char *dest)
+{
+    char temp[MAXPATH];
+    FILE *from, *to;
+    int fd, ok;
+
+    if (NULL == (from = fopen(source, "rb")))
+        return 0;
+
+    snprintf(temp, MAXPATH, "%s/tmp.XXXXXX", cc->dir);
+    if ((fd = mkstemp(temp)) < 0 || NULL == (to = fdopen(fd, "wb")))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            remove(temp);
+        }
+        fclose(from);
+        return 0;
+    }
+
+    fchmod(fd, 0644);
+    ok = CopyStream(from, to);
+    fclose(from);
+    if (fclose(to) != 0)
+        ok = 0;
+    if (ok)
+        ok = rename(temp, dest) == 0;
+    if (!ok)
+        remove(temp);
+    return ok;
+}
+
+PRIVATE int OlderFirst(const void *a, const void *b)
+{
+    time_t ta = ((const CACHEENTRY *)a)->mtime, tb = ((const CACHEENTRY *)b)->mtime;
+
+    return ta < tb ? -1 : ta > tb;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Evict: Removes least-recently-used entries, both files at a time,      */
+/*  until the cache is back under its size limit.                           */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Evict(COMPCACHE *cc)
+{
+    DIR *dir;
+    struct dirent *de;
+    struct stat st;
+    CACHEENTRY *entries = NULL, *grown;
+    char path[MAXPATH];
+    char *dot;
+    long total = 0;
+    int count = 0, capacity = 0, i;
+
+    if (NULL == (dir = opendir(cc->dir)))
+        return;
+
+    while (NULL != (de = readdir(dir)))
+    {
+        if (NULL == (dot = strrchr(de->d_name, '.')) ||
+            (strcmp(dot, ".code") != 0 && strcmp(dot, ".list") != 0) ||
+            dot - de->d_name >= (long)sizeof(entries->key))
+            continue;
+        snprintf(path, MAXPATH, "%s/%s", cc->dir, de->d_name);
+        if (stat(path, &st) != 0)
+            continue;
+
+        for (i = 0; i < count; i++)
+        {
+            if (strncmp(entries[i].key, de->d_name, dot - de->d_name) == 0 &&
+                entries[i].key[dot - de->d_name] == '\0')
+                break;
+        }
+        if (i == count)
+        {
+            if (count == capacity)
+            {
+                capacity = capacity == 0 ? 64 : capacity * 2;
+                if (NULL == (grown = realloc(entries, capacity * sizeof(CACHEENTRY))))
+                    break;
+                entries = grown;
+            }
+            memcpy(entries[i].key, de->d_name, dot - de->d_name);
+            entries[i].key[dot - de->d_name] = '\0';
+            entries[i].size = 0;
+            entries[i].mtime = 0;
+            count++;
+        }
+        entries[i].size += (long)st.st_size;
+        if (st.st_mtime > entries[i].mtime)
+            entries[i].mtime = st.st_mtime;
+        total += (long)st.st_size;
+    }
+    closedir(dir);
+
+    if (total > cc->limit)
+    {
+        qsort(entries, count, sizeof(CACHEENTRY), OlderFirst);
+        for (i = 0; i < count && total > cc->limit; i++)
+        {
+            snprintf(path, MAXPATH, "%s/%s.list", cc->dir, entries[i].key);
+            remove(path);
+            snprintf(path, MAXPATH, "%s/%s.code", cc->dir, entries[i].key);
+            remove(path);
+            total -= entries[i].size;
+        }
+    }
+    free(entries);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  StoreCompileCache: Adds the listing and code just written to "listPath" */
+/*  and "codePath" to the cache under "key".  The listing goes in first,   */
+/*  since a lookup needs both files and checks for the listing first.       */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int StoreCompileCache(COMPCACHE *cc, FINGERPRINT key, char *listPath, char *codePath)
+{
+    char path[MAXPATH];
+    int ok;
+
+    EntryPath(cc, key, "list", path);
+    ok = Publish(cc, listPath, path);
+    EntryPath(cc, key, "code", path);
+    ok = ok && Publish(cc, codePath, path);
+    Evict(cc);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CountCompileCache: Adds one hit or miss to the totals in "stats",      */
+/*  under an exclusive lock so concurrent compiles don't lose counts, and  */
+/*  leaves the new totals in "cc".                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void CountCompileCache(COMPCACHE *cc, int hit)
+{
+    char path[MAXPATH];
+    FILE *f;
+    int fd;
+
+    snprintf(path, MAXPATH, "%s/stats", cc->dir);
+    if ((fd = open(path, O_RDWR | O_CREAT, 0666)) < 0)
+        return;
+    if (NULL == (f = fdopen(fd, "r+")))
+    {
+        close(fd);
+        return;
+    }
+
+    flock(fd, LOCK_EX);
+    if (fscanf(f, "hits %ld misses %ld", &cc->hits, &cc->misses) != 2)
+        cc->hits = cc->misses = 0;
+    if (hit)
+        cc->hits++;
+    else
+        cc->misses++;
+    rewind(f);
+    fprintf(f, "hits %ld misses %ld\n", cc->hits, cc->misses);
+    fflush(f);
+    ftruncate(fd, ftell(f));
+    flock(fd, LOCK_UN);
+    fclose(f);
+}
@@ -0,0 +1,44 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       compcache.h                                                        */
+/*                                                                          */
+/*       Content-addressed cache of whole compilations.  The key is a hash  */
+/*       of the compiler version, the options that affect its output and    */
+/*       the source bytes; the cached value is the code and listing file    */
+/*       that compilation produced.  Entries live as <key>.code and         */
+/*       <key>.list in the cache directory, are written atomically and are  */
+/*       evicted least-recently-used first once the directory grows past    */
+/*       its size limit.  Hit and miss totals are kept in the file "stats". */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef COMPCACHE_H
+#define COMPCACHE_H
+
+#include <stdio.h>
+#include "global.h"
+#include "proccache.h"
+
+#define DEFAULT_CACHE_LIMIT (64L * 1024L * 1024L)
+
+typedef struct
+{
+    char *dir;  /*  Cache directory.                             */
+    long limit; /*  Size in bytes above which entries are evicted. */
+    long hits;  /*  Totals read back from the "stats" file.      */
+    long misses;
+} COMPCACHE;
+
+PUBLIC void InitCompileCache(COMPCACHE *cc, char *dir, long limit);
+PUBLIC FINGERPRINT CompileCacheKey(char *version, char *flags, char *source, size_t length);
+PUBLIC int FetchCompileCache(COMPCACHE *cc, FINGERPRINT key, FILE *listFile, FILE *codeFile);
+PUBLIC int StoreCompileCache(COMPCACHE *cc, FINGERPRINT key, char *listPath, char *codePath);
+PUBLIC void CountCompileCache(COMPCACHE *cc, int hit);
+
+#endif
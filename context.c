@@ -0,0 +1,370 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       context.c                                                          */
+/*                                                                          */
+/*       Compilation context.  See "context.h".                             */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "context.h"
+#include "global.h"
+
+PUBLIC void InitOptions(OPTIONS *options)
+{
+    memset(options, 0, sizeof(OPTIONS));
+    options->CacheLimit = DEFAULT_CACHE_LIMIT;
+    options->MaxErrors = DEFAULT_MAX_ERRORS;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  InitContext: Sets up a context with empty buffers, ready for its first */
+/*  compilation.                                                            */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void InitContext(CONTEXT *cx, OPTIONS *options)
+{
+    memset(cx, 0, sizeof(CONTEXT));
+    cx->options = options;
+    cx->OpenProcStat = -1;
+    cx->DebugOwner = -1;
+    InitCodeBuffer(&cx->CodeBuffer);
+    InitArena(&cx->Arena);
+    InitTokenBuffer(&cx->Pending, &cx->Arena);
+    InitProcCache(&cx->ProcCache);
+    InitObject(&cx->Object);
+    if (options->CacheDir != NULL)
+        InitCompileCache(&cx->CompileCache, options->CacheDir, options->CacheLimit);
+}
+
+PUBLIC void FreeContext(CONTEXT *cx)
+{
+    FreeCodeBuffer(&cx->CodeBuffer);
+    FreeTokenBuffer(&cx->Pending);
+    FreeArena(&cx->Arena);
+    FreeProcCache(&cx->ProcCache);
+    FreeObject(&cx->Object);
+    free(cx->Source);
+    cx->Source = NULL;
+    free(cx->Diagnostics);
+    cx->Diagnostics = NULL;
+    cx->DiagnosticCount = cx->DiagnosticCapacity = 0;
+    free(cx->Procs);
+    cx->Procs = NULL;
+    cx->ProcCount = cx->ProcCapacity = 0;
+    free(cx->Lines);
+    cx->Lines = NULL;
+    cx->LineCount = cx->LineCapacity = 0;
+    free(cx->Symbols);
+    cx->Symbols = NULL;
+    cx->SymbolCount = cx->SymbolCapacity = 0;
+    free(cx->Fixups);
+    cx->Fixups = NULL;
+    cx->FixupCount = cx->FixupCapacity = 0;
+    ClearInlineBodies(cx);
+    free(cx->Inlines);
+    cx->Inlines = NULL;
+    cx->InlineCapacity = 0;
+    free(cx->ProcStats);
+    cx->ProcStats = NULL;
+    cx->ProcStatCount = cx->ProcStatCapacity = 0;
+    free(cx->Frames);
+    cx->Frames = NULL;
+    cx->FrameCount = cx->FrameCapacity = 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Grow: Makes room for one more element in a growable array.             */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void *Grow(void *array, int count, int *capacity, size_t size)
+{
+    void *grown;
+    int newCapacity;
+
+    if (count < *capacity)
+        return array;
+    newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+    if (NULL == (grown = realloc(array, newCapacity * size)))
+    {
+        fprintf(stderr, "out of memory in compilation context\n");
+        exit(EXIT_FAILURE);
+    }
+    *capacity = newCapacity;
+    return grown;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddDiagnostic: Records an error found at "token".  Line and column are */
+/*  left for whoever has the source text to fill in.                        */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void AddDiagnostic(CONTEXT *cx, int kind, TOKEN *token, int expected, char *message)
+{
+    CPLDIAGNOSTIC *d;
+
+    cx->Diagnostics = Grow(cx->Diagnostics, cx->DiagnosticCount, &cx->DiagnosticCapacity, sizeof(CPLDIAGNOSTIC));
+    d = &cx->Diagnostics[cx->DiagnosticCount++];
+    d->kind = kind;
+    d->pos = token->pos;
+    d->line = 0;
+    d->column = 0;
+    d->found = token->code;
+    d->expected = expected;
+    d->message = message;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddProcedure: Appends a procedure to the procedure table.              */
+/*  "name" must last as long as the compilation.                            */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void AddProcedure(CONTEXT *cx, char *name, int start, int entry, int end)
+{
+    CODEPROC *p;
+
+    cx->Procs = Grow(cx->Procs, cx->ProcCount, &cx->ProcCapacity, sizeof(CODEPROC));
+    p = &cx->Procs[cx->ProcCount++];
+    p->name = name;
+    p->start = start;
+    p->entry = entry;
+    p->end = end;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddCodeLines: Extends the line table over "count" instructions written */
+/*  at "address", starting a run wherever the source offset changes.       */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void AddCodeLines(CONTEXT *cx, INSTRUCTION *code, int address, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (cx->LineCount > 0 && cx->Lines[cx->LineCount - 1].line == code[i].pos)
+            continue;
+        cx->Lines = Grow(cx->Lines, cx->LineCount, &cx->LineCapacity, sizeof(CODELINE));
+        cx->Lines[cx->LineCount].address = address + i;
+        cx->Lines[cx->LineCount++].line = code[i].pos;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddDebugSymbol: Appends a symbol to the debug map and returns its      */
+/*  index.  "name" must last as long as the compilation.                    */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int AddDebugSymbol(CONTEXT *cx, char *name, int kind, int depth, int address, int owner)
+{
+    CODESYMBOL *sym;
+
+    cx->Symbols = Grow(cx->Symbols, cx->SymbolCount, &cx->SymbolCapacity, sizeof(CODESYMBOL));
+    sym = &cx->Symbols[cx->SymbolCount];
+    sym->name = name;
+    sym->kind = kind;
+    sym->depth = depth;
+    sym->address = address;
+    sym->owner = owner;
+    return cx->SymbolCount++;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddCallFixup, ResolveCallFixups: A procedure's address is only known   */
+/*  once its block starts, after any nested procedures, which may call it. */
+/*  Those calls are patched when the address is set.                        */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void AddCallFixup(CONTEXT *cx, int location, SYMBOL *callee)
+{
+    cx->Fixups = Grow(cx->Fixups, cx->FixupCount, &cx->FixupCapacity, sizeof(CALLFIXUP));
+    cx->Fixups[cx->FixupCount].location = location;
+    cx->Fixups[cx->FixupCount].callee = callee;
+    cx->FixupCount++;
+}
+
+PUBLIC void ResolveCallFixups(CONTEXT *cx, SYMBOL *callee)
+{
+    int i;
+
+    for (i = 0; i < cx->FixupCount;)
+    {
+        if (cx->Fixups[i].callee == callee)
+        {
+            BufferBackPatch(&cx->CodeBuffer, cx->Fixups[i].location, callee->address);
+            COUNT_STAT(&cx->Stats, STAT_BACKPATCHES);
+            cx->Fixups[i] = cx->Fixups[--cx->FixupCount];
+        }
+        else
+            i++;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  MoveCallFixups: Code at [from, from + count) has been moved to "to",   */
+/*  or copied there if "copy" is set; its calls still waiting for their    */
+/*  callee's address go with it.                                            */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void MoveCallFixups(CONTEXT *cx, int from, int count, int to, int copy)
+{
+    int i, n = cx->FixupCount;
+
+    for (i = 0; i < n; i++)
+    {
+        if (cx->Fixups[i].location < from || cx->Fixups[i].location >= from + count)
+            continue;
+        if (copy)
+            AddCallFixup(cx, cx->Fixups[i].location - from + to, cx->Fixups[i].callee);
+        else
+            cx->Fixups[i].location += to - from;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  RemapCallFixups: Code at [from, from + count) has been compacted as    */
+/*  "map" says, one address per instruction and one for the end, as        */
+/*  RemoveDeadCode() sets it.  Fixups of calls that were removed go too.   */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void RemapCallFixups(CONTEXT *cx, int from, int count, int *map)
+{
+    int i = 0, at;
+
+    while (i < cx->FixupCount)
+    {
+        at = cx->Fixups[i].location - from;
+        if (at < 0 || at >= count)
+            i++;
+        else if (map[at] == map[at + 1])
+            cx->Fixups[i] = cx->Fixups[--cx->FixupCount];
+        else
+            cx->Fixups[i++].location = map[at];
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddInlineBody, FindInlineBody: Keep a copy of the block of a procedure */
+/*  entered at "entry", for --profile to inline after the procedure's own  */
+/*  code has been written out.                                              */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void AddInlineBody(CONTEXT *cx, int entry, INSTRUCTION *code, int count)
+{
+    INLINEBODY *body;
+
+    cx->Inlines = Grow(cx->Inlines, cx->InlineCount, &cx->InlineCapacity, sizeof(INLINEBODY));
+    body = &cx->Inlines[cx->InlineCount];
+    if (NULL == (body->code = malloc((count > 0 ? count : 1) * sizeof(INSTRUCTION))))
+    {
+        fprintf(stderr, "out of memory in compilation context\n");
+        exit(EXIT_FAILURE);
+    }
+    if (count > 0)
+        memcpy(body->code, code, count * sizeof(INSTRUCTION));
+    body->entry = entry;
+    body->count = count;
+    cx->InlineCount++;
+}
+
+PUBLIC INLINEBODY *FindInlineBody(CONTEXT *cx, int entry)
+{
+    int i;
+
+    for (i = 0; i < cx->InlineCount; i++)
+    {
+        if (cx->Inlines[i].entry == entry)
+            return &cx->Inlines[i];
+    }
+    return NULL;
+}
+
+PUBLIC void ClearInlineBodies(CONTEXT *cx)
+{
+    int i;
+
+    for (i = 0; i < cx->InlineCount; i++)
+        free(cx->Inlines[i].code);
+    cx->InlineCount = 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BeginProcStat, EndProcStat: Measure one procedure declaration for the  */
+/*  procedure report, from PROCEDURE at source offset "first" to the ";"   */
+/*  at "last".  A nested procedure's time, code and scopes are added to     */
+/*  the procedure around it as well.                                        */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int BeginProcStat(CONTEXT *cx, char *name, int first)
+{
+    PROCSTAT *p;
+
+    cx->ProcStats = Grow(cx->ProcStats, cx->ProcStatCount, &cx->ProcStatCapacity, sizeof(PROCSTAT));
+    p = &cx->ProcStats[cx->ProcStatCount];
+    memset(p, 0, sizeof(PROCSTAT));
+    p->name = name != NULL ? name : "?";
+    p->depth = cx->scope;
+    p->parent = cx->OpenProcStat;
+    p->first = p->last = first;
+    p->started = StatsClock();
+    p->address = BufferAddress(&cx->CodeBuffer);
+    p->peakScope = cx->scope;
+    cx->OpenProcStat = cx->ProcStatCount;
+    return cx->ProcStatCount++;
+}
+
+PUBLIC void EndProcStat(CONTEXT *cx, int index, int last, int cached)
+{
+    PROCSTAT *p = &cx->ProcStats[index], *parent;
+
+    p->last = last;
+    p->seconds = StatsClock() - p->started;
+    p->instructions = BufferAddress(&cx->CodeBuffer) - p->address;
+    p->cached = cached;
+    cx->OpenProcStat = p->parent;
+    if (p->parent >= 0)
+    {
+        parent = &cx->ProcStats[p->parent];
+        parent->nestedSeconds += p->seconds;
+        parent->nestedInstructions += p->instructions;
+        if (parent->peakScope < p->peakScope)
+            parent->peakScope = p->peakScope;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  OpenScope: Enters a new scope, a procedure's own or a block's, and     */
+/*  raises the peak of the procedure being measured if it goes deeper.     */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void OpenScope(CONTEXT *cx)
+{
+    cx->scope++;
+    if (cx->OpenProcStat >= 0 && cx->ProcStats[cx->OpenProcStat].peakScope < cx->scope)
+        cx->ProcStats[cx->OpenProcStat].peakScope = cx->scope;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  PushParseFrame: Saves where --explicit-stack parsing is to carry on,    */
+/*  and the locals it will need there.                                      */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void PushParseFrame(CONTEXT *cx, int state, int a, int b, int c)
+{
+    PARSEFRAME *f;
+
+    cx->Frames = Grow(cx->Frames, cx->FrameCount, &cx->FrameCapacity, sizeof(PARSEFRAME));
+    f = &cx->Frames[cx->FrameCount++];
+    f->state = state;
+    f->a = a;
+    f->b = b;
+    f->c = c;
+}
@@ -0,0 +1,196 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       context.h                                                          */
+/*                                                                          */
+/*       Compilation context.  Everything that one compilation reads or     */
+/*       writes lives in a CONTEXT, which is passed to every parser         */
+/*       routine, so separate compilations never share mutable state        */
+/*       through comp1's own globals.  OPTIONS are fixed before the first   */
+/*       compilation starts and may be shared between contexts.             */
+/*                                                                          */
+/*       The scanner, symbol table and code generator behind "scanner.h",   */
+/*       "symbol.h" and "code.h" are still single instances; compilations   */
+/*       running side by side need one copy of those per thread or process. */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stdio.h>
+#include "codebuf.h"
+#include "compcache.h"
+#include "cpl.h"
+#include "cplbin.h"
+#include "cplobj.h"
+#include "global.h"
+#include "listing.h"
+#include "proccache.h"
+#include "profile.h"
+#include "scanner.h"
+#include "stats.h"
+#include "symbol.h"
+#include "tokbuf.h"
+
+#define MAXFLAGS 1024
+#define DEFAULT_MAX_ERRORS 100  /*  --max-errors when it isn't given.   */
+#define MAXIMPORTS 64           /*  --import options allowed.           */
+
+typedef struct
+{
+    int location;   /*  CALL emitted before its callee's address was known. */
+    SYMBOL *callee;
+} CALLFIXUP;
+
+typedef struct
+{
+    int entry;         /*  Address a CALL to the procedure lands on.   */
+    INSTRUCTION *code; /*  Its block, as generated from "entry" on.    */
+    int count;
+} INLINEBODY; /*  A procedure --profile may inline.                   */
+
+typedef struct
+{
+    int pid;    /*  Child compiling one top-level procedure.   */
+    int fd;     /*  Read end of the pipe it returns code on.   */
+    int origin; /*  Source offset of the token after its name. */
+} PROCJOB;
+
+typedef struct
+{
+    char *ProcCachePath;       /*  Set by --incremental.               */
+    char *CacheDir;            /*  Set by --cache-dir.                 */
+    long CacheLimit;           /*  Set by --cache-limit.               */
+    char *BatchPath;           /*  Set by --batch.                     */
+    char *TreePath;            /*  Set by --tree.                      */
+    char *ServePath;           /*  Set by --serve.                     */
+    int Listing;               /*  Set by --listing; LISTING_NONE by default. */
+    int Format;                /*  Set by --format; CODE_TEXT by default. */
+    char *Imports[MAXIMPORTS]; /*  Set by --import.                    */
+    int ImportCount;
+    int Debug;                 /*  Set by --debug.                     */
+    PROFILE *Profile;          /*  Read from --profile, or NULL.       */
+    int Unroll;                /*  Set by --unroll; 0 unrolls nothing. */
+    int DeadCode;              /*  Set by --dead-code.                 */
+    int Check;                 /*  Set by --check: parse, generate nothing. */
+    int LL1;                   /*  Set by --ll1: check with LLParse(). */
+    int ExplicitStack;         /*  Set by --explicit-stack.            */
+    int MaxErrors;             /*  Set by --max-errors; 0 is no limit. */
+    int MaxSkip;               /*  Set by --max-skip; 0 is no limit.   */
+    int Jobs;                  /*  Set by --jobs; 0 or 1 runs in-process. */
+    int ProcJobs;              /*  Set by --proc-jobs; 0 or 1 is serial.  */
+    int Stats;                 /*  Set by --stats; STATS_OFF by default.  */
+    char *ProcReportPath;      /*  Set by --proc-report.               */
+    int ProcSort;              /*  Set by --proc-sort; PROCSORT_SOURCE by default. */
+    char CompileFlags[MAXFLAGS]; /*  Options that change the output.   */
+} OPTIONS;
+
+typedef struct
+{
+    int state;  /*  Where ParseNested carries on when this frame is popped. */
+    int a, b, c; /*  Locals of the routine it stands for.               */
+} PARSEFRAME;
+
+typedef struct
+{
+    OPTIONS *options;
+
+    FILE *InputFile; /*  CPL source comes from here.          */
+    FILE *ListFile;  /*  For nicely-formatted syntax errors.  */
+    FILE *CodeFile;  /*  This is the output machine code file */
+    FILE *ListStream; /*  What the scanner writes the listing to. */
+    LISTWRITER ListWriter; /*  Background writer for a full listing. */
+    char *InputPath; /*  Names of the three files.            */
+    char *ListPath;
+    char *CodePath;
+
+    char *Source;          /*  Whole input, when it has been read.  */
+    size_t SourceLength;
+    size_t SourceCapacity;
+
+    TOKEN CurrentToken; /*  Parser lookahead token.               */
+    int errCount;       /*  Errors reported by Accept.            */
+    int syncCount;      /*  Errors reported by Synchronise.       */
+    int scope;          /*  Current scope level.                  */
+    int Recovering;     /*  Accept is skipping to a match.        */
+    PARSEFRAME *Frames; /*  ParseNested's continuation stack.     */
+    int FrameCount;
+    int FrameCapacity;
+    int Detached;       /*  Never read past "Pending".            */
+    int Quiet;          /*  Don't print comp1's own error messages. */
+    int Abandoned;      /*  An error budget ran out; read no more. */
+    int Skipped;        /*  Tokens error recovery has passed over. */
+    STATS Stats;        /*  Counters and phase times of this compile. */
+    PROCSTAT *ProcStats; /*  One per procedure, for --proc-report.  */
+    int ProcStatCount;
+    int ProcStatCapacity;
+    int OpenProcStat;   /*  Innermost procedure being compiled, or -1. */
+    int ProcEnd;        /*  Offset of the ";" ending the last procedure body. */
+
+    CPLDIAGNOSTIC *Diagnostics; /*  Every error reported, in order. */
+    int DiagnosticCount;
+    int DiagnosticCapacity;
+
+    CODEBUF CodeBuffer; /*  Instructions generated so far.        */
+    int EntryPoint;     /*  Address of the main program block.    */
+    char *ProgramName;  /*  Name after PROGRAM, or NULL.          */
+    int DataSize;       /*  Words of global data.                 */
+    CODEPROC *Procs;    /*  Procedures, each after those nested in it. */
+    int ProcCount;
+    int ProcCapacity;
+    CODELINE *Lines;    /*  Runs of code by statement, as code is */
+    int LineCount;      /*  written under --debug.                */
+    int LineCapacity;
+    CODESYMBOL *Symbols; /*  Declared so far, under --debug.      */
+    int SymbolCount;
+    int SymbolCapacity;
+    int DebugOwner;     /*  Symbol of the procedure being compiled, or -1. */
+    CALLFIXUP *Fixups;  /*  Calls to procedures whose block has   */
+    int FixupCount;     /*  not started yet.                      */
+    int FixupCapacity;
+    INLINEBODY *Inlines; /*  Procedures small and hot enough to    */
+    int InlineCount;    /*  inline, under --profile.              */
+    int InlineCapacity;
+    int ProfileShift;   /*  Instructions --profile has added so far, */
+                        /*  to find code in the profiled build.   */
+    int StoreEnd;       /*  Just after the last assignment, or -1 */
+                        /*  once a block has ended since.         */
+    int StoreLoop;      /*  Top of a WHILE loop begun at StoreEnd */
+                        /*  and not yet ended, or -1.             */
+    ARENA Arena;        /*  Strings that outlive the scanner's.   */
+    TOKENBUF Pending;   /*  Tokens read ahead, replayed first.    */
+    PROCCACHE ProcCache;     /*  Procedure code from last run.    */
+    COMPCACHE CompileCache;  /*  Whole-program cache.             */
+    CPLOBJECT Object;        /*  Unit written by --format object. */
+
+    PROCJOB *ProcJobs;  /*  Procedures being compiled by children, */
+    int ProcJobCount;   /*  oldest first; NULL unless parallel.    */
+    int ProcJobsFailed; /*  A child could not compile its procedure. */
+} CONTEXT;
+
+PUBLIC void InitOptions(OPTIONS *options);
+PUBLIC void InitContext(CONTEXT *cx, OPTIONS *options);
+PUBLIC void FreeContext(CONTEXT *cx);
+PUBLIC void AddDiagnostic(CONTEXT *cx, int kind, TOKEN *token, int expected, char *message);
+PUBLIC void AddProcedure(CONTEXT *cx, char *name, int start, int entry, int end);
+PUBLIC void AddCodeLines(CONTEXT *cx, INSTRUCTION *code, int address, int count);
+PUBLIC int AddDebugSymbol(CONTEXT *cx, char *name, int kind, int depth, int address, int owner);
+PUBLIC void AddCallFixup(CONTEXT *cx, int location, SYMBOL *callee);
+PUBLIC void ResolveCallFixups(CONTEXT *cx, SYMBOL *callee);
+PUBLIC void MoveCallFixups(CONTEXT *cx, int from, int count, int to, int copy);
+PUBLIC void RemapCallFixups(CONTEXT *cx, int from, int count, int *map);
+PUBLIC void AddInlineBody(CONTEXT *cx, int entry, INSTRUCTION *code, int count);
+PUBLIC INLINEBODY *FindInlineBody(CONTEXT *cx, int entry);
+PUBLIC void ClearInlineBodies(CONTEXT *cx);
+PUBLIC int BeginProcStat(CONTEXT *cx, char *name, int first);
+PUBLIC void EndProcStat(CONTEXT *cx, int index, int last, int cached);
+PUBLIC void OpenScope(CONTEXT *cx);
+PUBLIC void PushParseFrame(CONTEXT *cx, int state, int a, int b, int c);
+
+#endif
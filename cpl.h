@@ -0,0 +1,58 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cpl.h                                                              */
+/*                                                                          */
+/*       comp1 as a library.  Building comp1.c with CPL_LIBRARY defined     */
+/*       leaves out main(), so the object can be linked into another        */
+/*       program that calls CompileBuffer() directly.  Source is read from, */
+/*       and code written to, memory; no file is created, and a listing is  */
+/*       only produced on request.                                          */
+/*                                                                          */
+/*       The scanner, symbol table and code generator are single instances */
+/*       per process, so CompileBuffer() must not be called from two        */
+/*       threads at once.  The course library may still print its own       */
+/*       error messages on standard output.                                 */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef CPL_H
+#define CPL_H
+
+#include <stddef.h>
+#include "global.h"
+
+#define CPL_SYNTAX 1   /*  Kinds of diagnostic.                         */
+#define CPL_SEMANTIC 2
+
+typedef struct
+{
+    int kind;      /*  CPL_SYNTAX or CPL_SEMANTIC.                      */
+    int pos;       /*  Offset of the offending token in the source.     */
+    int line;      /*  Line and column of "pos", both counted from 1.   */
+    int column;
+    int found;     /*  Token code found there.                          */
+    int expected;  /*  Token code expected, or -1 if there is no single one. */
+    char *message; /*  Static text; not to be freed.                    */
+} CPLDIAGNOSTIC;
+
+typedef struct
+{
+    int valid;                  /*  1 if the program has no syntax errors. */
+    char *code;                 /*  Code file contents.                 */
+    size_t codeLength;
+    char *listing;              /*  Listing, or NULL if not requested.  */
+    size_t listingLength;
+    CPLDIAGNOSTIC *diagnostics; /*  In the order they were found.       */
+    int diagnosticCount;
+} CPLRESULT;
+
+PUBLIC int CompileBuffer(char *source, size_t length, int wantListing, CPLRESULT *result);
+PUBLIC void FreeCompileResult(CPLRESULT *result);
+
+#endif
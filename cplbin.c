@@ -0,0 +1,410 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cplbin.c                                                           */
+/*                                                                          */
+/*       Binary code file format.  See "cplbin.h".                          */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "codebuf.h"
+#include "cplbin.h"
+#include "global.h"
+#include "symbol.h"
+
+#define ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+PRIVATE int Pad(FILE *f, size_t from, size_t to)
+{
+    for (; from < to; from++)
+        putc(0, f);
+    return !ferror(f);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BeginCodeImage: Starts an image at the beginning of "f", leaving room  */
+/*  for the header.  WriteImageCode() then appends the code as it is       */
+/*  retired from the code buffer, and EndCodeImage() finishes the image.    */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int BeginCodeImage(FILE *f)
+{
+    CPLBINHEADER header;
+
+    memset(&header, 0, sizeof(header));
+    rewind(f);
+    fwrite(&header, sizeof(header), 1, f);
+    return Pad(f, sizeof(header), ALIGN(sizeof(header)));
+}
+
+PUBLIC void WriteImageCode(FILE *f, INSTRUCTION *code, int count)
+{
+    CPLBININSTR ins;
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        ins.op = code[i].op;
+        ins.flags = code[i].hasOperand ? CPLBIN_HASOPERAND : 0;
+        ins.operand = code[i].operand;
+        fwrite(&ins, sizeof(ins), 1, f);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  PutUnsigned, PutSigned: Write a number to the debug section as         */
+/*  LEB128, seven bits to a byte, low bits first; signed numbers are       */
+/*  zigzag-encoded first so that small negative deltas stay short.         */
+/*  Return the number of bytes written.                                     */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE size_t PutUnsigned(FILE *f, uint32_t value)
+{
+    size_t n = 1;
+
+    for (; value >= 0x80; value >>= 7, n++)
+        putc((value & 0x7f) | 0x80, f);
+    putc(value, f);
+    return n;
+}
+
+PRIVATE size_t PutSigned(FILE *f, int32_t value)
+{
+    return PutUnsigned(f, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+/*--------------------------------------------------------------------------*/
+/*  WriteDebugSection: Writes the debug section at the end of "f".         */
+/*  Returns its size.                                                       */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE size_t WriteDebugSection(FILE *f, DEBUGINFO *debug)
+{
+    CODESYMBOL *sym;
+    size_t size;
+    int i, address = 0, line = 0;
+
+    size = PutUnsigned(f, debug->lineCount);
+    for (i = 0; i < debug->lineCount; i++)
+    {
+        size += PutUnsigned(f, debug->lines[i].address - address);
+        size += PutSigned(f, debug->lines[i].line - line);
+        address = debug->lines[i].address;
+        line = debug->lines[i].line;
+    }
+    size += PutUnsigned(f, debug->symbolCount);
+    for (i = 0; i < debug->symbolCount; i++)
+    {
+        sym = &debug->symbols[i];
+        size += PutUnsigned(f, sym->kind);
+        size += PutUnsigned(f, sym->depth);
+        size += PutSigned(f, sym->address);
+        size += PutSigned(f, sym->owner);
+        fwrite(sym->name, strlen(sym->name) + 1, 1, f);
+        size += strlen(sym->name) + 1;
+    }
+    return size;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  EndCodeImage:  Finishes an image begun with BeginCodeImage(), once all  */
+/*                 of its code has been written.                            */
+/*                                                                          */
+/*    Inputs:       1) Code file.                                           */
+/*                  2) Number of instructions written.                      */
+/*                  3) Entry point and size of global data.                 */
+/*                  4) Procedure table.                                     */
+/*                  5) Debug information, with line numbers, or NULL for    */
+/*                     no debug section.                                    */
+/*                                                                          */
+/*    Outputs:      The procedure and name tables and any debug section,    */
+/*                  then the header.                                        */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int EndCodeImage(FILE *f, int codeCount, int entry, int dataSize,
+                        CODEPROC *procs, int procCount, DEBUGINFO *debug)
+{
+    CPLBINHEADER header;
+    CPLBINPROC proc;
+    size_t at, names = 0;
+    int i;
+
+    for (i = 0; i < procCount; i++)
+        names += strlen(procs[i].name) + 1;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CPLBIN_MAGIC, sizeof(header.magic));
+    header.version = CPLBIN_VERSION;
+    header.byteOrder = CPLBIN_BYTEORDER;
+    header.entry = entry;
+    header.dataSize = dataSize;
+    header.codeCount = codeCount;
+    header.procCount = procCount;
+    header.codeOffset = ALIGN(sizeof(header));
+    header.procOffset = ALIGN(header.codeOffset + header.codeCount * sizeof(CPLBININSTR));
+    header.stringOffset = ALIGN(header.procOffset + procCount * sizeof(CPLBINPROC));
+    header.stringSize = names;
+
+    at = header.codeOffset + header.codeCount * sizeof(CPLBININSTR);
+    if (!Pad(f, at, header.procOffset))
+        return 0;
+    for (i = 0, names = 0; i < procCount; i++)
+    {
+        proc.name = names;
+        proc.start = procs[i].start;
+        proc.entry = procs[i].entry;
+        proc.end = procs[i].end;
+        fwrite(&proc, sizeof(proc), 1, f);
+        names += strlen(procs[i].name) + 1;
+    }
+    at = header.procOffset + procCount * sizeof(CPLBINPROC);
+    if (!Pad(f, at, header.stringOffset))
+        return 0;
+    for (i = 0; i < procCount; i++)
+        fwrite(procs[i].name, strlen(procs[i].name) + 1, 1, f);
+
+    if (debug != NULL)
+    {
+        header.debugOffset = ALIGN(header.stringOffset + header.stringSize);
+        if (!Pad(f, header.stringOffset + header.stringSize, header.debugOffset))
+            return 0;
+        header.debugSize = WriteDebugSection(f, debug);
+    }
+
+    if (fflush(f) != 0 || fseek(f, 0, SEEK_SET) != 0)
+        return 0;
+    fwrite(&header, sizeof(header), 1, f);
+    return fflush(f) == 0 && fseek(f, 0, SEEK_END) == 0 && !ferror(f);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Fits: True if "count" items of "size" bytes at "offset" lie inside a   */
+/*  file of "length" bytes, without overflowing.                            */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Fits(size_t length, size_t offset, size_t count, size_t size)
+{
+    return offset <= length && offset % 8 == 0 && count <= (length - offset) / size;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  LoadCodeImage:  Maps a binary code file into memory.                    */
+/*                                                                          */
+/*    Nothing is decoded: the header is checked, every table is checked to  */
+/*    lie inside the file and every name to lie inside the string table,    */
+/*    and the image's pointers are set to point into the mapping.  The      */
+/*    debug section is only decoded by ReadDebugInfo().                     */
+/*                                                                          */
+/*    Inputs:       1) Image to fill in.                                    */
+/*                  2) Path of the code file.                               */
+/*                                                                          */
+/*    Outputs:      The image, to be released with UnloadCodeImage().       */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int LoadCodeImage(CODEIMAGE *image, char *path)
+{
+    CPLBINHEADER *h;
+    struct stat st;
+    uint32_t i;
+    int fd;
+
+    memset(image, 0, sizeof(CODEIMAGE));
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return 0;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CPLBINHEADER) ||
+        MAP_FAILED == (image->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)))
+    {
+        image->map = NULL;
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    image->size = st.st_size;
+
+    h = image->header = image->map;
+    if (memcmp(h->magic, CPLBIN_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != CPLBIN_VERSION || h->byteOrder != CPLBIN_BYTEORDER ||
+        !Fits(image->size, h->procOffset, h->procCount, sizeof(CPLBINPROC)) ||
+        !Fits(image->size, h->codeOffset, h->codeCount, sizeof(CPLBININSTR)) ||
+        !Fits(image->size, h->debugOffset, h->debugSize, 1) ||
+        !Fits(image->size, h->stringOffset, h->stringSize, 1) ||
+        (h->stringSize > 0 && ((char *)image->map)[h->stringOffset + h->stringSize - 1] != '\0') ||
+        (h->entry > h->codeCount))
+    {
+        UnloadCodeImage(image);
+        return 0;
+    }
+
+    image->procs = (CPLBINPROC *)((char *)image->map + h->procOffset);
+    image->code = (CPLBININSTR *)((char *)image->map + h->codeOffset);
+    image->strings = (char *)image->map + h->stringOffset;
+    for (i = 0; i < h->procCount; i++)
+    {
+        if (image->procs[i].name >= h->stringSize || image->procs[i].entry > h->codeCount ||
+            image->procs[i].start > image->procs[i].end || image->procs[i].end > h->codeCount)
+        {
+            UnloadCodeImage(image);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  GetUnsigned, GetSigned: Read a number written by PutUnsigned() or      */
+/*  PutSigned(), advancing "*at".  Return 0 if it runs past "end" or does  */
+/*  not fit.                                                                */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int GetUnsigned(unsigned char **at, unsigned char *end, uint32_t *value)
+{
+    int shift;
+
+    *value = 0;
+    for (shift = 0; *at < end && shift < 32; shift += 7)
+    {
+        *value |= (uint32_t)(**at & 0x7f) << shift;
+        if ((*(*at)++ & 0x80) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+PRIVATE int GetSigned(unsigned char **at, unsigned char *end, int32_t *value)
+{
+    uint32_t u;
+
+    if (!GetUnsigned(at, end, &u))
+        return 0;
+    *value = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ReadDebugInfo:  Decodes the debug section of a loaded image.            */
+/*                                                                          */
+/*    Inputs:       1) Image.                                               */
+/*                  2) Debug information to fill in.                        */
+/*                                                                          */
+/*    Outputs:      The line table and symbols, to be released with         */
+/*                  FreeDebugInfo().  Symbol names point into the image.    */
+/*                  Both are empty if the image has no debug section.       */
+/*                                                                          */
+/*    Returns:      0 if the section is malformed: it runs off its end, the */
+/*                  line table is out of order or leaves the code, or a     */
+/*                  symbol's owner is not an earlier procedure.             */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int ReadDebugInfo(CODEIMAGE *image, DEBUGINFO *debug)
+{
+    unsigned char *at, *end, *name;
+    CODESYMBOL *sym;
+    uint32_t count, delta, kind, depth;
+    int32_t change, location, owner;
+    int i, address = 0, line = 0;
+
+    memset(debug, 0, sizeof(DEBUGINFO));
+    if (image->header->debugSize == 0)
+        return 1;
+    at = (unsigned char *)image->map + image->header->debugOffset;
+    end = at + image->header->debugSize;
+
+    if (!GetUnsigned(&at, end, &count) || count > (size_t)(end - at) / 2 ||
+        NULL == (debug->lines = malloc((count + 1) * sizeof(CODELINE))))
+        return 0;
+    for (; debug->lineCount < (int)count; debug->lineCount++)
+    {
+        if (!GetUnsigned(&at, end, &delta) || !GetSigned(&at, end, &change) ||
+            delta > image->header->codeCount - address || (debug->lineCount > 0 && delta == 0))
+        {
+            FreeDebugInfo(debug);
+            return 0;
+        }
+        address += delta;
+        line += change;
+        debug->lines[debug->lineCount].address = address;
+        debug->lines[debug->lineCount].line = line;
+    }
+
+    if (!GetUnsigned(&at, end, &count) || count > (size_t)(end - at) / 5 ||
+        NULL == (debug->symbols = malloc((count + 1) * sizeof(CODESYMBOL))))
+    {
+        FreeDebugInfo(debug);
+        return 0;
+    }
+    for (i = 0; i < (int)count; i++, debug->symbolCount++)
+    {
+        sym = &debug->symbols[i];
+        if (!GetUnsigned(&at, end, &kind) || !GetUnsigned(&at, end, &depth) ||
+            !GetSigned(&at, end, &location) || !GetSigned(&at, end, &owner) ||
+            owner < -1 || owner >= i || (owner >= 0 && debug->symbols[owner].kind != STYPE_PROCEDURE) ||
+            NULL == (name = memchr(at, '\0', end - at)))
+        {
+            FreeDebugInfo(debug);
+            return 0;
+        }
+        sym->kind = kind;
+        sym->depth = depth;
+        sym->address = location;
+        sym->owner = owner;
+        sym->name = (char *)at;
+        at = name + 1;
+    }
+    return 1;
+}
+
+PUBLIC void FreeDebugInfo(DEBUGINFO *debug)
+{
+    free(debug->lines);
+    free(debug->symbols);
+    memset(debug, 0, sizeof(DEBUGINFO));
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FindCodeLine: Source line of the instruction at "address", or 0 if the */
+/*  line table has none for it.                                             */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int FindCodeLine(DEBUGINFO *debug, int address)
+{
+    int low = 0, high = debug->lineCount, middle;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (debug->lines[middle].address <= address)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low > 0 ? debug->lines[low - 1].line : 0;
+}
+
+PUBLIC void UnloadCodeImage(CODEIMAGE *image)
+{
+    if (image->map != NULL)
+        munmap(image->map, image->size);
+    memset(image, 0, sizeof(CODEIMAGE));
+}
@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cplbin.h                                                           */
+/*                                                                          */
+/*       Binary code file format.  A code image is laid out so that it      */
+/*       can be mapped into memory and used where it lies:                  */
+/*                                                                          */
+/*           CPLBINHEADER                                                   */
+/*           CPLBININSTR x codeCount     at codeOffset                      */
+/*           CPLBINPROC  x procCount     at procOffset                      */
+/*           names, '\0'-terminated      at stringOffset                    */
+/*           debug section, optional     at debugOffset                     */
+/*                                                                          */
+/*       The code comes first so that it can be written as it is           */
+/*       generated; the header is written last, over a zeroed one, so an    */
+/*       image that was never finished is rejected by LoadCodeImage().      */
+/*                                                                          */
+/*       All offsets are from the start of the file and every table is      */
+/*       8-byte aligned.  Numbers are in the byte order of the machine      */
+/*       that wrote the file; "byteOrder" lets a loader on another kind of  */
+/*       machine reject it.  The procedure table lists every procedure,     */
+/*       nested ones included, in the order their declarations end.         */
+/*                                                                          */
+/*       The debug section, written with --debug, comes last, so stripping  */
+/*       it is a truncation and a header with no section.  It is a byte     */
+/*       stream of unsigned LEB128 numbers ("u") and zigzag-encoded signed  */
+/*       ones ("s"):                                                        */
+/*                                                                          */
+/*           u lineCount                                                    */
+/*           lineCount x  u address delta, s line delta                     */
+/*           u symbolCount                                                  */
+/*           symbolCount x  u kind, u depth, s address, s owner, name '\0'  */
+/*                                                                          */
+/*       The line table maps runs of code to the source line of the        */
+/*       statement that generated them, in address order; line 0 is code    */
+/*       outside any statement.  Each delta is from the run before, the     */
+/*       first from address 0 and line 0.  A symbol is a variable with its  */
+/*       data address or a procedure with its entry point, "kind" being     */
+/*       its STYPE_ code in "symbol.h"; "owner" is the index of the         */
+/*       procedure symbol it was declared in, or -1 at the top level.       */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef CPLBIN_H
+#define CPLBIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "codebuf.h"
+#include "global.h"
+
+#define CODE_TEXT 0   /*  Values of --format.                          */
+#define CODE_BINARY 1
+#define CODE_OBJECT 2 /*  An object unit; see "cplobj.h".              */
+
+#define CPLBIN_MAGIC "CPLB"
+#define CPLBIN_VERSION 3
+#define CPLBIN_BYTEORDER 0x0102
+
+#define CPLBIN_HASOPERAND 1 /*  CPLBININSTR flag: emitted with Emit().  */
+
+typedef struct
+{
+    char magic[4];         /*  CPLBIN_MAGIC, not '\0'-terminated.       */
+    uint16_t version;      /*  CPLBIN_VERSION.                          */
+    uint16_t byteOrder;    /*  CPLBIN_BYTEORDER as the writer stored it. */
+    uint32_t entry;        /*  Address of the main program block.       */
+    uint32_t dataSize;     /*  Words of global data.                    */
+    uint32_t codeCount;
+    uint32_t procCount;
+    uint32_t procOffset;
+    uint32_t codeOffset;
+    uint32_t stringOffset;
+    uint32_t stringSize;
+    uint32_t debugOffset;  /*  0 if there is no debug section.          */
+    uint32_t debugSize;
+} CPLBINHEADER;
+
+typedef struct
+{
+    uint32_t name;  /*  Offset of the name in the string table.         */
+    uint32_t start; /*  First instruction, nested procedures included.  */
+    uint32_t entry; /*  Where a CALL to the procedure lands.            */
+    uint32_t end;   /*  One past its last instruction.                  */
+} CPLBINPROC;
+
+typedef struct
+{
+    uint16_t op;      /*  One of the I_ codes in "code.h".              */
+    uint16_t flags;   /*  CPLBIN_HASOPERAND.                            */
+    int32_t operand;
+} CPLBININSTR;
+
+typedef struct
+{
+    char *name;
+    int start;
+    int entry;
+    int end;
+} CODEPROC; /*  A procedure table entry while compiling.            */
+
+typedef struct
+{
+    int address; /*  First instruction of the run.                      */
+    int line;    /*  Source offset, or -1, until the code is written.   */
+} CODELINE;
+
+typedef struct
+{
+    char *name;
+    int kind;    /*  STYPE_VARIABLE or STYPE_PROCEDURE.                 */
+    int depth;   /*  Scope it is declared in; 1 is top level.           */
+    int address; /*  Data address, or entry point; -1 if unknown.       */
+    int owner;
+} CODESYMBOL;
+
+typedef struct
+{
+    CODELINE *lines;
+    int lineCount;
+    CODESYMBOL *symbols;
+    int symbolCount;
+} DEBUGINFO; /*  Contents of the debug section.                      */
+
+typedef struct
+{
+    void *map;            /*  The whole file, mapped read-only.         */
+    size_t size;
+    CPLBINHEADER *header;
+    CPLBINPROC *procs;
+    CPLBININSTR *code;
+    char *strings;
+} CODEIMAGE;
+
+PUBLIC int BeginCodeImage(FILE *f);
+PUBLIC void WriteImageCode(FILE *f, INSTRUCTION *code, int count);
+PUBLIC int EndCodeImage(FILE *f, int codeCount, int entry, int dataSize,
+                        CODEPROC *procs, int procCount, DEBUGINFO *debug);
+PUBLIC int ReadDebugInfo(CODEIMAGE *image, DEBUGINFO *debug);
+PUBLIC void FreeDebugInfo(DEBUGINFO *debug);
+PUBLIC int FindCodeLine(DEBUGINFO *debug, int address);
+PUBLIC int LoadCodeImage(CODEIMAGE *image, char *path);
+PUBLIC void UnloadCodeImage(CODEIMAGE *image);
+
+#endif
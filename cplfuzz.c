@@ -0,0 +1,1047 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cplfuzz.c                                                          */
+/*                                                                          */
+/*       Fuzzing harness for parser1, parser2 and comp1.  Built into one    */
+/*       of them as "cplfuzz.h" describes, it runs inputs in-process,       */
+/*       each with a token budget, and reports three kinds of finding,      */
+/*       saving the input that caused it:                                   */
+/*                                                                          */
+/*           spin-<hash>.prog     The parser ran through its token budget.  */
+/*           slow-<hash>.prog     Parse time per token grows with the size  */
+/*                                of the input.                             */
+/*           timeout.prog         A parse ran past the time limit.  The     */
+/*                                harness stops there.                      */
+/*                                                                          */
+/*       Timing every input twice would halve the rate inputs are tried     */
+/*       at, so only inputs of at least FUZZ_SLOW_MIN_TOKENS tokens that    */
+/*       run FUZZ_SLOW_FACTOR times slower per token than the best seen    */
+/*       are checked further: the input and its first half are timed, and  */
+/*       it is slow if the time per token of the whole exceeds that of the  */
+/*       half by FUZZ_SUPERLINEAR_RATIO.  For a linear parser the two are   */
+/*       the same; a quadratic one doubles.                                 */
+/*                                                                          */
+/*           fuzz-<target> [options] <corpus>...                            */
+/*                                                                          */
+/*           --runs <n>          Mutated inputs to try (default 100000);    */
+/*                               0 only runs the corpus.                    */
+/*           --seed <n>          Seed for the mutations.                    */
+/*           --timeout <ms>      Time limit for one input (default 1000).   */
+/*           --artifacts <dir>   Where findings are saved (default ".").    */
+/*           --save <dir>        Save mutated inputs that reach a feature   */
+/*                               the corpus did not.                        */
+/*           --minimise <dir>    Write the smallest set of corpus inputs    */
+/*                               that reaches every feature the corpus      */
+/*                               does, fastest first, instead of fuzzing.   */
+/*           --generate <dir>    Write the seed corpus, the given files     */
+/*                               plus FUZZ_GENERATED generated programs,    */
+/*                               instead of fuzzing.                        */
+/*                                                                          */
+/*       Each <corpus> is a file or a directory of them.  The seed corpus   */
+/*       is made with "fuzz-comp1 --generate corpus fib.prog".  A feature   */
+/*       is a pair of token codes read one after the other, or how a parse  */
+/*       ended; without coverage instrumentation they stand in for the      */
+/*       parts of the grammar an input reaches.                             */
+/*                                                                          */
+/*       Built with CPL_LIBFUZZER and -fsanitize=fuzzer, libFuzzer drives   */
+/*       the target instead, and its own -timeout and -merge=1 take the     */
+/*       place of the time limit and --minimise.  A finding aborts, which   */
+/*       libFuzzer reports as a crash.                                      */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "cpl.h"
+#include "cplfuzz.h"
+#include "global.h"
+#include "scanner.h"
+
+#undef GetToken /*  FuzzGetToken() is the one caller of the real one.   */
+
+#define FUZZ_CODES 64               /*  Token codes told apart.         */
+#define FUZZ_OUTCOMES 6             /*  Verdict x valid.                */
+#define FUZZ_FEATURES (FUZZ_CODES * FUZZ_CODES + FUZZ_OUTCOMES)
+#define FUZZ_MAX_INPUT (64 * 1024)
+#define FUZZ_SLOW_MIN_TOKENS 512
+#define FUZZ_SLOW_FACTOR 8.0
+#define FUZZ_SUPERLINEAR_RATIO 1.5
+#define FUZZ_TIMING_RUNS 3          /*  Best of, when checking an input. */
+#define FUZZ_GENERATED 40
+#define DEFAULT_RUNS 100000L
+#define DEFAULT_TIMEOUT 1000        /*  Milliseconds.                   */
+
+#define FUZZ_OK 0                   /*  Verdicts.                       */
+#define FUZZ_SPIN 1
+#define FUZZ_SLOW 2
+
+typedef struct
+{
+    char *name;           /*  File name, without its directory.         */
+    unsigned char *data;
+    size_t size;
+    double ns;            /*  Time taken by its last run.               */
+} INPUT;
+
+typedef struct
+{
+    char *text;
+    size_t length;
+    size_t capacity;
+} TEXT;
+
+PRIVATE char *VerdictNames[] = {"ok", "token budget exceeded", "super-linear parse time"};
+
+PRIVATE jmp_buf Stopped;    /*  Where FuzzGetToken() and FuzzStop() go. */
+PRIVATE int Verdict;
+PRIVATE long Tokens;        /*  Read so far by the current input.       */
+PRIVATE long Budget;
+PRIVATE int Previous;       /*  Code of the token before.               */
+PRIVATE unsigned char Features[(FUZZ_FEATURES + 7) / 8]; /*  Current input's. */
+PRIVATE unsigned char Covered[(FUZZ_FEATURES + 7) / 8];  /*  The corpus's.    */
+PRIVATE double BestNsPerToken;
+PRIVATE FILE *NullList;     /*  Listing for the parsers, thrown away.   */
+
+PRIVATE volatile sig_atomic_t Running;
+PRIVATE volatile sig_atomic_t RunNumber;
+PRIVATE unsigned char *volatile Current;
+PRIVATE volatile size_t CurrentSize;
+
+PRIVATE void SetFeature(int feature)
+{
+    Features[feature / 8] |= 1 << (feature % 8);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FuzzGetToken: GetToken(), counted against the input's budget and       */
+/*  recorded as a feature with the token before it.                         */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC TOKEN FuzzGetToken(void)
+{
+    TOKEN token = GetToken();
+    int code = (unsigned)token.code % FUZZ_CODES;
+
+    SetFeature(Previous * FUZZ_CODES + code);
+    Previous = code;
+    if (++Tokens > Budget)
+    {
+        Verdict = FUZZ_SPIN;
+        longjmp(Stopped, 1);
+    }
+    return token;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FuzzStop: Ends the parse at once, for a parser that would exit.        */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void FuzzStop(void)
+{
+    Verdict = FUZZ_OK;
+    longjmp(Stopped, 1);
+}
+
+PRIVATE double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  RunTarget:  Parses or compiles one input with a fresh budget.           */
+/*                                                                          */
+/*    Inputs:       1) Input, which need not be '\0'-terminated.            */
+/*                  2) Its size.                                            */
+/*                                                                          */
+/*    Outputs:      "Features" and "Tokens" for the input.                  */
+/*                                                                          */
+/*    Returns:      FUZZ_OK or FUZZ_SPIN.                                   */
+/*                                                                          */
+/*    Side Effects: A comp1 compile cut short leaves its streams open;     */
+/*                  CompileBuffer() starts afresh the next time.            */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int RunTarget(unsigned char *data, size_t size)
+{
+    volatile int valid = 0;
+#ifdef CPL_LIBRARY
+    CPLRESULT result;
+#else
+    FILE *input;
+#endif
+
+    memset(Features, 0, sizeof(Features));
+    Tokens = 0;
+    Budget = FUZZ_TOKENS_PER_BYTE * (long)size + FUZZ_TOKEN_SLACK;
+    Previous = 0;
+    Verdict = FUZZ_OK;
+    Current = data;
+    CurrentSize = size;
+    RunNumber++;
+    Running = 1;
+
+#ifdef CPL_LIBRARY
+    if (setjmp(Stopped) == 0)
+    {
+        valid = CompileBuffer((char *)data, size, 0, &result) && result.valid;
+        FreeCompileResult(&result);
+    }
+#else
+    /*fmemopen() rejects an empty buffer.                                 */
+    if (NULL == (input = size > 0 ? fmemopen(data, size, "r") : fopen("/dev/null", "r")))
+    {
+        Running = 0;
+        return FUZZ_OK;
+    }
+    if (setjmp(Stopped) == 0)
+        valid = FuzzParse(input, NullList);
+    fclose(input);
+#endif
+
+    Running = 0;
+    SetFeature(FUZZ_CODES * FUZZ_CODES + Verdict * 2 + valid);
+    return Verdict;
+}
+
+PRIVATE double BestTime(unsigned char *data, size_t size, long *tokens)
+{
+    double best = 0, started, taken;
+    int i;
+
+    for (i = 0; i < FUZZ_TIMING_RUNS; i++)
+    {
+        started = Now();
+        RunTarget(data, size);
+        taken = Now() - started;
+        if (i == 0 || taken < best)
+            best = taken;
+    }
+    *tokens = Tokens;
+    return best;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  SuperLinear: Whether the time per token of the whole input exceeds     */
+/*  that of its first half by FUZZ_SUPERLINEAR_RATIO.  Keeps the features  */
+/*  of the run being checked.                                               */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int SuperLinear(unsigned char *data, size_t size)
+{
+    unsigned char saved[sizeof(Features)];
+    double full, half;
+    long fullTokens, halfTokens;
+    int verdict = Verdict;
+
+    memcpy(saved, Features, sizeof(Features));
+    full = BestTime(data, size, &fullTokens);
+    half = BestTime(data, size / 2, &halfTokens);
+    memcpy(Features, saved, sizeof(Features));
+    Verdict = verdict;
+
+    return halfTokens >= FUZZ_SLOW_MIN_TOKENS / 2 &&
+           full / fullTokens > FUZZ_SUPERLINEAR_RATIO * half / halfTokens;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  FuzzOne:  Runs one input and decides whether it is a finding.           */
+/*                                                                          */
+/*    Inputs:       1) Input.                                               */
+/*                  2) Its size.                                            */
+/*                                                                          */
+/*    Outputs:      3) Time the run took, in nanoseconds.                   */
+/*                                                                          */
+/*    Returns:      FUZZ_OK, FUZZ_SPIN or FUZZ_SLOW.                        */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int FuzzOne(unsigned char *data, size_t size, double *ns)
+{
+    double started = Now(), perToken;
+    int verdict;
+
+    verdict = RunTarget(data, size);
+    *ns = Now() - started;
+    if (verdict != FUZZ_OK || Tokens < FUZZ_SLOW_MIN_TOKENS)
+        return verdict;
+
+    perToken = *ns / Tokens;
+    if (BestNsPerToken == 0 || perToken < BestNsPerToken)
+        BestNsPerToken = perToken;
+    else if (perToken > FUZZ_SLOW_FACTOR * BestNsPerToken && SuperLinear(data, size))
+        return FUZZ_SLOW;
+    return FUZZ_OK;
+}
+
+#ifdef CPL_LIBFUZZER
+/*--------------------------------------------------------------------------*/
+/*  LLVMFuzzerInitialize, LLVMFuzzerTestOneInput: libFuzzer entry points.  */
+/*  The course library reports errors on standard output, which is sent    */
+/*  to /dev/null.                                                           */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+    if (NULL == (NullList = fopen("/dev/null", "w")) || NULL == freopen("/dev/null", "w", stdout))
+    {
+        fprintf(stderr, "cannot open \"/dev/null\" for output\n");
+        exit(EXIT_FAILURE);
+    }
+    return 0;
+}
+
+PUBLIC int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    double ns;
+    int verdict;
+
+    if (size > FUZZ_MAX_INPUT)
+        return 0;
+    if ((verdict = FuzzOne((unsigned char *)data, size, &ns)) != FUZZ_OK)
+    {
+        fprintf(stderr, "cplfuzz: %s\n", VerdictNames[verdict]);
+        abort();
+    }
+    return 0;
+}
+#else
+
+PRIVATE char *ArtifactPrefixes[] = {"", "spin", "slow"};
+
+PRIVATE INPUT *Corpus;
+PRIVATE int CorpusCount;
+PRIVATE int CorpusCapacity;
+PRIVATE char *ArtifactDir = ".";
+PRIVATE char *SaveDir = NULL;
+PRIVATE char *MinimiseDir = NULL;
+PRIVATE char *GenerateDir = NULL;
+PRIVATE char TimeoutPath[4096];
+PRIVATE long Runs = DEFAULT_RUNS;
+PRIVATE int TimeoutMs = DEFAULT_TIMEOUT;
+PRIVATE uint64_t RandomState = 1;
+PRIVATE long Findings;
+
+PRIVATE int ParseOptions(int argc, char *argv[]);
+PRIVATE int LoadCorpus(char *path);
+PRIVATE void RunCorpus(void);
+PRIVATE void Fuzz(void);
+PRIVATE int Minimise(void);
+PRIVATE int Generate(void);
+
+/*--------------------------------------------------------------------------*/
+/*  Watchdog: SIGALRM handler, called every "TimeoutMs".  An input still   */
+/*  running since the last call has taken too long: it is saved and the    */
+/*  harness stops, since the parse cannot safely be cut short.             */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Watchdog(int signo)
+{
+    static sig_atomic_t last = -1;
+    static char message[] = "cplfuzz: time limit exceeded, input saved\n";
+    int fd;
+
+    if (Running && RunNumber == last)
+    {
+        if ((fd = open(TimeoutPath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) >= 0)
+        {
+            if (write(fd, Current, CurrentSize) < 0)
+                fd = -1;
+            close(fd);
+        }
+        if (write(STDERR_FILENO, message, sizeof(message) - 1) < 0)
+            _exit(EXIT_FAILURE);
+        _exit(EXIT_FAILURE);
+    }
+    last = RunNumber;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Main: cplfuzz entry point.  Loads the corpus, then fuzzes, minimises   */
+/*  or generates as the options say.  Fails if anything was found.         */
+/*--------------------------------------------------------------------------*/
+PUBLIC int main(int argc, char *argv[])
+{
+    struct sigaction action;
+    struct itimerval timer;
+    int i, ok = 1;
+
+    if (!ParseOptions(argc, argv))
+        return EXIT_FAILURE;
+    if (NULL == (NullList = fopen("/dev/null", "w")) || NULL == freopen("/dev/null", "w", stdout))
+    {
+        fprintf(stderr, "cannot open \"/dev/null\" for output\n");
+        return EXIT_FAILURE;
+    }
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-' && argv[i][1] == '-')
+            i++;
+        else if (!LoadCorpus(argv[i]))
+            return EXIT_FAILURE;
+    }
+    if (CorpusCount == 0)
+    {
+        fprintf(stderr, "%s: the corpus is empty\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (GenerateDir != NULL)
+        return Generate() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    snprintf(TimeoutPath, sizeof(TimeoutPath), "%s/timeout.prog", ArtifactDir);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = Watchdog;
+    sigaction(SIGALRM, &action, NULL);
+    timer.it_interval.tv_sec = timer.it_value.tv_sec = TimeoutMs / 1000;
+    timer.it_interval.tv_usec = timer.it_value.tv_usec = TimeoutMs % 1000 * 1000;
+    setitimer(ITIMER_REAL, &timer, NULL);
+
+    RunCorpus();
+    if (MinimiseDir != NULL)
+        ok = Minimise();
+    else
+        Fuzz();
+    return ok && Findings == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+PRIVATE int ParseOptions(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-' || argv[i][1] != '-')
+            continue;
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+            Runs = atol(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            RandomState = strtoull(argv[++i], NULL, 10) | 1;
+        else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc)
+        {
+            if ((TimeoutMs = atoi(argv[++i])) <= 0)
+                TimeoutMs = DEFAULT_TIMEOUT;
+        }
+        else if (strcmp(argv[i], "--artifacts") == 0 && i + 1 < argc)
+            ArtifactDir = argv[++i];
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+            SaveDir = argv[++i];
+        else if (strcmp(argv[i], "--minimise") == 0 && i + 1 < argc)
+            MinimiseDir = argv[++i];
+        else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc)
+            GenerateDir = argv[++i];
+        else
+        {
+            fprintf(stderr, "%s: unknown or incomplete option \"%s\"\n", argv[0], argv[i]);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+PRIVATE void *Grow(void *array, int count, int *capacity, size_t size)
+{
+    void *grown;
+
+    if (count < *capacity)
+        return array;
+    *capacity = *capacity > 0 ? *capacity * 2 : 16;
+    if (NULL == (grown = realloc(array, *capacity * size)))
+    {
+        fprintf(stderr, "cplfuzz: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+PRIVATE uint64_t Random(uint64_t range)
+{
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 7;
+    RandomState ^= RandomState << 17;
+    return range > 0 ? RandomState % range : 0;
+}
+
+PRIVATE uint64_t Hash(unsigned char *data, size_t size)
+{
+    uint64_t h = 14695981039346656037ULL;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        h = (h ^ data[i]) * 1099511628211ULL;
+    return h;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddInput: Appends a copy of an input to the corpus.                    */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE INPUT *AddInput(char *name, unsigned char *data, size_t size)
+{
+    INPUT *input;
+
+    Corpus = Grow(Corpus, CorpusCount, &CorpusCapacity, sizeof(INPUT));
+    input = &Corpus[CorpusCount];
+    if (NULL == (input->name = strdup(name)) || NULL == (input->data = malloc(size + 1)))
+    {
+        fprintf(stderr, "cplfuzz: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(input->data, data, size);
+    input->size = size;
+    input->ns = 0;
+    CorpusCount++;
+    return input;
+}
+
+PRIVATE int WriteInput(char *dir, char *name, unsigned char *data, size_t size)
+{
+    char path[4096];
+    FILE *f;
+    int ok;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (NULL == (f = fopen(path, "w")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for output\n", path);
+        return 0;
+    }
+    ok = fwrite(data, 1, size, f) == size;
+    if (fclose(f) != 0 || !ok)
+    {
+        fprintf(stderr, "cannot write \"%s\"\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+PRIVATE int LoadFile(char *path, char *name)
+{
+    unsigned char *data;
+    size_t size;
+    FILE *f;
+
+    if (NULL == (f = fopen(path, "r")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for input\n", path);
+        return 0;
+    }
+    if (NULL == (data = malloc(FUZZ_MAX_INPUT)))
+    {
+        fclose(f);
+        return 0;
+    }
+    size = fread(data, 1, FUZZ_MAX_INPUT, f);
+    fclose(f);
+    AddInput(name, data, size);
+    free(data);
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  LoadCorpus: Adds a file, or every file in a directory, to the corpus.  */
+/*  Inputs are cut to FUZZ_MAX_INPUT bytes.                                 */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int LoadCorpus(char *path)
+{
+    char file[4096];
+    struct dirent *entry;
+    struct stat st;
+    DIR *dir;
+    char *name;
+    int ok = 1;
+
+    if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        name = strrchr(path, '/');
+        return LoadFile(path, name != NULL ? name + 1 : path);
+    }
+    if (NULL == (dir = opendir(path)))
+    {
+        fprintf(stderr, "cannot open \"%s\" for input\n", path);
+        return 0;
+    }
+    while (ok && NULL != (entry = readdir(dir)))
+    {
+        snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+        if (entry->d_name[0] != '.' && stat(file, &st) == 0 && S_ISREG(st.st_mode))
+            ok = LoadFile(file, entry->d_name);
+    }
+    closedir(dir);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Check: Runs an input through FuzzOne() and saves it as a finding if    */
+/*  it is one.                                                              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Check(unsigned char *data, size_t size, double *ns)
+{
+    char name[64];
+    int verdict;
+
+    if ((verdict = FuzzOne(data, size, ns)) != FUZZ_OK)
+    {
+        Findings++;
+        snprintf(name, sizeof(name), "%s-%016llx.prog", ArtifactPrefixes[verdict],
+                 (unsigned long long)Hash(data, size));
+        fprintf(stderr, "cplfuzz: %s: %s/%s\n", VerdictNames[verdict], ArtifactDir, name);
+        WriteInput(ArtifactDir, name, data, size);
+    }
+    return verdict;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddFeatures: Adds the current input's features to those covered, and   */
+/*  returns how many were new.                                              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int AddFeatures(void)
+{
+    int i, added = 0;
+
+    for (i = 0; i < FUZZ_FEATURES; i++)
+    {
+        if ((Features[i / 8] & ~Covered[i / 8]) & (1 << (i % 8)))
+        {
+            Covered[i / 8] |= 1 << (i % 8);
+            added++;
+        }
+    }
+    return added;
+}
+
+PRIVATE int CountFeatures(void)
+{
+    int i, count = 0;
+
+    for (i = 0; i < FUZZ_FEATURES; i++)
+        count += (Covered[i / 8] >> (i % 8)) & 1;
+    return count;
+}
+
+PRIVATE void RunCorpus(void)
+{
+    int i;
+
+    for (i = 0; i < CorpusCount; i++)
+    {
+        Check(Corpus[i].data, Corpus[i].size, &Corpus[i].ns);
+        AddFeatures();
+    }
+    fprintf(stderr, "cplfuzz: %d inputs, %d features\n", CorpusCount, CountFeatures());
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Mutate:  Makes a new input from one or two in the corpus by inserting   */
+/*           CPL tokens, deleting, repeating and changing bytes, and        */
+/*           splicing.  Repeating a piece of an input is what builds the    */
+/*           deep nesting and long lists that super-linear parsing shows    */
+/*           up on.                                                         */
+/*                                                                          */
+/*    Inputs:       1) Buffer of FUZZ_MAX_INPUT bytes.                      */
+/*                  2) Input to start from.                                 */
+/*                  3) Input to splice with.                                */
+/*                                                                          */
+/*    Outputs:      The new input in the buffer.                            */
+/*                                                                          */
+/*    Returns:      Its size.                                               */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE size_t Mutate(unsigned char *out, INPUT *from, INPUT *other)
+{
+    static char *words[] = {"PROGRAM", "VAR", "PROCEDURE", "BEGIN", "END", "REF", "WHILE", "DO",
+                            "IF", "THEN", "ELSE", "READ", "WRITE", ";", ",", ".", ":=", "(", ")",
+                            "+", "-", "*", "/", "=", "<", ">", "<=", ">=", "x", "0", "!", "\n"};
+    static char bytes[] = " \n;,.():=+-*/<>!0123456789abxyzPBE";
+    size_t size = from->size < FUZZ_MAX_INPUT ? from->size : FUZZ_MAX_INPUT;
+    size_t at, to, length, cut;
+    unsigned char piece[64];
+    char word[16];
+    int edits = 1 + Random(4);
+
+    memcpy(out, from->data, size);
+    while (edits-- > 0)
+    {
+        at = Random(size + 1);
+        switch (Random(5))
+        {
+        case 0:
+            length = snprintf(word, sizeof(word), " %s ", words[Random(sizeof(words) / sizeof(words[0]))]);
+            if (size + length > FUZZ_MAX_INPUT)
+                break;
+            memmove(out + at + length, out + at, size - at);
+            memcpy(out + at, word, length);
+            size += length;
+            break;
+        case 1:
+            length = 1 + Random(16);
+            if (length > size - at)
+                length = size - at;
+            memmove(out + at, out + at + length, size - at - length);
+            size -= length;
+            break;
+        case 2:
+            length = 1 + Random(64);
+            if (length > size - at)
+                length = size - at;
+            to = Random(size + 1);
+            if (length == 0 || size + length > FUZZ_MAX_INPUT)
+                break;
+            memcpy(piece, out + at, length);
+            memmove(out + to + length, out + to, size - to);
+            memcpy(out + to, piece, length);
+            size += length;
+            break;
+        case 3:
+            if (at < size)
+                out[at] = bytes[Random(sizeof(bytes) - 1)];
+            break;
+        default:
+            cut = Random(other->size + 1);
+            length = other->size - cut;
+            if (at + length > FUZZ_MAX_INPUT)
+                length = FUZZ_MAX_INPUT - at;
+            memcpy(out + at, other->data + cut, length);
+            size = at + length;
+            break;
+        }
+    }
+    return size;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Fuzz: Tries "Runs" mutated inputs, adding those that reach a new       */
+/*  feature to the corpus, and reports the rate they were run at.          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Fuzz(void)
+{
+    unsigned char *buffer;
+    char name[64];
+    double started = Now(), ns;
+    size_t size;
+    long run;
+    INPUT *input;
+
+    if (NULL == (buffer = malloc(FUZZ_MAX_INPUT)))
+        return;
+    for (run = 0; run < Runs; run++)
+    {
+        size = Mutate(buffer, &Corpus[Random(CorpusCount)], &Corpus[Random(CorpusCount)]);
+        if (Check(buffer, size, &ns) != FUZZ_OK || AddFeatures() == 0)
+            continue;
+        snprintf(name, sizeof(name), "%016llx.prog", (unsigned long long)Hash(buffer, size));
+        input = AddInput(name, buffer, size);
+        input->ns = ns;
+        if (SaveDir != NULL)
+            WriteInput(SaveDir, name, buffer, size);
+    }
+    free(buffer);
+    fprintf(stderr, "cplfuzz: %ld runs, %.0f runs/s, %d inputs, %d features, %ld findings\n", Runs,
+            Runs / ((Now() - started) / 1e9), CorpusCount, CountFeatures(), Findings);
+}
+
+PRIVATE int ByTime(const void *a, const void *b)
+{
+    const INPUT *x = a, *y = b;
+
+    if (x->ns != y->ns)
+        return x->ns < y->ns ? -1 : 1;
+    return x->size < y->size ? -1 : x->size > y->size;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Minimise: Writes the corpus inputs that reach a feature none faster    */
+/*  did, taking them in order of time, so the corpus written covers the    */
+/*  same features and runs as fast as it can.                              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Minimise(void)
+{
+    int i, kept = 0;
+
+    qsort(Corpus, CorpusCount, sizeof(INPUT), ByTime);
+    memset(Covered, 0, sizeof(Covered));
+    for (i = 0; i < CorpusCount; i++)
+    {
+        RunTarget(Corpus[i].data, Corpus[i].size);
+        if (AddFeatures() == 0)
+            continue;
+        if (!WriteInput(MinimiseDir, Corpus[i].name, Corpus[i].data, Corpus[i].size))
+            return 0;
+        kept++;
+    }
+    fprintf(stderr, "cplfuzz: kept %d of %d inputs, %d features\n", kept, CorpusCount, CountFeatures());
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Put: Appends formatted text to a generated program.                    */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Put(TEXT *t, char *format, ...)
+{
+    va_list args;
+    int length;
+
+    for (;;)
+    {
+        va_start(args, format);
+        length = vsnprintf(t->text + t->length, t->capacity - t->length, format, args);
+        va_end(args);
+        if (length >= 0 && t->length + length < t->capacity)
+            break;
+        t->capacity = t->capacity > 0 ? t->capacity * 2 : 4096;
+        if (NULL == (t->text = realloc(t->text, t->capacity)))
+        {
+            fprintf(stderr, "cplfuzz: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    t->length += length;
+}
+
+PRIVATE void GenExpression(TEXT *t, int depth);
+
+PRIVATE void GenSubTerm(TEXT *t, int depth)
+{
+    if (depth > 0 && Random(4) == 0)
+    {
+        Put(t, "(");
+        GenExpression(t, depth - 1);
+        Put(t, ")");
+    }
+    else if (Random(2) == 0)
+        Put(t, "v%d", (int)Random(4));
+    else
+        Put(t, "%d", (int)Random(1000));
+}
+
+PRIVATE void GenTerm(TEXT *t, int depth)
+{
+    if (Random(5) == 0)
+        Put(t, "-");
+    GenSubTerm(t, depth);
+    while (Random(3) == 0)
+    {
+        Put(t, Random(2) == 0 ? " * " : " / ");
+        GenSubTerm(t, depth);
+    }
+}
+
+PRIVATE void GenExpression(TEXT *t, int depth)
+{
+    GenTerm(t, depth);
+    while (Random(3) == 0)
+    {
+        Put(t, Random(2) == 0 ? " + " : " - ");
+        GenTerm(t, depth);
+    }
+}
+
+PRIVATE void GenBoolean(TEXT *t)
+{
+    static char *relops[] = {" = ", " <= ", " >= ", " < ", " > "};
+
+    GenExpression(t, 2);
+    Put(t, relops[Random(5)]);
+    GenExpression(t, 2);
+}
+
+PRIVATE void GenBlock(TEXT *t, int depth, int procs, int statements);
+
+PRIVATE void GenStatement(TEXT *t, int depth, int procs)
+{
+    switch (Random(depth > 0 ? 6 : 4))
+    {
+    case 0:
+        Put(t, "v%d := ", (int)Random(4));
+        GenExpression(t, 3);
+        break;
+    case 1:
+        if (procs == 0)
+            Put(t, "READ(v%d, v%d)", (int)Random(4), (int)Random(4));
+        else if (Random(2) == 0)
+            Put(t, "p%d", (int)Random(procs));
+        else
+        {
+            Put(t, "p%d(", (int)Random(procs));
+            GenExpression(t, 2);
+            Put(t, ", v%d)", (int)Random(4));
+        }
+        break;
+    case 2:
+        Put(t, "READ(v%d)", (int)Random(4));
+        break;
+    case 3:
+        Put(t, "WRITE(");
+        GenExpression(t, 3);
+        if (Random(2) == 0)
+        {
+            Put(t, ", ");
+            GenExpression(t, 1);
+        }
+        Put(t, ")");
+        break;
+    case 4:
+        Put(t, "WHILE ");
+        GenBoolean(t);
+        Put(t, " DO ");
+        GenBlock(t, depth - 1, procs, 1 + Random(3));
+        break;
+    default:
+        Put(t, "IF ");
+        GenBoolean(t);
+        Put(t, " THEN ");
+        GenBlock(t, depth - 1, procs, 1 + Random(3));
+        if (Random(2) == 0)
+        {
+            Put(t, "\nELSE ");
+            GenBlock(t, depth - 1, procs, 1 + Random(3));
+        }
+        break;
+    }
+}
+
+PRIVATE void GenBlock(TEXT *t, int depth, int procs, int statements)
+{
+    Put(t, "BEGIN\n");
+    while (statements-- > 0)
+    {
+        GenStatement(t, depth, procs);
+        Put(t, ";\n");
+    }
+    Put(t, "END");
+}
+
+/*--------------------------------------------------------------------------*/
+/*  GenProcedure: Declares procedure "p<index>", with nested ones to       */
+/*  "depth" levels.  Returns the index of the next procedure.              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int GenProcedure(TEXT *t, int index, int depth, int size)
+{
+    int first = index++;
+
+    Put(t, "PROCEDURE p%d", first);
+    if (Random(2) == 0)
+        Put(t, "(a, REF b)");
+    Put(t, ";\n");
+    if (Random(2) == 0)
+        Put(t, "VAR l0, l1;\n");
+    while (depth > 0 && Random(3) == 0)
+        index = GenProcedure(t, index, depth - 1, size);
+    GenBlock(t, 2, index, 1 + Random(size));
+    Put(t, ";\n");
+    return index;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  GenProgram: Writes the "number"th generated program.  Most are         */
+/*  syntactically valid programs of growing size, every fourth cut short   */
+/*  for the error paths; the last few are stress shapes.                   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void GenProgram(TEXT *t, int number)
+{
+    int i, procs = 0, size = 1 + number % 8 * 4;
+
+    t->length = 0;
+    Put(t, "PROGRAM g%d;\nVAR v0, v1, v2, v3;\n", number);
+    switch (FUZZ_GENERATED - number)
+    {
+    case 1: /*  Deep parentheses.                                       */
+        Put(t, "BEGIN\nWRITE(");
+        for (i = 0; i < 400; i++)
+            Put(t, "(");
+        Put(t, "1");
+        for (i = 0; i < 400; i++)
+            Put(t, ")");
+        Put(t, ");\nEND.\n");
+        return;
+    case 2: /*  A long block.                                           */
+        GenBlock(t, 0, 0, 3000);
+        Put(t, ".\n");
+        return;
+    case 3: /*  Deeply nested blocks.                                   */
+        Put(t, "BEGIN\n");
+        for (i = 0; i < 60; i++)
+            Put(t, "IF v0 < %d THEN BEGIN\n", i);
+        for (i = 0; i < 60; i++)
+            Put(t, "END;\n");
+        Put(t, "END.\n");
+        return;
+    case 4: /*  Deeply nested procedures.                               */
+        for (i = 0; i < 20; i++)
+            Put(t, "PROCEDURE p%d;\n", i);
+        for (i = 0; i < 20; i++)
+            Put(t, "BEGIN p%d; END;\n", 19 - i);
+        Put(t, "BEGIN\np0;\nEND.\n");
+        return;
+    case 5: /*  Many procedures.                                        */
+        for (i = 0; i < 200; i++)
+            procs = GenProcedure(t, procs, 0, 2);
+        GenBlock(t, 1, procs, 10);
+        Put(t, ".\n");
+        return;
+    }
+    for (i = Random(size / 2 + 1); i > 0; i--)
+        procs = GenProcedure(t, procs, 2, size);
+    GenBlock(t, 3, procs, 1 + Random(size * 2));
+    Put(t, ".\n");
+    if (number % 4 == 3)
+        t->length = Random(t->length);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Generate: Writes the seed corpus: each input given, then the           */
+/*  generated programs, made the same way for the same --seed.             */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Generate(void)
+{
+    TEXT t = {NULL, 0, 0};
+    char name[4096];
+    int i, ok = 1;
+
+    for (i = 0; ok && i < CorpusCount; i++)
+    {
+        snprintf(name, sizeof(name), "seed-%s", Corpus[i].name);
+        ok = WriteInput(GenerateDir, name, Corpus[i].data, Corpus[i].size);
+    }
+    for (i = 1; ok && i <= FUZZ_GENERATED; i++)
+    {
+        GenProgram(&t, i);
+        snprintf(name, sizeof(name), "gen-%03d.prog", i);
+        ok = WriteInput(GenerateDir, name, (unsigned char *)t.text, t.length);
+    }
+    free(t.text);
+    return ok;
+}
+#endif
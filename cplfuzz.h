@@ -0,0 +1,54 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cplfuzz.h                                                          */
+/*                                                                          */
+/*       Fuzzing hooks.  Building parser1.c, parser2.c or comp1.c with      */
+/*       CPL_FUZZ defined sends every GetToken() call through               */
+/*       FuzzGetToken(), which counts tokens against the budget for the     */
+/*       input being parsed, and gives the parsers a FuzzParse() entry      */
+/*       point in place of main().  Each target is linked with cplfuzz.c    */
+/*       and the course library:                                            */
+/*                                                                          */
+/*           cc -DCPL_FUZZ parser1.c cplfuzz.c <library> -o fuzz-parser1    */
+/*           cc -DCPL_FUZZ parser2.c cplfuzz.c <library> -o fuzz-parser2    */
+/*           cc -DCPL_FUZZ -DCPL_LIBRARY comp1.c cplfuzz.c codebuf.c ...    */
+/*              <library> -o fuzz-comp1                                     */
+/*                                                                          */
+/*       comp1 is driven through CompileBuffer(), so it needs the same      */
+/*       modules as any other program built on "cpl.h".  Adding             */
+/*       -DCPL_LIBFUZZER and -fsanitize=fuzzer builds a libFuzzer target    */
+/*       instead of cplfuzz's own driver; see "cplfuzz.c".                  */
+/*                                                                          */
+/*       A well-behaved parser reads each token once, and every token but   */
+/*       the end of input uses up at least one byte, so the budget is       */
+/*       FUZZ_TOKENS_PER_BYTE tokens a byte plus FUZZ_TOKEN_SLACK.  A       */
+/*       recovery loop that keeps asking for tokens at the end of input     */
+/*       runs through it at once.                                           */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef CPLFUZZ_H
+#define CPLFUZZ_H
+
+#include <stdio.h>
+#include "global.h"
+#include "scanner.h"
+
+#define FUZZ_TOKENS_PER_BYTE 2
+#define FUZZ_TOKEN_SLACK 256
+
+PUBLIC TOKEN FuzzGetToken(void);
+PUBLIC void FuzzStop(void);
+PUBLIC int FuzzParse(FILE *input, FILE *list);
+
+#ifdef CPL_FUZZ
+#define GetToken FuzzGetToken
+#endif
+
+#endif
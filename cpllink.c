@@ -0,0 +1,264 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cpllink.c                                                          */
+/*                                                                          */
+/*       Linker for object units written by "comp1 --format object".  The   */
+/*       first unit is the main program; the rest supply the procedures it  */
+/*       and they call.  See "cplobj.h".                                    */
+/*                                                                          */
+/*           cpllink [options] <objfile>... <codefile>                      */
+/*                                                                          */
+/*           --format text|binary  Write the code file as text for the      */
+/*                                 course simulator (the default), or in    */
+/*                                 the binary format of "cplbin.h".         */
+/*           --drop-dead           Leave out procedures the main block      */
+/*                                 never calls, directly or not, and say    */
+/*                                 how much code that saved.                */
+/*           --reorder             Lay procedures out in the order the      */
+/*                                 call graph reaches them from the main    */
+/*                                 block, so each follows its first caller. */
+/*           --profile <file>      Reorder, hottest first by the cycles     */
+/*                                 spent in each procedure in a call graph  */
+/*                                 written by "cplprof --callgraph".        */
+/*                                                                          */
+/*       Nothing is written if any unit cannot be read or any call cannot   */
+/*       be resolved.  A linked binary has no debug section, as objects     */
+/*       keep no line table.                                                */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "code.h"
+#include "codebuf.h"
+#include "cplbin.h"
+#include "cplobj.h"
+#include "global.h"
+
+#define MAXNAME 256
+
+PRIVATE int Format = CODE_TEXT;
+PRIVATE char **UnitPaths = NULL;
+PRIVATE int UnitCount = 0;
+PRIVATE char *CodePath = NULL;
+PRIVATE char *ProfilePath = NULL;
+PRIVATE LINKOPTIONS Options;
+
+PRIVATE int ParseOptions(int argc, char *argv[]);
+PRIVATE int ReadProfile(char *path, LINKOPTIONS *options);
+PRIVATE int ByName(const void *a, const void *b);
+PRIVATE int WriteLinkedCode(CODEBUF *cb, CODEPROC *procs, int procCount, int entry, int dataSize);
+PRIVATE void ImageSink(void *arg, INSTRUCTION *code, int count);
+
+/*--------------------------------------------------------------------------*/
+/*  Main: cpllink entry point.  Reads every unit, links them and writes    */
+/*  the code file.                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int main(int argc, char *argv[])
+{
+    CPLOBJECT *units;
+    CODEBUF cb;
+    CODEPROC *procs = NULL;
+    int procCount, entry, dataSize, ok = 1, i;
+
+    if (!ParseOptions(argc, argv))
+        return EXIT_FAILURE;
+    if (ProfilePath != NULL && !ReadProfile(ProfilePath, &Options))
+    {
+        fprintf(stderr, "cannot read profile \"%s\"\n", ProfilePath);
+        return EXIT_FAILURE;
+    }
+    if (NULL == (units = calloc(UnitCount, sizeof(CPLOBJECT))))
+    {
+        fprintf(stderr, "out of memory in linker\n");
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < UnitCount; i++)
+    {
+        InitObject(&units[i]);
+        if (!ReadObject(UnitPaths[i], &units[i]))
+        {
+            fprintf(stderr, "cannot read object \"%s\"\n", UnitPaths[i]);
+            ok = 0;
+        }
+    }
+
+    InitCodeBuffer(&cb);
+    ok = ok && LinkObjects(units, UnitPaths, UnitCount, &Options, &cb, &procs, &procCount, &entry, &dataSize) &&
+         WriteLinkedCode(&cb, procs, procCount, entry, dataSize);
+    if (ok && Options.dropDead)
+        printf("Dead procedures: %d dropped, %d instruction(s) saved\n", Options.dropped, Options.droppedCode);
+
+    FreeCodeBuffer(&cb);
+    free(procs);
+    for (i = 0; i < UnitCount; i++)
+        FreeObject(&units[i]);
+    free(units);
+    for (i = 0; i < Options.heatCount; i++)
+        free(Options.heat[i].name);
+    free(Options.heat);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+PRIVATE int ParseOptions(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] == '-'; i++)
+    {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            if (strcmp(argv[++i], "text") == 0)
+                Format = CODE_TEXT;
+            else if (strcmp(argv[i], "binary") == 0)
+                Format = CODE_BINARY;
+            else
+            {
+                fprintf(stderr, "%s: --format takes text or binary\n", argv[0]);
+                return 0;
+            }
+        }
+        else if (strcmp(argv[i], "--drop-dead") == 0)
+            Options.dropDead = 1;
+        else if (strcmp(argv[i], "--reorder") == 0)
+            Options.reorder = 1;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+        {
+            ProfilePath = argv[++i];
+            Options.reorder = 1;
+        }
+        else
+        {
+            fprintf(stderr, "%s: unknown or incomplete option \"%s\"\n", argv[0], argv[i]);
+            return 0;
+        }
+    }
+
+    if (argc - i < 2)
+    {
+        fprintf(stderr, "%s [options] <objfile>... <codefile>\n", argv[0]);
+        fprintf(stderr, "%s [--format text|binary] [--drop-dead] [--reorder]\n", argv[0]);
+        fprintf(stderr, "    [--profile <file>] <objfile>... <codefile>\n");
+        return 0;
+    }
+    UnitPaths = &argv[i];
+    UnitCount = argc - i - 1;
+    CodePath = argv[argc - 1];
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  WriteLinkedCode: Writes the linked program to CodePath in the chosen   */
+/*  format.  Returns 0, having said why, if it could not.                  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int WriteLinkedCode(CODEBUF *cb, CODEPROC *procs, int procCount, int entry, int dataSize)
+{
+    FILE *f;
+    int ok;
+
+    if (NULL == (f = fopen(CodePath, "w")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for output\n", CodePath);
+        return 0;
+    }
+
+    if (Format == CODE_TEXT)
+    {
+        InitCodeGenerator(f);
+        FlushCodeBuffer(cb);
+        WriteCodeFile();
+        ok = 1;
+    }
+    else
+    {
+        ok = BeginCodeImage(f);
+        RetireCode(cb, ImageSink, f);
+        ok = ok && EndCodeImage(f, BufferAddress(cb), entry, dataSize, procs, procCount, NULL);
+    }
+
+    if (fclose(f) != 0)
+        ok = 0;
+    if (!ok)
+        fprintf(stderr, "cannot write \"%s\"\n", CodePath);
+    return ok;
+}
+
+PRIVATE void ImageSink(void *arg, INSTRUCTION *code, int count)
+{
+    WriteImageCode(arg, code, count);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReadProfile: Reads a call graph written by "cplprof --callgraph" into  */
+/*  "options", weighing each procedure by the cycles spent in the calls    */
+/*  made to it.  Returns 0 if the file could not be read.                  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReadProfile(char *path, LINKOPTIONS *options)
+{
+    FILE *f;
+    LINKHEAT *heat = NULL;
+    char caller[MAXNAME], callee[MAXNAME], header[4][16];
+    long long calls, cycles;
+    int count = 0, capacity = 0, n, i;
+
+    if (NULL == (f = fopen(path, "r")))
+        return 0;
+    if (fscanf(f, "%15s %15s %15s %15s", header[0], header[1], header[2], header[3]) != 4 ||
+        strcmp(header[1], "callee") != 0 || strcmp(header[3], "cycles") != 0)
+    {
+        fclose(f);
+        return 0;
+    }
+
+    while (fscanf(f, "%255s %255s %lld %lld", caller, callee, &calls, &cycles) == 4)
+    {
+        if (count == capacity)
+        {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            if (NULL == (heat = realloc(heat, capacity * sizeof(LINKHEAT))))
+            {
+                fprintf(stderr, "out of memory in linker\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        if (NULL == (heat[count].name = malloc(strlen(callee) + 1)))
+        {
+            fprintf(stderr, "out of memory in linker\n");
+            exit(EXIT_FAILURE);
+        }
+        strcpy(heat[count].name, callee);
+        heat[count++].cycles = cycles;
+    }
+    fclose(f);
+
+    /*One entry per procedure, its edges' cycles added up.                 */
+    qsort(heat, count, sizeof(LINKHEAT), ByName);
+    for (n = 0, i = 0; i < count; i++)
+    {
+        if (n > 0 && strcmp(heat[n - 1].name, heat[i].name) == 0)
+        {
+            heat[n - 1].cycles += heat[i].cycles;
+            free(heat[i].name);
+        }
+        else
+            heat[n++] = heat[i];
+    }
+    options->heat = heat;
+    options->heatCount = n;
+    return 1;
+}
+
+PRIVATE int ByName(const void *a, const void *b)
+{
+    return strcmp(((LINKHEAT *)a)->name, ((LINKHEAT *)b)->name);
+}
@@ -0,0 +1,621 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cplobj.c                                                           */
+/*                                                                          */
+/*       Object units and the linker.  See "cplobj.h".                      */
+/*                                                                          */
+/*       An object file is plain text, its procedures in the format of      */
+/*       "proccache.c":                                                     */
+/*                                                                          */
+/*           CPLOBJECT 1                                                    */
+/*           UNIT <name> <dataSize> <exports> <imports>                     */
+/*           EXPORT <name>                                                  */
+/*           ...                                                            */
+/*           IMPORT <name>                                                  */
+/*           ...                                                            */
+/*           PROC ...              one per export, in the same order        */
+/*           MAIN                                                           */
+/*           PROC ...              the main block                           */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "code.h"
+#include "codebuf.h"
+#include "cplobj.h"
+#include "global.h"
+#include "proccache.h"
+
+#define OBJECT_MAGIC "CPLOBJECT"
+#define OBJECT_VERSION 1
+#define MAXNAME 256
+
+typedef struct
+{
+    PCENTRY *proc;
+    int unit;       /*  Index of the unit defining it.               */
+    int address;    /*  Where it is laid out, or -1 if left out.     */
+    int rank;       /*  Order the call graph reaches it in, or -1.   */
+    long long heat; /*  Cycles the profile gives it.                 */
+} LINKNODE;         /*  A top-level procedure or the main block.     */
+
+typedef struct
+{
+    char *name;
+    int node;
+} LINKSYMBOL;
+
+PRIVATE LINKNODE *SortNodes; /*  Nodes ByLayout compares.               */
+
+PRIVATE void *GrowArray(void *array, int count, int *capacity, size_t size);
+PRIVATE char *CopyName(char *s);
+PRIVATE PCENTRY *StoreEntry(char *name, CODEBUF *cb, int start, int entry, int end,
+                            CODEPROC *nested, int nestedCount);
+PRIVATE int Exports(CPLOBJECT *obj, char *name);
+PRIVATE int AddImport(CPLOBJECT *obj, char *name);
+PRIVATE int ByName(const void *a, const void *b);
+PRIVATE int ByHeatName(const void *a, const void *b);
+PRIVATE int ByLayout(const void *a, const void *b);
+PRIVATE LINKSYMBOL *FindSymbol(LINKSYMBOL *table, int count, char *name);
+PRIVATE void RankNodes(LINKNODE *nodes, int count, LINKSYMBOL *table);
+PRIVATE int EmitEntry(PCENTRY *entry, CODEBUF *cb, LINKSYMBOL *table, int count, LINKNODE *nodes,
+                      char *path);
+PRIVATE void AddLinkedProcs(PCENTRY *entry, int start, CODEPROC **procs, int *procCount, int *capacity);
+
+PUBLIC void InitObject(CPLOBJECT *obj)
+{
+    memset(obj, 0, sizeof(CPLOBJECT));
+}
+
+PUBLIC void FreeObject(CPLOBJECT *obj)
+{
+    int i;
+
+    for (i = 0; i < obj->procCount; i++)
+        FreeProcEntry(obj->procs[i]);
+    free(obj->procs);
+    if (obj->main != NULL)
+        FreeProcEntry(obj->main);
+    for (i = 0; i < obj->importCount; i++)
+        free(obj->imports[i]);
+    free(obj->imports);
+    free(obj->name);
+    InitObject(obj);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddObjectProc: Exports the code in [start, end) of the buffer as the   */
+/*  top-level procedure "name", whose calls land at "entry"; "nested" are  */
+/*  the procedure table entries of the procedures declared inside it.      */
+/*  Returns 0 if there was no memory for it.                                */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int AddObjectProc(CPLOBJECT *obj, char *name, CODEBUF *cb, int start, int entry, int end,
+                         CODEPROC *nested, int nestedCount)
+{
+    PCENTRY *proc;
+
+    if (NULL == (proc = StoreEntry(name, cb, start, entry, end, nested, nestedCount)))
+        return 0;
+    obj->procs = GrowArray(obj->procs, obj->procCount, &obj->procCapacity, sizeof(PCENTRY *));
+    obj->procs[obj->procCount++] = proc;
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  SetObjectMain: Records the code in [start, end) of the buffer as the   */
+/*  main block of program "name", and the program's data size.  Returns 0 */
+/*  if there was no memory for it.                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int SetObjectMain(CPLOBJECT *obj, char *name, int dataSize, CODEBUF *cb, int start, int end)
+{
+    if (obj->main != NULL)
+        FreeProcEntry(obj->main);
+    free(obj->name);
+    obj->name = CopyName(name);
+    obj->dataSize = dataSize;
+    return NULL != (obj->main = StoreEntry(name, cb, start, start, end, NULL, 0));
+}
+
+/*--------------------------------------------------------------------------*/
+/*  StoreEntry: StoreProcCache() for one procedure on its own, with calls  */
+/*  that land inside it made relative to its start like its branches, so   */
+/*  that only calls to other top-level procedures are left to resolve by   */
+/*  name.  Source offsets are kept as they are.                             */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE PCENTRY *StoreEntry(char *name, CODEBUF *cb, int start, int entry, int end,
+                            CODEPROC *nested, int nestedCount)
+{
+    PROCCACHE scratch;
+    PCENTRY *proc;
+    PCINSTRUCTION *ins;
+    int i;
+
+    InitProcCache(&scratch);
+    if (NULL == (proc = StoreProcCache(&scratch, name, 0, cb, start, entry, end, 0, nested, nestedCount)))
+        return NULL;
+    proc->next = NULL;
+    for (i = 0; i < proc->count; i++)
+    {
+        ins = &proc->code[i];
+        if (ins->reloc == RELOC_CALL && ins->operand >= start && ins->operand < end)
+        {
+            ins->reloc = RELOC_LOCAL;
+            ins->operand -= start;
+        }
+    }
+    return proc;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  WriteObject:  Writes a unit in the format described above.  Its        */
+/*                imports are every name called by name that it does not   */
+/*                export itself.                                            */
+/*                                                                          */
+/*    Inputs:       1) File to write to.                                    */
+/*                  2) Unit, with its main block set.                       */
+/*                                                                          */
+/*    Outputs:      The object on "f".                                      */
+/*                                                                          */
+/*    Returns:      1, or 0 if the unit has no main block or the file       */
+/*                  could not be written.                                   */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int WriteObject(FILE *f, CPLOBJECT *obj)
+{
+    PCENTRY *proc;
+    int i, j;
+
+    if (obj->main == NULL)
+        return 0;
+
+    for (i = 0; i <= obj->procCount; i++)
+    {
+        proc = i < obj->procCount ? obj->procs[i] : obj->main;
+        for (j = 0; j < proc->count; j++)
+        {
+            if (proc->code[j].reloc == RELOC_CALL && !Exports(obj, proc->code[j].callee) &&
+                !AddImport(obj, proc->code[j].callee))
+                return 0;
+        }
+    }
+
+    fprintf(f, "%s %d\n", OBJECT_MAGIC, OBJECT_VERSION);
+    fprintf(f, "UNIT %s %d %d %d\n", obj->name, obj->dataSize, obj->procCount, obj->importCount);
+    for (i = 0; i < obj->procCount; i++)
+        fprintf(f, "EXPORT %s\n", obj->procs[i]->name);
+    for (i = 0; i < obj->importCount; i++)
+        fprintf(f, "IMPORT %s\n", obj->imports[i]);
+    for (i = 0; i < obj->procCount; i++)
+        WriteProcEntry(f, obj->procs[i]);
+    fprintf(f, "MAIN\n");
+    WriteProcEntry(f, obj->main);
+    return !ferror(f);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ReadObject:  Reads a unit written by WriteObject.                       */
+/*                                                                          */
+/*    Inputs:       1) Path of the object file.                             */
+/*                  2) Unit to fill in, which must be empty.                */
+/*                                                                          */
+/*    Outputs:      The unit.                                               */
+/*                                                                          */
+/*    Returns:      1, or 0, with the unit left empty, if the file could    */
+/*                  not be opened or is not a well-formed object.           */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int ReadObject(char *path, CPLOBJECT *obj)
+{
+    FILE *f;
+    PCENTRY *proc;
+    char word[16], name[MAXNAME];
+    int version, exports, imports, i, ok;
+
+    if (NULL == (f = fopen(path, "r")))
+        return 0;
+
+    ok = fscanf(f, "%15s %d", word, &version) == 2 && strcmp(word, OBJECT_MAGIC) == 0 &&
+         version == OBJECT_VERSION &&
+         fscanf(f, " UNIT %255s %d %d %d", name, &obj->dataSize, &exports, &imports) == 4 &&
+         exports >= 0 && imports >= 0;
+    if (ok)
+        obj->name = CopyName(name);
+
+    /*The EXPORT lines repeat the names of the PROC entries, and are only  */
+    /*there for anything that just wants the symbol table.                 */
+    for (i = 0; ok && i < exports; i++)
+        ok = fscanf(f, " EXPORT %255s", name) == 1;
+    for (i = 0; ok && i < imports; i++)
+        ok = fscanf(f, " IMPORT %255s", name) == 1 && AddImport(obj, name);
+    for (i = 0; ok && i < exports; i++)
+    {
+        if ((ok = ReadProcEntry(f, &proc) == 1))
+        {
+            obj->procs = GrowArray(obj->procs, obj->procCount, &obj->procCapacity, sizeof(PCENTRY *));
+            obj->procs[obj->procCount++] = proc;
+        }
+    }
+    ok = ok && fscanf(f, "%15s", word) == 1 && strcmp(word, "MAIN") == 0 && ReadProcEntry(f, &obj->main) == 1;
+
+    fclose(f);
+    if (!ok)
+        FreeObject(obj);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  LinkObjects:  Links units into one program, appending its code to a    */
+/*                buffer that should be empty.                              */
+/*                                                                          */
+/*    By default the procedures of the other units are laid out in the     */
+/*    order the units are given, each unit's in declaration order, as if   */
+/*    declared ahead of the first unit's own.  The first unit's main       */
+/*    block always goes last, so that the program ends where it does.      */
+/*                                                                          */
+/*    The call graph is walked from the main block, depth first and in     */
+/*    the order each procedure makes its calls, when "options" asks for    */
+/*    it.  "dropDead" then leaves out the procedures it never reaches, and */
+/*    "reorder" lays out the rest hottest first by the profile, and        */
+/*    otherwise in the order they were reached, so that a procedure        */
+/*    follows its first caller; anything kept but not reached comes after. */
+/*    Only whole top-level procedures are moved or left out.               */
+/*                                                                          */
+/*    A procedure exported by two units, or called by name from code that  */
+/*    is kept but exported by none, is reported on stderr against "paths", */
+/*    and fails the link.  The names of called procedures in the code are  */
+/*    those in the units, which must outlive the buffer.                   */
+/*                                                                          */
+/*    Inputs:       1) Units, the first being the main program.             */
+/*                  2) Their file names, for messages.                      */
+/*                  3) Number of units.                                     */
+/*                  4) Options, or NULL for the default layout.             */
+/*                  5) Code buffer.                                         */
+/*                                                                          */
+/*    Outputs:      4) What was left out, in "dropped" and "droppedCode".   */
+/*                  6) Procedure table, in the order of "cplbin.h";         */
+/*                     the caller frees it, but not its names.              */
+/*                  7) Its length.                                          */
+/*                  8) Address of the main block.                           */
+/*                  9) Words of global data: the largest of any unit.      */
+/*                                                                          */
+/*    Returns:      1, or 0 if the link failed.                             */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int LinkObjects(CPLOBJECT *units, char **paths, int count, LINKOPTIONS *options, CODEBUF *cb,
+                       CODEPROC **procs, int *procCount, int *entry, int *dataSize)
+{
+    LINKNODE *nodes, *node;
+    LINKSYMBOL *table;
+    LINKHEAT *heat, key;
+    int *order, nodeCount = 1, kept = 0, address, capacity = 0, ok = 1, k, u, i;
+
+    *procs = NULL;
+    *procCount = 0;
+    *dataSize = 0;
+    for (u = 0; u < count; u++)
+        nodeCount += units[u].procCount;
+    nodes = malloc(nodeCount * sizeof(LINKNODE));
+    table = malloc(nodeCount * sizeof(LINKSYMBOL));
+    order = malloc(nodeCount * sizeof(int));
+    if (nodes == NULL || table == NULL || order == NULL)
+    {
+        fprintf(stderr, "out of memory in linker\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /*Nodes in the default layout, the main block last.                     */
+    nodeCount = 0;
+    for (k = 0; k < count; k++)
+    {
+        u = (k + 1) % count;
+        for (i = 0; i < units[u].procCount; i++, nodeCount++)
+        {
+            node = &nodes[nodeCount];
+            node->proc = units[u].procs[i];
+            node->unit = u;
+            node->rank = -1;
+            node->heat = 0;
+            key.name = node->proc->name;
+            if (options != NULL && options->heat != NULL &&
+                NULL != (heat = bsearch(&key, options->heat, options->heatCount, sizeof(LINKHEAT), ByHeatName)))
+                node->heat = heat->cycles;
+            table[nodeCount].name = node->proc->name;
+            table[nodeCount].node = nodeCount;
+        }
+        if (units[u].dataSize > *dataSize)
+            *dataSize = units[u].dataSize;
+    }
+    nodes[nodeCount].proc = units[0].main;
+    nodes[nodeCount].unit = 0;
+    nodes[nodeCount].rank = -1;
+    nodes[nodeCount].heat = 0;
+
+    qsort(table, nodeCount, sizeof(LINKSYMBOL), ByName);
+    for (i = 1; i < nodeCount; i++)
+    {
+        if (strcmp(table[i - 1].name, table[i].name) == 0)
+        {
+            fprintf(stderr, "procedure \"%s\" is defined in both \"%s\" and \"%s\"\n", table[i].name,
+                    paths[nodes[table[i - 1].node].unit], paths[nodes[table[i].node].unit]);
+            ok = 0;
+        }
+    }
+
+    for (i = 0; i < nodeCount; i++)
+        order[i] = i;
+    if (options != NULL && (options->dropDead || options->reorder))
+    {
+        RankNodes(nodes, nodeCount, table);
+        if (options->reorder)
+        {
+            SortNodes = nodes;
+            qsort(order, nodeCount, sizeof(int), ByLayout);
+        }
+    }
+
+    /*Lay out what is kept, so that every call can be resolved as it is    */
+    /*emitted.                                                              */
+    address = BufferAddress(cb);
+    if (options != NULL)
+        options->dropped = options->droppedCode = 0;
+    for (i = 0; i < nodeCount; i++)
+    {
+        node = &nodes[order[i]];
+        if (options != NULL && options->dropDead && node->rank < 0)
+        {
+            node->address = -1;
+            options->dropped += 1 + node->proc->nestedCount;
+            options->droppedCode += node->proc->count;
+            continue;
+        }
+        node->address = address;
+        address += node->proc->count;
+        order[kept++] = order[i];
+    }
+
+    for (i = 0; ok && i < kept; i++)
+    {
+        node = &nodes[order[i]];
+        AddLinkedProcs(node->proc, BufferAddress(cb), procs, procCount, &capacity);
+        ok = EmitEntry(node->proc, cb, table, nodeCount, nodes, paths[node->unit]);
+    }
+    *entry = BufferAddress(cb);
+    ok = ok && EmitEntry(units[0].main, cb, table, nodeCount, nodes, paths[0]);
+
+    free(nodes);
+    free(table);
+    free(order);
+    if (!ok)
+    {
+        free(*procs);
+        *procs = NULL;
+        *procCount = 0;
+    }
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  RankNodes: Numbers the "count" procedure nodes, and the main block     */
+/*  after them, in the order a depth-first walk of the call graph from     */
+/*  the main block reaches them, the callees of each in the order it       */
+/*  calls them.  Nodes it never reaches keep a rank of -1.  The walk keeps */
+/*  its own stack, so a long chain of calls is no deeper here than a       */
+/*  short one.                                                              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void RankNodes(LINKNODE *nodes, int count, LINKSYMBOL *table)
+{
+    LINKSYMBOL *callee;
+    PCENTRY *proc;
+    int *stack = NULL, depth = 0, capacity = 0, rank = 0, n, i;
+
+    stack = GrowArray(stack, depth, &capacity, sizeof(int));
+    stack[depth++] = count;
+    while (depth > 0)
+    {
+        n = stack[--depth];
+        if (nodes[n].rank >= 0)
+            continue;
+        nodes[n].rank = rank++;
+        proc = nodes[n].proc;
+        for (i = proc->count - 1; i >= 0; i--)
+        {
+            if (proc->code[i].reloc == RELOC_CALL &&
+                NULL != (callee = FindSymbol(table, count, proc->code[i].callee)) &&
+                nodes[callee->node].rank < 0)
+            {
+                stack = GrowArray(stack, depth, &capacity, sizeof(int));
+                stack[depth++] = callee->node;
+            }
+        }
+    }
+    free(stack);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ByLayout: Orders procedures for "reorder": those reached first,        */
+/*  hottest first and then in the order they were reached, and then the    */
+/*  rest as they were.                                                      */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ByLayout(const void *a, const void *b)
+{
+    LINKNODE *x = &SortNodes[*(int *)a], *y = &SortNodes[*(int *)b];
+
+    if ((x->rank >= 0) != (y->rank >= 0))
+        return x->rank >= 0 ? -1 : 1;
+    if (x->rank < 0)
+        return *(int *)a - *(int *)b;
+    if (x->heat != y->heat)
+        return x->heat > y->heat ? -1 : 1;
+    return x->rank - y->rank;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  EmitEntry: Appends one procedure to the buffer, relocated to the       */
+/*  current address.  Returns 0, having reported it, if a callee is not in */
+/*  the table.                                                              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int EmitEntry(PCENTRY *entry, CODEBUF *cb, LINKSYMBOL *table, int count, LINKNODE *nodes,
+                      char *path)
+{
+    LINKSYMBOL *callee;
+    PCINSTRUCTION *ins;
+    int base = BufferAddress(cb), ok = 1, i;
+
+    cb->pos = -1;
+    for (i = 0; i < entry->count; i++)
+    {
+        ins = &entry->code[i];
+        if (ins->reloc == RELOC_CALL)
+        {
+            if (NULL == (callee = FindSymbol(table, count, ins->callee)))
+            {
+                fprintf(stderr, "\"%s\": procedure \"%s\" called in \"%s\" is not defined\n", path,
+                        ins->callee, entry->name);
+                ok = 0;
+            }
+            BufferEmit(cb, ins->op,
+                       callee != NULL ? nodes[callee->node].address + nodes[callee->node].proc->entry : -1);
+        }
+        else if (ins->reloc == RELOC_LOCAL)
+            BufferEmit(cb, ins->op, base + ins->operand);
+        else if (ins->hasOperand)
+            BufferEmit(cb, ins->op, ins->operand);
+        else
+            BufferEmitOp(cb, ins->op);
+        if (ins->op == I_CALL)
+            BufferInstruction(cb, base + i)->target = ins->callee;
+    }
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddLinkedProcs: Adds a procedure placed at "start", after those nested */
+/*  in it, to the procedure table.                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void AddLinkedProcs(PCENTRY *entry, int start, CODEPROC **procs, int *procCount, int *capacity)
+{
+    CODEPROC *p;
+    int i;
+
+    for (i = 0; i <= entry->nestedCount; i++)
+    {
+        *procs = GrowArray(*procs, *procCount, capacity, sizeof(CODEPROC));
+        p = &(*procs)[(*procCount)++];
+        if (i < entry->nestedCount)
+        {
+            p->name = entry->nested[i].name;
+            p->start = start + entry->nested[i].start;
+            p->entry = start + entry->nested[i].entry;
+            p->end = start + entry->nested[i].end;
+        }
+        else
+        {
+            p->name = entry->name;
+            p->start = start;
+            p->entry = start + entry->entry;
+            p->end = start + entry->count;
+        }
+    }
+}
+
+PRIVATE int Exports(CPLOBJECT *obj, char *name)
+{
+    int i;
+
+    for (i = 0; i < obj->procCount; i++)
+    {
+        if (strcmp(obj->procs[i]->name, name) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AddImport: Adds "name" to the unit's imports unless it is there        */
+/*  already.  Returns 0 if it is not a name that fits the file format.     */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int AddImport(CPLOBJECT *obj, char *name)
+{
+    int i;
+
+    if (strlen(name) >= MAXNAME)
+        return 0;
+    for (i = 0; i < obj->importCount; i++)
+    {
+        if (strcmp(obj->imports[i], name) == 0)
+            return 1;
+    }
+    obj->imports = realloc(obj->imports, (obj->importCount + 1) * sizeof(char *));
+    if (obj->imports == NULL)
+    {
+        fprintf(stderr, "out of memory in object unit\n");
+        exit(EXIT_FAILURE);
+    }
+    obj->imports[obj->importCount++] = CopyName(name);
+    return 1;
+}
+
+PRIVATE int ByName(const void *a, const void *b)
+{
+    return strcmp(((LINKSYMBOL *)a)->name, ((LINKSYMBOL *)b)->name);
+}
+
+PRIVATE int ByHeatName(const void *a, const void *b)
+{
+    return strcmp(((LINKHEAT *)a)->name, ((LINKHEAT *)b)->name);
+}
+
+PRIVATE LINKSYMBOL *FindSymbol(LINKSYMBOL *table, int count, char *name)
+{
+    LINKSYMBOL key;
+
+    key.name = name;
+    return bsearch(&key, table, count, sizeof(LINKSYMBOL), ByName);
+}
+
+PRIVATE void *GrowArray(void *array, int count, int *capacity, size_t size)
+{
+    if (count < *capacity)
+        return array;
+    *capacity = *capacity == 0 ? 16 : *capacity * 2;
+    if (NULL == (array = realloc(array, *capacity * size)))
+    {
+        fprintf(stderr, "out of memory in object unit\n");
+        exit(EXIT_FAILURE);
+    }
+    return array;
+}
+
+PRIVATE char *CopyName(char *s)
+{
+    char *copy;
+
+    if (NULL == (copy = malloc(strlen(s) + 1)))
+    {
+        fprintf(stderr, "out of memory in object unit\n");
+        exit(EXIT_FAILURE);
+    }
+    return strcpy(copy, s);
+}
@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cplobj.h                                                           */
+/*                                                                          */
+/*       Object units, for programs built from separately compiled          */
+/*       modules.  "comp1 --format object" writes a unit instead of a code  */
+/*       file: the code of each top-level procedure and of the main block,  */
+/*       each relocatable in the form of "proccache.h", and a table of the  */
+/*       procedures it exports and the ones it calls but does not define.  */
+/*       A module is an ordinary CPL program whose procedures are wanted    */
+/*       elsewhere; its main block may be empty.                            */
+/*                                                                          */
+/*       "comp1 --import <unit>" declares the procedures another unit       */
+/*       exports, so calls to them compile and are left for the linker:    */
+/*                                                                          */
+/*           comp1 --format object fib.prog fib.lst fib.obj                 */
+/*           comp1 --format object --import fib.obj main.prog main.lst \    */
+/*                 main.obj                                                 */
+/*           cpllink main.obj fib.obj main.code                             */
+/*                                                                          */
+/*       LinkObjects() lays out the procedures of the other units, then     */
+/*       those of the first, then its main block, and resolves each CALL    */
+/*       by name.  Calls a procedure makes to itself or to procedures       */
+/*       nested in it are stored relative to its start, so nested names     */
+/*       never have to be unique across units; top-level names do.          */
+/*       Given LINKOPTIONS, it can also leave out procedures the call       */
+/*       graph never reaches and lay the rest out by the calls between      */
+/*       them and by a profile.                                             */
+/*       Variable addresses are not relocated: a module's procedures        */
+/*       should only use their own parameters and variables, and the        */
+/*       linked program's data is as large as that of its largest unit.     */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef CPLOBJ_H
+#define CPLOBJ_H
+
+#include <stdio.h>
+#include "codebuf.h"
+#include "cplbin.h"
+#include "global.h"
+#include "proccache.h"
+
+typedef struct
+{
+    char *name;         /*  Name after PROGRAM.                          */
+    int dataSize;       /*  Words of global data.                        */
+    PCENTRY **procs;    /*  Exported top-level procedures, in order.     */
+    int procCount;
+    int procCapacity;
+    PCENTRY *main;      /*  Main block, or NULL until it is added.       */
+    char **imports;     /*  Procedures called but not defined here.      */
+    int importCount;
+} CPLOBJECT;
+
+typedef struct
+{
+    char *name;
+    long long cycles;
+} LINKHEAT; /*  A procedure's weight in a profile.                   */
+
+typedef struct
+{
+    int dropDead;       /*  Leave out what the main block never calls.   */
+    int reorder;        /*  Lay out in call order, hottest first.        */
+    LINKHEAT *heat;     /*  Profile, sorted by name, or NULL.            */
+    int heatCount;
+    int dropped;        /*  Set by LinkObjects: procedures left out,     */
+    int droppedCode;    /*  nested ones included, and their code.        */
+} LINKOPTIONS;
+
+PUBLIC void InitObject(CPLOBJECT *obj);
+PUBLIC void FreeObject(CPLOBJECT *obj);
+PUBLIC int AddObjectProc(CPLOBJECT *obj, char *name, CODEBUF *cb, int start, int entry, int end,
+                         CODEPROC *nested, int nestedCount);
+PUBLIC int SetObjectMain(CPLOBJECT *obj, char *name, int dataSize, CODEBUF *cb, int start, int end);
+PUBLIC int WriteObject(FILE *f, CPLOBJECT *obj);
+PUBLIC int ReadObject(char *path, CPLOBJECT *obj);
+PUBLIC int LinkObjects(CPLOBJECT *units, char **paths, int count, LINKOPTIONS *options, CODEBUF *cb,
+                       CODEPROC **procs, int *procCount, int *entry, int *dataSize);
+
+#endif
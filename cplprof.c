@@ -0,0 +1,910 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       cplprof.c                                                          */
+/*                                                                          */
+/*       Execution profiler for compiled CPL programs.  Runs a binary code  */
+/*       file written by "comp1 --format binary" on a simple stack machine  */
+/*       and charges every instruction it executes, with a cycle cost from  */
+/*       the model in Cost(), to the procedure running it and to the       */
+/*       source line the image's line table gives for it.  Only code       */
+/*       compiled with "comp1 --format binary --debug" has a line table.    */
+/*                                                                          */
+/*           cplprof [options] <codefile>                                   */
+/*                                                                          */
+/*           --flat <file>       Flat profile by procedure and by line.     */
+/*           --callgraph <file>  Caller, callee, calls and cycles, as       */
+/*                               tab-separated lines under a header.        */
+/*           --folded <file>     Stacks in the folded form taken by         */
+/*                               flamegraph.pl: "main;p2;p1 <cycles>".      */
+/*           --counts <file>     Block, edge and call counts, for "comp1    */
+/*                               --profile"; see "profile.h".               */
+/*           --source <file>     Source, to show each line in the flat      */
+/*                               profile.                                   */
+/*           --max-steps <n>     Stop after <n> instructions.               */
+/*                                                                          */
+/*       With no profile named, the flat profile goes to stderr.  The       */
+/*       program itself reads from stdin and writes to stdout.              */
+/*                                                                          */
+/*       comp1 emits no return instruction: a call returns when control     */
+/*       reaches the end of the procedure called, and the program stops     */
+/*       when it runs off the end of the code.  Time in recursive calls is  */
+/*       counted once, in the outermost call.  Stacks are only told apart   */
+/*       to FOLD_LIMIT calls deep; deeper calls are charged to the stack    */
+/*       they were cut off at.                                              */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "code.h"
+#include "cplbin.h"
+#include "global.h"
+#include "listing.h"
+#include "profile.h"
+
+#define DEFAULT_MAX_STEPS 100000000L
+#define STACK_LIMIT (1024 * 1024) /*  Words of expression stack.          */
+#define FRAME_LIMIT 100000        /*  Calls in progress.                  */
+#define FOLD_LIMIT 128            /*  Deepest stack told apart.           */
+#define MAIN -1                   /*  "proc" of the main program block.   */
+
+typedef struct
+{
+    int proc;   /*  Procedure table index, or MAIN.                     */
+    int parent; /*  Index of the calling context, or -1.                */
+    int child;  /*  First context it calls, then the rest by "sibling". */
+    int sibling;
+    long long cycles; /*  Spent in this context itself.                 */
+} CALLNODE; /*  One per distinct call stack.                        */
+
+typedef struct
+{
+    int proc;
+    int node;
+    int returnTo;
+    long long started; /*  Cycle count when the call was made.      */
+} FRAME;
+
+typedef struct
+{
+    long long calls;
+    long long self;
+    long long total;   /*  Including its callees.                    */
+    long long instructions;
+    int active;        /*  Calls in progress.                        */
+} PROCPROFILE;
+
+typedef struct
+{
+    int caller;
+    int callee;
+    long long calls;
+    long long cycles;
+} CALLEDGE;
+
+typedef struct
+{
+    CODEIMAGE image;
+    DEBUGINFO debug;       /*  Empty if the image has no debug section.  */
+    int *memory;
+    int memorySize;
+    int *stack;
+    int depth;
+    FRAME *frames;
+    int frameCount;
+    int *entryProc;        /*  Procedure entered at each address, or -1. */
+
+    long long steps;
+    long long cycles;
+    long long *executed;   /*  Per address.                             */
+    long long *taken;      /*  Branches taken, per address.             */
+    PROCPROFILE *procs;    /*  One per procedure, then one for MAIN.    */
+    CALLEDGE *edges;
+    int edgeCount;
+    int edgeCapacity;
+    CALLNODE *nodes;
+    int nodeCount;
+    int nodeCapacity;
+} MACHINE;
+
+PRIVATE char *CodePath = NULL;
+PRIVATE char *FlatPath = NULL;
+PRIVATE char *CallGraphPath = NULL;
+PRIVATE char *FoldedPath = NULL;
+PRIVATE char *CountsPath = NULL;
+PRIVATE char *SourcePath = NULL;
+PRIVATE long MaxSteps = DEFAULT_MAX_STEPS;
+
+PRIVATE int ParseOptions(int argc, char *argv[]);
+PRIVATE int LoadMachine(MACHINE *m, char *path);
+PRIVATE void FreeMachine(MACHINE *m);
+PRIVATE int Run(MACHINE *m);
+PRIVATE int WriteProfiles(MACHINE *m);
+PRIVATE void WriteFlatProfile(FILE *f, MACHINE *m);
+PRIVATE void WriteCallGraph(FILE *f, MACHINE *m);
+PRIVATE void WriteFolded(FILE *f, MACHINE *m);
+PRIVATE void WriteCounts(FILE *f, MACHINE *m);
+
+/*--------------------------------------------------------------------------*/
+/*  Main: cplprof entry point.  Loads and runs the code file, then writes  */
+/*  the profiles asked for, even if the program stopped with an error.     */
+/*--------------------------------------------------------------------------*/
+PUBLIC int main(int argc, char *argv[])
+{
+    MACHINE m;
+    int ran;
+
+    if (!ParseOptions(argc, argv))
+        return EXIT_FAILURE;
+    if (!LoadMachine(&m, CodePath))
+    {
+        FreeMachine(&m);
+        return EXIT_FAILURE;
+    }
+    ran = Run(&m);
+    fflush(stdout);
+    if (!WriteProfiles(&m))
+        ran = 0;
+    FreeMachine(&m);
+    return ran ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+PRIVATE int ParseOptions(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] == '-'; i++)
+    {
+        if (strcmp(argv[i], "--flat") == 0 && i + 1 < argc)
+            FlatPath = argv[++i];
+        else if (strcmp(argv[i], "--callgraph") == 0 && i + 1 < argc)
+            CallGraphPath = argv[++i];
+        else if (strcmp(argv[i], "--folded") == 0 && i + 1 < argc)
+            FoldedPath = argv[++i];
+        else if (strcmp(argv[i], "--counts") == 0 && i + 1 < argc)
+            CountsPath = argv[++i];
+        else if (strcmp(argv[i], "--source") == 0 && i + 1 < argc)
+            SourcePath = argv[++i];
+        else if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc)
+        {
+            if ((MaxSteps = atol(argv[++i])) <= 0)
+                MaxSteps = DEFAULT_MAX_STEPS;
+        }
+        else
+        {
+            fprintf(stderr, "%s: unknown or incomplete option \"%s\"\n", argv[0], argv[i]);
+            return 0;
+        }
+    }
+
+    if (i != argc - 1)
+    {
+        fprintf(stderr, "%s [options] <codefile>\n", argv[0]);
+        fprintf(stderr, "%s [--flat <file>] [--callgraph <file>] [--folded <file>]\n", argv[0]);
+        fprintf(stderr, "    [--counts <file>] [--source <file>] [--max-steps <n>] <codefile>\n");
+        return 0;
+    }
+    CodePath = argv[i];
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Cost: Cycles charged for one execution of "op".  A model, not a        */
+/*  measurement: memory and I/O cost more than arithmetic, division more   */
+/*  than the rest of it, and a call pays for setting up its frame.         */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Cost(int op)
+{
+    switch (op)
+    {
+    case I_LOADI:
+    case I_ADD:
+    case I_SUB:
+    case I_NEG:
+    case I_BR:
+        return 1;
+    case I_LOADA:
+    case I_STOREA:
+    case I_BG:
+    case I_BL:
+    case I_BGZ:
+    case I_BLZ:
+        return 2;
+    case I_MULT:
+        return 4;
+    case I_CALL:
+        return 5;
+    case I_DIV:
+        return 20;
+    case I_READ:
+    case I_WRITE:
+        return 50;
+    default:
+        return 1;
+    }
+}
+
+PRIVATE void *Grow(void *array, int count, int *capacity, size_t size)
+{
+    void *grown;
+
+    if (count < *capacity)
+        return array;
+    *capacity = *capacity > 0 ? *capacity * 2 : 16;
+    if (NULL == (grown = realloc(array, *capacity * size)))
+    {
+        fprintf(stderr, "cplprof: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  LoadMachine:  Maps a code file and sets up a machine to run it.         */
+/*                                                                          */
+/*    Global data is sized from the header, or from the highest address     */
+/*    the code loads or stores if that is higher.                           */
+/*                                                                          */
+/*    Inputs:       1) Machine, zeroed here.                                */
+/*                  2) Path of the code file.                               */
+/*                                                                          */
+/*    Outputs:      The machine, to be released with FreeMachine().         */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int LoadMachine(MACHINE *m, char *path)
+{
+    CPLBININSTR *ins;
+    uint32_t i, count, procs;
+
+    memset(m, 0, sizeof(MACHINE));
+    if (!LoadCodeImage(&m->image, path))
+    {
+        fprintf(stderr, "cannot load \"%s\" as a binary code file\n", path);
+        return 0;
+    }
+    if (!ReadDebugInfo(&m->image, &m->debug))
+    {
+        fprintf(stderr, "cannot read the debug section of \"%s\"\n", path);
+        return 0;
+    }
+    count = m->image.header->codeCount;
+    procs = m->image.header->procCount;
+
+    m->memorySize = m->image.header->dataSize;
+    for (i = 0; i < count; i++)
+    {
+        ins = &m->image.code[i];
+        if ((ins->op == I_LOADA || ins->op == I_STOREA) && ins->operand >= m->memorySize)
+            m->memorySize = ins->operand + 1;
+    }
+
+    if (NULL == (m->memory = calloc(m->memorySize + 1, sizeof(int))) ||
+        NULL == (m->stack = malloc(STACK_LIMIT * sizeof(int))) ||
+        NULL == (m->frames = malloc(FRAME_LIMIT * sizeof(FRAME))) ||
+        NULL == (m->entryProc = malloc((count + 1) * sizeof(int))) ||
+        NULL == (m->executed = calloc(count + 1, sizeof(long long))) ||
+        NULL == (m->taken = calloc(count + 1, sizeof(long long))) ||
+        NULL == (m->procs = calloc(procs + 1, sizeof(PROCPROFILE))))
+    {
+        fprintf(stderr, "cplprof: out of memory\n");
+        return 0;
+    }
+    for (i = 0; i <= count; i++)
+        m->entryProc[i] = -1;
+    for (i = 0; i < procs; i++)
+        m->entryProc[m->image.procs[i].entry] = i;
+    return 1;
+}
+
+PRIVATE void FreeMachine(MACHINE *m)
+{
+    FreeDebugInfo(&m->debug);
+    UnloadCodeImage(&m->image);
+    free(m->memory);
+    free(m->stack);
+    free(m->frames);
+    free(m->entryProc);
+    free(m->executed);
+    free(m->taken);
+    free(m->procs);
+    free(m->edges);
+    free(m->nodes);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Profile: The profile entry of procedure "proc", MAIN included.         */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE PROCPROFILE *Profile(MACHINE *m, int proc)
+{
+    return &m->procs[proc == MAIN ? (int)m->image.header->procCount : proc];
+}
+
+PRIVATE char *ProcName(MACHINE *m, int proc)
+{
+    return proc == MAIN ? "main" : m->image.strings + m->image.procs[proc].name;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CallNode: The calling context reached by calling "proc" from context   */
+/*  "parent", made the first time it is reached.                            */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int CallNode(MACHINE *m, int parent, int proc)
+{
+    CALLNODE *n;
+    int i;
+
+    for (i = parent >= 0 ? m->nodes[parent].child : -1; i >= 0; i = m->nodes[i].sibling)
+    {
+        if (m->nodes[i].proc == proc)
+            return i;
+    }
+    m->nodes = Grow(m->nodes, m->nodeCount, &m->nodeCapacity, sizeof(CALLNODE));
+    n = &m->nodes[m->nodeCount];
+    n->proc = proc;
+    n->parent = parent;
+    n->child = -1;
+    n->cycles = 0;
+    n->sibling = -1;
+    if (parent >= 0)
+    {
+        n->sibling = m->nodes[parent].child;
+        m->nodes[parent].child = m->nodeCount;
+    }
+    return m->nodeCount++;
+}
+
+PRIVATE CALLEDGE *CallEdge(MACHINE *m, int caller, int callee)
+{
+    CALLEDGE *e;
+    int i;
+
+    for (i = 0; i < m->edgeCount; i++)
+    {
+        if (m->edges[i].caller == caller && m->edges[i].callee == callee)
+            return &m->edges[i];
+    }
+    m->edges = Grow(m->edges, m->edgeCount, &m->edgeCapacity, sizeof(CALLEDGE));
+    e = &m->edges[m->edgeCount++];
+    e->caller = caller;
+    e->callee = callee;
+    e->calls = 0;
+    e->cycles = 0;
+    return e;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Return: Ends the innermost call, charging the cycles it took to the    */
+/*  procedure and to the edge it was called along, unless an outer call    */
+/*  of the same procedure is still in progress.                             */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Return(MACHINE *m)
+{
+    FRAME *frame = &m->frames[--m->frameCount];
+    PROCPROFILE *p = Profile(m, frame->proc);
+    long long elapsed = m->cycles - frame->started;
+
+    if (--p->active == 0)
+    {
+        p->total += elapsed;
+        CallEdge(m, m->frames[m->frameCount - 1].proc, frame->proc)->cycles += elapsed;
+    }
+    return frame->returnTo;
+}
+
+PRIVATE int Pop(MACHINE *m, int *value)
+{
+    if (m->depth == 0)
+        return 0;
+    *value = m->stack[--m->depth];
+    return 1;
+}
+
+PRIVATE int Push(MACHINE *m, int value)
+{
+    if (m->depth == STACK_LIMIT)
+        return 0;
+    m->stack[m->depth++] = value;
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Run:  Executes the program from its entry point until it runs off the   */
+/*        end of the code, fails, or uses up --max-steps.                   */
+/*                                                                          */
+/*    Inputs:       Machine, freshly loaded.                                */
+/*                                                                          */
+/*    Outputs:      The program's output, on stdout.                        */
+/*                                                                          */
+/*    Returns:      1 if the program ran to completion, 0 if it stopped     */
+/*                  early, in which case the reason is on stderr.           */
+/*                                                                          */
+/*    Side Effects: The machine's counters hold the profile of the run.     */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Run(MACHINE *m)
+{
+    CPLBININSTR *ins;
+    FRAME *frame;
+    PROCPROFILE *p;
+    char *error = NULL;
+    int count = m->image.header->codeCount, pc = m->image.header->entry;
+    int a, b, at = pc, cost, target;
+
+    frame = &m->frames[m->frameCount++];
+    frame->proc = MAIN;
+    frame->node = CallNode(m, -1, MAIN);
+    frame->returnTo = count;
+    frame->started = 0;
+    Profile(m, MAIN)->calls = 1;
+    Profile(m, MAIN)->active = 1;
+
+    while (pc < count && error == NULL)
+    {
+        if (m->steps == MaxSteps)
+        {
+            error = "step limit reached";
+            break;
+        }
+        at = pc;
+        ins = &m->image.code[pc];
+        frame = &m->frames[m->frameCount - 1];
+        cost = Cost(ins->op);
+        m->steps++;
+        m->cycles += cost;
+        m->executed[pc]++;
+        m->nodes[frame->node].cycles += cost;
+        p = Profile(m, frame->proc);
+        p->self += cost;
+        p->instructions++;
+
+        pc++;
+        switch (ins->op)
+        {
+        case I_LOADI:
+            if (!Push(m, ins->operand))
+                error = "stack overflow";
+            break;
+        case I_LOADA:
+            if (ins->operand < 0 || !Push(m, m->memory[ins->operand]))
+                error = ins->operand < 0 ? "bad data address" : "stack overflow";
+            break;
+        case I_STOREA:
+            if (ins->operand < 0 || !Pop(m, &a))
+                error = ins->operand < 0 ? "bad data address" : "stack underflow";
+            else
+                m->memory[ins->operand] = a;
+            break;
+        case I_ADD:
+        case I_SUB:
+        case I_MULT:
+        case I_DIV:
+            if (!Pop(m, &b) || !Pop(m, &a))
+                error = "stack underflow";
+            else if (ins->op == I_DIV && b == 0)
+                error = "division by zero";
+            else
+                Push(m, ins->op == I_ADD ? a + b : ins->op == I_SUB ? a - b :
+                        ins->op == I_MULT ? a * b : a / b);
+            break;
+        case I_NEG:
+            if (!Pop(m, &a))
+                error = "stack underflow";
+            else
+                Push(m, -a);
+            break;
+        case I_READ:
+            if (scanf("%d", &a) != 1)
+                error = "input ended";
+            else if (!Push(m, a))
+                error = "stack overflow";
+            break;
+        case I_WRITE:
+            if (!Pop(m, &a))
+                error = "stack underflow";
+            else
+                printf("%d\n", a);
+            break;
+        case I_BR:
+            pc = ins->operand;
+            m->taken[at]++;
+            break;
+        case I_BG:
+        case I_BL:
+        case I_BGZ:
+        case I_BLZ:
+            if (!Pop(m, &a))
+                error = "stack underflow";
+            else if ((ins->op == I_BG && a > 0) || (ins->op == I_BL && a < 0) ||
+                     (ins->op == I_BGZ && a >= 0) || (ins->op == I_BLZ && a <= 0))
+            {
+                pc = ins->operand;
+                m->taken[at]++;
+            }
+            break;
+        case I_CALL:
+            target = ins->operand;
+            if (target < 0 || target >= count || m->entryProc[target] < 0)
+                error = "call to an address no procedure starts at";
+            else if (m->frameCount == FRAME_LIMIT)
+                error = "too many calls in progress";
+            else
+            {
+                frame = &m->frames[m->frameCount++];
+                frame->proc = m->entryProc[target];
+                frame->node = m->frames[m->frameCount - 2].node;
+                if (m->frameCount <= FOLD_LIMIT)
+                    frame->node = CallNode(m, frame->node, frame->proc);
+                frame->returnTo = pc;
+                frame->started = m->cycles;
+                p = Profile(m, frame->proc);
+                p->calls++;
+                p->active++;
+                CallEdge(m, m->frames[m->frameCount - 2].proc, frame->proc)->calls++;
+                pc = target;
+            }
+            break;
+        default:
+            error = "instruction the profiler does not know";
+            break;
+        }
+        if (error == NULL && (pc < 0 || pc > count))
+            error = "branch out of the code";
+
+        while (error == NULL && m->frameCount > 1 &&
+               pc == (int)m->image.procs[m->frames[m->frameCount - 1].proc].end)
+            pc = Return(m);
+    }
+
+    while (m->frameCount > 1)
+        Return(m);
+    Profile(m, MAIN)->total = m->cycles;
+    Profile(m, MAIN)->active = 0;
+
+    if (error != NULL)
+    {
+        fprintf(stderr, "%s: %s at address %d, after %lld instructions\n", CodePath, error, at, m->steps);
+        return 0;
+    }
+    return 1;
+}
+
+PRIVATE int WriteProfile(char *path, MACHINE *m, void (*writer)(FILE *, MACHINE *))
+{
+    FILE *f;
+    int ok;
+
+    if (NULL == (f = fopen(path, "w")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for output\n", path);
+        return 0;
+    }
+    writer(f, m);
+    ok = !ferror(f);
+    if (fclose(f) != 0 || !ok)
+    {
+        fprintf(stderr, "cannot write \"%s\"\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+PRIVATE int WriteProfiles(MACHINE *m)
+{
+    int ok = 1;
+
+    if (FlatPath == NULL && CallGraphPath == NULL && FoldedPath == NULL && CountsPath == NULL)
+        WriteFlatProfile(stderr, m);
+    if (FlatPath != NULL)
+        ok &= WriteProfile(FlatPath, m, WriteFlatProfile);
+    if (CallGraphPath != NULL)
+        ok &= WriteProfile(CallGraphPath, m, WriteCallGraph);
+    if (FoldedPath != NULL)
+        ok &= WriteProfile(FoldedPath, m, WriteFolded);
+    if (CountsPath != NULL)
+        ok &= WriteProfile(CountsPath, m, WriteCounts);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReadText: Reads a whole file into memory.  Returns NULL if it cannot.  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE char *ReadText(char *path, size_t *length)
+{
+    FILE *f;
+    char *text = NULL, *grown;
+    size_t n, capacity = 0;
+
+    *length = 0;
+    if (NULL == (f = fopen(path, "r")))
+        return NULL;
+    do
+    {
+        if (*length == capacity)
+        {
+            capacity = capacity > 0 ? capacity * 2 : 8192;
+            if (NULL == (grown = realloc(text, capacity)))
+            {
+                free(text);
+                fclose(f);
+                return NULL;
+            }
+            text = grown;
+        }
+        n = fread(text + *length, 1, capacity - *length, f);
+        *length += n;
+    } while (n > 0);
+    fclose(f);
+    return text;
+}
+
+PRIVATE double Percent(long long part, long long whole)
+{
+    return whole > 0 ? 100.0 * part / whole : 0;
+}
+
+PRIVATE PROCPROFILE *SortProcs; /*  Profiles BySelf() compares.          */
+
+PRIVATE int BySelf(const void *a, const void *b)
+{
+    long long d = SortProcs[*(int *)b].self - SortProcs[*(int *)a].self;
+
+    return d > 0 ? 1 : d < 0 ? -1 : *(int *)a - *(int *)b;
+}
+
+PRIVATE long long *SortLines; /*  Per-line cycles ByCycles() compares.   */
+
+PRIVATE int ByCycles(const void *a, const void *b)
+{
+    long long d = SortLines[*(int *)b] - SortLines[*(int *)a];
+
+    return d > 0 ? 1 : d < 0 ? -1 : *(int *)a - *(int *)b;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  WriteFlatProfile:  Writes the procedures, then the source lines, that   */
+/*                     the run spent cycles in, most expensive first.       */
+/*                                                                          */
+/*    A procedure's "self" cycles are those spent in it, while "total"      */
+/*    adds those of its callees.  Lines are taken from the image's line     */
+/*    table; line 0 is code no statement generated, or all the code if     */
+/*    there is no table.                                                    */
+/*                                                                          */
+/*    Inputs:       1) Profile file.                                        */
+/*                  2) Machine, after the run.                              */
+/*                                                                          */
+/*    Outputs:      The profile.                                            */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void WriteFlatProfile(FILE *f, MACHINE *m)
+{
+    PROCPROFILE *p;
+    long long *cycles, *counts;
+    char *source = NULL, *text;
+    size_t length = 0;
+    int *order, *newlines = NULL;
+    int procs = m->image.header->procCount, lines = 0, maxLine = 0, sourceLines = 0;
+    int i, line, shown;
+
+    fprintf(f, "Flat profile of %s: %lld instructions, %lld cycles\n\n", CodePath, m->steps, m->cycles);
+    fprintf(f, "  %7s %12s %12s %10s %12s  %s\n", "%cycles", "self", "total", "calls", "instructions", "procedure");
+    if (NULL == (order = malloc((procs + 1) * sizeof(int))))
+        return;
+    for (i = 0; i <= procs; i++)
+        order[i] = i;
+    SortProcs = m->procs;
+    qsort(order, procs + 1, sizeof(int), BySelf);
+    for (i = 0; i <= procs; i++)
+    {
+        p = &m->procs[order[i]];
+        if (p->calls > 0)
+            fprintf(f, "  %7.2f %12lld %12lld %10lld %12lld  %s\n", Percent(p->self, m->cycles), p->self,
+                    p->total, p->calls, p->instructions, ProcName(m, order[i] == procs ? MAIN : order[i]));
+    }
+    free(order);
+
+    for (i = 0; i < m->debug.lineCount; i++)
+    {
+        if (m->debug.lines[i].line > maxLine)
+            maxLine = m->debug.lines[i].line;
+    }
+    if (NULL == (cycles = calloc(maxLine + 1, sizeof(long long))) ||
+        NULL == (counts = calloc(maxLine + 1, sizeof(long long))) ||
+        NULL == (order = malloc((maxLine + 1) * sizeof(int))))
+    {
+        free(cycles);
+        return;
+    }
+    for (i = 0; i < (int)m->image.header->codeCount; i++)
+    {
+        if (m->executed[i] == 0)
+            continue;
+        line = FindCodeLine(&m->debug, i);
+        cycles[line] += m->executed[i] * Cost(m->image.code[i].op);
+        counts[line] += m->executed[i];
+    }
+    for (i = 0; i <= maxLine; i++)
+    {
+        if (cycles[i] > 0)
+            order[lines++] = i;
+    }
+    SortLines = cycles;
+    qsort(order, lines, sizeof(int), ByCycles);
+
+    if (SourcePath != NULL && NULL != (source = ReadText(SourcePath, &length)))
+        newlines = IndexLines(source, length, &sourceLines);
+    if (m->debug.lineCount == 0)
+        fprintf(f, "\n  No line table: compile with --debug for one.\n");
+    fprintf(f, "\n  %7s %12s %12s %6s  %s\n", "%cycles", "cycles", "instructions", "line", "source");
+    for (i = 0; i < lines; i++)
+    {
+        line = order[i];
+        fprintf(f, "  %7.2f %12lld %12lld %6d", Percent(cycles[line], m->cycles), cycles[line], counts[line], line);
+        if (newlines != NULL && line >= 1 && line <= sourceLines + 1)
+        {
+            text = line == 1 ? source : source + newlines[line - 2] + 1;
+            shown = (line <= sourceLines ? source + newlines[line - 1] : source + length) - text;
+            while (shown > 0 && (*text == ' ' || *text == '\t'))
+            {
+                text++;
+                shown--;
+            }
+            fprintf(f, "  %.*s", shown, text);
+        }
+        putc('\n', f);
+    }
+    free(newlines);
+    free(source);
+    free(order);
+    free(counts);
+    free(cycles);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  WriteCallGraph: One line per caller and callee pair, with the calls    */
+/*  made and the cycles spent in them, callees included.                   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void WriteCallGraph(FILE *f, MACHINE *m)
+{
+    CALLEDGE *e;
+    int i;
+
+    fprintf(f, "caller\tcallee\tcalls\tcycles\n");
+    for (i = 0; i < m->edgeCount; i++)
+    {
+        e = &m->edges[i];
+        fprintf(f, "%s\t%s\t%lld\t%lld\n", ProcName(m, e->caller), ProcName(m, e->callee), e->calls, e->cycles);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  WriteFolded: One line per call stack the run spent cycles in, outermost */
+/*  procedure first, each stack written by walking up from its context.    */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void WriteFolded(FILE *f, MACHINE *m)
+{
+    int *path, i, n, depth;
+
+    if (NULL == (path = malloc((FOLD_LIMIT + 1) * sizeof(int))))
+        return;
+    for (i = 0; i < m->nodeCount; i++)
+    {
+        if (m->nodes[i].cycles == 0)
+            continue;
+        for (depth = 0, n = i; n >= 0; n = m->nodes[n].parent)
+            path[depth++] = m->nodes[n].proc;
+        while (depth-- > 0)
+            fprintf(f, "%s%c", ProcName(m, path[depth]), depth > 0 ? ';' : ' ');
+        fprintf(f, "%lld\n", m->nodes[i].cycles);
+    }
+    free(path);
+}
+
+PRIVATE int IsProcEnd(MACHINE *m, int address)
+{
+    uint32_t i;
+
+    for (i = 0; i < m->image.header->procCount; i++)
+    {
+        if ((int)m->image.procs[i].end == address)
+            return 1;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  WriteCounts:  Writes the block, edge and call counts of the run in the  */
+/*                format of "profile.h".                                    */
+/*                                                                          */
+/*    A block starts at the entry point, at each procedure's start and      */
+/*    entry, at each branch target and after each branch; calls do not     */
+/*    end one, since they come back.  Code running off the end of a        */
+/*    procedure returns, so that is no edge.                                */
+/*                                                                          */
+/*    Inputs:       1) Counts file.                                         */
+/*                  2) Machine, after the run.                              */
+/*                                                                          */
+/*    Outputs:      The counts.                                             */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void WriteCounts(FILE *f, MACHINE *m)
+{
+    CPLBININSTR *ins;
+    char *leader;
+    int count = m->image.header->codeCount, procs = m->image.header->procCount;
+    int i, start, last;
+
+    fprintf(f, "%s %d %d\n", PROFILE_MAGIC, PROFILE_VERSION, count);
+    for (i = 0; i <= procs; i++)
+    {
+        if (m->procs[i].calls > 0)
+            fprintf(f, "proc %d %lld %s\n", i == procs ? (int)m->image.header->entry : (int)m->image.procs[i].entry,
+                    m->procs[i].calls, ProcName(m, i == procs ? MAIN : i));
+    }
+
+    if (NULL == (leader = calloc(count + 1, 1)))
+        return;
+    leader[0] = leader[count] = 1;
+    if (m->image.header->entry < (uint32_t)count)
+        leader[m->image.header->entry] = 1;
+    for (i = 0; i < procs; i++)
+    {
+        if (m->image.procs[i].start < (uint32_t)count)
+            leader[m->image.procs[i].start] = 1;
+        if (m->image.procs[i].entry < (uint32_t)count)
+            leader[m->image.procs[i].entry] = 1;
+    }
+    for (i = 0; i < count; i++)
+    {
+        ins = &m->image.code[i];
+        if (IsBranchOp(ins->op))
+        {
+            leader[i + 1] = 1;
+            if (ins->operand >= 0 && ins->operand <= count)
+                leader[ins->operand] = 1;
+        }
+    }
+
+    for (start = 0; start < count; start = last + 1)
+    {
+        for (last = start; !leader[last + 1]; last++)
+            ;
+        if (m->executed[start] == 0)
+            continue;
+        fprintf(f, "block %d %d %lld\n", start, last + 1, m->executed[start]);
+
+        ins = &m->image.code[last];
+        if (m->taken[last] > 0)
+            fprintf(f, "edge %d %d %lld\n", last, ins->operand, m->taken[last]);
+        if (ins->op != I_BR && m->executed[last] > m->taken[last] && last + 1 < count && !IsProcEnd(m, last + 1))
+            fprintf(f, "edge %d %d %lld\n", last, last + 1, m->executed[last] - m->taken[last]);
+    }
+    free(leader);
+}
@@ -0,0 +1,524 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       deadcode.c                                                         */
+/*                                                                          */
+/*       Dead code elimination over the code buffer.  See "deadcode.h".     */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "code.h"
+#include "codebuf.h"
+#include "deadcode.h"
+#include "global.h"
+
+#define MAXDEPTH 64 /*  Deepest constant expression folded.            */
+#define WORDBITS ((int)(8 * sizeof(unsigned long)))
+
+typedef struct
+{
+    INSTRUCTION *code; /*  The block, from its entry on.               */
+    int start;         /*  Address of code[0].                         */
+    int count;
+    char *dead;        /*  Set for instructions to be removed.         */
+    char *leader;      /*  Set for the first live instruction of each  */
+                       /*  basic block.                                */
+    int *next;         /*  First live instruction at or after each;    */
+                       /*  "count" if there is none.                   */
+} REGION;
+
+PRIVATE void *Allocate(size_t size)
+{
+    void *p;
+
+    if (NULL == (p = calloc(size > 0 ? size : 1, 1)))
+    {
+        fprintf(stderr, "out of memory eliminating dead code\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Index: Where control sent to "address" goes on in the region, "count"  */
+/*  if it leaves by the end, or -1 if the address is not in the region.    */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Index(REGION *r, int address)
+{
+    if (address < r->start || address > r->start + r->count)
+        return -1;
+    return r->next[address - r->start];
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FindLeaders: Brings "next" and "leader" up to date with "dead".  The   */
+/*  entry, every branch target and every instruction after a branch start  */
+/*  a basic block.                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void FindLeaders(REGION *r)
+{
+    int i, t, last = -1;
+
+    r->next[r->count] = r->count;
+    for (i = r->count - 1; i >= 0; i--)
+        r->next[i] = r->dead[i] ? r->next[i + 1] : i;
+    memset(r->leader, 0, r->count + 1);
+    r->leader[r->next[0]] = 1;
+    for (i = 0; i < r->count; i++)
+    {
+        if (r->dead[i])
+            continue;
+        if (last >= 0 && IsBranchOp(r->code[last].op))
+            r->leader[i] = 1;
+        if (IsBranchOp(r->code[i].op) && (t = Index(r, r->code[i].operand)) >= 0)
+            r->leader[t] = 1;
+        last = i;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ExpressionStart: The first instruction of the expression whose value   */
+/*  the one at "at" pops, or -1 if that is not made in the same basic      */
+/*  block from constants and variables alone.  DIV, which may fail, is     */
+/*  allowed only if "division" is set.                                      */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ExpressionStart(REGION *r, int at, int division)
+{
+    int need = 1, i;
+
+    if (r->leader[at])
+        return -1;
+    for (i = at - 1; i >= 0; i--)
+    {
+        if (r->dead[i])
+            continue;
+        switch (r->code[i].op)
+        {
+        case I_LOADI:
+        case I_LOADA:
+            need--;
+            break;
+        case I_DIV:
+            if (!division)
+                return -1;
+            need++;
+            break;
+        case I_ADD:
+        case I_SUB:
+        case I_MULT:
+            need++;
+            break;
+        case I_NEG:
+            break;
+        default:
+            return -1;
+        }
+        if (need == 0)
+            return i;
+        if (r->leader[i])
+            return -1;
+    }
+    return -1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Evaluate: Sets "value" to that of the expression at [from, to) and     */
+/*  returns 1, or returns 0 if it reads a variable, divides by zero or     */
+/*  overflows.                                                              */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Evaluate(REGION *r, int from, int to, int *value)
+{
+    long long stack[MAXDEPTH], a, b;
+    int depth = 0, i;
+
+    for (i = from; i < to; i++)
+    {
+        if (r->dead[i])
+            continue;
+        switch (r->code[i].op)
+        {
+        case I_LOADI:
+            if (depth == MAXDEPTH)
+                return 0;
+            stack[depth++] = r->code[i].operand;
+            continue;
+        case I_NEG:
+            stack[depth - 1] = -stack[depth - 1];
+            break;
+        case I_ADD:
+        case I_SUB:
+        case I_MULT:
+        case I_DIV:
+            b = stack[--depth];
+            a = stack[depth - 1];
+            if (r->code[i].op == I_DIV && b == 0)
+                return 0;
+            stack[depth - 1] = r->code[i].op == I_ADD ? a + b : r->code[i].op == I_SUB ? a - b :
+                               r->code[i].op == I_MULT ? a * b : a / b;
+            break;
+        default:
+            return 0;
+        }
+        if (stack[depth - 1] < INT_MIN || stack[depth - 1] > INT_MAX)
+            return 0;
+    }
+    *value = (int)stack[0];
+    return depth == 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FoldBranches: Turns each conditional branch on a constant into a BR if */
+/*  it is always taken, or drops it if it never is, and drops the          */
+/*  expression it tested.  Returns how many it folded.                      */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int FoldBranches(REGION *r)
+{
+    int folded = 0, value, taken, from, i, j;
+
+    FindLeaders(r);
+    for (i = 0; i < r->count; i++)
+    {
+        if (r->dead[i] || !IsBranchOp(r->code[i].op) || r->code[i].op == I_BR ||
+            (from = ExpressionStart(r, i, 1)) < 0 || !Evaluate(r, from, i, &value))
+            continue;
+        switch (r->code[i].op)
+        {
+        case I_BG:
+            taken = value > 0;
+            break;
+        case I_BL:
+            taken = value < 0;
+            break;
+        case I_BGZ:
+            taken = value >= 0;
+            break;
+        default:
+            taken = value <= 0;
+            break;
+        }
+        for (j = from; j < i; j++)
+            r->dead[j] = 1;
+        if (taken)
+            r->code[i].op = I_BR;
+        else
+            r->dead[i] = 1;
+        folded++;
+        FindLeaders(r);
+    }
+    return folded;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  RemoveUnreachable: Drops every instruction no path from the entry      */
+/*  reaches.  Returns how many it dropped.                                  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int RemoveUnreachable(REGION *r)
+{
+    char *reached = Allocate(r->count + 1);
+    int *work = Allocate((2 * r->count + 1) * sizeof(int));
+    int n = 0, removed = 0, i, t;
+
+    FindLeaders(r);
+    work[n++] = r->next[0];
+    while (n > 0)
+    {
+        i = work[--n];
+        if (i >= r->count || reached[i])
+            continue;
+        reached[i] = 1;
+        if (IsBranchOp(r->code[i].op) && (t = Index(r, r->code[i].operand)) >= 0)
+            work[n++] = t;
+        if (r->code[i].op != I_BR)
+            work[n++] = r->next[i + 1];
+    }
+
+    for (i = 0; i < r->count; i++)
+    {
+        if (!r->dead[i] && !reached[i])
+        {
+            r->dead[i] = 1;
+            removed++;
+        }
+    }
+    free(reached);
+    free(work);
+    return removed;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  RemoveUselessJumps: Drops each BR to where control would go anyway.    */
+/*  Returns how many it dropped.                                            */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int RemoveUselessJumps(REGION *r)
+{
+    int removed = 0, i;
+
+    FindLeaders(r);
+    for (i = r->count - 1; i >= 0; i--)
+    {
+        if (!r->dead[i] && r->code[i].op == I_BR && Index(r, r->code[i].operand) == r->next[i + 1])
+        {
+            r->dead[i] = 1;
+            removed++;
+        }
+        r->next[i] = r->dead[i] ? r->next[i + 1] : i;
+    }
+    return removed;
+}
+
+PRIVATE int ByAddress(const void *a, const void *b)
+{
+    return *(int *)a - *(int *)b;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Variable: Bit number of the variable at "address" in "vars".           */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Variable(int *vars, int varCount, int address)
+{
+    return (int *)bsearch(&address, vars, varCount, sizeof(int), ByAddress) - vars;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Transfer: Runs "live" back over the basic block at [first, last], as   */
+/*  it is on leaving the block, to as it is on entering it.  If "removed"  */
+/*  is not NULL, an assignment to a variable dead after it is dropped with */
+/*  its expression on the way, and counted there.                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Transfer(REGION *r, int first, int last, unsigned long *live, int words, int *vars, int varCount,
+                      int *removed)
+{
+    int i, v, from;
+
+    for (i = last; i >= first; i--)
+    {
+        if (r->dead[i])
+            continue;
+        switch (r->code[i].op)
+        {
+        case I_STOREA:
+            v = Variable(vars, varCount, r->code[i].operand);
+            if (removed != NULL && !(live[v / WORDBITS] & (1UL << (v % WORDBITS))) &&
+                (from = ExpressionStart(r, i, 0)) >= 0)
+            {
+                for (v = i; v >= from; v--)
+                {
+                    *removed += !r->dead[v];
+                    r->dead[v] = 1;
+                }
+                i = from;
+            }
+            else
+                live[v / WORDBITS] &= ~(1UL << (v % WORDBITS));
+            break;
+        case I_LOADA:
+            v = Variable(vars, varCount, r->code[i].operand);
+            live[v / WORDBITS] |= 1UL << (v % WORDBITS);
+            break;
+        case I_CALL:
+            memset(live, 0xFF, words * sizeof(unsigned long));
+            break;
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  RemoveDeadStores: Finds which variables are live after each basic      */
+/*  block, then drops the assignments no path reads before the next one.   */
+/*  A CALL may read any variable, and so may whatever follows the region   */
+/*  if "exitLive" is set.  Returns how many instructions it dropped,       */
+/*  counting the expressions that went with them; assignments of READ,     */
+/*  or of a quotient that may fail, are kept.                               */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int RemoveDeadStores(REGION *r, int exitLive)
+{
+    int *vars, *first, *block, varCount = 0, blockCount = 0, words, removed = 0, changed, i, j, k, t, last;
+    unsigned long *in, *out, *live;
+
+    FindLeaders(r);
+    vars = Allocate((r->count + 1) * sizeof(int));
+    first = Allocate((r->count + 1) * sizeof(int));
+    block = Allocate((r->count + 1) * sizeof(int));
+    for (i = 0; i < r->count; i++)
+    {
+        if (r->dead[i])
+            continue;
+        if (r->code[i].op == I_LOADA || r->code[i].op == I_STOREA)
+            vars[varCount++] = r->code[i].operand;
+        if (r->leader[i])
+        {
+            block[i] = blockCount;
+            first[blockCount++] = i;
+        }
+    }
+    first[blockCount] = r->count;
+    block[r->count] = blockCount;
+    qsort(vars, varCount, sizeof(int), ByAddress);
+    for (i = 0, j = 0; i < varCount; i++)
+        if (j == 0 || vars[j - 1] != vars[i])
+            vars[j++] = vars[i];
+    varCount = j;
+    if (varCount == 0)
+    {
+        free(vars);
+        free(first);
+        free(block);
+        return 0;
+    }
+    words = (varCount + WORDBITS - 1) / WORDBITS;
+    in = Allocate((blockCount + 1) * words * sizeof(unsigned long));
+    out = Allocate(blockCount * words * sizeof(unsigned long));
+    live = Allocate(words * sizeof(unsigned long));
+    if (exitLive)
+        memset(&in[blockCount * words], 0xFF, words * sizeof(unsigned long));
+
+    /*"in" of the block past the end stands for whatever follows.          */
+    do
+    {
+        changed = 0;
+        for (j = blockCount - 1; j >= 0; j--)
+        {
+            for (last = first[j + 1] - 1; r->dead[last]; last--)
+                ;
+            memset(&out[j * words], 0, words * sizeof(unsigned long));
+            if (IsBranchOp(r->code[last].op) && (t = Index(r, r->code[last].operand)) >= 0)
+                for (k = 0; k < words; k++)
+                    out[j * words + k] |= in[block[t] * words + k];
+            if (r->code[last].op != I_BR)
+                for (k = 0; k < words; k++)
+                    out[j * words + k] |= in[(j + 1) * words + k];
+            memcpy(live, &out[j * words], words * sizeof(unsigned long));
+            Transfer(r, first[j], last, live, words, vars, varCount, NULL);
+            if (memcmp(live, &in[j * words], words * sizeof(unsigned long)) != 0)
+            {
+                memcpy(&in[j * words], live, words * sizeof(unsigned long));
+                changed = 1;
+            }
+        }
+    } while (changed);
+
+    for (j = 0; j < blockCount; j++)
+        Transfer(r, first[j], first[j + 1] - 1, &out[j * words], words, vars, varCount, &removed);
+
+    free(vars);
+    free(first);
+    free(block);
+    free(in);
+    free(out);
+    free(live);
+    return removed;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  RemoveDeadCode:  Removes the dead code of the block at [start, end)    */
+/*                   of the buffer, "end" being its current address, and   */
+/*                   moves the rest down.  The block must be entered only  */
+/*                   at "start" and left only by its end.                   */
+/*                                                                          */
+/*    Inputs:       1) Buffer holding the block.                            */
+/*                  2) Address of the block's entry.                        */
+/*                  3) 1 if the block is a procedure's: any variable may   */
+/*                     be read once it returns, and it is never emptied,   */
+/*                     as a CALL to it would run on into the code after    */
+/*                     it.  0 for the main program's, after which nothing  */
+/*                     is read.                                             */
+/*                  4) Room for end - start + 1 addresses.                  */
+/*                                                                          */
+/*    Outputs:      The map is set to the new address of each instruction  */
+/*                  from "start" to "end", inclusive.  One removed goes to  */
+/*                  that of the next one kept, so an instruction was       */
+/*                  removed if its address maps where the next one's does. */
+/*                                                                          */
+/*    Returns:      How many instructions were removed.  If a procedure's   */
+/*                  block would be left empty, none are, and it is left    */
+/*                  as it was.                                              */
+/*                                                                          */
+/*    Side Effects: Branches into the block are redirected and the buffer   */
+/*                  is truncated to the block's new end.  CALLs waiting    */
+/*                  for their callee's address may have moved; the caller  */
+/*                  must follow them with the map.                          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int RemoveDeadCode(CODEBUF *cb, int start, int procedure, int *map)
+{
+    REGION r;
+    INSTRUCTION *original = NULL;
+    int changed, kept, i;
+
+    r.start = start;
+    r.count = BufferAddress(cb) - start;
+    for (i = 0; i <= r.count; i++)
+        map[i] = start + i;
+    if (r.count <= 0 || NULL == (r.code = BufferInstruction(cb, start)))
+        return 0;
+    r.dead = Allocate(r.count + 1);
+    r.leader = Allocate(r.count + 1);
+    r.next = Allocate((r.count + 1) * sizeof(int));
+    if (procedure)
+    {
+        original = Allocate(r.count * sizeof(INSTRUCTION));
+        memcpy(original, r.code, r.count * sizeof(INSTRUCTION));
+    }
+
+    do
+    {
+        changed = FoldBranches(&r);
+        changed += RemoveUnreachable(&r);
+        changed += RemoveUselessJumps(&r);
+        changed += RemoveDeadStores(&r, procedure);
+    } while (changed > 0);
+
+    /*A procedure's block is kept whole rather than emptied, with the      */
+    /*branches folding turned into BRs put back as they were.              */
+    for (i = 0, kept = 0; i < r.count; i++)
+        kept += !r.dead[i];
+    if (procedure && kept == 0)
+    {
+        memcpy(r.code, original, r.count * sizeof(INSTRUCTION));
+        memset(r.dead, 0, r.count);
+    }
+
+    for (i = 0, kept = 0; i <= r.count; i++)
+    {
+        map[i] = start + kept;
+        if (i < r.count && !r.dead[i])
+            kept++;
+    }
+    for (i = 0, kept = 0; i < r.count; i++)
+    {
+        if (r.dead[i])
+            continue;
+        r.code[kept] = r.code[i];
+        if (IsBranchOp(r.code[kept].op) && r.code[kept].operand >= start && r.code[kept].operand <= start + r.count)
+            r.code[kept].operand = map[r.code[kept].operand - start];
+        kept++;
+    }
+    BufferTruncate(cb, start + kept);
+
+    free(r.dead);
+    free(r.leader);
+    free(r.next);
+    free(original);
+    return r.count - kept;
+}
@@ -0,0 +1,40 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       deadcode.h                                                         */
+/*                                                                          */
+/*       Dead code elimination for "comp1 --dead-code".  When a block has   */
+/*       been generated, RemoveDeadCode() builds the control-flow graph of  */
+/*       its code in the buffer and, until none is left:                   */
+/*                                                                          */
+/*           folds a conditional branch on a constant into a BR, or drops  */
+/*           it, along with the expression it tests;                        */
+/*           drops code no path from the block's entry reaches, such as     */
+/*           the rest of an IF arm after the BR of an "=" condition;        */
+/*           drops a BR to the instruction after it;                        */
+/*           drops an assignment to a variable no path reads again before   */
+/*           assigning it, along with the expression assigned, if that has  */
+/*           no effect of its own.                                          */
+/*                                                                          */
+/*       What is left is moved down over the gaps and every branch into    */
+/*       the block is made to land where it did.  Code outside the block,   */
+/*       and CALLs, are left alone.  A procedure's block is never emptied:  */
+/*       with no return instruction, a CALL to it would run the code after  */
+/*       it.                                                                */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef DEADCODE_H
+#define DEADCODE_H
+
+#include "codebuf.h"
+#include "global.h"
+
+PUBLIC int RemoveDeadCode(CODEBUF *cb, int start, int procedure, int *map);
+
+#endif
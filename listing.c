@@ -0,0 +1,331 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       listing.c                                                          */
+/*                                                                          */
+/*       Listing output.  See "listing.h".                                  */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#define _GNU_SOURCE /*  For fopencookie().                              */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cpl.h"
+#include "global.h"
+#include "listing.h"
+
+#define RING_SIZE (1024 * 1024)
+
+PRIVATE ssize_t Discard(void *cookie, const char *buffer, size_t n)
+{
+    return n;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  OpenDiscardStream: Returns a stream that accepts and drops everything  */
+/*  written to it, without a system call per write as /dev/null would.      */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC FILE *OpenDiscardStream(void)
+{
+    cookie_io_functions_t io = {NULL, Discard, NULL, NULL};
+
+    return fopencookie(NULL, "w", io);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Enqueue: Write function of a list writer's stream.  Copies into the    */
+/*  ring, waiting only if the writer thread has fallen a whole ring        */
+/*  behind.  A child forked while the writer ran has no writer thread, so  */
+/*  anything it writes is dropped.                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE ssize_t Enqueue(void *cookie, const char *buffer, size_t n)
+{
+    LISTWRITER *lw = cookie;
+    size_t done = 0, tail, chunk;
+
+    if (getpid() != lw->owner)
+        return n;
+
+    pthread_mutex_lock(&lw->lock);
+    while (done < n)
+    {
+        while (lw->count == lw->size)
+            pthread_cond_wait(&lw->changed, &lw->lock);
+        tail = (lw->head + lw->count) % lw->size;
+        chunk = n - done;
+        if (chunk > lw->size - lw->count)
+            chunk = lw->size - lw->count;
+        if (chunk > lw->size - tail)
+            chunk = lw->size - tail;
+        memcpy(lw->ring + tail, buffer + done, chunk);
+        lw->count += chunk;
+        done += chunk;
+        pthread_cond_broadcast(&lw->changed);
+    }
+    pthread_mutex_unlock(&lw->lock);
+    return n;
+}
+
+PRIVATE int RequestClose(void *cookie)
+{
+    LISTWRITER *lw = cookie;
+
+    if (getpid() != lw->owner)
+        return 0;
+    pthread_mutex_lock(&lw->lock);
+    lw->closing = 1;
+    pthread_cond_broadcast(&lw->changed);
+    pthread_mutex_unlock(&lw->lock);
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Writer: Thread that drains the ring into the target file.  Bytes are   */
+/*  written outside the lock; they stay counted until written, so Enqueue  */
+/*  cannot overwrite them.                                                  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void *Writer(void *arg)
+{
+    LISTWRITER *lw = arg;
+    size_t chunk;
+
+    pthread_mutex_lock(&lw->lock);
+    for (;;)
+    {
+        while (lw->count == 0 && !lw->closing)
+            pthread_cond_wait(&lw->changed, &lw->lock);
+        if (lw->count == 0)
+            break;
+        chunk = lw->count;
+        if (chunk > lw->size - lw->head)
+            chunk = lw->size - lw->head;
+        pthread_mutex_unlock(&lw->lock);
+
+        fwrite(lw->ring + lw->head, 1, chunk, lw->target);
+
+        pthread_mutex_lock(&lw->lock);
+        lw->head = (lw->head + chunk) % lw->size;
+        lw->count -= chunk;
+        pthread_cond_broadcast(&lw->changed);
+    }
+    pthread_mutex_unlock(&lw->lock);
+    fflush(lw->target);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  OpenListWriter:  Starts a writer thread for "target" and returns the    */
+/*                   stream the scanner should write the listing to.        */
+/*                                                                          */
+/*    Inputs:       1) Writer to set up.                                    */
+/*                  2) Listing file.                                        */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      The stream, or NULL if the thread could not be started, */
+/*                  in which case the caller writes "target" directly.     */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC FILE *OpenListWriter(LISTWRITER *lw, FILE *target)
+{
+    cookie_io_functions_t io = {NULL, Enqueue, NULL, RequestClose};
+
+    memset(lw, 0, sizeof(LISTWRITER));
+    if (NULL == (lw->ring = malloc(RING_SIZE)))
+        return NULL;
+    lw->target = target;
+    lw->size = RING_SIZE;
+    lw->owner = getpid();
+    pthread_mutex_init(&lw->lock, NULL);
+    pthread_cond_init(&lw->changed, NULL);
+
+    if (NULL == (lw->stream = fopencookie(lw, "w", io)))
+    {
+        CloseListWriter(lw);
+        return NULL;
+    }
+    if (pthread_create(&lw->thread, NULL, Writer, lw) != 0)
+    {
+        lw->owner = 0; /*  Nothing to hand the stream's bytes to.    */
+        fclose(lw->stream);
+        lw->stream = NULL;
+        CloseListWriter(lw);
+        return NULL;
+    }
+    return lw->stream;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CloseListWriter: Flushes the stream, waits for the writer thread to    */
+/*  finish the listing and releases the writer.                             */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void CloseListWriter(LISTWRITER *lw)
+{
+    if (lw->stream != NULL)
+    {
+        fclose(lw->stream);
+        pthread_join(lw->thread, NULL);
+        lw->stream = NULL;
+    }
+    if (lw->ring != NULL)
+    {
+        pthread_mutex_destroy(&lw->lock);
+        pthread_cond_destroy(&lw->changed);
+        free(lw->ring);
+        lw->ring = NULL;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  IndexLines: Returns the offsets of every newline in the source, for    */
+/*  LineOf(), with their number in "*count", or NULL if out of memory.     */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int *IndexLines(char *source, size_t length, int *count)
+{
+    int *newlines;
+    size_t at;
+    int lines = 0;
+
+    for (at = 0; at < length; at++)
+        lines += source[at] == '\n';
+    if (NULL == (newlines = malloc((lines + 1) * sizeof(int))))
+        return NULL;
+    for (at = 0, lines = 0; at < length; at++)
+    {
+        if (source[at] == '\n')
+            newlines[lines++] = at;
+    }
+    *count = lines;
+    return newlines;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  LineOf: Line number, counted from 1, of "offset", given the offsets of  */
+/*  every newline in the source.                                            */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int LineOf(int *newlines, int count, int offset)
+{
+    int low = 0, high = count, middle;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (newlines[middle] < offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low + 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  LocateDiagnostics: Fills in the line and column of each diagnostic     */
+/*  from its offset, scanning forward from the previous one unless error   */
+/*  recovery has moved backwards.                                           */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void LocateDiagnostics(CPLDIAGNOSTIC *d, int count, char *source, size_t length)
+{
+    size_t at = 0;
+    int i, line = 1, column = 1;
+
+    for (i = 0; i < count; i++)
+    {
+        if (d[i].pos < 0)
+            continue;
+        if ((size_t)d[i].pos < at)
+        {
+            at = 0;
+            line = column = 1;
+        }
+        for (; at < (size_t)d[i].pos && at < length; at++)
+        {
+            if (source[at] == '\n')
+            {
+                line++;
+                column = 1;
+            }
+            else
+                column++;
+        }
+        d[i].line = line;
+        d[i].column = column;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  WriteErrorListing:  Writes the source lines within LISTING_CONTEXT      */
+/*                      lines of any diagnostic, each diagnostic marked     */
+/*                      under its line.  Gaps are shown as "...".           */
+/*                                                                          */
+/*    Inputs:       1) Listing file.                                        */
+/*                  2) Source text and its length.                          */
+/*                  3) Diagnostics, with their lines already located.       */
+/*                                                                          */
+/*    Outputs:      The listing.                                            */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void WriteErrorListing(FILE *out, char *source, size_t length,
+                              CPLDIAGNOSTIC *d, int count)
+{
+    char *shown, *end;
+    size_t at;
+    int lines = 1, line, first, last, i, gap = 0;
+
+    for (at = 0; at < length; at++)
+        lines += source[at] == '\n';
+    if (NULL == (shown = calloc(lines + 1, 1)))
+        return;
+    for (i = 0; i < count; i++)
+    {
+        if (d[i].line < 1)
+            continue;
+        first = d[i].line - LISTING_CONTEXT < 1 ? 1 : d[i].line - LISTING_CONTEXT;
+        last = d[i].line + LISTING_CONTEXT > lines ? lines : d[i].line + LISTING_CONTEXT;
+        for (line = first; line <= last; line++)
+            shown[line] = 1;
+    }
+
+    for (at = 0, line = 1; line <= lines && at <= length; line++)
+    {
+        if (NULL == (end = memchr(source + at, '\n', length - at)))
+            end = source + length;
+        if (!shown[line])
+            gap = 1;
+        else
+        {
+            if (gap)
+                fprintf(out, "  ...\n");
+            gap = 0;
+            fprintf(out, "%5d  %.*s\n", line, (int)(end - (source + at)), source + at);
+            for (i = 0; i < count; i++)
+            {
+                if (d[i].line == line)
+                    fprintf(out, "       %*s^ %s\n", d[i].column - 1, "", d[i].message);
+            }
+        }
+        at = end - source + 1;
+    }
+    free(shown);
+}
@@ -0,0 +1,59 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       listing.h                                                          */
+/*                                                                          */
+/*       Listing output.  The scanner writes the listing as it reads each   */
+/*       line, so by default it is given a stream that discards           */
+/*       everything.  A full listing goes through a ring buffer to a       */
+/*       writer thread, so the scanner never waits for the disk.  An error */
+/*       listing is built after the compile from the source text and the    */
+/*       diagnostics, showing only the lines around each error.             */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef LISTING_H
+#define LISTING_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include "cpl.h"
+#include "global.h"
+
+#define LISTING_NONE 0   /*  Values of --listing.                       */
+#define LISTING_FULL 1
+#define LISTING_ERRORS 2
+
+#define LISTING_CONTEXT 2 /*  Lines shown either side of an error.     */
+
+typedef struct
+{
+    FILE *target;          /*  Where the writer thread puts the listing. */
+    FILE *stream;          /*  What the scanner writes to.              */
+    char *ring;
+    size_t size;           /*  Capacity of "ring".                      */
+    size_t head;           /*  Next byte the writer takes.              */
+    size_t count;          /*  Bytes waiting in "ring".                 */
+    int closing;           /*  No more bytes will be added.             */
+    pid_t owner;           /*  Process the writer thread runs in.       */
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t thread;
+} LISTWRITER;
+
+PUBLIC FILE *OpenDiscardStream(void);
+PUBLIC FILE *OpenListWriter(LISTWRITER *lw, FILE *target);
+PUBLIC void CloseListWriter(LISTWRITER *lw);
+PUBLIC int *IndexLines(char *source, size_t length, int *count);
+PUBLIC int LineOf(int *newlines, int count, int offset);
+PUBLIC void LocateDiagnostics(CPLDIAGNOSTIC *d, int count, char *source, size_t length);
+PUBLIC void WriteErrorListing(FILE *out, char *source, size_t length,
+                              CPLDIAGNOSTIC *d, int count);
+
+#endif
@@ -0,0 +1,713 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       llgen.c                                                            */
+/*                                                                          */
+/*       LL(1) parser generator.  Reads a grammar in the form described in  */
+/*       "cpl.grammar" and writes the predictive parse table, FIRST and     */
+/*       FOLLOW sets that LLParse() runs on (see "llparse.h"):              */
+/*                                                                          */
+/*           llgen <grammarfile> <cfile> <hfile>                            */
+/*                                                                          */
+/*       <cfile> defines CplGrammar(), which returns the tables, and        */
+/*       <hfile> declares it along with an LL_<NAME> number for each        */
+/*       action.  A grammar that is not LL(1) is rejected, naming each      */
+/*       nonterminal and token with more than one rule to choose from.      */
+/*                                                                          */
+/*       Terminals stay as token names in the output, so their codes come   */
+/*       from "scanner.h" when the tables are compiled.                     */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+
+#define MAXSYMBOLS 256     /*  Terminals, nonterminals and actions.      */
+#define MAXTERMINALS 64    /*  As many as a token set in "llparse.h".    */
+#define MAXPRODUCTIONS 512
+#define MAXRHS 32
+#define MAXWORD 64
+
+#define TERMINAL 0
+#define NONTERMINAL 1
+#define ACTION 2
+
+typedef struct
+{
+    char name[MAXWORD]; /*  Without "<>" or "@".                       */
+    int kind;
+    int number;         /*  Among the symbols of its kind.             */
+    int defined;        /*  A nonterminal has a rule.                  */
+    int line;           /*  Where it was first used.                   */
+} GSYMBOL;
+
+typedef struct
+{
+    char text[MAXWORD];
+    int line;
+} WORD;
+
+typedef struct
+{
+    int lhs;            /*  GSYMBOL index.                             */
+    int rhs[MAXRHS];
+    int length;
+} GPRODUCTION;
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Global variables used by the generator.                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE char *GrammarPath;
+PRIVATE WORD *Words;        /*  The whole grammar file, word by word.   */
+PRIVATE int WordCount;
+PRIVATE int WordCapacity;
+
+PRIVATE GSYMBOL Symbols[MAXSYMBOLS];
+PRIVATE int SymbolCount;
+PRIVATE int Counts[3];      /*  Symbols of each kind.                   */
+PRIVATE int Start = -1;
+
+PRIVATE GPRODUCTION Productions[MAXPRODUCTIONS];
+PRIVATE int ProductionCount;
+
+/*  Indexed by nonterminal number, then terminal number.                   */
+PRIVATE int Nullable[MAXSYMBOLS];
+PRIVATE char First[MAXSYMBOLS][MAXTERMINALS];
+PRIVATE char Follow[MAXSYMBOLS][MAXTERMINALS];
+PRIVATE int Table[MAXSYMBOLS][MAXTERMINALS]; /*  Production + 1, or 0.   */
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Function prototypes                                                     */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReadWords(FILE *f);
+PRIVATE int ReadGrammar(void);
+PRIVATE int RuleStarts(int i);
+PRIVATE int FindSymbol(WORD *word);
+PRIVATE int CheckGrammar(void);
+PRIVATE void ComputeSets(void);
+PRIVATE int SequenceFirst(int *rhs, int length, char *set);
+PRIVATE int BuildTable(void);
+PRIVATE int WriteTables(char *path, char *header);
+PRIVATE int WriteHeader(char *path);
+PRIVATE void WriteSet(FILE *f, char *set);
+PRIVATE int Terminal(int number);
+PRIVATE int Nonterminal(int number);
+
+PUBLIC int main(int argc, char *argv[])
+{
+    FILE *f;
+    int ok;
+
+    if (argc != 4)
+    {
+        fprintf(stderr, "%s <grammarfile> <cfile> <hfile>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    GrammarPath = argv[1];
+    if (NULL == (f = fopen(GrammarPath, "r")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for input\n", GrammarPath);
+        return EXIT_FAILURE;
+    }
+    ok = ReadWords(f);
+    fclose(f);
+    if (!ok || !ReadGrammar() || !CheckGrammar())
+        return EXIT_FAILURE;
+    ComputeSets();
+    if (!BuildTable())
+        return EXIT_FAILURE;
+    if (!WriteTables(argv[2], argv[3]) || !WriteHeader(argv[3]))
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReadWords: Splits the grammar file into words at white space, leaving  */
+/*  out comments, and notes the line each is on.                            */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReadWords(FILE *f)
+{
+    WORD *grown;
+    int c, n, line = 1;
+
+    c = getc(f);
+    while (c != EOF)
+    {
+        if (c == '!')
+        {
+            while (c != '\n' && c != EOF)
+                c = getc(f);
+            continue;
+        }
+        if (isspace(c))
+        {
+            if (c == '\n')
+                line++;
+            c = getc(f);
+            continue;
+        }
+
+        if (WordCount == WordCapacity)
+        {
+            WordCapacity = WordCapacity == 0 ? 1024 : WordCapacity * 2;
+            if (NULL == (grown = realloc(Words, WordCapacity * sizeof(WORD))))
+            {
+                fprintf(stderr, "out of memory reading \"%s\"\n", GrammarPath);
+                return 0;
+            }
+            Words = grown;
+        }
+        for (n = 0; c != EOF && c != '!' && !isspace(c); c = getc(f))
+        {
+            if (n == MAXWORD - 1)
+            {
+                fprintf(stderr, "%s:%d: word too long\n", GrammarPath, line);
+                return 0;
+            }
+            Words[WordCount].text[n++] = c;
+        }
+        Words[WordCount].text[n] = '\0';
+        Words[WordCount++].line = line;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ReadGrammar:  Turns the words of the grammar file into "Productions",   */
+/*                one for each alternative of each rule.                    */
+/*                                                                          */
+/*    A rule starts at a nonterminal followed by ":==" and runs up to the   */
+/*    next such pair; its alternatives are separated by "|".                */
+/*                                                                          */
+/*    Inputs:       None                                                    */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*    Side Effects: Fills in "Symbols" and "Productions".                   */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReadGrammar(void)
+{
+    GPRODUCTION *p;
+    int i = 0, lhs, symbol;
+
+    while (i < WordCount)
+    {
+        if (!RuleStarts(i))
+        {
+            fprintf(stderr, "%s:%d: expected \"<Name> :==\", not \"%s\"\n", GrammarPath, Words[i].line,
+                    Words[i].text);
+            return 0;
+        }
+        if ((lhs = FindSymbol(&Words[i])) < 0)
+            return 0;
+        if (Symbols[lhs].defined)
+        {
+            fprintf(stderr, "%s:%d: <%s> already has a rule\n", GrammarPath, Words[i].line, Symbols[lhs].name);
+            return 0;
+        }
+        Symbols[lhs].defined = 1;
+        if (Start < 0)
+            Start = lhs;
+        i += 2;
+
+        for (;;)
+        {
+            if (ProductionCount == MAXPRODUCTIONS)
+            {
+                fprintf(stderr, "%s: more than %d alternatives\n", GrammarPath, MAXPRODUCTIONS);
+                return 0;
+            }
+            p = &Productions[ProductionCount++];
+            p->lhs = lhs;
+            p->length = 0;
+
+            if (i < WordCount && strcmp(Words[i].text, "%empty") == 0)
+                i++;
+            else
+            {
+                for (; i < WordCount && strcmp(Words[i].text, "|") != 0 && !RuleStarts(i); i++)
+                {
+                    if (strcmp(Words[i].text, "%empty") == 0 || strcmp(Words[i].text, ":==") == 0)
+                    {
+                        fprintf(stderr, "%s:%d: unexpected \"%s\"\n", GrammarPath, Words[i].line, Words[i].text);
+                        return 0;
+                    }
+                    if ((symbol = FindSymbol(&Words[i])) < 0)
+                        return 0;
+                    if (p->length == MAXRHS)
+                    {
+                        fprintf(stderr, "%s:%d: more than %d symbols in an alternative\n", GrammarPath,
+                                Words[i].line, MAXRHS);
+                        return 0;
+                    }
+                    p->rhs[p->length++] = symbol;
+                }
+                if (p->length == 0)
+                {
+                    fprintf(stderr, "%s:%d: empty alternative for <%s>; write %%empty\n", GrammarPath,
+                            Words[i < WordCount ? i : i - 1].line, Symbols[lhs].name);
+                    return 0;
+                }
+            }
+
+            if (i < WordCount && strcmp(Words[i].text, "|") == 0)
+                i++;
+            else
+                break;
+        }
+    }
+
+    if (Start < 0)
+    {
+        fprintf(stderr, "%s: no rules\n", GrammarPath);
+        return 0;
+    }
+    return 1;
+}
+
+PRIVATE int RuleStarts(int i)
+{
+    return Words[i].text[0] == '<' && i + 1 < WordCount && strcmp(Words[i + 1].text, ":==") == 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  FindSymbol: Returns the index of the symbol a word names, adding it the */
+/*  first time it is seen, or -1 if the word is not a symbol.               */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int FindSymbol(WORD *word)
+{
+    char name[MAXWORD];
+    int i, kind, n = strlen(word->text);
+
+    if (word->text[0] == '<' && n > 2 && word->text[n - 1] == '>')
+    {
+        kind = NONTERMINAL;
+        memcpy(name, word->text + 1, n - 2);
+        name[n - 2] = '\0';
+    }
+    else if (word->text[0] == '@' && n > 1)
+    {
+        kind = ACTION;
+        strcpy(name, word->text + 1);
+    }
+    else if (isupper((unsigned char)word->text[0]))
+    {
+        kind = TERMINAL;
+        strcpy(name, word->text);
+    }
+    else
+    {
+        fprintf(stderr, "%s:%d: \"%s\" is not a token name, <Nonterminal> or @Action\n", GrammarPath, word->line,
+                word->text);
+        return -1;
+    }
+    for (i = 1; name[i - 1] != '\0'; i++)
+    {
+        if (!isalnum((unsigned char)name[i - 1]) && name[i - 1] != '_')
+        {
+            fprintf(stderr, "%s:%d: bad name \"%s\"\n", GrammarPath, word->line, word->text);
+            return -1;
+        }
+    }
+
+    for (i = 0; i < SymbolCount; i++)
+    {
+        if (Symbols[i].kind == kind && strcmp(Symbols[i].name, name) == 0)
+            return i;
+    }
+
+    if (SymbolCount == MAXSYMBOLS || (kind == TERMINAL && Counts[TERMINAL] == MAXTERMINALS))
+    {
+        fprintf(stderr, "%s:%d: too many symbols\n", GrammarPath, word->line);
+        return -1;
+    }
+    strcpy(Symbols[SymbolCount].name, name);
+    Symbols[SymbolCount].kind = kind;
+    Symbols[SymbolCount].number = Counts[kind]++;
+    Symbols[SymbolCount].defined = 0;
+    Symbols[SymbolCount].line = word->line;
+    return SymbolCount++;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Terminal, Nonterminal: Return the index of the symbol with a given      */
+/*  number among those of its kind.                                         */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Terminal(int number)
+{
+    int i;
+
+    for (i = 0; i < SymbolCount; i++)
+    {
+        if (Symbols[i].kind == TERMINAL && Symbols[i].number == number)
+            return i;
+    }
+    return -1;
+}
+
+PRIVATE int Nonterminal(int number)
+{
+    int i;
+
+    for (i = 0; i < SymbolCount; i++)
+    {
+        if (Symbols[i].kind == NONTERMINAL && Symbols[i].number == number)
+            return i;
+    }
+    return -1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  CheckGrammar: Every nonterminal used needs a rule.                      */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int CheckGrammar(void)
+{
+    int i, ok = 1;
+
+    for (i = 0; i < SymbolCount; i++)
+    {
+        if (Symbols[i].kind == NONTERMINAL && !Symbols[i].defined)
+        {
+            fprintf(stderr, "%s:%d: <%s> has no rule\n", GrammarPath, Symbols[i].line, Symbols[i].name);
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ComputeSets:  Works out which nonterminals can derive the empty         */
+/*                string, and the FIRST and FOLLOW set of each, by going    */
+/*                over the productions until nothing changes.  Actions      */
+/*                derive the empty string and are otherwise ignored.        */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ComputeSets(void)
+{
+    char set[MAXTERMINALS];
+    int changed, i, j, t, lhs, symbol, nullable;
+    GPRODUCTION *p;
+
+    do
+    {
+        changed = 0;
+        for (i = 0; i < ProductionCount; i++)
+        {
+            p = &Productions[i];
+            lhs = Symbols[p->lhs].number;
+            nullable = SequenceFirst(p->rhs, p->length, set);
+            for (t = 0; t < Counts[TERMINAL]; t++)
+            {
+                if (set[t] && !First[lhs][t])
+                    First[lhs][t] = changed = 1;
+            }
+            if (nullable && !Nullable[lhs])
+                Nullable[lhs] = changed = 1;
+        }
+    } while (changed);
+
+    do
+    {
+        changed = 0;
+        for (i = 0; i < ProductionCount; i++)
+        {
+            p = &Productions[i];
+            lhs = Symbols[p->lhs].number;
+            for (j = 0; j < p->length; j++)
+            {
+                if (Symbols[p->rhs[j]].kind != NONTERMINAL)
+                    continue;
+                symbol = Symbols[p->rhs[j]].number;
+                nullable = SequenceFirst(p->rhs + j + 1, p->length - j - 1, set);
+                for (t = 0; t < Counts[TERMINAL]; t++)
+                {
+                    if ((set[t] || (nullable && Follow[lhs][t])) && !Follow[symbol][t])
+                        Follow[symbol][t] = changed = 1;
+                }
+            }
+        }
+    } while (changed);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  SequenceFirst: Sets "set" to the FIRST set of a string of symbols, as   */
+/*  far as it is known, and returns 1 if the string can derive nothing.     */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int SequenceFirst(int *rhs, int length, char *set)
+{
+    int i, t;
+    GSYMBOL *s;
+
+    memset(set, 0, MAXTERMINALS);
+    for (i = 0; i < length; i++)
+    {
+        s = &Symbols[rhs[i]];
+        if (s->kind == TERMINAL)
+        {
+            set[s->number] = 1;
+            return 0;
+        }
+        if (s->kind == NONTERMINAL)
+        {
+            for (t = 0; t < Counts[TERMINAL]; t++)
+                set[t] |= First[s->number][t];
+            if (!Nullable[s->number])
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  BuildTable:  Fills in the predictive parse table.  Production A -> x    */
+/*               goes under every token in FIRST(x), and under FOLLOW(A)    */
+/*               too if x can derive the empty string.  Two productions in  */
+/*               one entry mean the grammar is not LL(1); every such entry  */
+/*               is reported.  A nonterminal that cannot derive any string  */
+/*               of tokens would leave the parser nothing to match, so      */
+/*               that is reported too.                                      */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int BuildTable(void)
+{
+    char set[MAXTERMINALS];
+    int i, t, lhs, nullable, ok = 1, any;
+    GPRODUCTION *p;
+
+    for (i = 0; i < ProductionCount; i++)
+    {
+        p = &Productions[i];
+        lhs = Symbols[p->lhs].number;
+        nullable = SequenceFirst(p->rhs, p->length, set);
+        for (t = 0; t < Counts[TERMINAL]; t++)
+        {
+            if (!set[t] && !(nullable && Follow[lhs][t]))
+                continue;
+            if (Table[lhs][t] != 0 && Table[lhs][t] != i + 1)
+            {
+                fprintf(stderr, "%s: not LL(1): <%s> has more than one alternative for %s\n", GrammarPath,
+                        Symbols[p->lhs].name, Symbols[Terminal(t)].name);
+                ok = 0;
+            }
+            else
+                Table[lhs][t] = i + 1;
+        }
+    }
+
+    for (i = 0; i < Counts[NONTERMINAL]; i++)
+    {
+        for (any = Nullable[i], t = 0; t < Counts[TERMINAL]; t++)
+            any |= First[i][t];
+        if (!any)
+        {
+            fprintf(stderr, "%s: <%s> derives no string of tokens\n", GrammarPath, Symbols[Nonterminal(i)].name);
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  WriteTables:  Writes the tables out as C, with CplGrammar() to return   */
+/*                them.                                                     */
+/*                                                                          */
+/*    Inputs:       path      File to write.                                */
+/*                  header    The header being written alongside it, which  */
+/*                            it includes.                                  */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int WriteTables(char *path, char *header)
+{
+    FILE *f;
+    char *base;
+    int i, j, t, start = 0, first;
+    GPRODUCTION *p;
+    GSYMBOL *s;
+
+    if (NULL == (f = fopen(path, "w")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for output\n", path);
+        return 0;
+    }
+    base = strrchr(header, '/') ? strrchr(header, '/') + 1 : header;
+
+    fprintf(f, "/*  Generated by llgen from %s; do not edit.  */\n\n", GrammarPath);
+    fprintf(f, "#include <stdint.h>\n#include \"global.h\"\n#include \"scanner.h\"\n");
+    fprintf(f, "#include \"llparse.h\"\n#include \"%s\"\n\n", base);
+
+    fprintf(f, "/*  Fails to compile if a token code doesn't fit in a token set.  */\n");
+    fprintf(f, "typedef char LLTokenRange[(");
+    for (t = 0; t < Counts[TERMINAL]; t++)
+        fprintf(f, "%s%s < LL_MAXTOKENS", t == 0 ? "" : " &&\n                          ", Symbols[Terminal(t)].name);
+    fprintf(f, ") ? 1 : -1];\n\n");
+
+    fprintf(f, "PRIVATE short Rhs[] =\n{\n");
+    for (i = 0; i < ProductionCount; i++)
+    {
+        p = &Productions[i];
+        fprintf(f, "    /* %3d <%s> */", i, Symbols[p->lhs].name);
+        if (p->length == 0)
+            fprintf(f, " /* %%empty */");
+        for (j = 0; j < p->length; j++)
+        {
+            s = &Symbols[p->rhs[j]];
+            if (s->kind == TERMINAL)
+                fprintf(f, " %s,", s->name);
+            else if (s->kind == NONTERMINAL)
+                fprintf(f, " LL_NONTERMINAL(%d),", s->number);
+            else
+                fprintf(f, " LL_ACTION(%d),", s->number);
+        }
+        fprintf(f, "\n");
+    }
+    fprintf(f, "    0\n};\n\n");
+
+    fprintf(f, "PRIVATE LLPRODUCTION Productions[] =\n{\n");
+    for (i = 0; i < ProductionCount; i++)
+    {
+        p = &Productions[i];
+        fprintf(f, "    {%d, %d, %d},\n", Symbols[p->lhs].number, start, p->length);
+        start += p->length;
+    }
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "PRIVATE short Table[%d][LL_MAXTOKENS] =\n{\n", Counts[NONTERMINAL]);
+    for (i = 0; i < Counts[NONTERMINAL]; i++)
+    {
+        fprintf(f, "    /* <%s> */ {", Symbols[Nonterminal(i)].name);
+        for (first = 1, t = 0; t < Counts[TERMINAL]; t++)
+        {
+            if (Table[i][t] != 0)
+            {
+                fprintf(f, "%s[%s] = %d", first ? "" : ", ", Symbols[Terminal(t)].name, Table[i][t]);
+                first = 0;
+            }
+        }
+        fprintf(f, "},\n");
+    }
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "PRIVATE uint64_t First[] =\n{\n");
+    for (i = 0; i < Counts[NONTERMINAL]; i++)
+        WriteSet(f, First[i]);
+    fprintf(f, "};\n\nPRIVATE uint64_t Follow[] =\n{\n");
+    for (i = 0; i < Counts[NONTERMINAL]; i++)
+        WriteSet(f, Follow[i]);
+    fprintf(f, "};\n\n");
+
+    fprintf(f, "PRIVATE char *NonterminalNames[] =\n{\n");
+    for (i = 0; i < Counts[NONTERMINAL]; i++)
+        fprintf(f, "    \"%s\",\n", Symbols[Nonterminal(i)].name);
+    fprintf(f, "    NULL\n};\n\nPRIVATE char *ActionNames[] =\n{\n");
+    for (i = 0; i < SymbolCount; i++)
+    {
+        if (Symbols[i].kind == ACTION)
+            fprintf(f, "    \"%s\",\n", Symbols[i].name);
+    }
+    fprintf(f, "    NULL\n};\n\n");
+
+    fprintf(f, "PRIVATE LLGRAMMAR Grammar =\n{\n");
+    fprintf(f, "    LL_NONTERMINAL(%d), %d, Productions, Rhs, Table, First, Follow, NonterminalNames, ActionNames\n",
+            Symbols[Start].number, Counts[NONTERMINAL]);
+    fprintf(f, "};\n\nPUBLIC LLGRAMMAR *CplGrammar(void)\n{\n    return &Grammar;\n}\n");
+
+    if (ferror(f) | fclose(f))
+    {
+        fprintf(stderr, "cannot write \"%s\"\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  WriteHeader: Writes the header declaring CplGrammar() and numbering the */
+/*  actions.                                                                */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int WriteHeader(char *path)
+{
+    FILE *f;
+    char *c;
+    int i;
+
+    if (NULL == (f = fopen(path, "w")))
+    {
+        fprintf(stderr, "cannot open \"%s\" for output\n", path);
+        return 0;
+    }
+
+    fprintf(f, "/*  Generated by llgen from %s; do not edit.  */\n\n", GrammarPath);
+    fprintf(f, "#ifndef LLTABLE_H\n#define LLTABLE_H\n\n#include \"global.h\"\n#include \"llparse.h\"\n\n");
+    for (i = 0; i < SymbolCount; i++)
+    {
+        if (Symbols[i].kind != ACTION)
+            continue;
+        fprintf(f, "#define LL_");
+        for (c = Symbols[i].name; *c != '\0'; c++)
+            putc(toupper((unsigned char)*c), f);
+        fprintf(f, " %d\n", Symbols[i].number);
+    }
+    fprintf(f, "\nPUBLIC LLGRAMMAR *CplGrammar(void);\n\n#endif\n");
+
+    if (ferror(f) | fclose(f))
+    {
+        fprintf(stderr, "cannot write \"%s\"\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  WriteSet: Writes a set of terminals as an initializer of LL_BITs.       */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void WriteSet(FILE *f, char *set)
+{
+    int t, first = 1;
+
+    fprintf(f, "    ");
+    for (t = 0; t < Counts[TERMINAL]; t++)
+    {
+        if (set[t])
+        {
+            fprintf(f, "%sLL_BIT(%s)", first ? "" : " | ", Symbols[Terminal(t)].name);
+            first = 0;
+        }
+    }
+    fprintf(f, "%s,\n", first ? "0" : "");
+}
@@ -0,0 +1,146 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       llparse.c                                                          */
+/*                                                                          */
+/*       Table-driven LL(1) parser.  See "llparse.h".                       */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "global.h"
+#include "scanner.h"
+#include "llparse.h"
+
+#define INITIAL_STACK 256
+
+typedef struct
+{
+    short *symbols;
+    int depth;
+    int size;
+} LLSTACK;
+
+PRIVATE void Push(LLSTACK *stack, int symbol);
+PRIVATE int Expand(LLGRAMMAR *grammar, LLSTACK *stack, int nonterminal, int token);
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  LLParse:  Parses the token stream against a grammar's tables.           */
+/*                                                                          */
+/*    The stack holds what is still to be matched, top last.  A terminal    */
+/*    on top is matched against the lookahead, a nonterminal is replaced    */
+/*    by the right-hand side the table picks for the lookahead, and an      */
+/*    action is handed to the action hook.  Error recovery is described     */
+/*    in "llparse.h"; it never pushes without a table entry and never       */
+/*    reads past the end of input, so each step either reads a token or     */
+/*    shrinks what is left to derive, and the parse always ends.            */
+/*                                                                          */
+/*    Inputs:       grammar   Tables written by llgen.                      */
+/*                  hooks     Token, action and error callbacks.  The       */
+/*                            first token is read through "next".           */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      The number of errors reported.                          */
+/*                                                                          */
+/*    Side Effects: Whatever the hooks do.                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int LLParse(LLGRAMMAR *grammar, LLHOOKS *hooks)
+{
+    LLSTACK stack;
+    TOKEN token;
+    int symbol, nonterminal, errors = 0;
+
+    stack.symbols = NULL;
+    stack.depth = stack.size = 0;
+    Push(&stack, grammar->start);
+    token = hooks->next(hooks->arg, 0);
+
+    while (stack.depth > 0)
+    {
+        symbol = stack.symbols[--stack.depth];
+
+        if (symbol < 0)
+        {
+            if (hooks->action != NULL)
+                hooks->action(hooks->arg, -1 - symbol, &token);
+        }
+        else if (symbol < LL_MAXTOKENS)
+        {
+            if (token.code == symbol)
+            {
+                if (symbol != ENDOFINPUT)
+                    token = hooks->next(hooks->arg, 0);
+            }
+            else
+            {
+                errors++;
+                hooks->error(hooks->arg, symbol, LL_BIT(symbol), &token);
+            }
+        }
+        else
+        {
+            nonterminal = symbol - LL_MAXTOKENS;
+            if (Expand(grammar, &stack, nonterminal, token.code))
+                continue;
+
+            errors++;
+            hooks->error(hooks->arg, -1, grammar->first[nonterminal], &token);
+            while (token.code != ENDOFINPUT && (token.code < 0 || token.code >= LL_MAXTOKENS ||
+                   (grammar->table[nonterminal][token.code] == 0 &&
+                    !(grammar->follow[nonterminal] & LL_BIT(token.code)))))
+            {
+                token = hooks->next(hooks->arg, 1);
+            }
+            Expand(grammar, &stack, nonterminal, token.code);
+        }
+    }
+
+    free(stack.symbols);
+    return errors;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Expand: Replaces a nonterminal by the right-hand side the table gives   */
+/*  for "token", if there is one.  Returns 1 if there was.                  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Expand(LLGRAMMAR *grammar, LLSTACK *stack, int nonterminal, int token)
+{
+    LLPRODUCTION *p;
+    int i, entry;
+
+    if (token < 0 || token >= LL_MAXTOKENS || 0 == (entry = grammar->table[nonterminal][token]))
+        return 0;
+
+    p = &grammar->productions[entry - 1];
+    for (i = p->length - 1; i >= 0; i--)
+        Push(stack, grammar->rhs[p->start + i]);
+    return 1;
+}
+
+PRIVATE void Push(LLSTACK *stack, int symbol)
+{
+    short *grown;
+
+    if (stack->depth == stack->size)
+    {
+        stack->size = stack->size == 0 ? INITIAL_STACK : stack->size * 2;
+        if (NULL == (grown = realloc(stack->symbols, stack->size * sizeof(short))))
+        {
+            fprintf(stderr, "out of memory in LL(1) parser\n");
+            exit(EXIT_FAILURE);
+        }
+        stack->symbols = grown;
+    }
+    stack->symbols[stack->depth++] = symbol;
+}
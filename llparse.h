@@ -0,0 +1,86 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       llparse.h                                                          */
+/*                                                                          */
+/*       Table-driven LL(1) parser.  "llgen" reads a grammar such as        */
+/*       "cpl.grammar", computes its FIRST and FOLLOW sets and predictive   */
+/*       parse table, and writes them out as C:                             */
+/*                                                                          */
+/*           cc llgen.c -o llgen                                            */
+/*           ./llgen cpl.grammar lltable.c lltable.h                        */
+/*                                                                          */
+/*       LLParse() runs any such table with an explicit stack, so there is  */
+/*       no limit on nesting but memory.  It calls back for tokens, for     */
+/*       the semantic actions written as "@Name" in the grammar, and for    */
+/*       errors.                                                            */
+/*                                                                          */
+/*       Grammar symbols are stored as one number each: a terminal is its   */
+/*       token code from "scanner.h", which must be below LL_MAXTOKENS; a   */
+/*       nonterminal is LL_NONTERMINAL(n) and an action LL_ACTION(n).       */
+/*                                                                          */
+/*       Errors are recovered from without any hand-written sets.  A        */
+/*       terminal that doesn't match is reported and taken as read.  A      */
+/*       nonterminal with no rule for the lookahead is reported, then       */
+/*       tokens are skipped until one it can start with or one in its       */
+/*       FOLLOW set; in the second case, or at the end of input, it is      */
+/*       popped.  Either way the parse ends after reading each token once.  */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef LLPARSE_H
+#define LLPARSE_H
+
+#include <stdint.h>
+#include "global.h"
+#include "scanner.h"
+
+#define LL_MAXTOKENS 64 /*  Token codes fit in a 64-bit set.           */
+
+#define LL_NONTERMINAL(n) (LL_MAXTOKENS + (n))
+#define LL_ACTION(n) (-1 - (n))
+#define LL_BIT(code) ((uint64_t)1 << (code))
+
+typedef struct
+{
+    short lhs;    /*  Nonterminal number.                               */
+    short start;  /*  First symbol in the grammar's "rhs" array.        */
+    short length;
+} LLPRODUCTION;
+
+typedef struct
+{
+    int start;                          /*  Nonterminal the parse begins with. */
+    int nonterminals;
+    LLPRODUCTION *productions;
+    short *rhs;
+    short (*table)[LL_MAXTOKENS];       /*  Production + 1, or 0 for an error. */
+    uint64_t *first;                    /*  FIRST set of each nonterminal.    */
+    uint64_t *follow;                   /*  FOLLOW set of each nonterminal.   */
+    char **nonterminalNames;
+    char **actionNames;
+} LLGRAMMAR;
+
+/*  "skip" is 1 when the token is being passed over by error recovery.     */
+typedef TOKEN (*LLNEXT)(void *arg, int skip);
+typedef void (*LLACTION)(void *arg, int action, TOKEN *lookahead);
+/*  "expected" is a token code, or -1 if any token in "expectedSet" would  */
+/*  have done.                                                              */
+typedef void (*LLERROR)(void *arg, int expected, uint64_t expectedSet, TOKEN *lookahead);
+
+typedef struct
+{
+    LLNEXT next;
+    LLACTION action;  /*  May be NULL.                                   */
+    LLERROR error;
+    void *arg;
+} LLHOOKS;
+
+PUBLIC int LLParse(LLGRAMMAR *grammar, LLHOOKS *hooks);
+
+#endif
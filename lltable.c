@@ -0,0 +1,358 @@
+/*  Generated by llgen from cpl.grammar; do not edit.  */
+
+#include <stdint.h>
+#include "global.h"
+#include "scanner.h"
+#include "llparse.h"
+#include "lltable.h"
+
+/*  Fails to compile if a token code doesn't fit in a token set.  */
+typedef char LLTokenRange[(PROGRAM < LL_MAXTOKENS &&
+                          IDENTIFIER < LL_MAXTOKENS &&
+                          SEMICOLON < LL_MAXTOKENS &&
+                          ENDOFPROGRAM < LL_MAXTOKENS &&
+                          ENDOFINPUT < LL_MAXTOKENS &&
+                          VAR < LL_MAXTOKENS &&
+                          COMMA < LL_MAXTOKENS &&
+                          PROCEDURE < LL_MAXTOKENS &&
+                          LEFTPARENTHESIS < LL_MAXTOKENS &&
+                          RIGHTPARENTHESIS < LL_MAXTOKENS &&
+                          REF < LL_MAXTOKENS &&
+                          BEGIN < LL_MAXTOKENS &&
+                          END < LL_MAXTOKENS &&
+                          ASSIGNMENT < LL_MAXTOKENS &&
+                          WHILE < LL_MAXTOKENS &&
+                          DO < LL_MAXTOKENS &&
+                          IF < LL_MAXTOKENS &&
+                          THEN < LL_MAXTOKENS &&
+                          ELSE < LL_MAXTOKENS &&
+                          READ < LL_MAXTOKENS &&
+                          WRITE < LL_MAXTOKENS &&
+                          SUBTRACT < LL_MAXTOKENS &&
+                          INTCONST < LL_MAXTOKENS &&
+                          ADD < LL_MAXTOKENS &&
+                          MULTIPLY < LL_MAXTOKENS &&
+                          DIVIDE < LL_MAXTOKENS &&
+                          EQUALITY < LL_MAXTOKENS &&
+                          LESSEQUAL < LL_MAXTOKENS &&
+                          GREATEREQUAL < LL_MAXTOKENS &&
+                          LESS < LL_MAXTOKENS &&
+                          GREATER < LL_MAXTOKENS) ? 1 : -1];
+
+PRIVATE short Rhs[] =
+{
+    /*   0 <Program> */ PROGRAM, IDENTIFIER, LL_ACTION(0), SEMICOLON, LL_NONTERMINAL(1), LL_NONTERMINAL(2), LL_NONTERMINAL(3), ENDOFPROGRAM, LL_ACTION(1), ENDOFINPUT,
+    /*   1 <OptDeclarations> */ LL_NONTERMINAL(4),
+    /*   2 <OptDeclarations> */ /* %empty */
+    /*   3 <Declarations> */ VAR, IDENTIFIER, LL_NONTERMINAL(5), SEMICOLON,
+    /*   4 <MoreVariables> */ COMMA, IDENTIFIER, LL_NONTERMINAL(5),
+    /*   5 <MoreVariables> */ /* %empty */
+    /*   6 <ProcDeclarations> */ LL_NONTERMINAL(6), LL_NONTERMINAL(2),
+    /*   7 <ProcDeclarations> */ /* %empty */
+    /*   8 <ProcDeclaration> */ LL_ACTION(2), PROCEDURE, LL_ACTION(3), IDENTIFIER, LL_NONTERMINAL(7), SEMICOLON, LL_NONTERMINAL(1), LL_NONTERMINAL(2), LL_NONTERMINAL(3), LL_ACTION(4), SEMICOLON, LL_ACTION(1),
+    /*   9 <OptParameterList> */ LL_NONTERMINAL(8),
+    /*  10 <OptParameterList> */ /* %empty */
+    /*  11 <ParameterList> */ LEFTPARENTHESIS, LL_NONTERMINAL(9), LL_NONTERMINAL(10), RIGHTPARENTHESIS,
+    /*  12 <MoreParameters> */ COMMA, LL_NONTERMINAL(9), LL_NONTERMINAL(10),
+    /*  13 <MoreParameters> */ /* %empty */
+    /*  14 <FormalParameter> */ REF, IDENTIFIER,
+    /*  15 <FormalParameter> */ IDENTIFIER,
+    /*  16 <Block> */ BEGIN, LL_ACTION(0), LL_NONTERMINAL(11), LL_ACTION(1), END,
+    /*  17 <Statements> */ LL_NONTERMINAL(12), SEMICOLON, LL_NONTERMINAL(11),
+    /*  18 <Statements> */ /* %empty */
+    /*  19 <Statement> */ LL_NONTERMINAL(13),
+    /*  20 <Statement> */ LL_NONTERMINAL(14),
+    /*  21 <Statement> */ LL_NONTERMINAL(15),
+    /*  22 <Statement> */ LL_NONTERMINAL(16),
+    /*  23 <Statement> */ LL_NONTERMINAL(17),
+    /*  24 <SimpleStatement> */ IDENTIFIER, LL_NONTERMINAL(18),
+    /*  25 <RestOfStatement> */ LL_NONTERMINAL(19),
+    /*  26 <RestOfStatement> */ LL_NONTERMINAL(20),
+    /*  27 <RestOfStatement> */ /* %empty */
+    /*  28 <ProcCallList> */ LEFTPARENTHESIS, LL_NONTERMINAL(21), LL_NONTERMINAL(22), RIGHTPARENTHESIS,
+    /*  29 <MoreActuals> */ COMMA, LL_NONTERMINAL(21), LL_NONTERMINAL(22),
+    /*  30 <MoreActuals> */ /* %empty */
+    /*  31 <Assignment> */ ASSIGNMENT, LL_NONTERMINAL(23),
+    /*  32 <ActualParameter> */ LL_NONTERMINAL(23),
+    /*  33 <WhileStatement> */ WHILE, LL_NONTERMINAL(24), DO, LL_NONTERMINAL(3),
+    /*  34 <IfStatement> */ IF, LL_NONTERMINAL(24), THEN, LL_NONTERMINAL(3), LL_NONTERMINAL(25),
+    /*  35 <ElsePart> */ ELSE, LL_NONTERMINAL(3),
+    /*  36 <ElsePart> */ /* %empty */
+    /*  37 <ReadStatement> */ READ, LEFTPARENTHESIS, IDENTIFIER, LL_NONTERMINAL(26), RIGHTPARENTHESIS,
+    /*  38 <MoreReadVariables> */ COMMA, IDENTIFIER, LL_NONTERMINAL(26),
+    /*  39 <MoreReadVariables> */ /* %empty */
+    /*  40 <WriteStatement> */ WRITE, LEFTPARENTHESIS, LL_NONTERMINAL(23), LL_NONTERMINAL(27), RIGHTPARENTHESIS,
+    /*  41 <MoreExpressions> */ COMMA, LL_NONTERMINAL(23), LL_NONTERMINAL(27),
+    /*  42 <MoreExpressions> */ /* %empty */
+    /*  43 <Expression> */ LL_NONTERMINAL(28), LL_NONTERMINAL(29),
+    /*  44 <MoreTerms> */ LL_NONTERMINAL(30), LL_NONTERMINAL(28), LL_NONTERMINAL(29),
+    /*  45 <MoreTerms> */ /* %empty */
+    /*  46 <CompoundTerm> */ LL_NONTERMINAL(31), LL_NONTERMINAL(32),
+    /*  47 <MoreFactors> */ LL_NONTERMINAL(33), LL_NONTERMINAL(31), LL_NONTERMINAL(32),
+    /*  48 <MoreFactors> */ /* %empty */
+    /*  49 <Term> */ SUBTRACT, LL_NONTERMINAL(34),
+    /*  50 <Term> */ LL_NONTERMINAL(34),
+    /*  51 <SubTerm> */ IDENTIFIER,
+    /*  52 <SubTerm> */ INTCONST,
+    /*  53 <SubTerm> */ LEFTPARENTHESIS, LL_NONTERMINAL(23), RIGHTPARENTHESIS,
+    /*  54 <BooleanExpression> */ LL_NONTERMINAL(23), LL_NONTERMINAL(35), LL_NONTERMINAL(23),
+    /*  55 <AddOp> */ ADD,
+    /*  56 <AddOp> */ SUBTRACT,
+    /*  57 <MultOp> */ MULTIPLY,
+    /*  58 <MultOp> */ DIVIDE,
+    /*  59 <RelOp> */ EQUALITY,
+    /*  60 <RelOp> */ LESSEQUAL,
+    /*  61 <RelOp> */ GREATEREQUAL,
+    /*  62 <RelOp> */ LESS,
+    /*  63 <RelOp> */ GREATER,
+    0
+};
+
+PRIVATE LLPRODUCTION Productions[] =
+{
+    {0, 0, 10},
+    {1, 10, 1},
+    {1, 11, 0},
+    {4, 11, 4},
+    {5, 15, 3},
+    {5, 18, 0},
+    {2, 18, 2},
+    {2, 20, 0},
+    {6, 20, 12},
+    {7, 32, 1},
+    {7, 33, 0},
+    {8, 33, 4},
+    {10, 37, 3},
+    {10, 40, 0},
+    {9, 40, 2},
+    {9, 42, 1},
+    {3, 43, 5},
+    {11, 48, 3},
+    {11, 51, 0},
+    {12, 51, 1},
+    {12, 52, 1},
+    {12, 53, 1},
+    {12, 54, 1},
+    {12, 55, 1},
+    {13, 56, 2},
+    {18, 58, 1},
+    {18, 59, 1},
+    {18, 60, 0},
+    {19, 60, 4},
+    {22, 64, 3},
+    {22, 67, 0},
+    {20, 67, 2},
+    {21, 69, 1},
+    {14, 70, 4},
+    {15, 74, 5},
+    {25, 79, 2},
+    {25, 81, 0},
+    {16, 81, 5},
+    {26, 86, 3},
+    {26, 89, 0},
+    {17, 89, 5},
+    {27, 94, 3},
+    {27, 97, 0},
+    {23, 97, 2},
+    {29, 99, 3},
+    {29, 102, 0},
+    {28, 102, 2},
+    {32, 104, 3},
+    {32, 107, 0},
+    {31, 107, 2},
+    {31, 109, 1},
+    {34, 110, 1},
+    {34, 111, 1},
+    {34, 112, 3},
+    {24, 115, 3},
+    {30, 118, 1},
+    {30, 119, 1},
+    {33, 120, 1},
+    {33, 121, 1},
+    {35, 122, 1},
+    {35, 123, 1},
+    {35, 124, 1},
+    {35, 125, 1},
+    {35, 126, 1},
+};
+
+PRIVATE short Table[36][LL_MAXTOKENS] =
+{
+    /* <Program> */ {[PROGRAM] = 1},
+    /* <OptDeclarations> */ {[VAR] = 2, [PROCEDURE] = 3, [BEGIN] = 3},
+    /* <ProcDeclarations> */ {[PROCEDURE] = 7, [BEGIN] = 8},
+    /* <Block> */ {[BEGIN] = 17},
+    /* <Declarations> */ {[VAR] = 4},
+    /* <MoreVariables> */ {[SEMICOLON] = 6, [COMMA] = 5},
+    /* <ProcDeclaration> */ {[PROCEDURE] = 9},
+    /* <OptParameterList> */ {[SEMICOLON] = 11, [LEFTPARENTHESIS] = 10},
+    /* <ParameterList> */ {[LEFTPARENTHESIS] = 12},
+    /* <FormalParameter> */ {[IDENTIFIER] = 16, [REF] = 15},
+    /* <MoreParameters> */ {[COMMA] = 13, [RIGHTPARENTHESIS] = 14},
+    /* <Statements> */ {[IDENTIFIER] = 18, [END] = 19, [WHILE] = 18, [IF] = 18, [READ] = 18, [WRITE] = 18},
+    /* <Statement> */ {[IDENTIFIER] = 20, [WHILE] = 21, [IF] = 22, [READ] = 23, [WRITE] = 24},
+    /* <SimpleStatement> */ {[IDENTIFIER] = 25},
+    /* <WhileStatement> */ {[WHILE] = 34},
+    /* <IfStatement> */ {[IF] = 35},
+    /* <ReadStatement> */ {[READ] = 38},
+    /* <WriteStatement> */ {[WRITE] = 41},
+    /* <RestOfStatement> */ {[SEMICOLON] = 28, [LEFTPARENTHESIS] = 26, [ASSIGNMENT] = 27},
+    /* <ProcCallList> */ {[LEFTPARENTHESIS] = 29},
+    /* <Assignment> */ {[ASSIGNMENT] = 32},
+    /* <ActualParameter> */ {[IDENTIFIER] = 33, [LEFTPARENTHESIS] = 33, [SUBTRACT] = 33, [INTCONST] = 33},
+    /* <MoreActuals> */ {[COMMA] = 30, [RIGHTPARENTHESIS] = 31},
+    /* <Expression> */ {[IDENTIFIER] = 44, [LEFTPARENTHESIS] = 44, [SUBTRACT] = 44, [INTCONST] = 44},
+    /* <BooleanExpression> */ {[IDENTIFIER] = 55, [LEFTPARENTHESIS] = 55, [SUBTRACT] = 55, [INTCONST] = 55},
+    /* <ElsePart> */ {[SEMICOLON] = 37, [ELSE] = 36},
+    /* <MoreReadVariables> */ {[COMMA] = 39, [RIGHTPARENTHESIS] = 40},
+    /* <MoreExpressions> */ {[COMMA] = 42, [RIGHTPARENTHESIS] = 43},
+    /* <CompoundTerm> */ {[IDENTIFIER] = 47, [LEFTPARENTHESIS] = 47, [SUBTRACT] = 47, [INTCONST] = 47},
+    /* <MoreTerms> */ {[SEMICOLON] = 46, [COMMA] = 46, [RIGHTPARENTHESIS] = 46, [DO] = 46, [THEN] = 46, [SUBTRACT] = 45, [ADD] = 45, [EQUALITY] = 46, [LESSEQUAL] = 46, [GREATEREQUAL] = 46, [LESS] = 46, [GREATER] = 46},
+    /* <AddOp> */ {[SUBTRACT] = 57, [ADD] = 56},
+    /* <Term> */ {[IDENTIFIER] = 51, [LEFTPARENTHESIS] = 51, [SUBTRACT] = 50, [INTCONST] = 51},
+    /* <MoreFactors> */ {[SEMICOLON] = 49, [COMMA] = 49, [RIGHTPARENTHESIS] = 49, [DO] = 49, [THEN] = 49, [SUBTRACT] = 49, [ADD] = 49, [MULTIPLY] = 48, [DIVIDE] = 48, [EQUALITY] = 49, [LESSEQUAL] = 49, [GREATEREQUAL] = 49, [LESS] = 49, [GREATER] = 49},
+    /* <MultOp> */ {[MULTIPLY] = 58, [DIVIDE] = 59},
+    /* <SubTerm> */ {[IDENTIFIER] = 52, [LEFTPARENTHESIS] = 54, [INTCONST] = 53},
+    /* <RelOp> */ {[EQUALITY] = 60, [LESSEQUAL] = 61, [GREATEREQUAL] = 62, [LESS] = 63, [GREATER] = 64},
+};
+
+PRIVATE uint64_t First[] =
+{
+    LL_BIT(PROGRAM),
+    LL_BIT(VAR),
+    LL_BIT(PROCEDURE),
+    LL_BIT(BEGIN),
+    LL_BIT(VAR),
+    LL_BIT(COMMA),
+    LL_BIT(PROCEDURE),
+    LL_BIT(LEFTPARENTHESIS),
+    LL_BIT(LEFTPARENTHESIS),
+    LL_BIT(IDENTIFIER) | LL_BIT(REF),
+    LL_BIT(COMMA),
+    LL_BIT(IDENTIFIER) | LL_BIT(WHILE) | LL_BIT(IF) | LL_BIT(READ) | LL_BIT(WRITE),
+    LL_BIT(IDENTIFIER) | LL_BIT(WHILE) | LL_BIT(IF) | LL_BIT(READ) | LL_BIT(WRITE),
+    LL_BIT(IDENTIFIER),
+    LL_BIT(WHILE),
+    LL_BIT(IF),
+    LL_BIT(READ),
+    LL_BIT(WRITE),
+    LL_BIT(LEFTPARENTHESIS) | LL_BIT(ASSIGNMENT),
+    LL_BIT(LEFTPARENTHESIS),
+    LL_BIT(ASSIGNMENT),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+    LL_BIT(COMMA),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+    LL_BIT(ELSE),
+    LL_BIT(COMMA),
+    LL_BIT(COMMA),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+    LL_BIT(SUBTRACT) | LL_BIT(ADD),
+    LL_BIT(SUBTRACT) | LL_BIT(ADD),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+    LL_BIT(MULTIPLY) | LL_BIT(DIVIDE),
+    LL_BIT(MULTIPLY) | LL_BIT(DIVIDE),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(INTCONST),
+    LL_BIT(EQUALITY) | LL_BIT(LESSEQUAL) | LL_BIT(GREATEREQUAL) | LL_BIT(LESS) | LL_BIT(GREATER),
+};
+
+PRIVATE uint64_t Follow[] =
+{
+    0,
+    LL_BIT(PROCEDURE) | LL_BIT(BEGIN),
+    LL_BIT(BEGIN),
+    LL_BIT(SEMICOLON) | LL_BIT(ENDOFPROGRAM) | LL_BIT(ELSE),
+    LL_BIT(PROCEDURE) | LL_BIT(BEGIN),
+    LL_BIT(SEMICOLON),
+    LL_BIT(PROCEDURE) | LL_BIT(BEGIN),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS),
+    LL_BIT(RIGHTPARENTHESIS),
+    LL_BIT(END),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(SEMICOLON),
+    LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS),
+    LL_BIT(RIGHTPARENTHESIS),
+    LL_BIT(SEMICOLON) | LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS) | LL_BIT(DO) | LL_BIT(THEN) | LL_BIT(EQUALITY) | LL_BIT(LESSEQUAL) | LL_BIT(GREATEREQUAL) | LL_BIT(LESS) | LL_BIT(GREATER),
+    LL_BIT(DO) | LL_BIT(THEN),
+    LL_BIT(SEMICOLON),
+    LL_BIT(RIGHTPARENTHESIS),
+    LL_BIT(RIGHTPARENTHESIS),
+    LL_BIT(SEMICOLON) | LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS) | LL_BIT(DO) | LL_BIT(THEN) | LL_BIT(SUBTRACT) | LL_BIT(ADD) | LL_BIT(EQUALITY) | LL_BIT(LESSEQUAL) | LL_BIT(GREATEREQUAL) | LL_BIT(LESS) | LL_BIT(GREATER),
+    LL_BIT(SEMICOLON) | LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS) | LL_BIT(DO) | LL_BIT(THEN) | LL_BIT(EQUALITY) | LL_BIT(LESSEQUAL) | LL_BIT(GREATEREQUAL) | LL_BIT(LESS) | LL_BIT(GREATER),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+    LL_BIT(SEMICOLON) | LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS) | LL_BIT(DO) | LL_BIT(THEN) | LL_BIT(SUBTRACT) | LL_BIT(ADD) | LL_BIT(MULTIPLY) | LL_BIT(DIVIDE) | LL_BIT(EQUALITY) | LL_BIT(LESSEQUAL) | LL_BIT(GREATEREQUAL) | LL_BIT(LESS) | LL_BIT(GREATER),
+    LL_BIT(SEMICOLON) | LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS) | LL_BIT(DO) | LL_BIT(THEN) | LL_BIT(SUBTRACT) | LL_BIT(ADD) | LL_BIT(EQUALITY) | LL_BIT(LESSEQUAL) | LL_BIT(GREATEREQUAL) | LL_BIT(LESS) | LL_BIT(GREATER),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+    LL_BIT(SEMICOLON) | LL_BIT(COMMA) | LL_BIT(RIGHTPARENTHESIS) | LL_BIT(DO) | LL_BIT(THEN) | LL_BIT(SUBTRACT) | LL_BIT(ADD) | LL_BIT(MULTIPLY) | LL_BIT(DIVIDE) | LL_BIT(EQUALITY) | LL_BIT(LESSEQUAL) | LL_BIT(GREATEREQUAL) | LL_BIT(LESS) | LL_BIT(GREATER),
+    LL_BIT(IDENTIFIER) | LL_BIT(LEFTPARENTHESIS) | LL_BIT(SUBTRACT) | LL_BIT(INTCONST),
+};
+
+PRIVATE char *NonterminalNames[] =
+{
+    "Program",
+    "OptDeclarations",
+    "ProcDeclarations",
+    "Block",
+    "Declarations",
+    "MoreVariables",
+    "ProcDeclaration",
+    "OptParameterList",
+    "ParameterList",
+    "FormalParameter",
+    "MoreParameters",
+    "Statements",
+    "Statement",
+    "SimpleStatement",
+    "WhileStatement",
+    "IfStatement",
+    "ReadStatement",
+    "WriteStatement",
+    "RestOfStatement",
+    "ProcCallList",
+    "Assignment",
+    "ActualParameter",
+    "MoreActuals",
+    "Expression",
+    "BooleanExpression",
+    "ElsePart",
+    "MoreReadVariables",
+    "MoreExpressions",
+    "CompoundTerm",
+    "MoreTerms",
+    "AddOp",
+    "Term",
+    "MoreFactors",
+    "MultOp",
+    "SubTerm",
+    "RelOp",
+    NULL
+};
+
+PRIVATE char *ActionNames[] =
+{
+    "OpenScope",
+    "CloseScope",
+    "BeginProc",
+    "ProcName",
+    "EndProc",
+    NULL
+};
+
+PRIVATE LLGRAMMAR Grammar =
+{
+    LL_NONTERMINAL(0), 36, Productions, Rhs, Table, First, Follow, NonterminalNames, ActionNames
+};
+
+PUBLIC LLGRAMMAR *CplGrammar(void)
+{
+    return &Grammar;
+}
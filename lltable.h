@@ -0,0 +1,17 @@
+/*  Generated by llgen from cpl.grammar; do not edit.  */
+
+#ifndef LLTABLE_H
+#define LLTABLE_H
+
+#include "global.h"
+#include "llparse.h"
+
+#define LL_OPENSCOPE 0
+#define LL_CLOSESCOPE 1
+#define LL_BEGINPROC 2
+#define LL_PROCNAME 3
+#define LL_ENDPROC 4
+
+PUBLIC LLGRAMMAR *CplGrammar(void);
+
+#endif
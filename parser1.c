@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "code.h"
+#include "cplfuzz.h"
 #include "debug.h"
 #include "global.h"
 #include "line.h"
@@ -41,7 +42,9 @@ PRIVATE TOKEN CurrentToken; /*  Parser lookahead token.  Updated by  */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
+#ifndef CPL_FUZZ
 PRIVATE int OpenFiles(int argc, char *argv[]);
+#endif
 PRIVATE void ParseProgram(void);
 PRIVATE void ParseDeclarations(void);
 PRIVATE void ParseProcDeclaration(void);
@@ -69,6 +72,7 @@ PRIVATE void ParseRelOp(void);
 PRIVATE void Accept(int code);
 PRIVATE void ReadToEndOfFile(void);
 
+#ifndef CPL_FUZZ
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
 /*  Main: parser1 entry point.  Sets up parser globals (opens input and     */
@@ -92,6 +96,23 @@ PUBLIC int main(int argc, char *argv[])
     else
         return EXIT_FAILURE;
 }
+#else
+/*--------------------------------------------------------------------------*/
+/*  FuzzParse: main() for fuzz builds; see "cplfuzz.h".  Parses "input"    */
+/*  and returns 1 if it is valid.  A syntax error goes back to the harness */
+/*  through FuzzStop() instead of exiting; the harness owns both files.    */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int FuzzParse(FILE *input, FILE *list)
+{
+    InputFile = input;
+    ListFile = list;
+    InitCharProcessor(InputFile, ListFile);
+    CurrentToken = GetToken();
+    ParseProgram();
+    return 1;
+}
+#endif
 
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
@@ -863,6 +884,9 @@ PRIVATE void Accept(int ExpectedToken)
         SyntaxError(ExpectedToken, CurrentToken);
         printf("Syntax Error\n");
         ReadToEndOfFile();
+#ifdef CPL_FUZZ
+        FuzzStop();
+#endif
         fclose(InputFile);
         fclose(ListFile);
         exit(EXIT_FAILURE);
@@ -871,6 +895,7 @@ PRIVATE void Accept(int ExpectedToken)
         CurrentToken = GetToken();
 }
 
+#ifndef CPL_FUZZ
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
 /*  OpenFiles:  Reads strings from the command-line and opens the           */
@@ -919,6 +944,7 @@ PRIVATE int OpenFiles(int argc, char *argv[])
 
     return 1;
 }
+#endif
 
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "code.h"
+#include "cplfuzz.h"
 #include "debug.h"
 #include "global.h"
 #include "line.h"
@@ -41,7 +42,9 @@ PRIVATE TOKEN CurrentToken; /*  Parser lookahead token.  Updated by  */
 /*                                                                          */
 /*--------------------------------------------------------------------------*/
 
+#ifndef CPL_FUZZ
 PRIVATE int OpenFiles(int argc, char *argv[]);
+#endif
 PRIVATE void ParseProgram(void);
 PRIVATE void ParseDeclarations(void);
 PRIVATE void ParseProcDeclaration(void);
@@ -68,10 +71,18 @@ PRIVATE void ParseMultOp(void);
 PRIVATE void ParseRelOp(void);
 PRIVATE void Accept(int code);
 PRIVATE void Synchronise(SET *F, SET *FB);
+PRIVATE int ReportError(void);
+PRIVATE void GiveUp(void);
+
+#define MAX_ERRORS 100 /*  Errors reported before the parse gives up.  */
 
 int errCount = 0; /*Int that counts amount of errors received by parser*/
 int scope = 0;    /*Global scope*/
+PRIVATE int Recovering = 0; /*Set by Accept after an error, until it resyncs*/
+PRIVATE int Reported = 0;     /*Errors printed so far*/
+PRIVATE int LastErrorPos = -1; /*Offset of the last error printed*/
 
+#ifndef CPL_FUZZ
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
 /*  Main: parser2 entry point.  Sets up parser globals (opens input and     */
@@ -98,6 +109,29 @@ PUBLIC int main(int argc, char *argv[])
     else
         return EXIT_FAILURE;
 }
+#else
+/*--------------------------------------------------------------------------*/
+/*  FuzzParse: main() for fuzz builds; see "cplfuzz.h".  Parses "input"    */
+/*  and returns 1 if it is valid.  The parser state, and any symbols left  */
+/*  by a parse the harness cut short, are cleared first.                    */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int FuzzParse(FILE *input, FILE *list)
+{
+    InputFile = input;
+    ListFile = list;
+    errCount = 0;
+    scope = 0;
+    Recovering = 0;
+    Reported = 0;
+    LastErrorPos = -1;
+    RemoveSymbols(0);
+    InitCharProcessor(InputFile, ListFile);
+    CurrentToken = GetToken();
+    ParseProgram();
+    return errCount == 0;
+}
+#endif
 
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
@@ -322,7 +356,7 @@ PRIVATE void ParseBlock(void)
     SET StatementFS_aug_Block;
     SET StatementFBS_Block;
     InitSet(&StatementFS_aug_Block, 6, IDENTIFIER, WHILE, IF, READ, WRITE, END); /*First Set of Block*/
-    InitSet(&StatementFBS_Block, 4, ELSE, ENDOFPROGRAM, ENDOFINPUT);             /*Follow + Beacon Set of Block*/
+    InitSet(&StatementFBS_Block, 3, ELSE, ENDOFPROGRAM, ENDOFINPUT);             /*Follow + Beacon Set of Block*/
                                                                                  /*Setup Sets End*/
     Accept(BEGIN);
     scope++;
@@ -904,24 +938,27 @@ PRIVATE void ParseRelOp(void)
 
 PRIVATE void Accept(int ExpectedToken)
 {
-    static int recovering = 0;
-    if (recovering)
+    if (Recovering)
     {
         while (CurrentToken.code != ExpectedToken && CurrentToken.code != ENDOFINPUT)
             CurrentToken = GetToken();
-        recovering = 0;
+        Recovering = 0;
     }
     if (CurrentToken.code != ExpectedToken)
     {
-        printf("Syntax Error\n");
-        SyntaxError(ExpectedToken, CurrentToken);
+        if (ReportError())
+        {
+            printf("Syntax Error\n");
+            SyntaxError(ExpectedToken, CurrentToken);
+        }
         errCount++;
-        recovering = 1;
+        Recovering = 1;
     }
     else
         CurrentToken = GetToken();
 }
 
+#ifndef CPL_FUZZ
 /*--------------------------------------------------------------------------*/
 /*                                                                          */
 /*  OpenFiles:  Reads strings from the command-line and opens the           */
@@ -970,6 +1007,7 @@ PRIVATE int OpenFiles(int argc, char *argv[])
 
     return 1;
 }
+#endif
 
 /*Syncronise function which is used for the augmented error recovery*/
 PRIVATE void Synchronise(SET *F, SET *FB)
@@ -979,10 +1017,48 @@ PRIVATE void Synchronise(SET *F, SET *FB)
     S = Union(2, F, FB);
     if (!InSet(F, CurrentToken.code))
     {
-        SyntaxError2(*F, CurrentToken);
-        while (!InSet(&S, CurrentToken.code))
+        if (ReportError())
+            SyntaxError2(*F, CurrentToken);
+        errCount++;
+        while (!InSet(&S, CurrentToken.code) && CurrentToken.code != ENDOFINPUT)
         {
             CurrentToken = GetToken();
         }
     }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReportError: Returns 1 if an error at the lookahead should be printed.  */
+/*  One at the same offset as the last error is part of the same cascade    */
+/*  and isn't; one past the MAX_ERRORS'th ends the parse.                   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReportError(void)
+{
+    if (CurrentToken.pos == LastErrorPos)
+        return 0;
+    if (Reported == MAX_ERRORS)
+        GiveUp();
+    LastErrorPos = CurrentToken.pos;
+    Reported++;
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  GiveUp: Stops parsing a program with too many errors to be worth        */
+/*  reporting.  The rest of the input is still read, so that the listing    */
+/*  is complete, and the exit status is a failure, as for parser1.          */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void GiveUp(void)
+{
+    Error("Too many errors; parsing stopped", CurrentToken.pos);
+    while (CurrentToken.code != ENDOFINPUT)
+        CurrentToken = GetToken();
+#ifdef CPL_FUZZ
+    FuzzStop();
+#endif
+    fclose(InputFile);
+    fclose(ListFile);
+    exit(EXIT_FAILURE);
 }
\ No newline at end of file
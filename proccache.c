@@ -0,0 +1,462 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       proccache.c                                                        */
+/*                                                                          */
+/*       Per-procedure code cache for incremental recompilation.  See      */
+/*       "proccache.h".                                                     */
+/*                                                                          */
+/*       The cache file is plain text:                                      */
+/*                                                                          */
+/*           CPLPCACHE 3                                                    */
+/*           PROC <name> <fingerprint> <count> <entry> <nested> <symbols>   */
+/*           NESTED <name> <start> <entry> <end>                            */
+/*           ...                                                            */
+/*           SYMBOL <kind> <depth> <address> <owner> <name>                 */
+/*           ...                                                            */
+/*           <op> <operand> <hasOperand> <reloc> <pos> <callee or "-">      */
+/*           ...                                                            */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "code.h"
+#include "codebuf.h"
+#include "global.h"
+#include "proccache.h"
+#include "symbol.h"
+
+#define PCACHE_MAGIC "CPLPCACHE"
+#define PCACHE_VERSION 3
+#define MAXNAME 256
+
+/*--------------------------------------------------------------------------*/
+/*  Hashing: 64-bit FNV-1a.                                                 */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC FINGERPRINT HashBytes(FINGERPRINT h, void *bytes, size_t n)
+{
+    unsigned char *p = bytes;
+
+    while (n-- > 0)
+    {
+        h ^= *p++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+PUBLIC FINGERPRINT HashInt(FINGERPRINT h, int value)
+{
+    return HashBytes(h, &value, sizeof(value));
+}
+
+PUBLIC FINGERPRINT HashString(FINGERPRINT h, char *s)
+{
+    return HashBytes(h, s, strlen(s) + 1);
+}
+
+PRIVATE char *CopyName(char *s)
+{
+    char *copy;
+
+    if (NULL == (copy = malloc(strlen(s) + 1)))
+    {
+        fprintf(stderr, "out of memory in procedure cache\n");
+        exit(EXIT_FAILURE);
+    }
+    return strcpy(copy, s);
+}
+
+PUBLIC void FreeProcEntry(PCENTRY *entry)
+{
+    int i;
+
+    for (i = 0; i < entry->count; i++)
+        free(entry->code[i].callee);
+    for (i = 0; i < entry->nestedCount; i++)
+        free(entry->nested[i].name);
+    free(entry->nested);
+    for (i = 0; i < entry->symbolCount; i++)
+        free(entry->symbols[i].name);
+    free(entry->symbols);
+    free(entry->code);
+    free(entry->name);
+    free(entry);
+}
+
+PUBLIC void InitProcCache(PROCCACHE *pc)
+{
+    pc->entries = NULL;
+    pc->hits = 0;
+    pc->misses = 0;
+}
+
+PUBLIC void FreeProcCache(PROCCACHE *pc)
+{
+    PCENTRY *entry, *next;
+
+    for (entry = pc->entries; entry != NULL; entry = next)
+    {
+        next = entry->next;
+        FreeProcEntry(entry);
+    }
+    pc->entries = NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReadProcEntry: Reads one entry in the format written by WriteProcEntry. */
+/*  Returns 1 with "*result" set, 0 at the end of the entries, or -1 if    */
+/*  the entry is malformed.                                                 */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int ReadProcEntry(FILE *f, PCENTRY **result)
+{
+    PCENTRY *entry;
+    char name[MAXNAME], callee[MAXNAME];
+    PCPROC *p;
+    CODESYMBOL *sym;
+    int i, nested, symbols;
+
+    if (NULL == (entry = calloc(1, sizeof(PCENTRY))))
+        return -1;
+    if (fscanf(f, " PROC %255s %llx %d %d %d %d", name, &entry->fingerprint, &entry->count,
+               &entry->entry, &nested, &symbols) != 6 ||
+        entry->count < 0 || entry->entry < 0 || entry->entry > entry->count || nested < 0 || symbols < 0 ||
+        NULL == (entry->code = calloc(entry->count + 1, sizeof(PCINSTRUCTION))) ||
+        NULL == (entry->nested = calloc(nested + 1, sizeof(PCPROC))) ||
+        NULL == (entry->symbols = calloc(symbols + 1, sizeof(CODESYMBOL))))
+    {
+        free(entry->code);
+        free(entry->nested);
+        free(entry);
+        return 0;
+    }
+    entry->name = CopyName(name);
+
+    for (; entry->nestedCount < nested; entry->nestedCount++)
+    {
+        p = &entry->nested[entry->nestedCount];
+        if (fscanf(f, " NESTED %255s %d %d %d", callee, &p->start, &p->entry, &p->end) != 4 ||
+            p->start < 0 || p->start > p->entry || p->entry > p->end || p->end > entry->count)
+        {
+            FreeProcEntry(entry);
+            return -1;
+        }
+        p->name = CopyName(callee);
+    }
+
+    for (; entry->symbolCount < symbols; entry->symbolCount++)
+    {
+        sym = &entry->symbols[entry->symbolCount];
+        if (fscanf(f, " SYMBOL %d %d %d %d %255s", &sym->kind, &sym->depth, &sym->address,
+                   &sym->owner, callee) != 5 ||
+            sym->owner < -1 || sym->owner >= entry->symbolCount)
+        {
+            FreeProcEntry(entry);
+            return -1;
+        }
+        sym->name = CopyName(callee);
+    }
+
+    for (i = 0; i < entry->count; i++)
+    {
+        if (fscanf(f, "%d %d %d %d %d %255s", &entry->code[i].op, &entry->code[i].operand,
+                   &entry->code[i].hasOperand, &entry->code[i].reloc, &entry->code[i].pos, callee) != 6)
+            break;
+        if (entry->code[i].reloc == RELOC_CALL || strcmp(callee, "-") != 0)
+            entry->code[i].callee = CopyName(callee);
+    }
+    if (i < entry->count)
+    {
+        entry->count = i;
+        FreeProcEntry(entry);
+        return -1;
+    }
+
+    *result = entry;
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  WriteProcEntry: Writes one entry as a PROC line followed by its nested */
+/*  procedures, its symbols and its code.                                   */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void WriteProcEntry(FILE *f, PCENTRY *entry)
+{
+    PCINSTRUCTION *ins;
+    int i;
+
+    fprintf(f, "PROC %s %llx %d %d %d %d\n", entry->name, entry->fingerprint, entry->count,
+            entry->entry, entry->nestedCount, entry->symbolCount);
+    for (i = 0; i < entry->nestedCount; i++)
+        fprintf(f, "NESTED %s %d %d %d\n", entry->nested[i].name, entry->nested[i].start,
+                entry->nested[i].entry, entry->nested[i].end);
+    for (i = 0; i < entry->symbolCount; i++)
+        fprintf(f, "SYMBOL %d %d %d %d %s\n", entry->symbols[i].kind, entry->symbols[i].depth,
+                entry->symbols[i].address, entry->symbols[i].owner, entry->symbols[i].name);
+    for (i = 0; i < entry->count; i++)
+    {
+        ins = &entry->code[i];
+        fprintf(f, "%d %d %d %d %d %s\n", ins->op, ins->operand, ins->hasOperand,
+                ins->reloc, ins->pos, ins->callee != NULL ? ins->callee : "-");
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  LoadProcCache: Reads a cache file written by SaveProcCache.  A missing */
+/*  file is an empty cache; a malformed one is discarded.  Returns 1 if    */
+/*  the file was read.                                                      */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int LoadProcCache(PROCCACHE *pc, char *path)
+{
+    FILE *f;
+    PCENTRY *entry;
+    char magic[16];
+    int version, status;
+
+    if (NULL == (f = fopen(path, "r")))
+        return 0;
+
+    if (fscanf(f, "%15s %d", magic, &version) != 2 ||
+        strcmp(magic, PCACHE_MAGIC) != 0 || version != PCACHE_VERSION)
+    {
+        fclose(f);
+        return 0;
+    }
+
+    while (1 == (status = ReadProcEntry(f, &entry)))
+    {
+        entry->next = pc->entries;
+        pc->entries = entry;
+    }
+    if (status < 0)
+        FreeProcCache(pc);
+
+    fclose(f);
+    return 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  SaveProcCache: Writes out the entries used during this build, so that  */
+/*  procedures which have been deleted or changed drop out of the cache.   */
+/*  The file is written under a temporary name and renamed into place, so  */
+/*  an interrupted build never leaves a half-written cache behind.          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int SaveProcCache(PROCCACHE *pc, char *path)
+{
+    FILE *f;
+    PCENTRY *entry;
+    char *temp;
+    int ok;
+
+    if (NULL == (temp = malloc(strlen(path) + 5)))
+        return 0;
+    sprintf(temp, "%s.tmp", path);
+
+    if (NULL == (f = fopen(temp, "w")))
+    {
+        free(temp);
+        return 0;
+    }
+
+    fprintf(f, "%s %d\n", PCACHE_MAGIC, PCACHE_VERSION);
+    for (entry = pc->entries; entry != NULL; entry = entry->next)
+    {
+        if (entry->used)
+            WriteProcEntry(f, entry);
+    }
+
+    ok = !ferror(f);
+    if (fclose(f) != 0)
+        ok = 0;
+    if (ok)
+        ok = rename(temp, path) == 0;
+    else
+        remove(temp);
+    free(temp);
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  LookupProcCache: Returns the entry for "name" if its fingerprint       */
+/*  matches, NULL otherwise.  Counts hits and misses.                       */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC PCENTRY *LookupProcCache(PROCCACHE *pc, char *name, FINGERPRINT fp)
+{
+    PCENTRY *entry;
+
+    for (entry = pc->entries; entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->name, name) == 0 && entry->fingerprint == fp)
+        {
+            entry->used = 1;
+            pc->hits++;
+            return entry;
+        }
+    }
+    pc->misses++;
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  StoreProcCache: Records the code in [start, end) of the buffer as the  */
+/*  body of procedure "name", whose calls land at "entryAddress",          */
+/*  replacing any older entry for it.  Branches into the range become      */
+/*  RELOC_LOCAL, calls become RELOC_CALL and source offsets are made       */
+/*  relative to "origin".  "nested" are the procedure table entries of the */
+/*  procedures declared inside it.  Returns the new entry, or NULL if      */
+/*  there was no memory for it.                                             */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC PCENTRY *StoreProcCache(PROCCACHE *pc, char *name, FINGERPRINT fp,
+                           CODEBUF *cb, int start, int entryAddress, int end, int origin,
+                           CODEPROC *nested, int nestedCount)
+{
+    PCENTRY *entry, **link;
+    PCINSTRUCTION *ins;
+    INSTRUCTION *src;
+    int i;
+
+    for (link = &pc->entries; *link != NULL;)
+    {
+        if (strcmp((*link)->name, name) == 0)
+        {
+            entry = *link;
+            *link = entry->next;
+            FreeProcEntry(entry);
+        }
+        else
+            link = &(*link)->next;
+    }
+
+    if (NULL == (entry = calloc(1, sizeof(PCENTRY))) ||
+        NULL == (entry->code = calloc(end - start + 1, sizeof(PCINSTRUCTION))) ||
+        NULL == (entry->nested = calloc(nestedCount + 1, sizeof(PCPROC))))
+    {
+        if (entry != NULL)
+            free(entry->code);
+        free(entry);
+        return NULL;
+    }
+    entry->name = CopyName(name);
+    entry->fingerprint = fp;
+    entry->count = end - start;
+    entry->entry = entryAddress - start;
+    entry->used = 1;
+    for (i = 0; i < nestedCount; i++)
+    {
+        entry->nested[i].name = CopyName(nested[i].name);
+        entry->nested[i].start = nested[i].start - start;
+        entry->nested[i].entry = nested[i].entry - start;
+        entry->nested[i].end = nested[i].end - start;
+    }
+    entry->nestedCount = nestedCount;
+
+    for (i = 0; i < entry->count; i++)
+    {
+        src = BufferInstruction(cb, start + i);
+        ins = &entry->code[i];
+        ins->op = src->op;
+        ins->operand = src->operand;
+        ins->hasOperand = src->hasOperand;
+        ins->pos = src->pos >= origin ? src->pos - origin : -1;
+        ins->reloc = RELOC_NONE;
+        if (src->op == I_CALL && src->target != NULL)
+        {
+            ins->reloc = RELOC_CALL;
+            ins->callee = CopyName(src->target);
+        }
+        else if (IsBranchOp(src->op) && src->operand >= start && src->operand <= end)
+        {
+            ins->reloc = RELOC_LOCAL;
+            ins->operand = src->operand - start;
+        }
+    }
+
+    entry->next = pc->entries;
+    pc->entries = entry;
+    return entry;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  StoreProcSymbols: Adds the debug symbols a procedure declared, the     */
+/*  "count" from "first" on with its own first, to its entry.  Entry       */
+/*  points are made relative to "start" and owners to "first"; an owner    */
+/*  before "first" becomes -1, for whatever encloses the procedure when    */
+/*  it is replayed.                                                         */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void StoreProcSymbols(PCENTRY *entry, CODESYMBOL *symbols, int first, int count, int start)
+{
+    CODESYMBOL *sym;
+    int i;
+
+    if (count <= 0 || NULL == (entry->symbols = calloc(count, sizeof(CODESYMBOL))))
+        return;
+    for (i = 0; i < count; i++)
+    {
+        sym = &entry->symbols[i];
+        *sym = symbols[first + i];
+        sym->name = CopyName(sym->name);
+        sym->owner = sym->owner >= first ? sym->owner - first : -1;
+        if (sym->kind == STYPE_PROCEDURE && sym->address >= 0)
+            sym->address -= start;
+    }
+    entry->symbolCount = count;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReplayProcCache: Appends a cached procedure body to the buffer,        */
+/*  relocating it to the current address and its source offsets to         */
+/*  "origin".  Returns 0, without emitting anything, if a callee can no    */
+/*  longer be resolved.                                                     */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int ReplayProcCache(PCENTRY *entry, CODEBUF *cb, int origin)
+{
+    SYMBOL *callee;
+    PCINSTRUCTION *ins;
+    int base, saved, i;
+
+    for (i = 0; i < entry->count; i++)
+    {
+        ins = &entry->code[i];
+        if (ins->reloc == RELOC_CALL &&
+            (NULL == (callee = Probe(ins->callee, NULL)) || callee->type != STYPE_PROCEDURE))
+            return 0;
+    }
+
+    base = BufferAddress(cb);
+    saved = cb->pos;
+    for (i = 0; i < entry->count; i++)
+    {
+        ins = &entry->code[i];
+        cb->pos = ins->pos >= 0 ? origin + ins->pos : -1;
+        if (ins->reloc == RELOC_CALL)
+        {
+            callee = Probe(ins->callee, NULL);
+            BufferEmit(cb, ins->op, callee->address);
+            BufferInstruction(cb, base + i)->target = callee->s;
+        }
+        else if (ins->reloc == RELOC_LOCAL)
+            BufferEmit(cb, ins->op, base + ins->operand);
+        else if (ins->hasOperand)
+            BufferEmit(cb, ins->op, ins->operand);
+        else
+            BufferEmitOp(cb, ins->op);
+    }
+    cb->pos = saved;
+    return 1;
+}
@@ -0,0 +1,100 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       proccache.h                                                        */
+/*                                                                          */
+/*       Per-procedure code cache for incremental recompilation.  Each     */
+/*       entry holds the code generated for one top-level procedure, keyed  */
+/*       by the procedure's name and a fingerprint of its tokens and of     */
+/*       the outer symbols it refers to.  Branch targets are stored         */
+/*       relative to the start of the procedure and CALL targets by name,   */
+/*       so cached code can be relocated to wherever the procedure lands    */
+/*       in the next build.  Source offsets are stored relative to the      */
+/*       procedure's "origin", the first token after its name.  The ranges  */
+/*       of nested procedures are kept too, for the procedure table, and    */
+/*       under --debug the symbols the procedure declares.                  */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef PROCCACHE_H
+#define PROCCACHE_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "codebuf.h"
+#include "cplbin.h"
+#include "global.h"
+
+#define RELOC_NONE 0  /*  Operand used as is.                        */
+#define RELOC_LOCAL 1 /*  Operand is an offset from procedure start. */
+#define RELOC_CALL 2  /*  Operand is the address of "callee".        */
+
+typedef unsigned long long FINGERPRINT;
+
+#define FINGERPRINT_SEED 14695981039346656037ULL /*  FNV-1a offset basis. */
+
+typedef struct
+{
+    int op;
+    int operand;
+    int hasOperand;
+    int reloc;
+    int pos;      /*  Source offset from the origin, or -1.           */
+    char *callee; /*  Name an I_CALL calls, or NULL.                  */
+} PCINSTRUCTION;
+
+typedef struct
+{
+    char *name;
+    int start;    /*  Offsets from the start of the enclosing entry.  */
+    int entry;
+    int end;
+} PCPROC;
+
+typedef struct pcentry
+{
+    char *name;
+    FINGERPRINT fingerprint;
+    int count;
+    int entry; /*  Offset calls land at; nested procedures come first. */
+    PCINSTRUCTION *code;
+    int nestedCount;
+    PCPROC *nested; /*  Nested procedures, in procedure table order. */
+    int symbolCount;
+    CODESYMBOL *symbols; /*  Debug symbols, the procedure's own first; */
+                         /*  owners are indices into this array.        */
+    int used; /*  Looked up or stored during this build.     */
+    struct pcentry *next;
+} PCENTRY;
+
+typedef struct
+{
+    PCENTRY *entries;
+    int hits;
+    int misses;
+} PROCCACHE;
+
+PUBLIC FINGERPRINT HashBytes(FINGERPRINT h, void *bytes, size_t n);
+PUBLIC FINGERPRINT HashInt(FINGERPRINT h, int value);
+PUBLIC FINGERPRINT HashString(FINGERPRINT h, char *s);
+
+PUBLIC void InitProcCache(PROCCACHE *pc);
+PUBLIC int ReadProcEntry(FILE *f, PCENTRY **result);
+PUBLIC void WriteProcEntry(FILE *f, PCENTRY *entry);
+PUBLIC void FreeProcEntry(PCENTRY *entry);
+PUBLIC int LoadProcCache(PROCCACHE *pc, char *path);
+PUBLIC int SaveProcCache(PROCCACHE *pc, char *path);
+PUBLIC void FreeProcCache(PROCCACHE *pc);
+PUBLIC PCENTRY *LookupProcCache(PROCCACHE *pc, char *name, FINGERPRINT fp);
+PUBLIC PCENTRY *StoreProcCache(PROCCACHE *pc, char *name, FINGERPRINT fp,
+                           CODEBUF *cb, int start, int entryAddress, int end, int origin,
+                           CODEPROC *nested, int nestedCount);
+PUBLIC void StoreProcSymbols(PCENTRY *entry, CODESYMBOL *symbols, int first, int count, int start);
+PUBLIC int ReplayProcCache(PCENTRY *entry, CODEBUF *cb, int origin);
+
+#endif
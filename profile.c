@@ -0,0 +1,211 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       profile.c                                                          */
+/*                                                                          */
+/*       Reader for the execution counts of "cplprof --counts".  See        */
+/*       "profile.h".                                                       */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "profile.h"
+
+#define MAXLINE 512
+
+PRIVATE void *Grow(void *array, int count, int *capacity, size_t size)
+{
+    void *grown;
+
+    if (count < *capacity)
+        return array;
+    *capacity = *capacity > 0 ? *capacity * 2 : 64;
+    if (NULL == (grown = realloc(array, *capacity * size)))
+    {
+        fprintf(stderr, "out of memory reading profile\n");
+        exit(EXIT_FAILURE);
+    }
+    return grown;
+}
+
+PRIVATE int ByStart(const void *a, const void *b)
+{
+    return ((PROFBLOCK *)a)->start - ((PROFBLOCK *)b)->start;
+}
+
+PRIVATE int ByFrom(const void *a, const void *b)
+{
+    PROFEDGE *x = (PROFEDGE *)a, *y = (PROFEDGE *)b;
+
+    return x->from != y->from ? x->from - y->from : x->to - y->to;
+}
+
+PRIVATE int ByName(const void *a, const void *b)
+{
+    return strcmp(((PROFPROC *)a)->name, ((PROFPROC *)b)->name);
+}
+
+PUBLIC void InitProfile(PROFILE *p)
+{
+    memset(p, 0, sizeof(PROFILE));
+}
+
+PUBLIC void FreeProfile(PROFILE *p)
+{
+    int i;
+
+    for (i = 0; i < p->procCount; i++)
+        free(p->procs[i].name);
+    free(p->procs);
+    free(p->blocks);
+    free(p->edges);
+    InitProfile(p);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  ReadProfile:  Reads a profile written by "cplprof --counts".            */
+/*                                                                          */
+/*    The tables are sorted for the lookups below, and "hot" is set from    */
+/*    the busiest block.  Lines of a kind this version does not know are    */
+/*    skipped, so later versions can add to the format.                     */
+/*                                                                          */
+/*    Inputs:       1) Path of the profile.                                 */
+/*                  2) Profile, initialised with InitProfile().             */
+/*                                                                          */
+/*    Outputs:      The profile, to be released with FreeProfile().         */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0)          */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int ReadProfile(char *path, PROFILE *p)
+{
+    FILE *f;
+    char line[MAXLINE], magic[16], name[MAXLINE];
+    int version, blockCapacity = 0, edgeCapacity = 0, procCapacity = 0, a, b, ok = 1, i;
+    long long count, busiest = 0;
+
+    if (NULL == (f = fopen(path, "r")))
+        return 0;
+    p->fingerprint = FINGERPRINT_SEED;
+    if (NULL == fgets(line, MAXLINE, f) || sscanf(line, "%15s %d %d", magic, &version, &p->codeCount) != 3 ||
+        strcmp(magic, PROFILE_MAGIC) != 0 || version != PROFILE_VERSION)
+    {
+        fclose(f);
+        return 0;
+    }
+    p->fingerprint = HashString(p->fingerprint, line);
+
+    while (ok && NULL != fgets(line, MAXLINE, f))
+    {
+        p->fingerprint = HashString(p->fingerprint, line);
+        if (sscanf(line, "block %d %d %lld", &a, &b, &count) == 3)
+        {
+            p->blocks = Grow(p->blocks, p->blockCount, &blockCapacity, sizeof(PROFBLOCK));
+            p->blocks[p->blockCount].start = a;
+            p->blocks[p->blockCount].end = b;
+            p->blocks[p->blockCount++].count = count;
+            if (count > busiest)
+                busiest = count;
+        }
+        else if (sscanf(line, "edge %d %d %lld", &a, &b, &count) == 3)
+        {
+            p->edges = Grow(p->edges, p->edgeCount, &edgeCapacity, sizeof(PROFEDGE));
+            p->edges[p->edgeCount].from = a;
+            p->edges[p->edgeCount].to = b;
+            p->edges[p->edgeCount++].count = count;
+        }
+        else if (sscanf(line, "proc %d %lld %s", &a, &count, name) == 3)
+        {
+            p->procs = Grow(p->procs, p->procCount, &procCapacity, sizeof(PROFPROC));
+            if (NULL == (p->procs[p->procCount].name = malloc(strlen(name) + 1)))
+            {
+                fprintf(stderr, "out of memory reading profile\n");
+                exit(EXIT_FAILURE);
+            }
+            strcpy(p->procs[p->procCount].name, name);
+            p->procs[p->procCount].entry = a;
+            p->procs[p->procCount++].calls = count;
+        }
+        else
+            ok = strchr(line, '\n') != NULL;
+    }
+    ok = ok && !ferror(f);
+    fclose(f);
+
+    qsort(p->blocks, p->blockCount, sizeof(PROFBLOCK), ByStart);
+    qsort(p->edges, p->edgeCount, sizeof(PROFEDGE), ByFrom);
+    qsort(p->procs, p->procCount, sizeof(PROFPROC), ByName);
+    for (i = 1; i < p->blockCount; i++)
+        ok = ok && p->blocks[i - 1].end <= p->blocks[i].start;
+    p->hot = busiest / PROFILE_HOT_SHARE > 0 ? busiest / PROFILE_HOT_SHARE : 1;
+    return ok;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  BlockCount: How often the block holding "address" was entered, or 0 if */
+/*  the run never reached it.                                               */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC long long BlockCount(PROFILE *p, int address)
+{
+    int low = 0, high = p->blockCount - 1, mid;
+
+    while (low <= high)
+    {
+        mid = (low + high) / 2;
+        if (address < p->blocks[mid].start)
+            high = mid - 1;
+        else if (address >= p->blocks[mid].end)
+            low = mid + 1;
+        else
+            return p->blocks[mid].count;
+    }
+    return 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ProfileEdges: The edges out of the instruction at "from", by target,   */
+/*  and how many there are; NULL and 0 if control never left it.            */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC PROFEDGE *ProfileEdges(PROFILE *p, int from, int *count)
+{
+    int low = 0, high = p->edgeCount, mid, first;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (p->edges[mid].from < from)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    first = low;
+    while (low < p->edgeCount && p->edges[low].from == from)
+        low++;
+    *count = low - first;
+    return *count > 0 ? &p->edges[first] : NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ProfileCalls: How often the procedure "name" was called, 0 if never.   */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC long long ProfileCalls(PROFILE *p, char *name)
+{
+    PROFPROC key, *found;
+
+    key.name = name;
+    found = p->procCount > 0 ? bsearch(&key, p->procs, p->procCount, sizeof(PROFPROC), ByName) : NULL;
+    return found != NULL ? found->calls : 0;
+}
@@ -0,0 +1,89 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       profile.h                                                          */
+/*                                                                          */
+/*       Execution counts for profile-guided compilation.  "cplprof         */
+/*       --counts" writes them from a run of a binary code file, and        */
+/*       "comp1 --profile" reads them back to lay out, inline and unroll    */
+/*       the code it generates for the same program:                       */
+/*                                                                          */
+/*           comp1 --format binary prog.prog prog.lst prog.bin              */
+/*           cplprof --counts prog.counts prog.bin < input                  */
+/*           comp1 --format binary --profile prog.counts prog.prog \        */
+/*                 prog.lst prog.bin                                        */
+/*                                                                          */
+/*       Addresses are those of the profiled code, so the profile must be   */
+/*       taken from a build without --profile, --unroll or --dead-code.     */
+/*       The file is plain text:                                            */
+/*                                                                          */
+/*           CPLPROFILE 1 <codeCount>                                       */
+/*           proc <entry> <calls> <name>                                    */
+/*           block <start> <end> <count>                                    */
+/*           edge <from> <to> <count>                                       */
+/*                                                                          */
+/*       A block is a run of code entered only at its start; its count is   */
+/*       how often it was.  An edge is a transfer of control from the last  */
+/*       instruction of a block, at "from", to another block: a branch      */
+/*       taken or not taken, or a fall into the next block.  Only blocks,   */
+/*       edges and procedures the run reached are listed.                   */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "global.h"
+#include "proccache.h"
+
+#define PROFILE_MAGIC "CPLPROFILE"
+#define PROFILE_VERSION 1
+#define PROFILE_HOT_SHARE 64 /*  Hot: at least 1/64th of the busiest block. */
+
+typedef struct
+{
+    int start;
+    int end;
+    long long count;
+} PROFBLOCK;
+
+typedef struct
+{
+    int from;
+    int to;
+    long long count;
+} PROFEDGE;
+
+typedef struct
+{
+    char *name;
+    int entry;
+    long long calls;
+} PROFPROC;
+
+typedef struct
+{
+    int codeCount;         /*  Size of the profiled code.               */
+    PROFBLOCK *blocks;     /*  By start.                                */
+    int blockCount;
+    PROFEDGE *edges;       /*  By "from", then "to".                    */
+    int edgeCount;
+    PROFPROC *procs;       /*  By name.                                 */
+    int procCount;
+    long long hot;         /*  Count from which code is worth growing.  */
+    FINGERPRINT fingerprint; /*  Of the whole file.                     */
+} PROFILE;
+
+PUBLIC void InitProfile(PROFILE *p);
+PUBLIC void FreeProfile(PROFILE *p);
+PUBLIC int ReadProfile(char *path, PROFILE *p);
+PUBLIC long long BlockCount(PROFILE *p, int address);
+PUBLIC PROFEDGE *ProfileEdges(PROFILE *p, int from, int *count);
+PUBLIC long long ProfileCalls(PROFILE *p, char *name);
+
+#endif
@@ -0,0 +1,202 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       serve.c                                                            */
+/*                                                                          */
+/*       Compile server on a Unix domain socket.  See "serve.h".           */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "global.h"
+#include "serve.h"
+
+PRIVATE volatile sig_atomic_t Stopping; /*  Set by SIGINT or SIGTERM.  */
+
+PRIVATE void Stop(int signo)
+{
+    Stopping = 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ReadFully, WriteFully: Transfer exactly "n" bytes, retrying after      */
+/*  short transfers and signals.  ReadFully returns 0 at end of file or    */
+/*  on error.                                                               */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int ReadFully(int fd, void *buffer, size_t n)
+{
+    char *p = buffer;
+    ssize_t got;
+
+    while (n > 0)
+    {
+        if ((got = read(fd, p, n)) < 0 && errno == EINTR && !Stopping)
+            continue;
+        if (got <= 0)
+            return 0;
+        p += got;
+        n -= got;
+    }
+    return 1;
+}
+
+PRIVATE int WriteFully(int fd, void *buffer, size_t n)
+{
+    char *p = buffer;
+    ssize_t put;
+
+    while (n > 0)
+    {
+        if ((put = write(fd, p, n)) < 0 && errno == EINTR)
+            continue;
+        if (put <= 0)
+            return 0;
+        p += put;
+        n -= put;
+    }
+    return 1;
+}
+
+PRIVATE int WriteLength(int fd, size_t n)
+{
+    unsigned int word = htonl((unsigned int)n);
+
+    return WriteFully(fd, &word, sizeof(word));
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ServeConnection: Answers requests on one connection until the client   */
+/*  closes it or sends something malformed.                                 */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ServeConnection(int fd, SERVEFN compile, void *arg,
+                             char **source, size_t *capacity)
+{
+    SERVEREPLY reply;
+    unsigned int word;
+    size_t length;
+    char *grown;
+
+    while (!Stopping && ReadFully(fd, &word, sizeof(word)))
+    {
+        if ((length = ntohl(word)) > MAXREQUEST)
+            return;
+        if (length + 1 > *capacity)
+        {
+            if (NULL == (grown = realloc(*source, length + 1)))
+                return;
+            *source = grown;
+            *capacity = length + 1;
+        }
+        if (!ReadFully(fd, *source, length))
+            return;
+        (*source)[length] = '\0';
+
+        memset(&reply, 0, sizeof(reply));
+        if (!compile(arg, *source, length, &reply))
+            return;
+        if (!WriteLength(fd, reply.status) ||
+            !WriteLength(fd, reply.codeLength) ||
+            !WriteLength(fd, reply.diagnosticsLength) ||
+            !WriteLength(fd, reply.listingLength) ||
+            !WriteFully(fd, reply.code, reply.codeLength) ||
+            !WriteFully(fd, reply.diagnostics, reply.diagnosticsLength) ||
+            !WriteFully(fd, reply.listing, reply.listingLength))
+            return;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  Serve:  Listens on the socket at "path" and hands every request to      */
+/*          "compile" until SIGINT or SIGTERM arrives.                      */
+/*                                                                          */
+/*    A stale socket left at "path" by an earlier server is replaced; any   */
+/*    other kind of file there is an error.                                 */
+/*                                                                          */
+/*    Inputs:       1) Path of the socket.                                  */
+/*                  2) Compile function and its argument.                   */
+/*                                                                          */
+/*    Outputs:      None                                                    */
+/*                                                                          */
+/*    Returns:      1 after a clean shutdown, 0 if the socket could not     */
+/*                  be set up.                                              */
+/*                                                                          */
+/*    Side Effects: Creates and finally removes the socket.  SIGPIPE is     */
+/*                  ignored, so a client going away cannot kill the server. */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int Serve(char *path, SERVEFN compile, void *arg)
+{
+    struct sockaddr_un address;
+    struct sigaction action;
+    struct stat info;
+    char *source = NULL;
+    size_t capacity = 0;
+    int listener, fd;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "socket path \"%s\" is too long\n", path);
+        return 0;
+    }
+    if (lstat(path, &info) == 0)
+    {
+        if (!S_ISSOCK(info.st_mode))
+        {
+            fprintf(stderr, "\"%s\" exists and is not a socket\n", path);
+            return 0;
+        }
+        unlink(path);
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+        bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0)
+    {
+        fprintf(stderr, "cannot listen on \"%s\"\n", path);
+        if (listener >= 0)
+            close(listener);
+        return 0;
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = Stop; /*  No SA_RESTART, so accept() returns.  */
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    Stopping = 0;
+    while (!Stopping)
+    {
+        if ((fd = accept(listener, NULL, NULL)) < 0)
+            continue;
+        ServeConnection(fd, compile, arg, &source, &capacity);
+        close(fd);
+    }
+
+    close(listener);
+    unlink(path);
+    free(source);
+    return 1;
+}
@@ -0,0 +1,53 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       serve.h                                                            */
+/*                                                                          */
+/*       Compile server on a Unix domain socket, for clients that issue     */
+/*       many small compiles and cannot afford a process start for each.   */
+/*       Requests are handled one at a time, because the scanner, symbol   */
+/*       table and code generator are single instances per process; the    */
+/*       compiler's own state stays allocated between requests.             */
+/*                                                                          */
+/*       A connection carries any number of requests.  All lengths are      */
+/*       32-bit unsigned integers in network byte order.                    */
+/*                                                                          */
+/*           Request:   <length> <source bytes>                             */
+/*           Reply:     <status> <code length> <diagnostics length>         */
+/*                      <listing length> <code> <diagnostics> <listing>     */
+/*                                                                          */
+/*       Status is 0 if the program is valid and 1 if it is not.  The code  */
+/*       is the code file and the diagnostics are what comp1 would have     */
+/*       printed on standard output.                                        */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef SERVE_H
+#define SERVE_H
+
+#include <stddef.h>
+#include "global.h"
+
+#define MAXREQUEST (64L * 1024 * 1024) /*  Largest source accepted.   */
+
+typedef struct
+{
+    int status;
+    char *code; /*  Each buffer is owned by the compile function */
+    size_t codeLength; /*  and must stay valid until the next call. */
+    char *diagnostics;
+    size_t diagnosticsLength;
+    char *listing;
+    size_t listingLength;
+} SERVEREPLY;
+
+typedef int (*SERVEFN)(void *arg, char *source, size_t length, SERVEREPLY *reply);
+
+PUBLIC int Serve(char *path, SERVEFN compile, void *arg);
+
+#endif
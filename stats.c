@@ -0,0 +1,274 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       stats.c                                                            */
+/*                                                                          */
+/*       Compiler instrumentation.  See "stats.h".                          */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "global.h"
+#include "listing.h"
+#include "stats.h"
+
+PRIVATE char *PhaseNames[STAT_PHASES] = {"parse", "scan", "symbols", "emit"};
+PRIVATE char *CounterNames[STAT_COUNTERS] = {"tokens", "probes", "enters",
+                                             "instructions", "backpatches", "recoveries",
+                                             "inlined", "swapped", "unrolled", "removed"};
+
+PRIVATE double Seconds(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ShareCpu: Reads the CPU clock and shares the CPU time used since it    */
+/*  was last read among the phases, in proportion to their wall time.      */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void ShareCpu(STATS *stats)
+{
+    double now, used, wall = 0;
+    int i;
+
+    now = Seconds(CLOCK_THREAD_CPUTIME_ID);
+    used = now - stats->lastCpu;
+    stats->lastCpu = now;
+    for (i = 0; i < STAT_PHASES; i++)
+        wall += stats->unshared[i];
+    for (i = 0; i < STAT_PHASES; i++)
+    {
+        if (wall > 0)
+            stats->cpu[i] += used * stats->unshared[i] / wall;
+        stats->unshared[i] = 0;
+    }
+    stats->changes = 0;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  StartStats: Clears the counters and starts charging time to parsing.   */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void StartStats(STATS *stats, int timed)
+{
+    memset(stats, 0, sizeof(STATS));
+    stats->timed = timed;
+    stats->phase = STAT_PARSE;
+    if (timed)
+    {
+        stats->lastWall = Seconds(CLOCK_MONOTONIC);
+        stats->lastCpu = Seconds(CLOCK_THREAD_CPUTIME_ID);
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Charge: Charges the wall time since the last change to the current     */
+/*  phase.                                                                  */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Charge(STATS *stats)
+{
+    double now = Seconds(CLOCK_MONOTONIC);
+
+    stats->wall[stats->phase] += now - stats->lastWall;
+    stats->unshared[stats->phase] += now - stats->lastWall;
+    stats->lastWall = now;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  EnterPhase: Makes "phase" the one time is charged to.  Returns the     */
+/*  phase it replaced, for the caller to go back to.                        */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int EnterPhase(STATS *stats, int phase)
+{
+    int previous = stats->phase;
+
+    if (stats->timed && phase != previous)
+    {
+        Charge(stats);
+        if (++stats->changes == STATS_CPU_PERIOD)
+            ShareCpu(stats);
+    }
+    stats->phase = phase;
+    return previous;
+}
+
+PUBLIC void StopStats(STATS *stats)
+{
+    if (!stats->timed)
+        return;
+    Charge(stats);
+    ShareCpu(stats);
+    stats->timed = 0;
+}
+
+PRIVATE void WriteJsonString(FILE *f, char *s)
+{
+    putc('"', f);
+    for (; *s != '\0'; s++)
+    {
+        if (*s == '"' || *s == '\\')
+            fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < ' ')
+            fprintf(f, "\\u%04x", *s);
+        else
+            putc(*s, f);
+    }
+    putc('"', f);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  WriteStats:  Reports the counters and phase times of one compilation.   */
+/*                                                                          */
+/*    Inputs:       1) Report file.                                         */
+/*                  2) Statistics, stopped.                                 */
+/*                  3) Name of the unit compiled.                           */
+/*                  4) STATS_TEXT, or STATS_JSON for one JSON object on a   */
+/*                     line of its own.                                     */
+/*                                                                          */
+/*    Outputs:      The report.                                             */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void WriteStats(FILE *f, STATS *stats, char *unit, int format)
+{
+    double wall = 0, cpu = 0;
+    int i;
+
+    for (i = 0; i < STAT_PHASES; i++)
+    {
+        wall += stats->wall[i];
+        cpu += stats->cpu[i];
+    }
+
+    if (format == STATS_JSON)
+    {
+        fprintf(f, "{\"unit\":");
+        WriteJsonString(f, unit);
+        fprintf(f, ",\"phases\":{");
+        for (i = 0; i < STAT_PHASES; i++)
+            fprintf(f, "%s\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}", i > 0 ? "," : "",
+                    PhaseNames[i], stats->wall[i], stats->cpu[i]);
+        fprintf(f, "},\"total\":{\"wall\":%.6f,\"cpu\":%.6f},\"counts\":{", wall, cpu);
+        for (i = 0; i < STAT_COUNTERS; i++)
+            fprintf(f, "%s\"%s\":%ld", i > 0 ? "," : "", CounterNames[i], stats->counts[i]);
+        fprintf(f, "}}\n");
+        return;
+    }
+
+    fprintf(f, "Statistics for %s\n", unit);
+    fprintf(f, "  %-12s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+    for (i = 0; i < STAT_PHASES; i++)
+        fprintf(f, "  %-12s %12.3f %12.3f\n", PhaseNames[i], stats->wall[i] * 1e3, stats->cpu[i] * 1e3);
+    fprintf(f, "  %-12s %12.3f %12.3f\n", "total", wall * 1e3, cpu * 1e3);
+    for (i = 0; i < STAT_COUNTERS; i++)
+        fprintf(f, "  %-12s %12ld\n", CounterNames[i], stats->counts[i]);
+}
+
+PUBLIC double StatsClock(void)
+{
+    return Seconds(CLOCK_MONOTONIC);
+}
+
+PUBLIC void WriteProcReportHeader(FILE *f)
+{
+    fprintf(f, "unit\tname\tdepth\tfirst_line\tlast_line\tfirst_offset\tlast_offset\t"
+               "ms\tself_ms\tinstructions\tself_instructions\tpeak_scope\tcached\n");
+}
+
+PRIVATE int BySource(const void *a, const void *b)
+{
+    return (*(PROCSTAT **)a)->first - (*(PROCSTAT **)b)->first;
+}
+
+PRIVATE int ByName(const void *a, const void *b)
+{
+    int order = strcmp((*(PROCSTAT **)a)->name, (*(PROCSTAT **)b)->name);
+
+    return order != 0 ? order : BySource(a, b);
+}
+
+PRIVATE int ByTime(const void *a, const void *b)
+{
+    double d = ((*(PROCSTAT **)b)->seconds - (*(PROCSTAT **)b)->nestedSeconds) -
+               ((*(PROCSTAT **)a)->seconds - (*(PROCSTAT **)a)->nestedSeconds);
+
+    return d > 0 ? 1 : d < 0 ? -1 : BySource(a, b);
+}
+
+PRIVATE int BySize(const void *a, const void *b)
+{
+    int d = ((*(PROCSTAT **)b)->instructions - (*(PROCSTAT **)b)->nestedInstructions) -
+            ((*(PROCSTAT **)a)->instructions - (*(PROCSTAT **)a)->nestedInstructions);
+
+    return d != 0 ? d : BySource(a, b);
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  WriteProcReport:  Writes one line per procedure of one compilation.     */
+/*                                                                          */
+/*    Inputs:       1) Report file.                                         */
+/*                  2) Procedure statistics, in declaration order.          */
+/*                  3) Name of the unit compiled.                           */
+/*                  4) Source text and its length, for line numbers; with   */
+/*                     no source the lines are reported as 0.               */
+/*                  5) PROCSORT_ order; time and size sort by the "self"    */
+/*                     columns.                                             */
+/*                                                                          */
+/*    Outputs:      The report lines, without a header.                     */
+/*                                                                          */
+/*    Returns:      Nothing                                                 */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void WriteProcReport(FILE *f, PROCSTAT *procs, int count, char *unit,
+                            char *source, size_t length, int sort)
+{
+    PROCSTAT **order;
+    PROCSTAT *p;
+    int *newlines = NULL;
+    int i, lines = 0;
+
+    if (count == 0 || NULL == (order = malloc(count * sizeof(PROCSTAT *))))
+        return;
+    for (i = 0; i < count; i++)
+        order[i] = &procs[i];
+    if (sort == PROCSORT_NAME)
+        qsort(order, count, sizeof(PROCSTAT *), ByName);
+    else if (sort == PROCSORT_TIME)
+        qsort(order, count, sizeof(PROCSTAT *), ByTime);
+    else if (sort == PROCSORT_SIZE)
+        qsort(order, count, sizeof(PROCSTAT *), BySize);
+
+    if (source != NULL)
+        newlines = IndexLines(source, length, &lines);
+
+    for (i = 0; i < count; i++)
+    {
+        p = order[i];
+        fprintf(f, "%s\t%s\t%d\t%d\t%d\t%d\t%d\t%.3f\t%.3f\t%d\t%d\t%d\t%d\n", unit, p->name, p->depth,
+                newlines != NULL ? LineOf(newlines, lines, p->first) : 0,
+                newlines != NULL ? LineOf(newlines, lines, p->last) : 0,
+                p->first, p->last, p->seconds * 1e3, (p->seconds - p->nestedSeconds) * 1e3,
+                p->instructions, p->instructions - p->nestedInstructions, p->peakScope, p->cached);
+    }
+    free(newlines);
+    free(order);
+}
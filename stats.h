@@ -0,0 +1,112 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       stats.h                                                            */
+/*                                                                          */
+/*       Compiler instrumentation.  Time is charged to one phase at a       */
+/*       time: the parser calls EnterPhase() around scanning, symbol table  */
+/*       and code emission work, and everything else counts as parsing.     */
+/*                                                                          */
+/*       Counters are always kept; they cost an increment each.  Phase      */
+/*       times are only taken when asked for, with one read of the          */
+/*       monotonic clock per phase change.  Reading the CPU clock costs a   */
+/*       system call, so it is read every STATS_CPU_PERIOD changes and the  */
+/*       CPU time in between is shared out by each phase's wall time.       */
+/*                                                                          */
+/*       Children forked by --proc-jobs are not measured.                   */
+/*                                                                          */
+/*       The procedure report has one PROCSTAT per procedure declaration,   */
+/*       nested ones included, written as tab-separated lines under a       */
+/*       header line:                                                       */
+/*                                                                          */
+/*           unit name depth first_line last_line first_offset last_offset  */
+/*           ms self_ms instructions self_instructions peak_scope cached    */
+/*                                                                          */
+/*       Times and instruction counts include nested procedures; the        */
+/*       "self" columns leave them out.  The span runs from PROCEDURE to    */
+/*       the ";" that ends the declaration.                                 */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "global.h"
+
+#define STATS_OFF 0    /*  Values of --stats.                           */
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+#define STAT_PARSE 0   /*  Phases.                                      */
+#define STAT_SCAN 1
+#define STAT_SYMBOLS 2
+#define STAT_EMIT 3
+#define STAT_PHASES 4
+
+#define STAT_TOKENS 0  /*  Counters.                                    */
+#define STAT_PROBES 1
+#define STAT_ENTERS 2
+#define STAT_INSTRUCTIONS 3
+#define STAT_BACKPATCHES 4
+#define STAT_RECOVERIES 5
+#define STAT_INLINED 6 /*  Changes made by --profile, --unroll and      */
+#define STAT_SWAPPED 7 /*  --dead-code.                                 */
+#define STAT_UNROLLED 8
+#define STAT_REMOVED 9
+#define STAT_COUNTERS 10
+
+#define STATS_CPU_PERIOD 64
+
+#define PROCSORT_SOURCE 0  /*  Values of --proc-sort.                    */
+#define PROCSORT_NAME 1
+#define PROCSORT_TIME 2    /*  Largest first.                            */
+#define PROCSORT_SIZE 3
+
+#define COUNT_STAT(stats, counter) ((stats)->counts[counter]++)
+
+typedef struct
+{
+    int timed;                  /*  Phase times are being taken.        */
+    int phase;                  /*  Phase being charged now.            */
+    int changes;                /*  Phase changes since the CPU clock was read. */
+    double lastWall;            /*  Clock readings at the last change.  */
+    double lastCpu;
+    double wall[STAT_PHASES];   /*  Seconds charged to each phase.      */
+    double cpu[STAT_PHASES];
+    double unshared[STAT_PHASES]; /*  Wall time not yet matched with CPU time. */
+    long counts[STAT_COUNTERS];
+} STATS;
+
+typedef struct
+{
+    char *name;            /*  "?" if the heading was in error.         */
+    int depth;             /*  Scope it is declared in; 1 is top level. */
+    int parent;            /*  Index of the enclosing procedure, or -1. */
+    int first;             /*  Source offsets of PROCEDURE and the ";". */
+    int last;
+    double started;        /*  StatsClock() and code address when it    */
+    int address;           /*  started.                                 */
+    double seconds;
+    double nestedSeconds;  /*  Part of "seconds" spent in nested ones.  */
+    int instructions;
+    int nestedInstructions;
+    int peakScope;         /*  Deepest scope opened inside it.          */
+    int cached;            /*  Code came from the --incremental cache.  */
+} PROCSTAT;
+
+PUBLIC void StartStats(STATS *stats, int timed);
+PUBLIC int EnterPhase(STATS *stats, int phase);
+PUBLIC void StopStats(STATS *stats);
+PUBLIC void WriteStats(FILE *f, STATS *stats, char *unit, int format);
+PUBLIC double StatsClock(void);
+PUBLIC void WriteProcReportHeader(FILE *f);
+PUBLIC void WriteProcReport(FILE *f, PROCSTAT *procs, int count, char *unit,
+                            char *source, size_t length, int sort);
+
+#endif
@@ -0,0 +1,60 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       libtest.c                                                          */
+/*                                                                          */
+/*       Compiles each test program with CompileBuffer() and checks the     */
+/*       verdict.  Linked with comp1.c built with CPL_LIBRARY defined.      */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "cpl.h"
+
+typedef struct
+{
+    char *name;
+    char *source;
+    int valid;
+} CASE;
+
+PRIVATE CASE Cases[] = {
+    {"valid", "PROGRAM p;\nBEGIN\n    WRITE(1);\nEND.\n", 1},
+    {"token error", "PROGRAM p;\nBEGIN\n    WRITE(1)\nEND.\n", 0},
+    {"statement error", "PROGRAM p;\nBEGIN\n    5;\n    WRITE(1);\nEND.\n", 0},
+};
+
+int main(void)
+{
+    CPLRESULT result;
+    int i, failed = 0;
+
+    for (i = 0; i < (int)(sizeof(Cases) / sizeof(Cases[0])); i++)
+    {
+        if (!CompileBuffer(Cases[i].source, strlen(Cases[i].source), 0, &result))
+        {
+            fprintf(stderr, "%s: cannot compile\n", Cases[i].name);
+            return EXIT_FAILURE;
+        }
+        if (result.valid != Cases[i].valid)
+        {
+            printf("%s: valid %d, expected %d\n", Cases[i].name, result.valid, Cases[i].valid);
+            failed++;
+        }
+        if (!result.valid && result.diagnosticCount == 0)
+        {
+            printf("%s: invalid with no diagnostics\n", Cases[i].name);
+            failed++;
+        }
+        FreeCompileResult(&result);
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
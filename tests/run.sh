@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# Builds comp1 and the test programs in a scratch directory and runs them.
+# CPLLIB names the directory holding the course library's headers and
+# compiled objects.
+#
+set -e
+cd "$(dirname "$0")/.."
+: "${CPLLIB:?set CPLLIB to the course library directory}"
+CC=${CC:-cc}
+out=$(mktemp -d)
+trap 'kill $server 2>/dev/null; rm -rf "$out"' EXIT
+sources=$(ls *.c | grep -v '^\(comp1\|parser1\|parser2\|llgen\|cpllink\|cplprof\|cplfuzz\)\.c$')
+build() { $CC -I. -I"$CPLLIB" "$@" "$CPLLIB"/*.o -lpthread; }
+
+build -o "$out/comp1" comp1.c $sources
+build -o "$out/servetest" tests/servetest.c
+build -o "$out/libtest" -DCPL_LIBRARY comp1.c $sources tests/libtest.c
+
+"$out/libtest"
+
+"$out/comp1" --serve "$out/socket" &
+server=$!
+while [ ! -S "$out/socket" ]; do kill -0 $server; sleep 0.1; done
+"$out/servetest" "$out/socket"
+
+# A block inside a procedure's body is a scope deeper than the body.
+cat > "$out/nested.prog" <<'END'
+PROGRAM p;
+PROCEDURE q;
+BEGIN
+    IF 1 > 0 THEN BEGIN
+        WRITE(1);
+    END;
+END;
+BEGIN
+    q;
+END.
+END
+# The second incremental build replays q and must report the same.
+for pass in parsed stored replayed; do
+    [ $pass = parsed ] && cache= || cache="--incremental $out/cache"
+    "$out/comp1" $cache --proc-report "$out/report" "$out/nested.prog" "$out/nested.lst" "$out/nested.code" > /dev/null
+    peak=$(awk -F '\t' '$2 == "q" { print $12 }' "$out/report")
+    if [ "$peak" != 4 ]; then
+        echo "procedure report, $pass: peak_scope of q is \"$peak\", expected 4"
+        exit 1
+    fi
+done
+
+echo "all tests passed"
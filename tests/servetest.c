@@ -0,0 +1,101 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       servetest.c                                                        */
+/*                                                                          */
+/*       Sends each test program to a "comp1 --serve" socket, named on the  */
+/*       command line, and checks the status of the reply.                  */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include "global.h"
+
+typedef struct
+{
+    char *name;
+    char *source;
+    unsigned int status; /*  0 if the program is valid, 1 if not.        */
+} CASE;
+
+PRIVATE CASE Cases[] = {
+    {"valid", "PROGRAM p;\nBEGIN\n    WRITE(1);\nEND.\n", 0},
+    {"token error", "PROGRAM p;\nBEGIN\n    WRITE(1)\nEND.\n", 1},
+    {"statement error", "PROGRAM p;\nBEGIN\n    5;\n    WRITE(1);\nEND.\n", 1},
+};
+
+PRIVATE int Transfer(int fd, void *buffer, size_t n, int sending)
+{
+    char *p = buffer;
+    ssize_t done;
+
+    while (n > 0)
+    {
+        if ((done = sending ? write(fd, p, n) : read(fd, p, n)) <= 0)
+            return 0;
+        p += done;
+        n -= done;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un address;
+    unsigned int word, reply[4];
+    size_t length, rest;
+    char discard[256];
+    int fd, i, j, failed = 0;
+
+    if (argc != 2 || strlen(argv[1]) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "%s <socket>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, argv[1]);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+        connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        fprintf(stderr, "cannot connect to \"%s\"\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < (int)(sizeof(Cases) / sizeof(Cases[0])); i++)
+    {
+        length = strlen(Cases[i].source);
+        word = htonl((unsigned int)length);
+        if (!Transfer(fd, &word, sizeof(word), 1) || !Transfer(fd, Cases[i].source, length, 1) ||
+            !Transfer(fd, reply, sizeof(reply), 0))
+        {
+            fprintf(stderr, "%s: no reply\n", Cases[i].name);
+            return EXIT_FAILURE;
+        }
+        for (j = 1; j < 4; j++)
+            for (rest = ntohl(reply[j]); rest > 0; rest -= length)
+            {
+                length = rest < sizeof(discard) ? rest : sizeof(discard);
+                if (!Transfer(fd, discard, length, 0))
+                    return EXIT_FAILURE;
+            }
+        if (ntohl(reply[0]) != Cases[i].status)
+        {
+            printf("%s: status %u, expected %u\n", Cases[i].name, ntohl(reply[0]), Cases[i].status);
+            failed++;
+        }
+    }
+    close(fd);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,160 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       tokbuf.c                                                           */
+/*                                                                          */
+/*       Token buffer and string arena.  See "tokbuf.h".                    */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "global.h"
+#include "scanner.h"
+#include "tokbuf.h"
+
+#define ARENA_BLOCK_SIZE 8192
+#define INITIAL_TOKENS 256
+
+PRIVATE void *Allocate(void *old, size_t size)
+{
+    void *p;
+
+    if (NULL == (p = realloc(old, size)))
+    {
+        fprintf(stderr, "out of memory in token buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
+
+PUBLIC void InitArena(ARENA *arena)
+{
+    arena->blocks = NULL;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ArenaString: Returns a copy of "s" that stays valid until the arena is */
+/*  freed.                                                                  */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC char *ArenaString(ARENA *arena, char *s)
+{
+    ARENABLOCK *block;
+    size_t length, size;
+    char *copy;
+
+    length = strlen(s) + 1;
+    block = arena->blocks;
+    if (block == NULL || block->size - block->used < length)
+    {
+        size = length > ARENA_BLOCK_SIZE ? length : ARENA_BLOCK_SIZE;
+        block = Allocate(NULL, sizeof(ARENABLOCK) + size);
+        block->next = arena->blocks;
+        block->used = 0;
+        block->size = size;
+        arena->blocks = block;
+    }
+
+    copy = block->data + block->used;
+    memcpy(copy, s, length);
+    block->used += length;
+    return copy;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  ResetArena: Forgets every string in the arena.  The newest block is    */
+/*  kept for reuse and the rest are freed.                                  */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void ResetArena(ARENA *arena)
+{
+    ARENABLOCK *block, *next;
+
+    if (arena->blocks == NULL)
+        return;
+    for (block = arena->blocks->next; block != NULL; block = next)
+    {
+        next = block->next;
+        free(block);
+    }
+    arena->blocks->next = NULL;
+    arena->blocks->used = 0;
+}
+
+PUBLIC void FreeArena(ARENA *arena)
+{
+    ARENABLOCK *block, *next;
+
+    for (block = arena->blocks; block != NULL; block = next)
+    {
+        next = block->next;
+        free(block);
+    }
+    arena->blocks = NULL;
+}
+
+PUBLIC void InitTokenBuffer(TOKENBUF *tb, ARENA *arena)
+{
+    tb->tokens = NULL;
+    tb->count = 0;
+    tb->next = 0;
+    tb->capacity = 0;
+    tb->arena = arena;
+}
+
+PUBLIC void ClearTokenBuffer(TOKENBUF *tb)
+{
+    tb->count = 0;
+    tb->next = 0;
+}
+
+PUBLIC void FreeTokenBuffer(TOKENBUF *tb)
+{
+    free(tb->tokens);
+    InitTokenBuffer(tb, tb->arena);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  AppendToken: Adds a token to the end of the buffer, copying its        */
+/*  identifier string into the arena.                                       */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC void AppendToken(TOKENBUF *tb, TOKEN token)
+{
+    if (tb->count == tb->capacity)
+    {
+        tb->capacity = tb->capacity == 0 ? INITIAL_TOKENS : tb->capacity * 2;
+        tb->tokens = Allocate(tb->tokens, tb->capacity * sizeof(TOKEN));
+    }
+
+    if (token.code == IDENTIFIER && token.s != NULL)
+        token.s = ArenaString(tb->arena, token.s);
+    tb->tokens[tb->count++] = token;
+}
+
+PUBLIC int TokensPending(TOKENBUF *tb)
+{
+    return tb->next < tb->count;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  NextBufferedToken: Hands back the next buffered token.  The buffer is  */
+/*  emptied once the last one has been taken.                               */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC TOKEN NextBufferedToken(TOKENBUF *tb)
+{
+    TOKEN token;
+
+    token = tb->tokens[tb->next++];
+    if (tb->next == tb->count)
+        ClearTokenBuffer(tb);
+    return token;
+}
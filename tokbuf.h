@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       tokbuf.h                                                           */
+/*                                                                          */
+/*       Token buffer, used when the parser needs to read ahead over a      */
+/*       whole construct before deciding how to handle it.  Buffered        */
+/*       tokens are handed back to the parser in order, ahead of any        */
+/*       further tokens from GetToken().                                    */
+/*                                                                          */
+/*       Identifier strings returned by the scanner only live until the     */
+/*       next identifier is read, so buffered tokens point at copies held   */
+/*       in an ARENA that lasts for the whole compilation.                  */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef TOKBUF_H
+#define TOKBUF_H
+
+#include <stddef.h>
+#include "global.h"
+#include "scanner.h"
+
+typedef struct arenablock
+{
+    struct arenablock *next;
+    size_t used;
+    size_t size;
+    char data[1];
+} ARENABLOCK;
+
+typedef struct
+{
+    ARENABLOCK *blocks; /*  Most recently allocated block first.     */
+} ARENA;
+
+typedef struct
+{
+    TOKEN *tokens; /*  Buffered tokens.                              */
+    int count;     /*  Number of tokens in the buffer.               */
+    int next;      /*  Index of the next token to hand back.         */
+    int capacity;  /*  Allocated size of "tokens".                   */
+    ARENA *arena;  /*  Where identifier strings are copied to.       */
+} TOKENBUF;
+
+PUBLIC void InitArena(ARENA *arena);
+PUBLIC char *ArenaString(ARENA *arena, char *s);
+PUBLIC void ResetArena(ARENA *arena);
+PUBLIC void FreeArena(ARENA *arena);
+
+PUBLIC void InitTokenBuffer(TOKENBUF *tb, ARENA *arena);
+PUBLIC void ClearTokenBuffer(TOKENBUF *tb);
+PUBLIC void FreeTokenBuffer(TOKENBUF *tb);
+PUBLIC void AppendToken(TOKENBUF *tb, TOKEN token);
+PUBLIC int TokensPending(TOKENBUF *tb);
+PUBLIC TOKEN NextBufferedToken(TOKENBUF *tb);
+
+#endif
@@ -0,0 +1,279 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       workpool.c                                                         */
+/*                                                                          */
+/*       Fixed pool of worker processes with work-stealing scheduling.     */
+/*       See "workpool.h".                                                  */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "global.h"
+#include "workpool.h"
+
+#define MAXPATH 4096
+
+typedef struct
+{
+    volatile int lock; /*  Spinlock guarding head and tail.          */
+    int head;          /*  Next unit the owner takes.                */
+    int tail;          /*  One past the last unit; thieves take here. */
+} DEQUE;
+
+typedef struct
+{
+    int workers;
+    int perWorker; /*  Deque capacity; deque w owns slots[w * perWorker ...]. */
+    DEQUE *deques;
+    int *slots;
+    int *status;
+} POOL;
+
+PRIVATE long *SortWeights; /*  Only used while sorting.           */
+
+PRIVATE int HeaviestFirst(const void *a, const void *b)
+{
+    long wa = SortWeights[*(const int *)a], wb = SortWeights[*(const int *)b];
+
+    if (wa != wb)
+        return wa > wb ? -1 : 1;
+    return *(const int *)a - *(const int *)b;
+}
+
+PRIVATE void Lock(DEQUE *d)
+{
+    while (__sync_lock_test_and_set(&d->lock, 1))
+        ;
+}
+
+PRIVATE void Unlock(DEQUE *d)
+{
+    __sync_lock_release(&d->lock);
+}
+
+/*--------------------------------------------------------------------------*/
+/*  TakeOwn: Pops the front of worker w's own deque, or returns -1.        */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int TakeOwn(POOL *pool, int w)
+{
+    DEQUE *d = &pool->deques[w];
+    int unit = -1;
+
+    Lock(d);
+    if (d->head < d->tail)
+        unit = pool->slots[w * pool->perWorker + d->head++];
+    Unlock(d);
+    return unit;
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Steal: Takes the back of the fullest other deque, or returns -1 once   */
+/*  every deque is empty.                                                   */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE int Steal(POOL *pool, int w)
+{
+    DEQUE *d;
+    int victim, best, most, left, i, unit;
+
+    for (;;)
+    {
+        best = -1;
+        most = 0;
+        for (i = 1; i < pool->workers; i++)
+        {
+            victim = (w + i) % pool->workers;
+            left = pool->deques[victim].tail - pool->deques[victim].head;
+            if (left > most)
+            {
+                most = left;
+                best = victim;
+            }
+        }
+        if (best < 0)
+            return -1;
+
+        d = &pool->deques[best];
+        unit = -1;
+        Lock(d);
+        if (d->head < d->tail)
+            unit = pool->slots[best * pool->perWorker + --d->tail];
+        Unlock(d);
+        if (unit >= 0)
+            return unit;
+    }
+}
+
+/*--------------------------------------------------------------------------*/
+/*  Worker: Runs units until there are none left anywhere, with stdout and */
+/*  stderr sent to a per-unit capture file in "dir".                        */
+/*--------------------------------------------------------------------------*/
+
+PRIVATE void Worker(POOL *pool, int w, char *dir, WORKFN work, void *arg)
+{
+    char path[MAXPATH];
+    int unit, fd;
+
+    while ((unit = TakeOwn(pool, w)) >= 0 || (unit = Steal(pool, w)) >= 0)
+    {
+        fflush(stdout);
+        fflush(stderr);
+        snprintf(path, MAXPATH, "%s/%d", dir, unit);
+        if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600)) >= 0)
+        {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        pool->status[unit] = work(unit, arg);
+        fflush(stdout);
+        fflush(stderr);
+    }
+}
+
+PRIVATE void CopyCapture(char *dir, int unit)
+{
+    char path[MAXPATH], buffer[8192];
+    FILE *f;
+    size_t n;
+
+    snprintf(path, MAXPATH, "%s/%d", dir, unit);
+    if (NULL == (f = fopen(path, "r")))
+        return;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        fwrite(buffer, 1, n, stdout);
+    fclose(f);
+    remove(path);
+}
+
+PUBLIC int DefaultWorkers(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? (int)n : 1;
+}
+
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*  RunWorkPool:  Runs work(unit, arg) for every unit in [0, units) on      */
+/*                "workers" processes.                                      */
+/*                                                                          */
+/*    Inputs:       1) Number of units.                                     */
+/*                  2) Weight of each unit (e.g. source size); heavier     */
+/*                     units are started first.                             */
+/*                  3) Number of worker processes.                          */
+/*                  4) Work function and its argument.  The function runs  */
+/*                     in a worker, so only its return value gets back.     */
+/*                                                                          */
+/*    Outputs:      status[unit] is work's return value, or UNIT_NOT_RUN.   */
+/*                                                                          */
+/*    Returns:      Boolean success flag (i.e., an "int":  1 or 0); 0 if   */
+/*                  the pool could not be started or a worker died.         */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+PUBLIC int RunWorkPool(int units, long *weights, int workers,
+                       WORKFN work, void *arg, int *status)
+{
+    POOL pool;
+    char dir[] = "/tmp/comp1.XXXXXX";
+    int *order;
+    pid_t *pids;
+    size_t shared;
+    void *base;
+    int w, i, wstatus, ok = 1;
+
+    if (units == 0)
+        return 1;
+    if (workers > units)
+        workers = units;
+    if (workers < 1)
+        workers = 1;
+
+    pool.workers = workers;
+    pool.perWorker = (units + workers - 1) / workers;
+    shared = workers * sizeof(DEQUE) + (size_t)workers * pool.perWorker * sizeof(int) + units * sizeof(int);
+    base = mmap(NULL, shared, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    order = malloc(units * sizeof(int));
+    pids = malloc(workers * sizeof(pid_t));
+    /*  The directory is made last, so there is none to remove here.   */
+    if (base == MAP_FAILED || order == NULL || pids == NULL || NULL == mkdtemp(dir))
+    {
+        fprintf(stderr, "cannot start worker pool\n");
+        if (base != MAP_FAILED)
+            munmap(base, shared);
+        free(order);
+        free(pids);
+        return 0;
+    }
+    pool.deques = base;
+    pool.slots = (int *)(pool.deques + workers);
+    pool.status = pool.slots + workers * pool.perWorker;
+
+    /*  Deal the units, heaviest first, round-robin onto the deques.    */
+    for (i = 0; i < units; i++)
+    {
+        order[i] = i;
+        pool.status[i] = UNIT_NOT_RUN;
+    }
+    SortWeights = weights;
+    qsort(order, units, sizeof(int), HeaviestFirst);
+    for (w = 0; w < workers; w++)
+    {
+        pool.deques[w].lock = 0;
+        pool.deques[w].head = 0;
+        pool.deques[w].tail = 0;
+    }
+    for (i = 0; i < units; i++)
+    {
+        w = i % workers;
+        pool.slots[w * pool.perWorker + pool.deques[w].tail++] = order[i];
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    for (w = 0; w < workers; w++)
+    {
+        if ((pids[w] = fork()) == 0)
+        {
+            Worker(&pool, w, dir, work, arg);
+            _exit(EXIT_SUCCESS);
+        }
+        /*  If a fork fails, the workers that did start steal that      */
+        /*  worker's share; units nobody ran show up as UNIT_NOT_RUN.   */
+    }
+    for (w = 0; w < workers; w++)
+    {
+        if (pids[w] > 0 && (waitpid(pids[w], &wstatus, 0) < 0 ||
+                            !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != EXIT_SUCCESS))
+            ok = 0;
+    }
+
+    for (i = 0; i < units; i++)
+    {
+        CopyCapture(dir, i);
+        status[i] = pool.status[i];
+        if (status[i] == UNIT_NOT_RUN)
+            ok = 0;
+    }
+    fflush(stdout);
+
+    rmdir(dir);
+    munmap(base, shared);
+    free(order);
+    free(pids);
+    return ok;
+}
@@ -0,0 +1,38 @@
+/*--------------------------------------------------------------------------*/
+/*                                                                          */
+/*       workpool.h                                                         */
+/*                                                                          */
+/*       Fixed pool of worker processes with work-stealing scheduling.      */
+/*       Units are sorted heaviest first and dealt round-robin onto one     */
+/*       deque per worker.  A worker takes from the front of its own deque  */
+/*       and, once that is empty, steals from the back of the fullest       */
+/*       other deque.  Workers are processes rather than threads because   */
+/*       the scanner, symbol table and code generator are single instances */
+/*       per process.                                                       */
+/*                                                                          */
+/*       Everything a unit writes to stdout or stderr is captured and       */
+/*       written out in unit order once all workers have finished, so the   */
+/*       output does not depend on the schedule.                            */
+/*                                                                          */
+/*                                                                          */
+/*       Group Members:          ID numbers                                 */
+/*                                                                          */
+/*           Ian Burke            13122525                                  */
+/*           Lorcan Chinnock      14174103                                  */
+/*                                                                          */
+/*--------------------------------------------------------------------------*/
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include "global.h"
+
+#define UNIT_NOT_RUN -1 /*  Status of a unit whose worker died.      */
+
+typedef int (*WORKFN)(int unit, void *arg);
+
+PUBLIC int DefaultWorkers(void);
+PUBLIC int RunWorkPool(int units, long *weights, int workers,
+                       WORKFN work, void *arg, int *status);
+
+#endif